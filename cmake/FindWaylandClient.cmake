@@ -0,0 +1,17 @@
+# rules for finding the Wayland client library and the wayland-scanner tool
+
+find_package(PkgConfig REQUIRED)
+pkg_check_modules(PC_WAYLANDCLIENT wayland-client)
+pkg_check_modules(PC_WAYLANDSCANNER wayland-scanner)
+
+find_path(WAYLANDCLIENT_INCLUDE_DIR wayland-client.h HINTS ${PC_WAYLANDCLIENT_INCLUDEDIR} ${PC_WAYLANDCLIENT_INCLUDE_DIRS})
+find_library(WAYLANDCLIENT_LIBRARY NAMES wayland-client HINTS ${PC_WAYLANDCLIENT_LIBDIR} ${PC_WAYLANDCLIENT_LIBRARY_DIRS})
+find_program(WAYLAND_SCANNER_EXECUTABLE NAMES wayland-scanner HINTS ${PC_WAYLANDSCANNER_PREFIX}/bin)
+
+include(FindPackageHandleStandardArgs)
+find_package_handle_standard_args(WaylandClient DEFAULT_MSG WAYLANDCLIENT_LIBRARY WAYLANDCLIENT_INCLUDE_DIR WAYLAND_SCANNER_EXECUTABLE)
+
+mark_as_advanced(WAYLANDCLIENT_INCLUDE_DIR WAYLANDCLIENT_LIBRARY WAYLAND_SCANNER_EXECUTABLE)
+
+set(WAYLANDCLIENT_INCLUDE_DIRS ${WAYLANDCLIENT_INCLUDE_DIR})
+set(WAYLANDCLIENT_LIBRARIES ${WAYLANDCLIENT_LIBRARY})
@@ -0,0 +1,16 @@
+# rules for finding the XCB and XCB-SHM libraries
+
+find_package(PkgConfig REQUIRED)
+pkg_check_modules(PC_XCBSHM xcb xcb-shm)
+
+find_path(XCBSHM_INCLUDE_DIR xcb/shm.h HINTS ${PC_XCBSHM_INCLUDEDIR} ${PC_XCBSHM_INCLUDE_DIRS})
+find_library(XCBSHM_XCB_LIBRARY NAMES xcb HINTS ${PC_XCBSHM_LIBDIR} ${PC_XCBSHM_LIBRARY_DIRS})
+find_library(XCBSHM_SHM_LIBRARY NAMES xcb-shm HINTS ${PC_XCBSHM_LIBDIR} ${PC_XCBSHM_LIBRARY_DIRS})
+
+include(FindPackageHandleStandardArgs)
+find_package_handle_standard_args(XCBShm DEFAULT_MSG XCBSHM_XCB_LIBRARY XCBSHM_SHM_LIBRARY XCBSHM_INCLUDE_DIR)
+
+mark_as_advanced(XCBSHM_INCLUDE_DIR XCBSHM_XCB_LIBRARY XCBSHM_SHM_LIBRARY)
+
+set(XCBSHM_INCLUDE_DIRS ${XCBSHM_INCLUDE_DIR})
+set(XCBSHM_LIBRARIES ${XCBSHM_XCB_LIBRARY} ${XCBSHM_SHM_LIBRARY})
@@ -6,7 +6,7 @@ TARGET = GLInject
 TEMPLATE = app
 
 QMAKE_CXXFLAGS += -std=c++0x
-LIBS += -rt -ldl -lGL -lGLU -lX11 -lXfixes
+LIBS += -rt -ldl -lGL -lGLU -lX11
 
 SOURCES += \
 	elfhacks.c \
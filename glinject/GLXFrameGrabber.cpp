@@ -13,7 +13,6 @@ THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES WITH RE
 #include <GL/gl.h>
 #include <GL/glu.h>
 #include <GL/glext.h>
-#include <X11/extensions/Xfixes.h>
 
 #define CGLE(code) \
 	code; \
@@ -59,51 +58,6 @@ static unsigned int GetGLVersion() {
 	return major * 1000 + minor;
 }
 
-static void GLImageDrawCursor(Display* dpy, uint8_t* image_data, size_t image_stride, int image_width, int image_height, int recording_area_x, int recording_area_y) {
-
-	// get the cursor
-	XFixesCursorImage *xcim = XFixesGetCursorImage(dpy);
-	if(xcim == NULL)
-		return;
-
-	// calculate the position of the cursor
-	int x = xcim->x - xcim->xhot - recording_area_x;
-	int y = xcim->y - xcim->yhot - recording_area_y;
-
-	// calculate the part of the cursor that's visible
-	int cursor_left = std::max(0, -x), cursor_right = std::min((int) xcim->width, image_width - x);
-	int cursor_top = std::max(0, -y), cursor_bottom = std::min((int) xcim->height, image_height - y);
-
-	// draw the cursor
-	// XFixesCursorImage uses 'long' instead of 'int' to store the cursor images, which is a bit weird since
-	// 'long' is 64-bit on 64-bit systems and only 32 bits are actually used. The image uses premultiplied alpha.
-	for(int j = cursor_top; j < cursor_bottom; ++j) {
-		unsigned long *cursor_row = xcim->pixels + xcim->width * j;
-		uint8_t *image_row = image_data + image_stride * (image_height - 1 - y - j);
-		for(int i = cursor_left; i < cursor_right; ++i) {
-			unsigned long cursor_pixel = cursor_row[i];
-			uint8_t *image_pixel = image_row + 4 * (x + i);
-			int cursor_a = (uint8_t) (cursor_pixel >> 24);
-			int cursor_r = (uint8_t) (cursor_pixel >> 16);
-			int cursor_g = (uint8_t) (cursor_pixel >> 8);
-			int cursor_b = (uint8_t) (cursor_pixel >> 0);
-			if(cursor_a == 255) {
-				image_pixel[2] = cursor_r;
-				image_pixel[1] = cursor_g;
-				image_pixel[0] = cursor_b;
-			} else {
-				image_pixel[2] = (image_pixel[2] * (255 - cursor_a) + 127) / 255 + cursor_r;
-				image_pixel[1] = (image_pixel[1] * (255 - cursor_a) + 127) / 255 + cursor_g;
-				image_pixel[0] = (image_pixel[0] * (255 - cursor_a) + 127) / 255 + cursor_b;
-			}
-		}
-	}
-
-	// free the cursor
-	XFree(xcim);
-
-}
-
 GLXFrameGrabber::GLXFrameGrabber(Display* display, Window window, GLXDrawable drawable) {
 
 	m_id = ++g_glx_frame_grabber_counter;
@@ -115,6 +69,13 @@ GLXFrameGrabber::GLXFrameGrabber(Display* display, Window window, GLXDrawable dr
 	m_warn_too_small = true;
 	m_warn_too_large = true;
 
+	m_timer_query_context = NULL; // queries will be created when we get the first frame
+	for(unsigned int i = 0; i < GLINJECT_TIMER_QUERIES; ++i) {
+		m_timer_queries[i] = 0;
+		m_timer_query_pending[i] = false;
+	}
+	m_timer_query_pos = 0;
+
 	m_stream_writer = NULL; // will be created when we get the first frame
 
 	try {
@@ -145,21 +106,17 @@ void GLXFrameGrabber::Init() {
 		}
 	}
 
-	// showing the cursor requires XFixes (which should be supported on any modern X server, but let's check it anyway)
-	{
-		int event, error;
-		if(XFixesQueryExtension(m_x11_display, &event, &error)) {
-			m_has_xfixes = true;
-		} else {
-			GLINJECT_PRINT("[GLXFrameGrabber " << m_id << "] Warning: XFixes is not supported by server, the cursor will not be recorded.");
-			m_has_xfixes = false;
-		}
-	}
-
 }
 
 void GLXFrameGrabber::Free() {
 
+	// delete timer queries
+	// this is only possible if the context that owns them is still current, otherwise they are left to the application
+	if(m_timer_query_context != NULL && glXGetCurrentContext() == m_timer_query_context) {
+		CGLE(glDeleteQueries(GLINJECT_TIMER_QUERIES, m_timer_queries));
+		m_timer_query_context = NULL;
+	}
+
 	// destroy stream writer
 	if(m_stream_writer != NULL) {
 		delete m_stream_writer;
@@ -170,8 +127,57 @@ void GLXFrameGrabber::Free() {
 
 }
 
+bool GLXFrameGrabber::InitTimerQueries() {
+
+	// timer queries require OpenGL 3.3
+	if(m_gl_version < 3003)
+		return false;
+
+	// the queries belong to the context, so they have to be recreated when the application switches to a different context
+	// (the old queries can't be deleted since the old context is not current anymore)
+	GLXContext context = glXGetCurrentContext();
+	if(context == NULL)
+		return false;
+	if(context != m_timer_query_context) {
+		CGLE(glGenQueries(GLINJECT_TIMER_QUERIES, m_timer_queries));
+		for(unsigned int i = 0; i < GLINJECT_TIMER_QUERIES; ++i) {
+			m_timer_query_pending[i] = false;
+		}
+		m_timer_query_pos = 0;
+		m_timer_query_context = context;
+	}
+	return true;
+
+}
+
+void GLXFrameGrabber::ReadTimerQueries() {
+	// the results are read a few frames later so the GPU doesn't have to be synchronized with the CPU
+	for(unsigned int i = 0; i < GLINJECT_TIMER_QUERIES; ++i) {
+		if(!m_timer_query_pending[i])
+			continue;
+		GLint available;
+		CGLE(glGetQueryObjectiv(m_timer_queries[i], GL_QUERY_RESULT_AVAILABLE, &available));
+		if(!available)
+			continue;
+		GLuint64 time;
+		CGLE(glGetQueryObjectui64v(m_timer_queries[i], GL_QUERY_RESULT, &time));
+		m_timer_query_pending[i] = false;
+		m_stream_writer->AddGPUOverhead((int64_t) (time / 1000));
+	}
+}
+
 void GLXFrameGrabber::GrabFrame() {
 
+	// measure the time spent in the capture code, excluding the fps limiter (which is intentional)
+	// swaps that don't capture anything are not counted, otherwise they would hide the real cost of a capture
+	int64_t start_time = hrt_time_micro(), wait_time = 0;
+	if(CaptureFrame(&wait_time))
+		m_stream_writer->AddCPUOverhead(hrt_time_micro() - start_time - wait_time);
+
+}
+
+bool GLXFrameGrabber::CaptureFrame(int64_t* wait_time) {
+
 	// create stream writer
 	if(m_stream_writer == NULL) {
 		std::string channel;
@@ -181,6 +187,7 @@ void GLXFrameGrabber::GrabFrame() {
 		std::ostringstream source;
 		source << "glx" << std::setw(4) << std::setfill('0') << m_id;
 		m_stream_writer = new SSRVideoStreamWriter(channel, source.str());
+		m_stream_writer->SetWindowID(m_x11_window);
 	}
 
 	// get the OpenGL version
@@ -204,21 +211,27 @@ void GLXFrameGrabber::GrabFrame() {
 			m_warn_too_small = false;
 			GLINJECT_PRINT("[GLXFrameGrabber " << m_id << "] Error: Frame is too small!");
 		}
-		return;
+		return false;
 	}
 	if(width > SSR_MAX_IMAGE_SIZE || height > SSR_MAX_IMAGE_SIZE) {
 		if(m_warn_too_large) {
 			m_warn_too_large = false;
 			GLINJECT_PRINT("[GLXFrameGrabber " << m_id << "] Error: Frame is too large!");
 		}
-		return;
+		return false;
 	}
 
+	// collect the results of the GPU timer queries
+	bool use_timer_query = InitTimerQueries();
+	if(use_timer_query)
+		ReadTimerQueries();
+
 	// should we capture this frame?
 	unsigned int flags;
 	void *image_data = m_stream_writer->NewFrame(&flags);
+	*wait_time = m_stream_writer->GetLastWaitTime();
 	if(image_data == NULL)
-		return;
+		return false;
 
 	// detect errors in external code so it won't look like it's my fault :)
 	if(m_debug) CheckGLError("<external code>");
@@ -243,16 +256,26 @@ void GLXFrameGrabber::GrabFrame() {
 	CGLE(glPixelStorei(GL_PACK_ALIGNMENT, 8));
 	CGLE(glReadBuffer(GL_BACK));
 
+	// start a timer query, unless the previous result hasn't been read yet or the application is using a timer query itself
+	if(use_timer_query && !m_timer_query_pending[m_timer_query_pos]) {
+		GLint current_query;
+		CGLE(glGetQueryiv(GL_TIME_ELAPSED, GL_CURRENT_QUERY, &current_query));
+		use_timer_query = (current_query == 0);
+	} else {
+		use_timer_query = false;
+	}
+	if(use_timer_query) {
+		CGLE(glBeginQuery(GL_TIME_ELAPSED, m_timer_queries[m_timer_query_pos]));
+	}
+
 	// capture the frame
 	CGLE(glReadPixels(0, 0, width, height, GL_BGRA, GL_UNSIGNED_INT_8_8_8_8_REV, image_data));
 
-	// draw the cursor
-	if((flags & GLINJECT_FLAG_RECORD_CURSOR) && m_has_xfixes) {
-		int inner_x, inner_y;
-		Window unused_window;
-		if(XTranslateCoordinates(m_x11_display, m_x11_window, DefaultRootWindow(m_x11_display), 0, 0, &inner_x, &inner_y, &unused_window)) {
-			GLImageDrawCursor(m_x11_display, (uint8_t*) image_data, stride, width, height, inner_x, inner_y);
-		}
+	// end the timer query
+	if(use_timer_query) {
+		CGLE(glEndQuery(GL_TIME_ELAPSED));
+		m_timer_query_pending[m_timer_query_pos] = true;
+		m_timer_query_pos = (m_timer_query_pos + 1) % GLINJECT_TIMER_QUERIES;
 	}
 
 	// write the frame
@@ -265,4 +288,6 @@ void GLXFrameGrabber::GrabFrame() {
 	CGLE(glPopClientAttrib());
 	CGLE(glPopAttrib());
 
+	return true;
+
 }
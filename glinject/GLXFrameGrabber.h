@@ -14,6 +14,9 @@ THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES WITH RE
 #include <GL/glx.h>
 #include <X11/X.h>
 
+// The number of GPU timer queries that can be in flight at the same time.
+#define GLINJECT_TIMER_QUERIES 4
+
 class GLXFrameGrabber {
 
 private:
@@ -23,9 +26,14 @@ private:
 	GLXDrawable m_glx_drawable;
 
 	unsigned int m_gl_version;
-	bool m_debug, m_has_xfixes;
+	bool m_debug;
 	bool m_warn_too_small, m_warn_too_large;
 
+	GLXContext m_timer_query_context;
+	GLuint m_timer_queries[GLINJECT_TIMER_QUERIES];
+	bool m_timer_query_pending[GLINJECT_TIMER_QUERIES];
+	unsigned int m_timer_query_pos;
+
 	SSRVideoStreamWriter *m_stream_writer;
 
 public:
@@ -36,6 +44,10 @@ private:
 	void Init();
 	void Free();
 
+	bool InitTimerQueries();
+	void ReadTimerQueries();
+	bool CaptureFrame(int64_t* wait_time);
+
 public:
 	void GrabFrame();
 
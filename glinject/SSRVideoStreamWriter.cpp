@@ -8,11 +8,25 @@ THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES WITH RE
 
 #include "SSRVideoStreamWriter.h"
 
+#include <algorithm>
+
 #include <fcntl.h>
 #include <sys/file.h>
 #include <sys/mman.h>
+#include <sys/socket.h>
 #include <sys/stat.h>
 #include <sys/types.h>
+#include <sys/un.h>
+
+// The fps limiter sleeps until this amount of time before the deadline (in microseconds) and then spins for the remaining time.
+// The scheduler often wakes up threads a bit too late, spinning for a short time is far more accurate.
+#define GLINJECT_PACING_SPIN_TIME 500
+
+// The interval at which the maximum pacing error is reset (in microseconds).
+#define GLINJECT_PACING_WINDOW 1000000
+
+// The interval at which the capture overhead statistics are updated (in microseconds).
+#define GLINJECT_OVERHEAD_UPDATE_INTERVAL 250000
 
 // Returns the program name (i.e. filename of the binary)
 static std::string GetProgramName() {
@@ -27,17 +41,44 @@ static std::string GetProgramName() {
 	return path.substr(p + 1);
 }
 
+// Waits until the given time (hrt_time_micro clock).
+static void WaitUntil(int64_t deadline) {
+	int64_t sleep_deadline = deadline - GLINJECT_PACING_SPIN_TIME;
+	if(hrt_time_micro() < sleep_deadline) {
+		timespec ts;
+		ts.tv_sec = sleep_deadline / 1000000;
+		ts.tv_nsec = (sleep_deadline % 1000000) * 1000;
+		while(clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &ts, NULL) == EINTR) {}
+	}
+	while(hrt_time_micro() < deadline) {
+#if defined(__i386__) || defined(__x86_64__)
+		__builtin_ia32_pause();
+#endif
+	}
+}
+
 SSRVideoStreamWriter::SSRVideoStreamWriter(const std::string& channel, const std::string& source) {
 
 	std::string stream_name = NumToString(hrt_time_micro()) + "-" + NumToString(getpid()) + "-" + source + "-" + GetProgramName();
 
 	m_channel_directory = "/dev/shm/ssr-" + ((channel.empty())? "channel-" + GetUserName() : channel);
 	m_filename_main = m_channel_directory + "/video-" + stream_name;
+	m_filename_socket = m_channel_directory + "/videofd-" + stream_name;
 	m_page_size = sysconf(_SC_PAGE_SIZE);
 	m_width = 0;
 	m_height = 0;
 	m_stride = 0;
 	m_next_frame_time = hrt_time_micro();
+	m_pacing_error_avg = 0;
+	m_pacing_error_max = 0;
+	m_pacing_window_end = m_next_frame_time + GLINJECT_PACING_WINDOW;
+	m_last_wait_time = 0;
+
+	m_overhead_cpu.m_sample_count = 0;
+	m_overhead_cpu.m_sample_pos = 0;
+	m_overhead_gpu.m_sample_count = 0;
+	m_overhead_gpu.m_sample_pos = 0;
+	m_next_overhead_update = m_next_frame_time;
 
 	m_fd_main = -1;
 	m_mmap_ptr_main = MAP_FAILED;
@@ -51,6 +92,16 @@ SSRVideoStreamWriter::SSRVideoStreamWriter(const std::string& channel, const std
 		fd.m_mmap_size_frame = 0;
 	}
 
+	m_use_memfd = false;
+	m_relax_permissions = false;
+	m_fd_frames = -1;
+	m_fd_socket = -1;
+	m_mmap_ptr_frames = MAP_FAILED;
+	m_mmap_size_frames = 0;
+	m_frame_slot_size = 0;
+	m_transport_request_counter = 0;
+	m_warn_frame_too_large = true;
+
 	try {
 		Init();
 	} catch(...) {
@@ -76,6 +127,11 @@ void SSRVideoStreamWriter::Init() {
 			relax_permissions = true;
 		}
 	}
+	m_relax_permissions = relax_permissions;
+	{
+		char *ssr_stream_memfd = getenv("SSR_STREAM_MEMFD");
+		m_use_memfd = (ssr_stream_memfd != NULL && atoi(ssr_stream_memfd) > 0);
+	}
 
 	// create channel directory (permissions may be wrong because of umask, fix this later)
 	if(mkdir(m_channel_directory.c_str(), (relax_permissions)? 0777 : 0700) == -1) {
@@ -108,17 +164,24 @@ void SSRVideoStreamWriter::Init() {
 		}
 	}
 
+	// create the memfd and socket (this has to be done before the main file is created)
+	if(m_use_memfd) {
+		InitMemfd();
+	}
+
 	// open frame files
-	for(unsigned int i = 0; i < GLINJECT_RING_BUFFER_SIZE; ++i) {
-		FrameData &fd = m_frame_data[i];
-		fd.m_fd_frame = open(fd.m_filename_frame.c_str(), O_RDWR | O_CREAT | O_EXCL | O_CLOEXEC, (relax_permissions)? 0666 : 0600);
-		if(fd.m_fd_frame == -1) {
-			GLINJECT_PRINT("Error: Can't open video frame file!");
-			throw SSRStreamException();
-		}
-		if(fchmod(fd.m_fd_frame, (relax_permissions)? 0666 : 0600) == -1) {
-			GLINJECT_PRINT("Error: Can't set video frame file mode!");
-			throw SSRStreamException();
+	if(!m_use_memfd) {
+		for(unsigned int i = 0; i < GLINJECT_RING_BUFFER_SIZE; ++i) {
+			FrameData &fd = m_frame_data[i];
+			fd.m_fd_frame = open(fd.m_filename_frame.c_str(), O_RDWR | O_CREAT | O_EXCL | O_CLOEXEC, (relax_permissions)? 0666 : 0600);
+			if(fd.m_fd_frame == -1) {
+				GLINJECT_PRINT("Error: Can't open video frame file!");
+				throw SSRStreamException();
+			}
+			if(fchmod(fd.m_fd_frame, (relax_permissions)? 0666 : 0600) == -1) {
+				GLINJECT_PRINT("Error: Can't set video frame file mode!");
+				throw SSRStreamException();
+			}
 		}
 	}
 
@@ -155,6 +218,19 @@ void SSRVideoStreamWriter::Init() {
 	header->current_width = m_width;
 	header->current_height = m_height;
 	header->frame_counter = 0;
+	header->frame_slot_size = m_frame_slot_size;
+	// transport_request_counter is not initialized because the reader may already have changed it
+	header->pacing_error_avg = 0;
+	header->pacing_error_max = 0;
+	header->overhead_cpu_mean = 0;
+	header->overhead_cpu_p99 = 0;
+	header->overhead_cpu_max = 0;
+	header->overhead_gpu_mean = 0;
+	header->overhead_gpu_p99 = 0;
+	header->overhead_gpu_max = 0;
+	header->dropped_ring_full = 0;
+	header->dropped_too_large = 0;
+	header->window_id = 0;
 
 	// initialize frame info
 	for(unsigned int i = 0; i < GLINJECT_RING_BUFFER_SIZE; ++i) {
@@ -174,6 +250,23 @@ void SSRVideoStreamWriter::Init() {
 
 void SSRVideoStreamWriter::Free() {
 
+	// unmap and close memfd
+	if(m_mmap_ptr_frames != MAP_FAILED) {
+		munmap(m_mmap_ptr_frames, m_mmap_size_frames);
+		m_mmap_ptr_frames = MAP_FAILED;
+	}
+	if(m_fd_frames != -1) {
+		close(m_fd_frames);
+		m_fd_frames = -1;
+	}
+
+	// close and unlink socket
+	if(m_fd_socket != -1) {
+		close(m_fd_socket);
+		m_fd_socket = -1;
+		unlink(m_filename_socket.c_str());
+	}
+
 	for(unsigned int i = 0; i < GLINJECT_RING_BUFFER_SIZE; ++i) {
 		FrameData &fd = m_frame_data[i];
 
@@ -209,6 +302,197 @@ void SSRVideoStreamWriter::Free() {
 
 }
 
+void SSRVideoStreamWriter::InitMemfd() {
+#ifdef MFD_CLOEXEC
+
+	// the socket name has to fit in sockaddr_un
+	sockaddr_un addr;
+	if(m_filename_socket.size() >= sizeof(addr.sun_path)) {
+		GLINJECT_PRINT("Warning: Socket path is too long, using frame files instead of memfd.");
+		m_use_memfd = false;
+		return;
+	}
+
+	// get the maximum frame size
+	unsigned int max_width = 3840, max_height = 2160;
+	{
+		char *ssr_stream_max_size = getenv("SSR_STREAM_MAX_SIZE");
+		if(ssr_stream_max_size != NULL) {
+			if(sscanf(ssr_stream_max_size, "%ux%u", &max_width, &max_height) != 2 || max_width < 2 || max_height < 2 ||
+					max_width > SSR_MAX_IMAGE_SIZE || max_height > SSR_MAX_IMAGE_SIZE) {
+				GLINJECT_PRINT("Error: Invalid maximum frame size '" << ssr_stream_max_size << "'!");
+				throw SSRStreamException();
+			}
+		}
+	}
+	bool hugepages = false;
+	{
+		char *ssr_stream_hugepages = getenv("SSR_STREAM_HUGEPAGES");
+		hugepages = (ssr_stream_hugepages != NULL && atoi(ssr_stream_hugepages) > 0);
+	}
+
+	// create memfd, preferably with huge pages
+	bool hugetlb = false;
+#ifdef MFD_HUGETLB
+	if(hugepages) {
+		m_fd_frames = memfd_create("ssr-frames", MFD_CLOEXEC | MFD_HUGETLB);
+		if(m_fd_frames == -1) {
+			GLINJECT_PRINT("Warning: Can't create memfd with huge pages, using normal pages instead.");
+		} else {
+			hugetlb = true;
+		}
+	}
+#endif
+	if(m_fd_frames == -1) {
+		m_fd_frames = memfd_create("ssr-frames", MFD_CLOEXEC);
+		if(m_fd_frames == -1) {
+			if(errno == ENOSYS) {
+				GLINJECT_PRINT("Warning: memfd is not supported by the kernel, using frame files instead.");
+				m_use_memfd = false;
+				return;
+			}
+			GLINJECT_PRINT("Error: Can't create memfd!");
+			throw SSRStreamException();
+		}
+	}
+
+	// calculate the slot size, slots are aligned to the (huge) page size
+	size_t alignment = m_page_size;
+	if(hugetlb) {
+		struct stat statinfo;
+		if(fstat(m_fd_frames, &statinfo) == -1) {
+			GLINJECT_PRINT("Error: Can't stat memfd!");
+			throw SSRStreamException();
+		}
+		alignment = std::max(alignment, (size_t) statinfo.st_blksize);
+	}
+	uint64_t slot_size = (uint64_t) grow_align16(max_width * 4) * (uint64_t) max_height;
+	slot_size = (slot_size + alignment - 1) / alignment * alignment;
+	if(slot_size > (uint64_t) UINT32_MAX || slot_size * GLINJECT_RING_BUFFER_SIZE > (uint64_t) SIZE_MAX) {
+		GLINJECT_PRINT("Error: Maximum frame size is too large for the memfd frame buffer!");
+		throw SSRStreamException();
+	}
+	m_frame_slot_size = slot_size;
+
+	// resize and map memfd
+	// Memory is only committed when a slot is used for the first time, but the mapping never changes after this.
+	if(ftruncate(m_fd_frames, m_frame_slot_size * GLINJECT_RING_BUFFER_SIZE) == -1) {
+		GLINJECT_PRINT("Error: Can't resize memfd!");
+		throw SSRStreamException();
+	}
+	m_mmap_ptr_frames = mmap(NULL, m_frame_slot_size * GLINJECT_RING_BUFFER_SIZE, PROT_READ | PROT_WRITE, MAP_SHARED, m_fd_frames, 0);
+	if(m_mmap_ptr_frames == MAP_FAILED && hugetlb) {
+		// The memfd can be created and resized even if there are not enough huge pages, in that case only mmap fails.
+		GLINJECT_PRINT("Warning: Can't memory-map memfd with huge pages, using normal pages instead.");
+		close(m_fd_frames);
+		m_fd_frames = -1;
+		hugetlb = false;
+		m_fd_frames = memfd_create("ssr-frames", MFD_CLOEXEC);
+		if(m_fd_frames == -1) {
+			GLINJECT_PRINT("Error: Can't create memfd!");
+			throw SSRStreamException();
+		}
+		uint64_t slot_size = (uint64_t) grow_align16(max_width * 4) * (uint64_t) max_height;
+		m_frame_slot_size = (slot_size + m_page_size - 1) / m_page_size * m_page_size;
+		if(ftruncate(m_fd_frames, m_frame_slot_size * GLINJECT_RING_BUFFER_SIZE) == -1) {
+			GLINJECT_PRINT("Error: Can't resize memfd!");
+			throw SSRStreamException();
+		}
+		m_mmap_ptr_frames = mmap(NULL, m_frame_slot_size * GLINJECT_RING_BUFFER_SIZE, PROT_READ | PROT_WRITE, MAP_SHARED, m_fd_frames, 0);
+	}
+	if(m_mmap_ptr_frames == MAP_FAILED) {
+		GLINJECT_PRINT("Error: Can't memory-map memfd!");
+		throw SSRStreamException();
+	}
+	m_mmap_size_frames = m_frame_slot_size * GLINJECT_RING_BUFFER_SIZE;
+#ifdef MADV_HUGEPAGE
+	if(hugepages && !hugetlb)
+		madvise(m_mmap_ptr_frames, m_mmap_size_frames, MADV_HUGEPAGE); // only a hint, errors can be ignored
+#endif
+
+	// create socket
+	m_fd_socket = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC | SOCK_NONBLOCK, 0);
+	if(m_fd_socket == -1) {
+		GLINJECT_PRINT("Error: Can't create frame buffer socket!");
+		throw SSRStreamException();
+	}
+	memset(&addr, 0, sizeof(addr));
+	addr.sun_family = AF_UNIX;
+	strcpy(addr.sun_path, m_filename_socket.c_str());
+	if(bind(m_fd_socket, (sockaddr*) &addr, sizeof(addr)) == -1) {
+		GLINJECT_PRINT("Error: Can't bind frame buffer socket!");
+		throw SSRStreamException();
+	}
+	if(chmod(m_filename_socket.c_str(), (m_relax_permissions)? 0666 : 0600) == -1) {
+		GLINJECT_PRINT("Error: Can't set frame buffer socket mode!");
+		throw SSRStreamException();
+	}
+	if(listen(m_fd_socket, 4) == -1) {
+		GLINJECT_PRINT("Error: Can't listen on frame buffer socket!");
+		throw SSRStreamException();
+	}
+
+	GLINJECT_PRINT("[" << m_filename_main << "] Using memfd frame buffer with " << m_frame_slot_size << " bytes per frame" << ((hugetlb)? " (huge pages)." : "."));
+
+#else
+	GLINJECT_PRINT("Warning: memfd is not supported on this system, using frame files instead.");
+	m_use_memfd = false;
+#endif
+}
+
+void SSRVideoStreamWriter::SendFrameBuffer() {
+	for( ; ; ) {
+
+		// accept the next connection
+		int fd = accept4(m_fd_socket, NULL, NULL, SOCK_CLOEXEC);
+		if(fd == -1) {
+			if(errno == EINTR)
+				continue;
+			if(errno != EAGAIN && errno != EWOULDBLOCK)
+				GLINJECT_PRINT("Warning: Can't accept connection on frame buffer socket!");
+			break;
+		}
+
+		// only send the frame buffer to the same user, unless permissions are relaxed
+		if(!m_relax_permissions) {
+			ucred cred;
+			socklen_t len = sizeof(cred);
+			if(getsockopt(fd, SOL_SOCKET, SO_PEERCRED, &cred, &len) == -1 || cred.uid != geteuid()) {
+				GLINJECT_PRINT("Warning: Frame buffer was requested by a different user, ignoring request.");
+				close(fd);
+				continue;
+			}
+		}
+
+		// send the file descriptor
+		char dummy = 0;
+		iovec iov;
+		iov.iov_base = &dummy;
+		iov.iov_len = 1;
+		union {
+			cmsghdr align;
+			char buffer[CMSG_SPACE(sizeof(int))];
+		} control;
+		memset(&control, 0, sizeof(control));
+		msghdr msg;
+		memset(&msg, 0, sizeof(msg));
+		msg.msg_iov = &iov;
+		msg.msg_iovlen = 1;
+		msg.msg_control = control.buffer;
+		msg.msg_controllen = sizeof(control.buffer);
+		cmsghdr *cmsg = CMSG_FIRSTHDR(&msg);
+		cmsg->cmsg_level = SOL_SOCKET;
+		cmsg->cmsg_type = SCM_RIGHTS;
+		cmsg->cmsg_len = CMSG_LEN(sizeof(int));
+		memcpy(CMSG_DATA(cmsg), &m_fd_frames, sizeof(int));
+		if(sendmsg(fd, &msg, MSG_NOSIGNAL) == -1) {
+			GLINJECT_PRINT("Warning: Can't send frame buffer!");
+		}
+		close(fd);
+
+	}
+}
+
 GLInjectHeader* SSRVideoStreamWriter::GetGLInjectHeader() {
 	return (GLInjectHeader*) m_mmap_ptr_main;
 }
@@ -232,11 +516,23 @@ void SSRVideoStreamWriter::UpdateSize(unsigned int width, unsigned int height, i
 
 void* SSRVideoStreamWriter::NewFrame(unsigned int* flags) {
 
+	m_last_wait_time = 0;
+
 	// increment the frame counter
 	GLInjectHeader *header = GetGLInjectHeader();
 	++header->frame_counter;
 	std::atomic_thread_fence(std::memory_order_release);
 
+	// send the frame buffer to new readers
+	if(m_use_memfd) {
+		std::atomic_thread_fence(std::memory_order_acquire);
+		uint32_t transport_request_counter = header->transport_request_counter;
+		if(transport_request_counter != m_transport_request_counter) {
+			m_transport_request_counter = transport_request_counter;
+			SendFrameBuffer();
+		}
+	}
+
 	// get capture parameters
 	std::atomic_thread_fence(std::memory_order_acquire);
 	*flags = header->capture_flags;
@@ -248,10 +544,21 @@ void* SSRVideoStreamWriter::NewFrame(unsigned int* flags) {
 	int64_t timestamp = hrt_time_micro();
 	if(target_fps > 0) {
 		int64_t interval = 1000000 / target_fps;
+
+		// align the phase of the limiter with the frames that the recorder wants, so frames arrive just in time instead of up to one interval late
+		int64_t next_timestamp = __atomic_load_n(&header->capture_next_timestamp, __ATOMIC_ACQUIRE);
+		if(next_timestamp > 0) {
+			int64_t shift = positive_mod(next_timestamp - m_next_frame_time, interval);
+			m_next_frame_time += (shift > interval / 2)? shift - interval : shift;
+		}
+
 		if(*flags & GLINJECT_FLAG_LIMIT_FPS) {
 			if(timestamp < m_next_frame_time) {
-				usleep(m_next_frame_time - timestamp);
+				WaitUntil(m_next_frame_time);
+				int64_t old_timestamp = timestamp;
 				timestamp = hrt_time_micro();
+				m_last_wait_time = timestamp - old_timestamp;
+				UpdatePacingError(header, timestamp - m_next_frame_time, timestamp);
 			}
 		} else {
 			if(timestamp < m_next_frame_time - interval)
@@ -264,8 +571,23 @@ void* SSRVideoStreamWriter::NewFrame(unsigned int* flags) {
 	unsigned int read_pos = header->ring_buffer_read_pos;
 	unsigned int write_pos = header->ring_buffer_write_pos;
 	unsigned int frames_used = positive_mod((int) write_pos - (int) read_pos, GLINJECT_RING_BUFFER_SIZE * 2);
-	if(frames_used >= GLINJECT_RING_BUFFER_SIZE)
+	if(frames_used >= GLINJECT_RING_BUFFER_SIZE) {
+		++header->dropped_ring_full;
+		std::atomic_thread_fence(std::memory_order_release);
+		return NULL;
+	}
+
+	// make sure that the frame fits in the memfd slot
+	size_t required_size = (size_t) abs(m_stride) * (size_t) m_height;
+	if(m_use_memfd && required_size > m_frame_slot_size) {
+		if(m_warn_frame_too_large) {
+			m_warn_frame_too_large = false;
+			GLINJECT_PRINT("Warning: Frame is too large for the memfd frame buffer, frames will be dropped! Increase SSR_STREAM_MAX_SIZE to fix this.");
+		}
+		++header->dropped_too_large;
+		std::atomic_thread_fence(std::memory_order_release);
 		return NULL;
+	}
 
 	// write frame info
 	GLInjectFrameInfo *frameinfo = GetGLInjectFrameInfo(write_pos % GLINJECT_RING_BUFFER_SIZE);
@@ -274,9 +596,12 @@ void* SSRVideoStreamWriter::NewFrame(unsigned int* flags) {
 	frameinfo->height = m_height;
 	frameinfo->stride = m_stride;
 
+	// with memfd, the slots never have to be remapped
+	if(m_use_memfd)
+		return (char*) m_mmap_ptr_frames + (size_t) (write_pos % GLINJECT_RING_BUFFER_SIZE) * m_frame_slot_size;
+
 	// prepare the frame file
 	FrameData &fd = m_frame_data[write_pos % GLINJECT_RING_BUFFER_SIZE];
-	size_t required_size = (size_t) abs(m_stride) * (size_t) m_height;
 	if(required_size > fd.m_mmap_size_frame) {
 
 		// calculate new size
@@ -308,6 +633,69 @@ void* SSRVideoStreamWriter::NewFrame(unsigned int* flags) {
 	return fd.m_mmap_ptr_frame;
 }
 
+void SSRVideoStreamWriter::UpdatePacingError(GLInjectHeader* header, int64_t error, int64_t timestamp) {
+	m_pacing_error_avg += (error - m_pacing_error_avg) / 16;
+	m_pacing_error_max = std::max(m_pacing_error_max, error);
+	header->pacing_error_avg = (uint32_t) std::max((int64_t) 0, m_pacing_error_avg);
+	header->pacing_error_max = (uint32_t) m_pacing_error_max;
+	if(timestamp >= m_pacing_window_end) {
+		m_pacing_error_max = 0;
+		m_pacing_window_end = timestamp + GLINJECT_PACING_WINDOW;
+	}
+}
+
+// Calculates the mean, 99th percentile and maximum of the samples.
+static void CalculateOverheadStats(const uint32_t* samples, unsigned int count, uint32_t* mean, uint32_t* p99, uint32_t* max) {
+	if(count == 0) {
+		*mean = *p99 = *max = 0;
+		return;
+	}
+	uint32_t temp[GLINJECT_OVERHEAD_SAMPLES];
+	std::copy(samples, samples + count, temp);
+	uint64_t sum = 0;
+	for(unsigned int i = 0; i < count; ++i) {
+		sum += temp[i];
+	}
+	*mean = (uint32_t) (sum / count);
+	unsigned int p = (count * 99) / 100;
+	std::nth_element(temp, temp + p, temp + count);
+	*p99 = temp[p];
+	*max = *std::max_element(temp + p, temp + count);
+}
+
+void SSRVideoStreamWriter::UpdateOverheadStats() {
+	int64_t timestamp = hrt_time_micro();
+	if(timestamp < m_next_overhead_update)
+		return;
+	m_next_overhead_update = timestamp + GLINJECT_OVERHEAD_UPDATE_INTERVAL;
+	GLInjectHeader *header = GetGLInjectHeader();
+	CalculateOverheadStats(m_overhead_cpu.m_samples, m_overhead_cpu.m_sample_count, &header->overhead_cpu_mean, &header->overhead_cpu_p99, &header->overhead_cpu_max);
+	CalculateOverheadStats(m_overhead_gpu.m_samples, m_overhead_gpu.m_sample_count, &header->overhead_gpu_mean, &header->overhead_gpu_p99, &header->overhead_gpu_max);
+	std::atomic_thread_fence(std::memory_order_release);
+}
+
+// Adds a sample to the ring of samples, overwriting the oldest one.
+static void AddOverheadSample(uint32_t* samples, unsigned int* count, unsigned int* pos, int64_t time) {
+	samples[*pos] = (uint32_t) std::min(std::max(time, (int64_t) 0), (int64_t) UINT32_MAX);
+	*pos = (*pos + 1) % GLINJECT_OVERHEAD_SAMPLES;
+	*count = std::min(*count + 1, (unsigned int) GLINJECT_OVERHEAD_SAMPLES);
+}
+
+void SSRVideoStreamWriter::AddCPUOverhead(int64_t time) {
+	AddOverheadSample(m_overhead_cpu.m_samples, &m_overhead_cpu.m_sample_count, &m_overhead_cpu.m_sample_pos, time);
+	UpdateOverheadStats();
+}
+
+void SSRVideoStreamWriter::AddGPUOverhead(int64_t time) {
+	AddOverheadSample(m_overhead_gpu.m_samples, &m_overhead_gpu.m_sample_count, &m_overhead_gpu.m_sample_pos, time);
+}
+
+void SSRVideoStreamWriter::SetWindowID(uint32_t window_id) {
+	GLInjectHeader *header = GetGLInjectHeader();
+	header->window_id = window_id;
+	std::atomic_thread_fence(std::memory_order_release);
+}
+
 void SSRVideoStreamWriter::NextFrame() {
 
 	// make sure all changes are visible
@@ -11,6 +11,9 @@ THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES WITH RE
 
 #include "ShmStructs.h"
 
+// The number of samples used to calculate the capture overhead statistics.
+#define GLINJECT_OVERHEAD_SAMPLES 256
+
 class SSRVideoStreamWriter {
 
 private:
@@ -20,14 +23,23 @@ private:
 		void *m_mmap_ptr_frame;
 		size_t m_mmap_size_frame;
 	};
+	struct OverheadStats {
+		uint32_t m_samples[GLINJECT_OVERHEAD_SAMPLES];
+		unsigned int m_sample_count, m_sample_pos;
+	};
 
 private:
-	std::string m_channel_directory, m_filename_main;
+	std::string m_channel_directory, m_filename_main, m_filename_socket;
 	size_t m_page_size;
 	unsigned int m_width, m_height;
 	int m_stride;
 
 	int64_t m_next_frame_time;
+	int64_t m_pacing_error_avg, m_pacing_error_max, m_pacing_window_end;
+	int64_t m_last_wait_time;
+
+	OverheadStats m_overhead_cpu, m_overhead_gpu;
+	int64_t m_next_overhead_update;
 
 	int m_fd_main, m_file_lock;
 	void *m_mmap_ptr_main;
@@ -35,6 +47,14 @@ private:
 
 	FrameData m_frame_data[GLINJECT_RING_BUFFER_SIZE];
 
+	// memfd transport
+	bool m_use_memfd, m_relax_permissions;
+	int m_fd_frames, m_fd_socket;
+	void *m_mmap_ptr_frames;
+	size_t m_mmap_size_frames, m_frame_slot_size;
+	uint32_t m_transport_request_counter;
+	bool m_warn_frame_too_large;
+
 public:
 	SSRVideoStreamWriter(const std::string& channel, const std::string& source);
 	~SSRVideoStreamWriter();
@@ -43,9 +63,15 @@ private:
 	void Init();
 	void Free();
 
+	void InitMemfd();
+	void SendFrameBuffer();
+
 	GLInjectHeader* GetGLInjectHeader();
 	GLInjectFrameInfo* GetGLInjectFrameInfo(unsigned int frame);
 
+	void UpdatePacingError(GLInjectHeader* header, int64_t error, int64_t timestamp);
+	void UpdateOverheadStats();
+
 public:
 	// Updates the size of the video stream.
 	void UpdateSize(unsigned int width, unsigned int height, int stride);
@@ -54,7 +80,19 @@ public:
 	// If it should be captured, it will allocate shared memory for the frame and return a pointer. Otherwise it returns NULL.
 	void* NewFrame(unsigned int* flags);
 
+	// Stores the X11 window ID of the captured window, so the recorder can draw the cursor.
+	// The recorder tracks the position of the window itself, so the application doesn't need any X server round-trips for this.
+	void SetWindowID(uint32_t window_id);
+
 	// Writes the allocated frame to the ring buffer after it has been captured.
 	void NextFrame();
 
+	// Adds a capture overhead sample (in microseconds). The statistics are written to the shared memory a few times per second.
+	void AddCPUOverhead(int64_t time);
+	void AddGPUOverhead(int64_t time);
+
+public:
+	// Returns the time spent in the fps limiter during the last call to NewFrame (in microseconds).
+	inline int64_t GetLastWaitTime() { return m_last_wait_time; }
+
 };
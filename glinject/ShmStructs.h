@@ -8,6 +8,7 @@ THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES WITH RE
 
 #pragma once
 
+#include <stddef.h>
 #include <stdint.h>
 
 /*
@@ -24,6 +25,17 @@ There are two types of files:
 > NUM is the position of the frame in the ring buffer (starting from zero).
 > This file contains one video frame. The file size is not constant, it may be enlarged when the video frame size changes. The size can only increase, not decrease.
 
+Alternatively, the frames can be stored in a single memfd instead of the videoframe files (enabled with SSR_STREAM_MEMFD=1 in the captured application).
+In that case there is a third type of file, which replaces the videoframe files:
+
+>>>> CHANNEL_DIRECTORY/videofd-STREAM_NAME <<<<
+> This file is in the same channel directory as the main file and uses the same stream name (the main file is CHANNEL_DIRECTORY/video-STREAM_NAME).
+> A Unix socket that is used to send the file descriptor of the memfd to SimpleScreenRecorder (SCM_RIGHTS). The socket is created before the main file,
+> so the reader can use it to detect which transport is used. The reader connects to the socket and then increments transport_request_counter,
+> (atomically, since both processes access it), the captured application sends the file descriptor the next time it handles a frame. The memfd contains one slot for each frame in the ring buffer,
+> each slot has a fixed size (frame_slot_size) that is large enough for the largest allowed frame (SSR_STREAM_MAX_SIZE, 3840x2160 by default).
+> If SSR_STREAM_HUGEPAGES=1 is set, the memfd will use huge pages when possible. Frames are never remapped.
+
 */
 
 // Disable padding to make sure the 32-bit and 64-bit libs are compatible.
@@ -34,7 +46,7 @@ There are two types of files:
 #define GLINJECT_IDENTIFIER 0x8af7a476
 
 #define GLINJECT_FLAG_CAPTURE_ENABLED  0x0001
-#define GLINJECT_FLAG_RECORD_CURSOR    0x0002
+#define GLINJECT_FLAG_RECORD_CURSOR    0x0002 // the recorder draws the cursor (the application only stores its window ID, see window_id)
 #define GLINJECT_FLAG_LIMIT_FPS        0x0004
 
 struct GLInjectHeader {
@@ -53,6 +65,28 @@ struct GLInjectHeader {
 	uint32_t capture_flags;
 	uint32_t capture_target_fps;
 
+	// memfd transport: frame_slot_size is set by the captured application, transport_request_counter is set by SimpleScreenRecorder
+	uint32_t frame_slot_size;
+	uint32_t transport_request_counter;
+
+	// frame pacing: capture_next_timestamp is set by SimpleScreenRecorder (the timestamp of the next frame it wants, or 0 if unknown),
+	// pacing_error_avg and pacing_error_max are set by the captured application (how late the fps limiter wakes up, in microseconds)
+	// capture_next_timestamp must only be accessed with atomic operations, otherwise 32-bit builds could read half of an old value.
+	int64_t capture_next_timestamp;
+	uint32_t pacing_error_avg, pacing_error_max;
+
+	// capture overhead statistics: set by the captured application (time spent per captured frame, in microseconds)
+	// swaps that were skipped by the fps limiter or because of an invalid size are not included
+	// cpu_* is the total time spent in the capture code (excluding the fps limiter), gpu_* is the GPU time used by the readback
+	uint32_t overhead_cpu_mean, overhead_cpu_p99, overhead_cpu_max;
+	uint32_t overhead_gpu_mean, overhead_gpu_p99, overhead_gpu_max;
+
+	// dropped frames: set by the captured application (frames that could not be stored because the ring buffer was full or the frame was too large)
+	uint32_t dropped_ring_full, dropped_too_large;
+
+	// window: set by the captured application (the X11 window that is captured, SimpleScreenRecorder uses it to draw the cursor)
+	uint32_t window_id;
+
 };
 
 struct GLInjectFrameInfo {
@@ -65,3 +99,7 @@ struct GLInjectFrameInfo {
 };
 
 #pragma pack(pop)
+
+// 64-bit atomic operations are only lock-free (and therefore also atomic between processes) if the field is aligned.
+static_assert(offsetof(GLInjectHeader, capture_next_timestamp) % 8 == 0, "capture_next_timestamp is not aligned");
+static_assert(__atomic_always_lock_free(sizeof(int64_t), 0), "64-bit atomic operations are not lock-free");
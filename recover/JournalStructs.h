@@ -0,0 +1,114 @@
+/*
+Copyright (c) 2012-2020 Maarten Baert <maarten-baert@hotmail.com>
+
+Permission to use, copy, modify, and/or distribute this software for any purpose with or without fee is hereby granted, provided that the above copyright notice and this permission notice appear in all copies.
+
+THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+*/
+
+#pragma once
+
+#include <stdint.h>
+
+/*
+When the journal is enabled (with the '--recovery-journal' option), SimpleScreenRecorder writes a small journal next to the output file
+while recording to a local file. If the recording is interrupted (a crash, the X server dies, the machine loses power), the output file
+is usually incomplete: MP4 and MOV store their index at the end of the file, so a file without that index can't be played at all.
+The journal contains everything that is needed to rebuild the index, and the 'ssr-recover' tool uses it to create a valid file from the
+incomplete one. The journal is removed when the recording is finished normally.
+
+>>>> OUTPUTFILE.ssrjournal <<<<
+> This file contains a JournalHeader struct, followed by 'stream_count' JournalStream structs (each followed by 'extradata_size' bytes of
+> codec extradata), followed by any number of JournalPacket structs (one for each packet that was written to the output file).
+
+The journal is only appended to, and it is flushed periodically (the output file is flushed first, so the journal never refers to data
+that was still in a buffer). After a crash the last packet record may be incomplete or zero-filled, readers should stop at the first
+record that doesn't have the correct identifier.
+
+If JOURNAL_FLAG_CONTIGUOUS_PACKETS is set, the muxer writes the data of each packet to the output file as one contiguous block, and the
+'offset' and 'size' fields of the packet records point to that data. This is the case for MP4/MOV, which are also the formats that need
+the journal the most. For other formats the offsets are only informative, 'ssr-recover' remuxes those files with libavformat instead
+(formats like Matroska, WebM, OGG and MPEG-TS can be read without the index that is missing).
+
+All values are stored in the native byte order, the journal is not meant to be moved to another machine.
+*/
+
+// Disable padding to make sure the 32-bit and 64-bit versions are compatible.
+#pragma pack(push, 1)
+
+#define JOURNAL_IDENTIFIER 0x7e3a51c9
+#define JOURNAL_PACKET_IDENTIFIER 0x2d9b64f0
+#define JOURNAL_VERSION 1
+
+#define JOURNAL_NAME_SIZE 32
+
+#define JOURNAL_FLAG_CONTIGUOUS_PACKETS 0x1
+
+#define JOURNAL_PACKET_FLAG_KEY 0x1
+
+#define JOURNAL_STREAM_TYPE_VIDEO 0
+#define JOURNAL_STREAM_TYPE_AUDIO 1
+
+#define JOURNAL_NOPTS_VALUE ((int64_t) UINT64_C(0x8000000000000000))
+
+struct JournalHeader {
+
+	// identifier and version
+	uint32_t identifier;
+	uint32_t version;
+	uint32_t flags;
+
+	// libavformat container name (e.g. 'mp4')
+	char container_name[JOURNAL_NAME_SIZE];
+
+	// number of streams
+	uint32_t stream_count;
+
+	// file offset of the first byte after the container header
+	uint64_t data_start;
+
+};
+
+struct JournalStream {
+
+	// stream type and libavcodec codec name (not the encoder name, e.g. 'h264' rather than 'libx264')
+	uint32_t type;
+	char codec_name[JOURNAL_NAME_SIZE];
+
+	// time base of the packet timestamps
+	int32_t time_base_num, time_base_den;
+
+	// video parameters
+	uint32_t width, height;
+	int32_t sample_aspect_ratio_num, sample_aspect_ratio_den;
+	char pixel_format[JOURNAL_NAME_SIZE];
+
+	// audio parameters
+	uint32_t sample_rate, channels, frame_size;
+	char sample_format[JOURNAL_NAME_SIZE];
+
+	// bit rate (informative)
+	uint64_t bit_rate;
+
+	// the size of the extradata that follows this struct
+	uint32_t extradata_size;
+
+};
+
+struct JournalPacket {
+
+	// identifier (used to detect incomplete records)
+	uint32_t identifier;
+
+	// packet info, the timestamps use the time base of the stream
+	uint32_t stream_index;
+	uint32_t flags;
+	int64_t pts, dts, duration;
+
+	// location of the packet data in the output file
+	uint64_t offset;
+	uint32_t size;
+
+};
+
+#pragma pack(pop)
@@ -0,0 +1,425 @@
+/*
+Copyright (c) 2012-2020 Maarten Baert <maarten-baert@hotmail.com>
+
+Permission to use, copy, modify, and/or distribute this software for any purpose with or without fee is hereby granted, provided that the above copyright notice and this permission notice appear in all copies.
+
+THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+*/
+
+// Rebuilds a playable file from a recording that was interrupted, using the journal that SimpleScreenRecorder writes next to the output file
+// (see JournalStructs.h). The recovered file is written to a new file, the original file and the journal are not modified.
+// Usage: ssr-recover INPUT [OUTPUT]
+
+#include "JournalStructs.h"
+
+extern "C" {
+#include <libavformat/avformat.h>
+#include <libavcodec/avcodec.h>
+#include <libavutil/avutil.h>
+#include <libavutil/channel_layout.h>
+#include <libavutil/pixdesc.h>
+}
+
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <iostream>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include <sys/stat.h>
+#include <unistd.h>
+
+#define SSR_USE_CODECPAR_CH_LAYOUT (LIBAVCODEC_VERSION_INT >= AV_VERSION_INT(59, 24, 100))
+
+class RecoverException : public std::runtime_error {
+public:
+	RecoverException(const std::string& message) : std::runtime_error(message) {}
+};
+
+struct JournalData {
+	JournalHeader m_header;
+	std::vector<JournalStream> m_streams;
+	std::vector<std::vector<uint8_t> > m_extradata;
+	std::vector<JournalPacket> m_packets;
+};
+
+struct StreamStats {
+	uint64_t m_packets_total, m_packets_recovered;
+	double m_end_time_total, m_end_time_recovered;
+};
+
+static std::string GetJournalFile(const std::string& input_file) {
+	return input_file + ".ssrjournal";
+}
+
+static std::string GetDefaultOutputFile(const std::string& input_file) {
+	size_t slash = input_file.find_last_of('/');
+	size_t dot = input_file.find_last_of('.');
+	if(dot == std::string::npos || (slash != std::string::npos && dot < slash))
+		return input_file + "-recovered";
+	return input_file.substr(0, dot) + "-recovered" + input_file.substr(dot);
+}
+
+static bool FileExists(const std::string& filename) {
+	struct stat statinfo;
+	return (stat(filename.c_str(), &statinfo) == 0);
+}
+
+static std::string GetErrorString(int error) {
+	char buffer[AV_ERROR_MAX_STRING_SIZE] = {};
+	av_strerror(error, buffer, sizeof(buffer));
+	return buffer;
+}
+
+// Returns the end time of a packet in seconds.
+static double GetEndTime(int64_t pts, int64_t dts, int64_t duration, AVRational time_base) {
+	int64_t ts = (pts != AV_NOPTS_VALUE)? pts : dts;
+	if(ts == AV_NOPTS_VALUE)
+		return 0.0;
+	return (double) (ts + duration) * av_q2d(time_base);
+}
+
+static std::string GetName(const char* name) {
+	return std::string(name, strnlen(name, JOURNAL_NAME_SIZE));
+}
+
+// Reads the journal. The last packet records may be missing or incomplete, the reader stops at the first invalid record.
+static bool ReadJournal(const std::string& filename, JournalData* journal) {
+
+	// read the file
+	FILE *f = fopen(filename.c_str(), "rb");
+	if(f == NULL)
+		return false;
+	std::vector<uint8_t> data;
+	uint8_t buffer[65536];
+	for( ; ; ) {
+		size_t done = fread(buffer, 1, sizeof(buffer), f);
+		if(done == 0)
+			break;
+		data.insert(data.end(), buffer, buffer + done);
+	}
+	fclose(f);
+
+	// read the header
+	size_t pos = 0;
+	if(data.size() < sizeof(JournalHeader))
+		throw RecoverException("The journal is too short.");
+	memcpy(&journal->m_header, data.data(), sizeof(JournalHeader));
+	pos += sizeof(JournalHeader);
+	if(journal->m_header.identifier != JOURNAL_IDENTIFIER)
+		throw RecoverException("The journal is not a SimpleScreenRecorder journal.");
+	if(journal->m_header.version != JOURNAL_VERSION)
+		throw RecoverException("The journal has an unsupported version (" + std::to_string(journal->m_header.version) + ").");
+	if(journal->m_header.stream_count == 0 || journal->m_header.stream_count > 64)
+		throw RecoverException("The journal has an invalid stream count.");
+
+	// read the streams
+	journal->m_streams.resize(journal->m_header.stream_count);
+	journal->m_extradata.resize(journal->m_header.stream_count);
+	for(unsigned int i = 0; i < journal->m_header.stream_count; ++i) {
+		if(data.size() - pos < sizeof(JournalStream))
+			throw RecoverException("The journal is incomplete.");
+		memcpy(&journal->m_streams[i], data.data() + pos, sizeof(JournalStream));
+		pos += sizeof(JournalStream);
+		size_t extradata_size = journal->m_streams[i].extradata_size;
+		if(data.size() - pos < extradata_size)
+			throw RecoverException("The journal is incomplete.");
+		journal->m_extradata[i].assign(data.data() + pos, data.data() + pos + extradata_size);
+		pos += extradata_size;
+	}
+
+	// read the packets
+	while(data.size() - pos >= sizeof(JournalPacket)) {
+		JournalPacket packet;
+		memcpy(&packet, data.data() + pos, sizeof(JournalPacket));
+		if(packet.identifier != JOURNAL_PACKET_IDENTIFIER || packet.stream_index >= journal->m_header.stream_count)
+			break;
+		journal->m_packets.push_back(packet);
+		pos += sizeof(JournalPacket);
+	}
+
+	return true;
+}
+
+// The MOV muxer converts H.264 and H.265 packets to length-prefixed NAL units if the extradata uses start codes (Annex B).
+// The muxer will do that conversion again when the packets are written to the new file, so they have to be converted back first.
+// The length prefixes and start codes are both 4 bytes, so this can be done in place.
+static bool IsAnnexB(const std::vector<uint8_t>& extradata) {
+	return ((extradata.size() >= 3 && extradata[0] == 0 && extradata[1] == 0 && extradata[2] == 1) ||
+			(extradata.size() >= 4 && extradata[0] == 0 && extradata[1] == 0 && extradata[2] == 0 && extradata[3] == 1));
+}
+static void ConvertToAnnexB(uint8_t* data, size_t size) {
+	size_t pos = 0;
+	while(pos < size) {
+		if(size - pos < 4)
+			return;
+		uint32_t length = ((uint32_t) data[pos] << 24) | ((uint32_t) data[pos + 1] << 16) | ((uint32_t) data[pos + 2] << 8) | (uint32_t) data[pos + 3];
+		if(length > size - pos - 4)
+			return; // not length-prefixed, leave it alone
+		pos += 4 + length;
+	}
+	pos = 0;
+	while(pos < size) {
+		uint32_t length = ((uint32_t) data[pos] << 24) | ((uint32_t) data[pos + 1] << 16) | ((uint32_t) data[pos + 2] << 8) | (uint32_t) data[pos + 3];
+		data[pos] = 0;
+		data[pos + 1] = 0;
+		data[pos + 2] = 0;
+		data[pos + 3] = 1;
+		pos += 4 + length;
+	}
+}
+
+class OutputFile {
+
+private:
+	std::string m_filename;
+	AVFormatContext *m_format_context;
+	bool m_started;
+
+public:
+	OutputFile(const std::string& filename, const char* container_name) {
+		m_filename = filename;
+		m_format_context = NULL;
+		m_started = false;
+		int error = avformat_alloc_output_context2(&m_format_context, NULL, container_name, filename.c_str());
+		if(error < 0 || m_format_context == NULL)
+			throw RecoverException("Can't create output context: " + GetErrorString(error));
+	}
+	~OutputFile() {
+		if(m_format_context != NULL) {
+			if(m_started)
+				av_write_trailer(m_format_context);
+			if(!(m_format_context->oformat->flags & AVFMT_NOFILE))
+				avio_closep(&m_format_context->pb);
+			avformat_free_context(m_format_context);
+		}
+	}
+
+	OutputFile(const OutputFile&) = delete;
+	OutputFile& operator=(const OutputFile&) = delete;
+
+	AVStream* AddStream() {
+		AVStream *stream = avformat_new_stream(m_format_context, NULL);
+		if(stream == NULL)
+			throw RecoverException("Can't create output stream.");
+		return stream;
+	}
+
+	void Start() {
+		if(!(m_format_context->oformat->flags & AVFMT_NOFILE)) {
+			int error = avio_open(&m_format_context->pb, m_filename.c_str(), AVIO_FLAG_WRITE);
+			if(error < 0)
+				throw RecoverException("Can't open output file: " + GetErrorString(error));
+		}
+		int error = avformat_write_header(m_format_context, NULL);
+		if(error < 0)
+			throw RecoverException("Can't write header: " + GetErrorString(error));
+		m_started = true;
+	}
+
+	// Writes a packet. The timestamps are rescaled from the given time base to the time base of the output stream.
+	void WritePacket(AVPacket* packet, AVRational time_base) {
+		av_packet_rescale_ts(packet, time_base, m_format_context->streams[packet->stream_index]->time_base);
+		int error = av_interleaved_write_frame(m_format_context, packet);
+		if(error < 0)
+			throw RecoverException("Can't write packet: " + GetErrorString(error));
+	}
+
+	void Finish() {
+		m_started = false;
+		int error = av_write_trailer(m_format_context);
+		if(error < 0)
+			throw RecoverException("Can't write trailer: " + GetErrorString(error));
+	}
+
+};
+
+// Rebuilds the file using the packet offsets in the journal. This is used for MP4/MOV.
+static void RecoverContiguous(const std::string& input_file, const std::string& output_file, const JournalData& journal, std::vector<StreamStats>* stats) {
+
+	FILE *input = fopen(input_file.c_str(), "rb");
+	if(input == NULL)
+		throw RecoverException("Can't open input file.");
+	std::unique_ptr<FILE, int (*)(FILE*)> input_closer(input, &fclose);
+	struct stat statinfo;
+	if(fstat(fileno(input), &statinfo) != 0)
+		throw RecoverException("Can't get the size of the input file.");
+	uint64_t input_size = statinfo.st_size;
+
+	// create the streams
+	OutputFile output(output_file, GetName(journal.m_header.container_name).c_str());
+	std::vector<bool> annexb(journal.m_streams.size(), false);
+	for(unsigned int i = 0; i < journal.m_streams.size(); ++i) {
+		const JournalStream &info = journal.m_streams[i];
+		const AVCodecDescriptor *descriptor = avcodec_descriptor_get_by_name(GetName(info.codec_name).c_str());
+		if(descriptor == NULL)
+			throw RecoverException("Unknown codec '" + GetName(info.codec_name) + "'.");
+		AVStream *stream = output.AddStream();
+		AVCodecParameters *par = stream->codecpar;
+		par->codec_id = descriptor->id;
+		par->bit_rate = info.bit_rate;
+		if(info.type == JOURNAL_STREAM_TYPE_VIDEO) {
+			par->codec_type = AVMEDIA_TYPE_VIDEO;
+			par->width = info.width;
+			par->height = info.height;
+			par->sample_aspect_ratio = av_make_q(info.sample_aspect_ratio_num, info.sample_aspect_ratio_den);
+			par->format = av_get_pix_fmt(GetName(info.pixel_format).c_str());
+			stream->sample_aspect_ratio = par->sample_aspect_ratio;
+		} else {
+			par->codec_type = AVMEDIA_TYPE_AUDIO;
+			par->sample_rate = info.sample_rate;
+			par->frame_size = info.frame_size;
+			par->format = av_get_sample_fmt(GetName(info.sample_format).c_str());
+#if SSR_USE_CODECPAR_CH_LAYOUT
+			av_channel_layout_default(&par->ch_layout, info.channels);
+#else
+			par->channels = info.channels;
+			par->channel_layout = av_get_default_channel_layout(info.channels);
+#endif
+		}
+		const std::vector<uint8_t> &extradata = journal.m_extradata[i];
+		if(!extradata.empty()) {
+			par->extradata = (uint8_t*) av_mallocz(extradata.size() + AV_INPUT_BUFFER_PADDING_SIZE);
+			if(par->extradata == NULL)
+				throw std::bad_alloc();
+			memcpy(par->extradata, extradata.data(), extradata.size());
+			par->extradata_size = extradata.size();
+		}
+		stream->time_base = av_make_q(info.time_base_num, info.time_base_den);
+		annexb[i] = ((descriptor->id == AV_CODEC_ID_H264 || descriptor->id == AV_CODEC_ID_HEVC) && IsAnnexB(extradata));
+	}
+	output.Start();
+
+	// copy the packets that made it to the input file
+	// The packets are stored in the order in which they were written, so everything after the first missing packet is missing as well.
+	std::unique_ptr<AVPacket, void (*)(AVPacket*)> packet(av_packet_alloc(), [](AVPacket* p) { av_packet_free(&p); });
+	if(packet == NULL)
+		throw std::bad_alloc();
+	for(const JournalPacket &record : journal.m_packets) {
+		if(record.size == 0 || record.offset < journal.m_header.data_start || record.offset + record.size > input_size)
+			break;
+		const JournalStream &info = journal.m_streams[record.stream_index];
+		AVRational time_base = av_make_q(info.time_base_num, info.time_base_den);
+		if(av_new_packet(packet.get(), record.size) < 0)
+			throw std::bad_alloc();
+		if(fseeko(input, record.offset, SEEK_SET) != 0 || fread(packet->data, 1, record.size, input) != record.size)
+			throw RecoverException("Can't read from input file.");
+		if(annexb[record.stream_index])
+			ConvertToAnnexB(packet->data, packet->size);
+		packet->stream_index = record.stream_index;
+		packet->pts = (record.pts == JOURNAL_NOPTS_VALUE)? AV_NOPTS_VALUE : record.pts;
+		packet->dts = (record.dts == JOURNAL_NOPTS_VALUE)? AV_NOPTS_VALUE : record.dts;
+		packet->duration = record.duration;
+		packet->flags = (record.flags & JOURNAL_PACKET_FLAG_KEY)? AV_PKT_FLAG_KEY : 0;
+		output.WritePacket(packet.get(), time_base);
+		av_packet_unref(packet.get());
+		StreamStats &s = (*stats)[record.stream_index];
+		++s.m_packets_recovered;
+		s.m_end_time_recovered = std::max(s.m_end_time_recovered, GetEndTime(record.pts, record.dts, record.duration, time_base));
+	}
+	output.Finish();
+
+}
+
+// Remuxes the file with libavformat. This works for containers that can be read without an index, like Matroska, WebM, OGG and MPEG-TS.
+static void RecoverRemux(const std::string& input_file, const std::string& output_file, const char* container_name, std::vector<StreamStats>* stats) {
+
+	AVFormatContext *input = NULL;
+	int error = avformat_open_input(&input, input_file.c_str(), NULL, NULL);
+	if(error < 0)
+		throw RecoverException("Can't open input file: " + GetErrorString(error));
+	std::unique_ptr<AVFormatContext*, void (*)(AVFormatContext**)> input_closer(&input, &avformat_close_input);
+	error = avformat_find_stream_info(input, NULL);
+	if(error < 0)
+		throw RecoverException("Can't read stream info: " + GetErrorString(error));
+
+	// create the streams
+	OutputFile output(output_file, container_name);
+	for(unsigned int i = 0; i < input->nb_streams; ++i) {
+		AVStream *stream = output.AddStream();
+		if(avcodec_parameters_copy(stream->codecpar, input->streams[i]->codecpar) < 0)
+			throw RecoverException("Can't copy stream parameters.");
+		stream->codecpar->codec_tag = 0;
+		stream->time_base = input->streams[i]->time_base;
+		stream->sample_aspect_ratio = input->streams[i]->sample_aspect_ratio;
+	}
+	output.Start();
+
+	// copy the packets until the end of the file (or the first error)
+	if(stats->size() < input->nb_streams)
+		stats->resize(input->nb_streams, StreamStats{0, 0, 0.0, 0.0});
+	std::unique_ptr<AVPacket, void (*)(AVPacket*)> packet(av_packet_alloc(), [](AVPacket* p) { av_packet_free(&p); });
+	if(packet == NULL)
+		throw std::bad_alloc();
+	while(av_read_frame(input, packet.get()) >= 0) {
+		AVRational time_base = input->streams[packet->stream_index]->time_base;
+		StreamStats &s = (*stats)[packet->stream_index];
+		++s.m_packets_recovered;
+		s.m_end_time_recovered = std::max(s.m_end_time_recovered, GetEndTime(packet->pts, packet->dts, packet->duration, time_base));
+		output.WritePacket(packet.get(), time_base);
+		av_packet_unref(packet.get());
+	}
+	output.Finish();
+
+}
+
+int main(int argc, char* argv[]) {
+
+	if(argc < 2 || argc > 3) {
+		std::cerr << "Usage: " << argv[0] << " INPUT [OUTPUT]" << std::endl;
+		return 1;
+	}
+	std::string input_file = argv[1];
+	std::string journal_file = GetJournalFile(input_file);
+	std::string output_file = (argc == 3)? argv[2] : GetDefaultOutputFile(input_file);
+
+	try {
+
+		if(!FileExists(input_file))
+			throw RecoverException("The input file doesn't exist.");
+		if(FileExists(output_file))
+			throw RecoverException("The output file '" + output_file + "' already exists.");
+
+		// read the journal
+		JournalData journal;
+		bool have_journal = ReadJournal(journal_file, &journal);
+		if(have_journal) {
+			std::cout << "Journal: container " << GetName(journal.m_header.container_name) << ", " << journal.m_streams.size() << " streams, "
+					  << journal.m_packets.size() << " packets" << std::endl;
+		} else {
+			std::cout << "Journal '" << journal_file << "' not found, trying to remux the file without it." << std::endl;
+		}
+
+		// recover the file
+		std::vector<StreamStats> stats(journal.m_streams.size(), StreamStats{0, 0, 0.0, 0.0});
+		for(const JournalPacket &record : journal.m_packets) {
+			const JournalStream &info = journal.m_streams[record.stream_index];
+			StreamStats &s = stats[record.stream_index];
+			++s.m_packets_total;
+			s.m_end_time_total = std::max(s.m_end_time_total, GetEndTime(record.pts, record.dts, record.duration, av_make_q(info.time_base_num, info.time_base_den)));
+		}
+		if(have_journal && (journal.m_header.flags & JOURNAL_FLAG_CONTIGUOUS_PACKETS)) {
+			RecoverContiguous(input_file, output_file, journal, &stats);
+		} else {
+			RecoverRemux(input_file, output_file, (have_journal)? GetName(journal.m_header.container_name).c_str() : NULL, &stats);
+		}
+
+		// print the result
+		for(unsigned int i = 0; i < stats.size(); ++i) {
+			std::cout << "Stream " << i << ": recovered " << stats[i].m_packets_recovered << " packets, " << stats[i].m_end_time_recovered << " seconds";
+			if(have_journal)
+				std::cout << " (journal: " << stats[i].m_packets_total << " packets, " << stats[i].m_end_time_total << " seconds)";
+			std::cout << std::endl;
+		}
+		std::cout << "Recovered file written to '" << output_file << "'." << std::endl;
+
+	} catch(const std::exception& e) {
+		std::cerr << "Error: " << e.what() << std::endl;
+		return 1;
+	}
+
+	return 0;
+}
@@ -0,0 +1,66 @@
+/*
+Copyright (c) 2012-2020 Maarten Baert <maarten-baert@hotmail.com>
+
+This file is part of SimpleScreenRecorder.
+
+SimpleScreenRecorder is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+SimpleScreenRecorder is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with SimpleScreenRecorder.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#include "CursorBlend.h"
+
+#include "CPUFeatures.h"
+
+void CursorBlend_BGRA(const uint32_t* cursor_data, unsigned int cursor_width, unsigned int cursor_height, int cursor_x, int cursor_y,
+					  uint8_t* image_data, int image_stride, unsigned int image_width, unsigned int image_height) {
+
+	// calculate the part of the cursor that's visible
+	int cursor_left = std::max(0, -cursor_x), cursor_right = std::min((int) cursor_width, (int) image_width - cursor_x);
+	int cursor_top = std::max(0, -cursor_y), cursor_bottom = std::min((int) cursor_height, (int) image_height - cursor_y);
+	if(cursor_left >= cursor_right || cursor_top >= cursor_bottom)
+		return;
+
+	unsigned int w = cursor_right - cursor_left, h = cursor_bottom - cursor_top;
+	const uint32_t *in_data = cursor_data + (size_t) cursor_width * (size_t) cursor_top + (size_t) cursor_left;
+	int in_stride = cursor_width * 4;
+	uint8_t *out_data = image_data + (ptrdiff_t) image_stride * (ptrdiff_t) (cursor_y + cursor_top) + (ptrdiff_t) (cursor_x + cursor_left) * 4;
+
+#if SSR_USE_X86_ASM
+	if(CPUFeatures::HasSSE2()) {
+		CursorBlend_BGRA_SSE2(w, h, in_data, in_stride, out_data, image_stride);
+		return;
+	}
+#endif
+
+	CursorBlend_BGRA_Fallback(w, h, in_data, in_stride, out_data, image_stride);
+
+}
+
+void CursorBlend_BGRA_Fallback(unsigned int w, unsigned int h, const uint32_t* in_data, int in_stride, uint8_t* out_data, int out_stride) {
+	for(unsigned int j = 0; j < h; ++j) {
+		const uint32_t *in = (const uint32_t*) ((const uint8_t*) in_data + in_stride * (int) j);
+		uint8_t *out = out_data + out_stride * (int) j;
+		for(unsigned int i = 0; i < w; ++i) {
+			uint32_t cursor_pixel = in[i];
+			int cursor_a = (uint8_t) (cursor_pixel >> 24);
+			int cursor_r = (uint8_t) (cursor_pixel >> 16);
+			int cursor_g = (uint8_t) (cursor_pixel >> 8);
+			int cursor_b = (uint8_t) (cursor_pixel >> 0);
+			out[2] = std::min(255, (out[2] * (255 - cursor_a) + 127) / 255 + cursor_r);
+			out[1] = std::min(255, (out[1] * (255 - cursor_a) + 127) / 255 + cursor_g);
+			out[0] = std::min(255, (out[0] * (255 - cursor_a) + 127) / 255 + cursor_b);
+			out += 4;
+		}
+	}
+}
@@ -0,0 +1,33 @@
+/*
+Copyright (c) 2012-2020 Maarten Baert <maarten-baert@hotmail.com>
+
+This file is part of SimpleScreenRecorder.
+
+SimpleScreenRecorder is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+SimpleScreenRecorder is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with SimpleScreenRecorder.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#pragma once
+#include "Global.h"
+
+// Draws a cursor image on top of a BGRA image. The cursor image uses 32-bit ARGB pixels with premultiplied alpha (like XFixes cursors).
+// The cursor is clipped to the image, so the position can be anywhere. The alpha channel of the image is not changed.
+void CursorBlend_BGRA(const uint32_t* cursor_data, unsigned int cursor_width, unsigned int cursor_height, int cursor_x, int cursor_y,
+					  uint8_t* image_data, int image_stride, unsigned int image_width, unsigned int image_height);
+
+void CursorBlend_BGRA_Fallback(unsigned int w, unsigned int h, const uint32_t* in_data, int in_stride, uint8_t* out_data, int out_stride);
+
+#if SSR_USE_X86_ASM
+void CursorBlend_BGRA_SSE2(unsigned int w, unsigned int h, const uint32_t* in_data, int in_stride, uint8_t* out_data, int out_stride);
+#endif
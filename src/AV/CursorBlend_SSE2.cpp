@@ -0,0 +1,80 @@
+/*
+Copyright (c) 2012-2020 Maarten Baert <maarten-baert@hotmail.com>
+
+This file is part of SimpleScreenRecorder.
+
+SimpleScreenRecorder is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+SimpleScreenRecorder is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with SimpleScreenRecorder.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#include "CursorBlend.h"
+
+#if SSR_USE_X86_ASM
+
+#include <emmintrin.h> // sse2
+
+/*
+==== SSE2 Cursor Blender ====
+
+Same calculation as the fallback blender, but 4 pixels at once using 16-bit integers. The division by 255 with rounding is done as
+(x + 128 + ((x + 128) >> 8)) >> 8, which gives exactly the same result as (x + 127) / 255 for the range that is used here.
+The remaining pixels at the end of each row are handled by the fallback blender.
+
+*/
+
+void CursorBlend_BGRA_SSE2(unsigned int w, unsigned int h, const uint32_t* in_data, int in_stride, uint8_t* out_data, int out_stride) {
+
+	__m128i v_zero = _mm_setzero_si128();
+	__m128i v_255 = _mm_set1_epi16(255);
+	__m128i v_128 = _mm_set1_epi16(128);
+	__m128i v_alpha = _mm_set1_epi32(0xff000000);
+
+	unsigned int w4 = w / 4;
+	for(unsigned int j = 0; j < h; ++j) {
+		const uint32_t *in = (const uint32_t*) ((const uint8_t*) in_data + in_stride * (int) j);
+		uint8_t *out = out_data + out_stride * (int) j;
+		for(unsigned int i = 0; i < w4; ++i) {
+			__m128i v_cursor = _mm_loadu_si128((const __m128i*) in);
+			__m128i v_image = _mm_loadu_si128((const __m128i*) out);
+
+			// expand to 16-bit and get the inverse cursor alpha for each channel
+			__m128i v_cursor_lo = _mm_unpacklo_epi8(v_cursor, v_zero), v_cursor_hi = _mm_unpackhi_epi8(v_cursor, v_zero);
+			__m128i v_image_lo = _mm_unpacklo_epi8(v_image, v_zero), v_image_hi = _mm_unpackhi_epi8(v_image, v_zero);
+			__m128i v_inv_lo = _mm_sub_epi16(v_255, _mm_shufflehi_epi16(_mm_shufflelo_epi16(v_cursor_lo, 0xff), 0xff));
+			__m128i v_inv_hi = _mm_sub_epi16(v_255, _mm_shufflehi_epi16(_mm_shufflelo_epi16(v_cursor_hi, 0xff), 0xff));
+
+			// image * (255 - alpha) / 255
+			__m128i v_mul_lo = _mm_add_epi16(_mm_mullo_epi16(v_image_lo, v_inv_lo), v_128);
+			__m128i v_mul_hi = _mm_add_epi16(_mm_mullo_epi16(v_image_hi, v_inv_hi), v_128);
+			v_mul_lo = _mm_srli_epi16(_mm_add_epi16(v_mul_lo, _mm_srli_epi16(v_mul_lo, 8)), 8);
+			v_mul_hi = _mm_srli_epi16(_mm_add_epi16(v_mul_hi, _mm_srli_epi16(v_mul_hi, 8)), 8);
+
+			// add the cursor and keep the original alpha
+			__m128i v_result = _mm_adds_epu8(_mm_packus_epi16(v_mul_lo, v_mul_hi), v_cursor);
+			v_result = _mm_or_si128(_mm_andnot_si128(v_alpha, v_result), _mm_and_si128(v_alpha, v_image));
+			_mm_storeu_si128((__m128i*) out, v_result);
+
+			in += 4;
+			out += 16;
+		}
+	}
+
+	// remaining pixels
+	if(w % 4 != 0) {
+		CursorBlend_BGRA_Fallback(w % 4, h, (const uint32_t*) ((const uint8_t*) in_data + w4 * 16), in_stride, out_data + w4 * 16, out_stride);
+	}
+
+}
+
+#endif
@@ -0,0 +1,105 @@
+/*
+Copyright (c) 2012-2020 Maarten Baert <maarten-baert@hotmail.com>
+
+This file is part of SimpleScreenRecorder.
+
+SimpleScreenRecorder is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+SimpleScreenRecorder is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with SimpleScreenRecorder.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "FrameAccounting.h"
+
+#include "Logger.h"
+
+const FrameAccounting::ReasonInfo FrameAccounting::REASON_INFO[FrameAccounting::REASON_COUNT] = {
+	{"input", "missed", false},
+	{"glinject", "ring_full", false},
+	{"glinject", "too_large", false},
+	{"sync", "too_early", false},
+	{"sync", "overflow", false},
+	{"sync", "collision", false},
+	{"output", "throttle", false},
+	{"sync", "gap", true},
+};
+
+std::atomic<int64_t> FrameAccounting::s_reset_time(0);
+std::atomic<uint64_t> FrameAccounting::s_counts[FrameAccounting::REASON_COUNT];
+std::atomic<int64_t> FrameAccounting::s_first_times[FrameAccounting::REASON_COUNT], FrameAccounting::s_last_times[FrameAccounting::REASON_COUNT];
+
+void FrameAccounting::Reset() {
+	for(unsigned int i = 0; i < REASON_COUNT; ++i) {
+		s_counts[i] = 0;
+		s_first_times[i] = 0;
+		s_last_times[i] = 0;
+	}
+	s_reset_time = hrt_time_micro();
+}
+
+void FrameAccounting::Add(Reason reason, uint64_t count) {
+	if(count == 0)
+		return;
+	// zero means that there was no event yet, hrt_time_micro() is never zero
+	int64_t timestamp = hrt_time_micro(), expected = 0;
+	s_counts[reason].fetch_add(count, std::memory_order_relaxed);
+	s_first_times[reason].compare_exchange_strong(expected, timestamp, std::memory_order_relaxed);
+	s_last_times[reason].store(timestamp, std::memory_order_relaxed);
+}
+
+FrameAccounting::Counter FrameAccounting::GetCounter(Reason reason) {
+	int64_t reset_time = s_reset_time.load(std::memory_order_relaxed);
+	int64_t first_time = s_first_times[reason].load(std::memory_order_relaxed), last_time = s_last_times[reason].load(std::memory_order_relaxed);
+	Counter counter;
+	counter.m_count = s_counts[reason].load(std::memory_order_relaxed);
+	counter.m_first_time = (first_time == 0)? -1 : std::max((int64_t) 0, first_time - reset_time);
+	counter.m_last_time = (last_time == 0)? -1 : std::max((int64_t) 0, last_time - reset_time);
+	return counter;
+}
+
+QString FrameAccounting::GetStatsString() {
+	uint64_t total_dropped = 0, total_duplicated = 0;
+	QString str;
+	for(unsigned int i = 0; i < REASON_COUNT; ++i) {
+		Reason reason = (Reason) i;
+		Counter counter = GetCounter(reason);
+		if(IsDuplicate(reason))
+			total_duplicated += counter.m_count;
+		else
+			total_dropped += counter.m_count;
+		QString key = QString((IsDuplicate(reason))? "frames_duplicated_" : "frames_dropped_") + GetStageName(reason) + "_" + GetReasonName(reason);
+		str += key + "\t" + QString::number(counter.m_count) + "\n"
+				+ key + "_first\t" + QString::number((counter.m_first_time < 0)? -1 : counter.m_first_time / 1000) + "\n"
+				+ key + "_last\t" + QString::number((counter.m_last_time < 0)? -1 : counter.m_last_time / 1000) + "\n";
+	}
+	return "frames_dropped\t" + QString::number(total_dropped) + "\n"
+			"frames_duplicated\t" + QString::number(total_duplicated) + "\n" + str;
+}
+
+void FrameAccounting::LogSummary() {
+	uint64_t total_dropped = 0, total_duplicated = 0;
+	for(unsigned int i = 0; i < REASON_COUNT; ++i) {
+		if(IsDuplicate((Reason) i))
+			total_duplicated += GetCounter((Reason) i).m_count;
+		else
+			total_dropped += GetCounter((Reason) i).m_count;
+	}
+	Logger::LogInfo("[FrameAccounting::LogSummary] " + Logger::tr("Video frames dropped: %1, duplicated: %2.").arg(total_dropped).arg(total_duplicated));
+	for(unsigned int i = 0; i < REASON_COUNT; ++i) {
+		Reason reason = (Reason) i;
+		Counter counter = GetCounter(reason);
+		if(counter.m_count == 0)
+			continue;
+		Logger::LogInfo("[FrameAccounting::LogSummary] " + Logger::tr("    %1/%2: %3 frames (first after %4 s, last after %5 s)")
+						.arg(GetStageName(reason)).arg(GetReasonName(reason)).arg(counter.m_count)
+						.arg((double) counter.m_first_time * 1.0e-6, 0, 'f', 3).arg((double) counter.m_last_time * 1.0e-6, 0, 'f', 3));
+	}
+}
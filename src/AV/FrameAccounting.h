@@ -0,0 +1,81 @@
+/*
+Copyright (c) 2012-2020 Maarten Baert <maarten-baert@hotmail.com>
+
+This file is part of SimpleScreenRecorder.
+
+SimpleScreenRecorder is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+SimpleScreenRecorder is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with SimpleScreenRecorder.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+#include "Global.h"
+
+// Counts the video frames that are dropped or duplicated anywhere in the pipeline, for each stage and reason, so it is possible to tell
+// which bottleneck caused a bad recording. Only the main video track is counted. The counters are global (like the thread heartbeats)
+// because the frames are dropped in many different places, and they are lock-free so they can be updated from any thread.
+class FrameAccounting {
+
+public:
+	enum Reason {
+		REASON_INPUT_MISSED, // the input delivered a frame more than one frame interval too late, the frames in between were never captured
+		REASON_GLINJECT_RING_FULL, // the application couldn't store a frame because the ring buffer was full
+		REASON_GLINJECT_TOO_LARGE, // the application couldn't store a frame because it didn't fit in the shared memory slot
+		REASON_SYNC_TOO_EARLY, // the frame arrived before the synchronizer needed it
+		REASON_SYNC_OVERFLOW, // the video buffer of the synchronizer was full (usually because the audio input is too slow)
+		REASON_SYNC_COLLISION, // the frame ended up in the same output frame as the previous frame
+		REASON_OUTPUT_THROTTLE, // the output frame was skipped because the encoder queue was too long
+		REASON_SYNC_DUPLICATE, // the previous frame was duplicated to fill a gap (this is not a drop)
+		REASON_COUNT // must be last
+	};
+
+	struct Counter {
+		uint64_t m_count;
+		int64_t m_first_time, m_last_time; // time of the first and last event since the last reset (in microseconds), or -1 if there were none
+	};
+
+private:
+	struct ReasonInfo {
+		const char *m_stage, *m_name;
+		bool m_duplicate;
+	};
+
+private:
+	static const ReasonInfo REASON_INFO[REASON_COUNT];
+
+private:
+	static std::atomic<int64_t> s_reset_time;
+	static std::atomic<uint64_t> s_counts[REASON_COUNT];
+	static std::atomic<int64_t> s_first_times[REASON_COUNT], s_last_times[REASON_COUNT];
+
+public:
+	// Resets all counters. Called when the recording page is started.
+	static void Reset();
+
+	// Counts 'count' dropped or duplicated frames. This function is lock-free.
+	static void Add(Reason reason, uint64_t count = 1);
+
+	// Returns the counter for one reason.
+	static Counter GetCounter(Reason reason);
+
+	// Returns the statistics in the format of the statistics file.
+	static QString GetStatsString();
+
+	// Writes a summary of all non-zero counters to the log.
+	static void LogSummary();
+
+public:
+	inline static const char* GetStageName(Reason reason) { return REASON_INFO[reason].m_stage; }
+	inline static const char* GetReasonName(Reason reason) { return REASON_INFO[reason].m_name; }
+	inline static bool IsDuplicate(Reason reason) { return REASON_INFO[reason].m_duplicate; }
+
+};
@@ -22,6 +22,7 @@ along with SimpleScreenRecorder.  If not, see <http://www.gnu.org/licenses/>.
 #if SSR_USE_ALSA
 
 #include "Logger.h"
+#include "ThreadWatchdog.h"
 
 #include "TempBuffer.h"
 
@@ -31,6 +32,10 @@ along with SimpleScreenRecorder.  If not, see <http://www.gnu.org/licenses/>.
 // It also eliminates the clicking sound when the microphone is started for the first time.
 const int64_t ALSAInput::START_DELAY = 100000;
 
+// Device timestamps that differ more than this from the current time are ignored (in microseconds).
+// This can happen with plugins that don't support timestamps, or with drivers that use a different clock.
+const int64_t ALSAInput::DEVICE_TIMESTAMP_MAX_ERROR = 200000;
+
 static void ALSARecoverAfterOverrun(snd_pcm_t* pcm) {
 	Logger::LogWarning("[ALSARecoverAfterOverrun] " + Logger::tr("Warning: An overrun has occurred, some samples were lost.", "Don't translate 'overrun'"));
 	if(snd_pcm_prepare(pcm) < 0) {
@@ -402,6 +407,27 @@ void ALSAInput::Init() {
 		throw;
 	}
 
+	// enable device timestamps
+	// These timestamps are recorded by the driver when the hardware pointer is updated, so they are not affected by the scheduling
+	// delays of the input thread. This makes drift correction a lot more accurate. If the device doesn't support this, use the current time instead.
+	m_device_timestamps = false;
+	{
+		snd_pcm_sw_params_t *alsa_sw_params = NULL;
+		if(snd_pcm_sw_params_malloc(&alsa_sw_params) >= 0) {
+			if(snd_pcm_sw_params_current(m_alsa_pcm, alsa_sw_params) >= 0 &&
+					snd_pcm_sw_params_set_tstamp_mode(m_alsa_pcm, alsa_sw_params, SND_PCM_TSTAMP_ENABLE) >= 0 &&
+					snd_pcm_sw_params_set_tstamp_type(m_alsa_pcm, alsa_sw_params, SND_PCM_TSTAMP_TYPE_MONOTONIC) >= 0 &&
+					snd_pcm_sw_params(m_alsa_pcm, alsa_sw_params) >= 0) {
+				m_device_timestamps = true;
+			}
+			snd_pcm_sw_params_free(alsa_sw_params);
+		}
+		if(!m_device_timestamps) {
+			Logger::LogWarning("[ALSAInput::Init] " + Logger::tr("Warning: Device timestamps are not supported, using system timestamps instead. "
+																 "This is not a problem."));
+		}
+	}
+
 	// start PCM device
 	if(snd_pcm_start(m_alsa_pcm) < 0) {
 		Logger::LogError("[ALSAInput::Init] " + Logger::tr("Error: Can't start PCM device!"));
@@ -427,6 +453,8 @@ void ALSAInput::InputThread() {
 
 		Logger::LogInfo("[ALSAInput::InputThread] " + Logger::tr("Input thread started."));
 
+		ThreadHeartbeat heartbeat("ALSAInput");
+
 		// allocate buffer
 		TempBuffer<uint8_t> buffer;
 		switch(m_sample_format) {
@@ -442,9 +470,12 @@ void ALSAInput::InputThread() {
 		while(!m_should_stop) {
 
 			// wait for new samples
+			heartbeat.Beat("wait");
 			int wait = snd_pcm_wait(m_alsa_pcm, 100);
 			if(wait < 0) {
-				if(wait == -EPIPE) {
+				if(wait == -EINTR) { // can be caused by the thread watchdog
+					continue;
+				} else if(wait == -EPIPE) {
 					ALSARecoverAfterOverrun(m_alsa_pcm);
 					PushAudioHole();
 					continue;
@@ -459,9 +490,12 @@ void ALSAInput::InputThread() {
 			int64_t timestamp = hrt_time_micro();
 
 			// read the samples
+			heartbeat.Beat("read");
 			snd_pcm_sframes_t samples_read = snd_pcm_readi(m_alsa_pcm, buffer.GetData(), m_period_size);
 			if(samples_read < 0) {
-				if(samples_read == -EPIPE) {
+				if(samples_read == -EINTR) {
+					continue;
+				} else if(samples_read == -EPIPE) {
 					ALSARecoverAfterOverrun(m_alsa_pcm);
 					PushAudioHole();
 					continue;
@@ -473,6 +507,20 @@ void ALSAInput::InputThread() {
 				continue;
 			}
 
+			// get the timestamp of the first sample
+			// The device timestamp is the time when the hardware pointer was last updated, at that point 'avail' samples were not read yet.
+			int64_t time = timestamp - (int64_t) samples_read * (int64_t) 1000000 / (int64_t) m_sample_rate;
+			if(m_device_timestamps) {
+				snd_pcm_uframes_t avail;
+				snd_htimestamp_t tstamp;
+				if(snd_pcm_htimestamp(m_alsa_pcm, &avail, &tstamp) >= 0) {
+					int64_t device_time = (int64_t) tstamp.tv_sec * (int64_t) 1000000 + (int64_t) (tstamp.tv_nsec / 1000)
+										  - (int64_t) (avail + samples_read) * (int64_t) 1000000 / (int64_t) m_sample_rate;
+					if(device_time > time - DEVICE_TIMESTAMP_MAX_ERROR && device_time < time + DEVICE_TIMESTAMP_MAX_ERROR)
+						time = device_time;
+				}
+			}
+
 			// skip the first samples
 			if(has_first_samples) {
 				if(timestamp > first_timestamp + START_DELAY) {
@@ -486,7 +534,7 @@ void ALSAInput::InputThread() {
 					}
 
 					// push the samples
-					int64_t time = timestamp - (int64_t) samples_read * (int64_t) 1000000 / (int64_t) m_sample_rate;
+					heartbeat.Beat("push");
 					PushAudioSamples(m_channels, m_sample_rate, m_sample_format, samples_read, buffer.GetData(), time);
 
 				}
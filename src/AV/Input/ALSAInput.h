@@ -36,12 +36,13 @@ public:
 	};
 
 private:
-	static const int64_t START_DELAY;
+	static const int64_t START_DELAY, DEVICE_TIMESTAMP_MAX_ERROR;
 
 private:
 	QString m_source_name;
 	AVSampleFormat m_sample_format;
 	bool m_convert_24_to_32;
+	bool m_device_timestamps;
 	unsigned int m_sample_rate, m_channels;
 	unsigned int m_period_size, m_buffer_size;
 
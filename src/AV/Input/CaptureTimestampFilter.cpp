@@ -0,0 +1,68 @@
+/*
+Copyright (c) 2012-2020 Maarten Baert <maarten-baert@hotmail.com>
+
+This file is part of SimpleScreenRecorder.
+
+SimpleScreenRecorder is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+SimpleScreenRecorder is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with SimpleScreenRecorder.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "CaptureTimestampFilter.h"
+
+// Speed at which the copy time estimate follows shorter and longer copies. Shorter copies are trusted more, longer copies are
+// usually caused by server load rather than a change of the capture size.
+static const int64_t COPY_TIME_FALL = 4, COPY_TIME_RISE = 64;
+
+CaptureTimestampFilter::CaptureTimestampFilter() {
+	Reset();
+}
+
+void CaptureTimestampFilter::Reset() {
+	m_copy_time = 0;
+	m_last_copy_end = INT64_MIN;
+	m_has_copy_time = false;
+}
+
+int64_t CaptureTimestampFilter::Filter(int64_t request_time, int64_t reply_time, bool reply_exact) {
+
+	// requests are handled in order, so the copy can't start before the previous copy has ended
+	int64_t copy_start = std::max(request_time, m_last_copy_end);
+	reply_time = std::max(reply_time, copy_start);
+
+	int64_t timestamp;
+	if(reply_exact) {
+
+		// update the copy time
+		int64_t copy_time = reply_time - copy_start;
+		if(!m_has_copy_time) {
+			m_copy_time = copy_time;
+			m_has_copy_time = true;
+		} else if(copy_time < m_copy_time) {
+			m_copy_time += (copy_time - m_copy_time) / COPY_TIME_FALL;
+		} else {
+			m_copy_time += (copy_time - m_copy_time) / COPY_TIME_RISE;
+		}
+
+		// the copy ends right before the reply, unless the reply came faster than expected
+		timestamp = std::max((copy_start + reply_time) / 2, reply_time - m_copy_time / 2);
+
+	} else {
+
+		// the reply may have arrived much earlier, so assume that the copy started right away
+		timestamp = std::min(copy_start + m_copy_time / 2, (copy_start + reply_time) / 2);
+
+	}
+
+	m_last_copy_end = std::min(reply_time, timestamp + m_copy_time / 2);
+	return timestamp;
+}
@@ -0,0 +1,51 @@
+/*
+Copyright (c) 2012-2020 Maarten Baert <maarten-baert@hotmail.com>
+
+This file is part of SimpleScreenRecorder.
+
+SimpleScreenRecorder is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+SimpleScreenRecorder is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with SimpleScreenRecorder.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+#include "Global.h"
+
+// Estimates when an image was actually captured by the X server, based on the time when the request was sent and the time when the
+// reply was received. The server copies the image somewhere in between, but the grab itself can take several milliseconds for large
+// screens, and when the server is busy the request can wait in the queue before it is handled. So neither the request time nor the
+// midpoint of the request and the reply is very accurate. This filter assumes that the copy takes a roughly constant amount of time,
+// and that it ends right before the reply is sent. The copy time is tracked with a filter that follows decreases quickly and increases
+// slowly, so delays caused by server load are mostly ignored. The returned timestamp is the middle of the copy.
+// Requests on the same connection are handled in order, so a copy can't start before the previous one has ended. This matters for
+// pipelined requests, where the reply may have arrived long before it is read.
+class CaptureTimestampFilter {
+
+private:
+	int64_t m_copy_time, m_last_copy_end;
+	bool m_has_copy_time;
+
+public:
+	CaptureTimestampFilter();
+
+	// Forgets the previous captures.
+	void Reset();
+
+	// Returns the estimated capture time (in microseconds). 'request_time' is the time when the request was sent, 'reply_time' is the
+	// time when the reply was received. If 'reply_exact' is false, the reply arrived at some unknown time before 'reply_time'.
+	// The returned timestamps are monotonic as long as the request times are.
+	int64_t Filter(int64_t request_time, int64_t reply_time, bool reply_exact);
+
+	// Returns the current estimate of the time it takes to copy the image (in microseconds).
+	inline int64_t GetCopyTime() { return m_copy_time; }
+
+};
@@ -0,0 +1,294 @@
+/*
+Copyright (c) 2012-2020 Maarten Baert <maarten-baert@hotmail.com>
+
+This file is part of SimpleScreenRecorder.
+
+SimpleScreenRecorder is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+SimpleScreenRecorder is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with SimpleScreenRecorder.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "FileAudioInput.h"
+
+#include "Logger.h"
+#include "FileInputStream.h"
+#include "ThreadWatchdog.h"
+
+// The number of samples that are pushed at once.
+const unsigned int FileAudioInput::BLOCK_SIZE = 1024;
+
+// The maximum time the input will wait for a backlogged sink in fast mode (see FileVideoInput).
+const int64_t FileAudioInput::BACKLOG_TIMEOUT = 2000000;
+
+static inline uint16_t ReadLE16(const uint8_t* data) {
+	return (uint16_t) data[0] | ((uint16_t) data[1] << 8);
+}
+static inline uint32_t ReadLE32(const uint8_t* data) {
+	return (uint32_t) data[0] | ((uint32_t) data[1] << 8) | ((uint32_t) data[2] << 16) | ((uint32_t) data[3] << 24);
+}
+
+FileAudioInput::FileAudioInput(const QString& file, bool fast, AVSampleFormat raw_format, unsigned int raw_sample_rate, unsigned int raw_channels) {
+
+	m_file = file;
+	m_fast = fast;
+	m_sample_format = raw_format;
+	m_sample_rate = raw_sample_rate;
+	m_channels = raw_channels;
+	m_wav = (raw_format == AV_SAMPLE_FMT_NONE);
+
+	m_file_sample_size = (raw_format == AV_SAMPLE_FMT_S16)? 2 : 4;
+	m_data_left = UINT64_MAX;
+
+	try {
+		Init();
+	} catch(...) {
+		Free();
+		throw;
+	}
+
+}
+
+FileAudioInput::~FileAudioInput() {
+
+	// tell the thread to stop
+	if(m_thread.joinable()) {
+		Logger::LogInfo("[FileAudioInput::~FileAudioInput] " + Logger::tr("Stopping input thread ..."));
+		m_should_stop = true;
+		m_thread.join();
+	}
+
+	// free everything
+	Free();
+
+}
+
+AVSampleFormat FileAudioInput::GetRawFormatFromName(const QString& name) {
+	if(name == "s16le")
+		return AV_SAMPLE_FMT_S16;
+	if(name == "s32le")
+		return AV_SAMPLE_FMT_S32;
+	if(name == "f32le")
+		return AV_SAMPLE_FMT_FLT;
+	return AV_SAMPLE_FMT_NONE;
+}
+
+void FileAudioInput::Init() {
+
+	m_should_stop = false;
+	m_error_occurred = false;
+	m_end_of_file = false;
+
+	// open the file and read the header
+	m_stream.reset(new FileInputStream(m_file));
+	if(m_wav)
+		ReadWAVHeader();
+
+	// check the parameters
+	if(m_channels == 0 || m_channels > 32) {
+		Logger::LogError("[FileAudioInput::Init] " + Logger::tr("Error: The number of channels is not supported!"));
+		throw FileInputException();
+	}
+	if(m_sample_rate < 1000 || m_sample_rate > 1000000) {
+		Logger::LogError("[FileAudioInput::Init] " + Logger::tr("Error: The sample rate is not supported!"));
+		throw FileInputException();
+	}
+	Logger::LogInfo("[FileAudioInput::Init] " + Logger::tr("Reading audio file '%1' (%2 Hz, %3 channels).").arg(m_file).arg(m_sample_rate).arg(m_channels));
+
+	// start input thread
+	m_thread = std::thread(&FileAudioInput::InputThread, this);
+
+}
+
+void FileAudioInput::Free() {
+	m_stream.reset();
+}
+
+void FileAudioInput::ReadWAVHeader() {
+
+	// read the RIFF header
+	uint8_t header[12];
+	if(m_stream->Read(header, 12, &m_should_stop) != 12 || memcmp(header, "RIFF", 4) != 0 || memcmp(header + 8, "WAVE", 4) != 0) {
+		Logger::LogError("[FileAudioInput::ReadWAVHeader] " + Logger::tr("Error: The input file is not a WAV file!"));
+		throw FileInputException();
+	}
+
+	// read chunks until the data chunk is found, the samples follow directly after it
+	bool has_format = false;
+	unsigned int format_tag = 0, bits = 0;
+	for( ; ; ) {
+		uint8_t chunk[8];
+		if(m_stream->Read(chunk, 8, &m_should_stop) != 8) {
+			Logger::LogError("[FileAudioInput::ReadWAVHeader] " + Logger::tr("Error: The WAV file has no data chunk!"));
+			throw FileInputException();
+		}
+		uint32_t size = ReadLE32(chunk + 4);
+		if(memcmp(chunk, "fmt ", 4) == 0) {
+			if(size < 16 || size > 1024) {
+				Logger::LogError("[FileAudioInput::ReadWAVHeader] " + Logger::tr("Error: The WAV format chunk is invalid!"));
+				throw FileInputException();
+			}
+			uint8_t format[1024];
+			if(m_stream->Read(format, size, &m_should_stop) != size || !m_stream->Skip(size & 1, &m_should_stop)) {
+				Logger::LogError("[FileAudioInput::ReadWAVHeader] " + Logger::tr("Error: The WAV format chunk is incomplete!"));
+				throw FileInputException();
+			}
+			format_tag = ReadLE16(format);
+			m_channels = ReadLE16(format + 2);
+			m_sample_rate = ReadLE32(format + 4);
+			bits = ReadLE16(format + 14);
+			if(format_tag == 0xfffe && size >= 26)
+				format_tag = ReadLE16(format + 24); // WAVE_FORMAT_EXTENSIBLE, the real format is in the sub-format GUID
+			has_format = true;
+		} else if(memcmp(chunk, "data", 4) == 0) {
+			// pipes can't seek back to write the size, so they often use zero or the maximum
+			m_data_left = (size == 0 || size == 0xffffffff)? UINT64_MAX : size;
+			break;
+		} else {
+			if(!m_stream->Skip((uint64_t) size + (size & 1), &m_should_stop)) {
+				Logger::LogError("[FileAudioInput::ReadWAVHeader] " + Logger::tr("Error: The WAV file has no data chunk!"));
+				throw FileInputException();
+			}
+		}
+	}
+	if(!has_format) {
+		Logger::LogError("[FileAudioInput::ReadWAVHeader] " + Logger::tr("Error: The WAV file has no format chunk!"));
+		throw FileInputException();
+	}
+
+	// 24-bit samples are converted to 32-bit, the other formats are pushed directly
+	if(format_tag == 1 && bits == 16) {
+		m_sample_format = AV_SAMPLE_FMT_S16;
+		m_file_sample_size = 2;
+	} else if(format_tag == 1 && bits == 24) {
+		m_sample_format = AV_SAMPLE_FMT_S32;
+		m_file_sample_size = 3;
+	} else if(format_tag == 1 && bits == 32) {
+		m_sample_format = AV_SAMPLE_FMT_S32;
+		m_file_sample_size = 4;
+	} else if(format_tag == 3 && bits == 32) {
+		m_sample_format = AV_SAMPLE_FMT_FLT;
+		m_file_sample_size = 4;
+	} else {
+		Logger::LogError("[FileAudioInput::ReadWAVHeader] " + Logger::tr("Error: WAV sample format %1 with %2 bits is not supported, only 16, 24 or 32-bit PCM and 32-bit float are supported!")
+						 .arg(format_tag).arg(bits));
+		throw FileInputException();
+	}
+
+}
+
+unsigned int FileAudioInput::ReadSamples() {
+
+	// read the next block, up to the end of the data chunk
+	size_t frame_size = m_file_sample_size * m_channels;
+	size_t size = (size_t) std::min((uint64_t) BLOCK_SIZE * frame_size, m_data_left);
+	m_file_buffer.Alloc(size);
+	size_t done = m_stream->Read(m_file_buffer.GetData(), size, &m_should_stop);
+	if(m_data_left != UINT64_MAX)
+		m_data_left -= done;
+	if(done % frame_size != 0 && !m_should_stop)
+		Logger::LogWarning("[FileAudioInput::ReadSamples] " + Logger::tr("Warning: The last sample of the input file is incomplete."));
+	unsigned int sample_count = done / frame_size;
+
+	// convert 24-bit samples to 32-bit (the samples are little-endian, like the native format of the CPU)
+	if(m_file_sample_size == 3) {
+		m_convert_buffer.Alloc(sample_count * m_channels * sizeof(int32_t));
+		const uint8_t *in = m_file_buffer.GetData();
+		int32_t *out = (int32_t*) m_convert_buffer.GetData();
+		for(size_t i = 0; i < sample_count * m_channels; ++i) {
+			out[i] = (int32_t) (((uint32_t) in[3 * i] << 8) | ((uint32_t) in[3 * i + 1] << 16) | ((uint32_t) in[3 * i + 2] << 24));
+		}
+	}
+
+	return sample_count;
+
+}
+
+void FileAudioInput::InputThread() {
+	try {
+
+		Logger::LogInfo("[FileAudioInput::InputThread] " + Logger::tr("Input thread started."));
+
+		ThreadHeartbeat heartbeat("FileAudioInput");
+
+		int64_t start_timestamp = hrt_time_micro(), pause_timestamp = 0;
+		bool paused = false;
+		uint64_t position = 0;
+
+		while(!m_should_stop) {
+
+			// the file doesn't advance while nothing is connected (e.g. when the recording is paused)
+			heartbeat.Beat("wait");
+			if(!HasAudioSinks()) {
+				if(!paused) {
+					paused = true;
+					pause_timestamp = hrt_time_micro();
+				}
+				usleep(20000);
+				continue;
+			}
+			if(paused) {
+				paused = false;
+				start_timestamp += hrt_time_micro() - pause_timestamp;
+			}
+
+			// in fast mode, wait until the sinks can accept more samples
+			if(m_fast) {
+				int64_t wait_start = hrt_time_micro();
+				while(!m_should_stop && IsAudioBacklogged() && hrt_time_micro() < wait_start + BACKLOG_TIMEOUT) {
+					heartbeat.Beat("wait for sink");
+					usleep(1000);
+				}
+			}
+
+			// read the samples
+			heartbeat.Beat("read");
+			unsigned int sample_count = ReadSamples();
+			if(sample_count == 0) {
+				if(!m_should_stop) {
+					Logger::LogInfo("[FileAudioInput::InputThread] " + Logger::tr("Reached the end of the audio file."));
+					m_end_of_file = true;
+				}
+				break;
+			}
+
+			// in real-time mode, wait until the last sample would have been recorded, like a live input
+			int64_t timestamp = start_timestamp + (int64_t) (position * 1000000 / m_sample_rate);
+			if(!m_fast) {
+				int64_t end_timestamp = start_timestamp + (int64_t) ((position + sample_count) * 1000000 / m_sample_rate);
+				for( ; ; ) {
+					int64_t wait = end_timestamp - hrt_time_micro();
+					if(m_should_stop || wait <= 0)
+						break;
+					// the thread can't sleep for too long because it still has to check the m_should_stop flag periodically
+					heartbeat.Beat("wait");
+					usleep(std::min(wait, (int64_t) 20000));
+				}
+			}
+
+			// push the samples
+			heartbeat.Beat("push");
+			const uint8_t *data = (m_file_sample_size == 3)? m_convert_buffer.GetData() : m_file_buffer.GetData();
+			PushAudioSamples(m_channels, m_sample_rate, m_sample_format, sample_count, data, timestamp);
+			position += sample_count;
+
+		}
+
+		Logger::LogInfo("[FileAudioInput::InputThread] " + Logger::tr("Input thread stopped."));
+
+	} catch(const std::exception& e) {
+		m_error_occurred = true;
+		Logger::LogError("[FileAudioInput::InputThread] " + Logger::tr("Exception '%1' in input thread.").arg(e.what()));
+	} catch(...) {
+		m_error_occurred = true;
+		Logger::LogError("[FileAudioInput::InputThread] " + Logger::tr("Unknown exception in input thread."));
+	}
+}
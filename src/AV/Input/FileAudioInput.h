@@ -0,0 +1,79 @@
+/*
+Copyright (c) 2012-2020 Maarten Baert <maarten-baert@hotmail.com>
+
+This file is part of SimpleScreenRecorder.
+
+SimpleScreenRecorder is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+SimpleScreenRecorder is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with SimpleScreenRecorder.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+#include "Global.h"
+
+#include "SourceSink.h"
+#include "TempBuffer.h"
+
+class FileInputStream;
+
+// Reads audio samples from a WAV or raw PCM file (or a pipe) and pushes them like a live input.
+// The pacing modes are the same as for FileVideoInput.
+class FileAudioInput : public AudioSource {
+
+private:
+	static const unsigned int BLOCK_SIZE;
+	static const int64_t BACKLOG_TIMEOUT;
+
+private:
+	QString m_file;
+	bool m_fast;
+	AVSampleFormat m_sample_format;
+	unsigned int m_sample_rate, m_channels;
+	bool m_wav;
+
+	std::unique_ptr<FileInputStream> m_stream;
+	unsigned int m_file_sample_size; // the size of one sample in the file, can be 3 for 24-bit WAV
+	uint64_t m_data_left; // the number of bytes left in the WAV data chunk, or UINT64_MAX if unknown
+	TempBuffer<uint8_t> m_file_buffer, m_convert_buffer;
+
+	std::thread m_thread;
+	std::atomic<bool> m_should_stop, m_error_occurred, m_end_of_file;
+
+public:
+	// Reads a WAV file, or a raw PCM file if a raw format is given. If the file name is "-", standard input is used.
+	// For WAV, the format is read from the file and the raw parameters are ignored.
+	FileAudioInput(const QString& file, bool fast, AVSampleFormat raw_format = AV_SAMPLE_FMT_NONE, unsigned int raw_sample_rate = 0, unsigned int raw_channels = 0);
+	~FileAudioInput();
+
+	// Returns whether an error has occurred in the input thread.
+	// This function is thread-safe.
+	inline bool HasErrorOccurred() { return m_error_occurred; }
+
+	// Returns whether the end of the file has been reached.
+	// This function is thread-safe.
+	inline bool HasReachedEnd() { return m_end_of_file; }
+
+public:
+	// Returns the raw sample format with the given name (as used on the command line), or AV_SAMPLE_FMT_NONE if the name is unknown.
+	static AVSampleFormat GetRawFormatFromName(const QString& name);
+
+private:
+	void Init();
+	void Free();
+
+	void ReadWAVHeader();
+	unsigned int ReadSamples();
+
+private:
+	void InputThread();
+
+};
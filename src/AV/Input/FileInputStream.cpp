@@ -0,0 +1,116 @@
+/*
+Copyright (c) 2012-2020 Maarten Baert <maarten-baert@hotmail.com>
+
+This file is part of SimpleScreenRecorder.
+
+SimpleScreenRecorder is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+SimpleScreenRecorder is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with SimpleScreenRecorder.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "FileInputStream.h"
+
+#include "Logger.h"
+
+#include <poll.h>
+
+FileInputStream::FileInputStream(const QString& file) {
+
+	m_file = file;
+
+	m_fd = -1;
+
+	try {
+		Init();
+	} catch(...) {
+		Free();
+		throw;
+	}
+
+}
+
+FileInputStream::~FileInputStream() {
+	Free();
+}
+
+size_t FileInputStream::Read(void* data, size_t size, std::atomic<bool>* should_stop) {
+	size_t done = 0;
+	while(done < size && !*should_stop) {
+		pollfd pfd = {m_fd, POLLIN, 0};
+		int res = poll(&pfd, 1, 100);
+		if(res < 0) {
+			if(errno == EINTR)
+				continue;
+			Logger::LogError("[FileInputStream::Read] " + Logger::tr("Error: Can't poll input file!"));
+			throw FileInputException();
+		}
+		if(res == 0)
+			continue;
+		ssize_t n = read(m_fd, (uint8_t*) data + done, size - done);
+		if(n < 0) {
+			if(errno == EINTR || errno == EAGAIN)
+				continue;
+			Logger::LogError("[FileInputStream::Read] " + Logger::tr("Error: Can't read input file!"));
+			throw FileInputException();
+		}
+		if(n == 0)
+			break; // end of file
+		done += n;
+	}
+	return done;
+}
+
+bool FileInputStream::ReadLine(std::string* line, size_t max_length, std::atomic<bool>* should_stop) {
+	line->clear();
+	for( ; ; ) {
+		char c;
+		if(Read(&c, 1, should_stop) != 1)
+			return false;
+		if(c == '\n')
+			return true;
+		if(line->size() >= max_length) {
+			Logger::LogError("[FileInputStream::ReadLine] " + Logger::tr("Error: Line in input file is too long!"));
+			throw FileInputException();
+		}
+		line->push_back(c);
+	}
+}
+
+bool FileInputStream::Skip(uint64_t size, std::atomic<bool>* should_stop) {
+	uint8_t buffer[4096];
+	while(size != 0) {
+		size_t n = std::min(size, (uint64_t) sizeof(buffer));
+		if(Read(buffer, n, should_stop) != n)
+			return false;
+		size -= n;
+	}
+	return true;
+}
+
+void FileInputStream::Init() {
+	if(m_file == "-") {
+		m_fd = 0;
+	} else {
+		m_fd = open(QFile::encodeName(m_file).constData(), O_RDONLY | O_CLOEXEC);
+		if(m_fd == -1) {
+			Logger::LogError("[FileInputStream::Init] " + Logger::tr("Error: Can't open input file '%1'!").arg(m_file));
+			throw FileInputException();
+		}
+	}
+}
+
+void FileInputStream::Free() {
+	if(m_fd > 0) {
+		close(m_fd);
+		m_fd = -1;
+	}
+}
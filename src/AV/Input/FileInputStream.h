@@ -0,0 +1,49 @@
+/*
+Copyright (c) 2012-2020 Maarten Baert <maarten-baert@hotmail.com>
+
+This file is part of SimpleScreenRecorder.
+
+SimpleScreenRecorder is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+SimpleScreenRecorder is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with SimpleScreenRecorder.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+#include "Global.h"
+
+// Reads a file or pipe for the file inputs. Reads wait for data in short steps, so the input thread can still be stopped when a pipe stalls.
+class FileInputStream {
+
+private:
+	QString m_file;
+	int m_fd;
+
+public:
+	// Opens the file. If the file name is "-", standard input is used.
+	FileInputStream(const QString& file);
+	~FileInputStream();
+
+	// Reads exactly 'size' bytes, unless the end of the file is reached or should_stop becomes true.
+	// Returns the number of bytes that were read.
+	size_t Read(void* data, size_t size, std::atomic<bool>* should_stop);
+
+	// Reads one line (without the newline). Returns false if the end of the file was reached before the end of the line.
+	bool ReadLine(std::string* line, size_t max_length, std::atomic<bool>* should_stop);
+
+	// Reads and discards 'size' bytes. Returns false if the end of the file was reached first.
+	bool Skip(uint64_t size, std::atomic<bool>* should_stop);
+
+private:
+	void Init();
+	void Free();
+
+};
@@ -0,0 +1,318 @@
+/*
+Copyright (c) 2012-2020 Maarten Baert <maarten-baert@hotmail.com>
+
+This file is part of SimpleScreenRecorder.
+
+SimpleScreenRecorder is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+SimpleScreenRecorder is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with SimpleScreenRecorder.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "FileVideoInput.h"
+
+#include "Logger.h"
+#include "FileInputStream.h"
+#include "ThreadWatchdog.h"
+
+// The maximum time the input will wait for a backlogged sink in fast mode. This avoids hanging forever when another input has stopped,
+// e.g. because its file has ended. After this time, the frame is pushed anyway and the synchronizer decides what to do with it.
+const int64_t FileVideoInput::BACKLOG_TIMEOUT = 2000000;
+
+FileVideoInput::FileVideoInput(const QString& file, bool fast, AVPixelFormat raw_format, unsigned int raw_width, unsigned int raw_height, unsigned int raw_frame_rate) {
+
+	m_file = file;
+	m_fast = fast;
+	m_format = raw_format;
+	m_width = raw_width;
+	m_height = raw_height;
+	m_frame_rate_num = raw_frame_rate;
+	m_frame_rate_den = 1;
+	m_y4m = (raw_format == AV_PIX_FMT_NONE);
+
+	try {
+		Init();
+	} catch(...) {
+		Free();
+		throw;
+	}
+
+}
+
+FileVideoInput::~FileVideoInput() {
+
+	// tell the thread to stop
+	if(m_thread.joinable()) {
+		Logger::LogInfo("[FileVideoInput::~FileVideoInput] " + Logger::tr("Stopping input thread ..."));
+		m_should_stop = true;
+		m_thread.join();
+	}
+
+	// free everything
+	Free();
+
+}
+
+void FileVideoInput::GetCurrentSize(unsigned int* width, unsigned int* height) {
+	*width = m_width;
+	*height = m_height;
+}
+
+double FileVideoInput::GetFPS() {
+	int64_t timestamp = hrt_time_micro();
+	uint32_t frame_counter = m_frame_counter;
+	unsigned int time = timestamp - m_fps_last_timestamp;
+	if(time > 500000) {
+		unsigned int frames = frame_counter - m_fps_last_counter;
+		m_fps_last_timestamp = timestamp;
+		m_fps_last_counter = frame_counter;
+		m_fps_current = (double) frames / ((double) time * 1.0e-6);
+	}
+	return m_fps_current;
+}
+
+AVPixelFormat FileVideoInput::GetRawFormatFromName(const QString& name) {
+	if(name == "bgra")
+		return AV_PIX_FMT_BGRA;
+	if(name == "yuyv422")
+		return AV_PIX_FMT_YUYV422;
+	if(name == "yuv420p")
+		return AV_PIX_FMT_YUV420P;
+	return AV_PIX_FMT_NONE;
+}
+
+void FileVideoInput::Init() {
+
+	m_should_stop = false;
+	m_error_occurred = false;
+	m_end_of_file = false;
+
+	// open the file and read the header
+	m_stream.reset(new FileInputStream(m_file));
+	if(m_y4m)
+		ReadY4MHeader();
+
+	// check the parameters
+	if(m_width == 0 || m_height == 0) {
+		Logger::LogError("[FileVideoInput::Init] " + Logger::tr("Error: Width or height is zero!"));
+		throw FileInputException();
+	}
+	if(m_width > SSR_MAX_IMAGE_SIZE || m_height > SSR_MAX_IMAGE_SIZE) {
+		Logger::LogError("[FileVideoInput::Init] " + Logger::tr("Error: Width or height is too large, the maximum width and height is %1!").arg(SSR_MAX_IMAGE_SIZE));
+		throw FileInputException();
+	}
+	if(m_format != AV_PIX_FMT_BGRA && (m_width % 2 != 0 || m_height % 2 != 0)) {
+		Logger::LogError("[FileVideoInput::Init] " + Logger::tr("Error: Width or height is not an even number!"));
+		throw FileInputException();
+	}
+	if(m_frame_rate_num == 0 || m_frame_rate_den == 0) {
+		Logger::LogError("[FileVideoInput::Init] " + Logger::tr("Error: Frame rate is zero!"));
+		throw FileInputException();
+	}
+
+	// calculate the frame size
+	switch(m_format) {
+		case AV_PIX_FMT_BGRA: m_frame_size = (size_t) m_width * m_height * 4; break;
+		case AV_PIX_FMT_YUYV422: m_frame_size = (size_t) m_width * m_height * 2; break;
+		case AV_PIX_FMT_YUV420P: m_frame_size = (size_t) m_width * m_height * 3 / 2; break;
+		case AV_PIX_FMT_YUV422P: m_frame_size = (size_t) m_width * m_height * 2; break;
+		case AV_PIX_FMT_GRAY8: m_frame_size = (size_t) m_width * m_height; break;
+		default: assert(false);
+	}
+	m_frame_buffer.Alloc(m_frame_size);
+	Logger::LogInfo("[FileVideoInput::Init] " + Logger::tr("Reading video file '%1' (%2x%3, %4 fps).")
+					.arg(m_file).arg(m_width).arg(m_height).arg((double) m_frame_rate_num / (double) m_frame_rate_den, 0, 'f', 2));
+
+	// start input thread
+	m_frame_counter = 0;
+	m_fps_last_timestamp = hrt_time_micro();
+	m_fps_last_counter = 0;
+	m_fps_current = 0.0;
+	m_thread = std::thread(&FileVideoInput::InputThread, this);
+
+}
+
+void FileVideoInput::Free() {
+	m_stream.reset();
+}
+
+void FileVideoInput::ReadY4MHeader() {
+
+	// read the stream header, e.g. 'YUV4MPEG2 W1920 H1080 F30000:1001 Ip A1:1 C420jpeg'
+	std::string line;
+	if(!m_stream->ReadLine(&line, 1000, &m_should_stop) || line.compare(0, 10, "YUV4MPEG2 ") != 0) {
+		Logger::LogError("[FileVideoInput::ReadY4MHeader] " + Logger::tr("Error: The input file is not a Y4M file!"));
+		throw FileInputException();
+	}
+	QString colorspace = "420jpeg";
+	for(const QString &param : SplitSkipEmptyParts(QString::fromLatin1(line.c_str() + 10), ' ')) {
+		QString value = param.mid(1);
+		switch(param[0].toLatin1()) {
+			case 'W': m_width = value.toUInt(); break;
+			case 'H': m_height = value.toUInt(); break;
+			case 'F': m_frame_rate_num = value.section(':', 0, 0).toUInt(); m_frame_rate_den = value.section(':', 1, 1).toUInt(); break;
+			case 'C': colorspace = value; break;
+			default: break; // interlacing, aspect ratio and extensions are ignored
+		}
+	}
+
+	// only 8-bit YUV 4:2:0, 4:2:2 and grayscale are supported, the chroma siting is ignored
+	if(colorspace == "420jpeg" || colorspace == "420mpeg2" || colorspace == "420paldv" || colorspace == "420") {
+		m_format = AV_PIX_FMT_YUV420P;
+	} else if(colorspace == "422") {
+		m_format = AV_PIX_FMT_YUV422P;
+	} else if(colorspace == "mono") {
+		m_format = AV_PIX_FMT_GRAY8;
+	} else {
+		Logger::LogError("[FileVideoInput::ReadY4MHeader] " + Logger::tr("Error: Y4M color space '%1' is not supported!").arg(colorspace));
+		throw FileInputException();
+	}
+
+}
+
+bool FileVideoInput::ReadFrame() {
+
+	// read the frame header
+	if(m_y4m) {
+		std::string line;
+		if(!m_stream->ReadLine(&line, 1000, &m_should_stop))
+			return false;
+		if(line.compare(0, 5, "FRAME") != 0) {
+			Logger::LogError("[FileVideoInput::ReadFrame] " + Logger::tr("Error: Invalid Y4M frame header!"));
+			throw FileInputException();
+		}
+	}
+
+	// read the frame data
+	size_t size = m_stream->Read(m_frame_buffer.GetData(), m_frame_size, &m_should_stop);
+	if(size != m_frame_size) {
+		if(size != 0 && !m_should_stop)
+			Logger::LogWarning("[FileVideoInput::ReadFrame] " + Logger::tr("Warning: The last frame of the input file is incomplete."));
+		return false;
+	}
+	return true;
+
+}
+
+void FileVideoInput::PackFrame() {
+
+	// The sinks only accept packed formats, so planar YUV is converted to YUYV. This is cheap, and for 4:2:2 and 4:2:0 no information is lost
+	// because the encoder will subsample the chroma again anyway.
+	unsigned int chroma_width = m_width / 2, chroma_height = (m_format == AV_PIX_FMT_YUV420P)? m_height / 2 : m_height;
+	m_packed_buffer.Alloc((size_t) m_width * m_height * 2);
+	const uint8_t *plane_y = m_frame_buffer.GetData();
+	const uint8_t *plane_u = plane_y + (size_t) m_width * m_height;
+	const uint8_t *plane_v = plane_u + (size_t) chroma_width * chroma_height;
+	for(unsigned int y = 0; y < m_height; ++y) {
+		const uint8_t *in_y = plane_y + (size_t) m_width * y;
+		uint8_t *out = m_packed_buffer.GetData() + (size_t) m_width * 2 * y;
+		if(m_format == AV_PIX_FMT_GRAY8) {
+			for(unsigned int x = 0; x < chroma_width; ++x) {
+				out[4 * x + 0] = in_y[2 * x + 0];
+				out[4 * x + 1] = 128;
+				out[4 * x + 2] = in_y[2 * x + 1];
+				out[4 * x + 3] = 128;
+			}
+		} else {
+			unsigned int chroma_y = (m_format == AV_PIX_FMT_YUV420P)? y / 2 : y;
+			const uint8_t *in_u = plane_u + (size_t) chroma_width * chroma_y;
+			const uint8_t *in_v = plane_v + (size_t) chroma_width * chroma_y;
+			for(unsigned int x = 0; x < chroma_width; ++x) {
+				out[4 * x + 0] = in_y[2 * x + 0];
+				out[4 * x + 1] = in_u[x];
+				out[4 * x + 2] = in_y[2 * x + 1];
+				out[4 * x + 3] = in_v[x];
+			}
+		}
+	}
+
+}
+
+void FileVideoInput::InputThread() {
+	try {
+
+		Logger::LogInfo("[FileVideoInput::InputThread] " + Logger::tr("Input thread started."));
+
+		ThreadHeartbeat heartbeat("FileVideoInput");
+
+		int64_t start_timestamp = hrt_time_micro(), pause_timestamp = 0;
+		bool paused = false;
+		uint64_t frame = 0;
+
+		while(!m_should_stop) {
+
+			// the file doesn't advance while nothing is connected (e.g. when the recording is paused)
+			heartbeat.Beat("wait");
+			if(!HasVideoSinks()) {
+				if(!paused) {
+					paused = true;
+					pause_timestamp = hrt_time_micro();
+				}
+				usleep(20000);
+				continue;
+			}
+			if(paused) {
+				paused = false;
+				start_timestamp += hrt_time_micro() - pause_timestamp;
+			}
+
+			// the timestamps always follow the frame rate of the file, only the pacing depends on the mode
+			int64_t timestamp = start_timestamp + (int64_t) (frame * 1000000 * m_frame_rate_den / m_frame_rate_num);
+			if(m_fast) {
+				int64_t wait_start = hrt_time_micro();
+				while(!m_should_stop && IsVideoBacklogged() && hrt_time_micro() < wait_start + BACKLOG_TIMEOUT) {
+					heartbeat.Beat("wait for sink");
+					usleep(1000);
+				}
+			} else {
+				int64_t wait = timestamp - hrt_time_micro();
+				if(wait > 21000) {
+					// the thread can't sleep for too long because it still has to check the m_should_stop flag periodically
+					usleep(20000);
+					continue;
+				} else if(wait > 0) {
+					usleep(wait);
+				}
+			}
+
+			// read the frame
+			heartbeat.Beat("read");
+			if(!ReadFrame()) {
+				if(!m_should_stop) {
+					Logger::LogInfo("[FileVideoInput::InputThread] " + Logger::tr("Reached the end of the video file."));
+					m_end_of_file = true;
+				}
+				break;
+			}
+
+			// push the frame
+			heartbeat.Beat("push");
+			if(m_format == AV_PIX_FMT_BGRA || m_format == AV_PIX_FMT_YUYV422) {
+				PushVideoFrame(m_width, m_height, m_frame_buffer.GetData(), m_width * ((m_format == AV_PIX_FMT_BGRA)? 4 : 2), m_format, SWS_CS_DEFAULT, timestamp);
+			} else {
+				PackFrame();
+				PushVideoFrame(m_width, m_height, m_packed_buffer.GetData(), m_width * 2, AV_PIX_FMT_YUYV422, SWS_CS_DEFAULT, timestamp);
+			}
+			++m_frame_counter;
+			++frame;
+
+		}
+
+		Logger::LogInfo("[FileVideoInput::InputThread] " + Logger::tr("Input thread stopped."));
+
+	} catch(const std::exception& e) {
+		m_error_occurred = true;
+		Logger::LogError("[FileVideoInput::InputThread] " + Logger::tr("Exception '%1' in input thread.").arg(e.what()));
+	} catch(...) {
+		m_error_occurred = true;
+		Logger::LogError("[FileVideoInput::InputThread] " + Logger::tr("Unknown exception in input thread."));
+	}
+}
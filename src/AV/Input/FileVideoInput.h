@@ -0,0 +1,93 @@
+/*
+Copyright (c) 2012-2020 Maarten Baert <maarten-baert@hotmail.com>
+
+This file is part of SimpleScreenRecorder.
+
+SimpleScreenRecorder is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+SimpleScreenRecorder is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with SimpleScreenRecorder.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+#include "Global.h"
+
+#include "SourceSink.h"
+#include "TempBuffer.h"
+
+class FileInputStream;
+
+// Reads video frames from a Y4M or raw video file (or a pipe) and pushes them like a live input.
+// In real-time mode the frames are pushed at the frame rate of the file. In fast mode they are pushed as fast as the sinks can accept them,
+// with timestamps that follow the frame rate of the file, so the output is identical to real-time mode.
+class FileVideoInput : public VideoSource {
+
+private:
+	static const int64_t BACKLOG_TIMEOUT;
+
+private:
+	QString m_file;
+	bool m_fast;
+	AVPixelFormat m_format;
+	unsigned int m_width, m_height;
+	unsigned int m_frame_rate_num, m_frame_rate_den;
+	bool m_y4m;
+
+	std::unique_ptr<FileInputStream> m_stream;
+	size_t m_frame_size;
+	TempBuffer<uint8_t> m_frame_buffer, m_packed_buffer;
+
+	std::atomic<uint32_t> m_frame_counter;
+	int64_t m_fps_last_timestamp;
+	uint32_t m_fps_last_counter;
+	double m_fps_current;
+
+	std::thread m_thread;
+	std::atomic<bool> m_should_stop, m_error_occurred, m_end_of_file;
+
+public:
+	// Reads a Y4M file, or a raw video file if a raw format is given. If the file name is "-", standard input is used.
+	// For Y4M, the size and frame rate are read from the file and the raw parameters are ignored.
+	FileVideoInput(const QString& file, bool fast, AVPixelFormat raw_format = AV_PIX_FMT_NONE, unsigned int raw_width = 0, unsigned int raw_height = 0, unsigned int raw_frame_rate = 0);
+	~FileVideoInput();
+
+	// Reads the current size of the stream.
+	// This function is thread-safe.
+	void GetCurrentSize(unsigned int* width, unsigned int* height);
+
+	// Returns the total number of frames read.
+	// This function is thread-safe.
+	double GetFPS();
+
+	// Returns whether an error has occurred in the input thread.
+	// This function is thread-safe.
+	inline bool HasErrorOccurred() { return m_error_occurred; }
+
+	// Returns whether the end of the file has been reached.
+	// This function is thread-safe.
+	inline bool HasReachedEnd() { return m_end_of_file; }
+
+public:
+	// Returns the raw video format with the given name (as used on the command line), or AV_PIX_FMT_NONE if the name is unknown.
+	static AVPixelFormat GetRawFormatFromName(const QString& name);
+
+private:
+	void Init();
+	void Free();
+
+	void ReadY4MHeader();
+	bool ReadFrame();
+	void PackFrame();
+
+private:
+	void InputThread();
+
+};
@@ -22,7 +22,10 @@ along with SimpleScreenRecorder.  If not, see <http://www.gnu.org/licenses/>.
 #if SSR_USE_OPENGL_RECORDING
 
 #include "Logger.h"
+#include "ThreadWatchdog.h"
+#include "FrameAccounting.h"
 #include "AVWrapper.h"
+#include "CursorBlend.h"
 #include "SSRVideoStreamWatcher.h"
 #include "SSRVideoStreamReader.h"
 
@@ -41,6 +44,13 @@ static QString ShellEscape(QString str) {
 // The highest expected latency between GLInject and the input thread.
 const int64_t GLInjectInput::MAX_COMMUNICATION_LATENCY = 100000;
 
+// The interval at which the capture overhead of the application is logged.
+const int64_t GLInjectInput::OVERHEAD_LOG_INTERVAL = 30000000;
+
+// The maximum age of the previous pointer sample that is still used to interpolate the cursor position.
+// Older samples (e.g. after a pause) are ignored and the current pointer position is used instead.
+const int64_t GLInjectInput::MAX_POINTER_SAMPLE_AGE = 100000;
+
 bool ExecuteDetached(const char* command, const char* working_directory) {
 
 	// set up feedback pipe
@@ -151,12 +161,29 @@ bool ExecuteDetached(const char* command, const char* working_directory) {
 
 }
 
-GLInjectInput::GLInjectInput(const QString& channel, bool relax_permissions, bool record_cursor, bool limit_fps, unsigned int target_fps) {
+GLInjectInput::GLInjectInput(const QString& channel, bool relax_permissions, bool record_cursor, bool limit_fps, unsigned int target_fps, unsigned int stream_index, bool exclusive) {
 
 	m_channel = channel;
 	m_relax_permissions = relax_permissions;
 	m_flags = ((record_cursor)? GLINJECT_FLAG_RECORD_CURSOR : 0) | ((limit_fps)? GLINJECT_FLAG_LIMIT_FPS : 0);
 	m_target_fps = target_fps;
+	m_stream_index = stream_index;
+	m_exclusive = exclusive;
+
+	m_record_cursor = record_cursor;
+	m_x11_display = NULL;
+	m_cursor_changed = true;
+	m_cursor_width = 0;
+	m_cursor_height = 0;
+	m_cursor_xhot = 0;
+	m_cursor_yhot = 0;
+	m_cursor_window = None;
+	m_window_position_valid = false;
+	m_window_x = 0;
+	m_window_y = 0;
+	m_pointer_time = AV_NOPTS_VALUE;
+	m_pointer_x = 0;
+	m_pointer_y = 0;
 
 	try {
 		Init();
@@ -197,6 +224,24 @@ double GLInjectInput::GetFPS() {
 	return lock->m_stream_reader->GetFPS();
 }
 
+void GLInjectInput::GetPacingError(unsigned int* avg, unsigned int* max) {
+	SharedLock lock(&m_shared_data);
+	if(lock->m_stream_reader == NULL) {
+		*avg = *max = 0;
+	} else {
+		lock->m_stream_reader->GetPacingError(avg, max);
+	}
+}
+
+void GLInjectInput::GetOverhead(SSRVideoStreamOverhead* overhead) {
+	SharedLock lock(&m_shared_data);
+	if(lock->m_stream_reader == NULL) {
+		*overhead = SSRVideoStreamOverhead();
+	} else {
+		lock->m_stream_reader->GetOverhead(overhead);
+	}
+}
+
 void GLInjectInput::SetCapturing(bool capturing) {
 	SharedLock lock(&m_shared_data);
 	lock->m_capturing = capturing;
@@ -222,6 +267,22 @@ bool GLInjectInput::LaunchApplication(const QString& channel, bool relax_permiss
 
 void GLInjectInput::Init() {
 
+	// the cursor is drawn here rather than in the application, this requires XFixes
+	// we need a separate display because the existing one would interfere with what Qt is doing in some cases
+	if(m_record_cursor) {
+		m_x11_display = XOpenDisplay(NULL);
+		int error_base;
+		if(m_x11_display == NULL) {
+			Logger::LogWarning("[GLInjectInput::Init] " + Logger::tr("Warning: Can't open X display, the cursor has been hidden.", "Don't translate 'display'"));
+		} else if(!XFixesQueryExtension(m_x11_display, &m_xfixes_event_base, &error_base)) {
+			Logger::LogWarning("[GLInjectInput::Init] " + Logger::tr("Warning: XFixes is not supported by X server, the cursor has been hidden.", "Don't translate 'XFixes'"));
+			XCloseDisplay(m_x11_display);
+			m_x11_display = NULL;
+		} else {
+			XFixesSelectCursorInput(m_x11_display, DefaultRootWindow(m_x11_display), XFixesDisplayCursorNotifyMask);
+		}
+	}
+
 	// initialize shared data
 	{
 		SharedLock lock(&m_shared_data);
@@ -237,9 +298,92 @@ void GLInjectInput::Init() {
 }
 
 void GLInjectInput::Free() {
-	SharedLock lock(&m_shared_data);
-	lock->m_stream_reader.reset();
-	lock->m_stream_watcher.reset();
+	{
+		SharedLock lock(&m_shared_data);
+		lock->m_stream_reader.reset();
+		lock->m_stream_watcher.reset();
+	}
+	if(m_x11_display != NULL) {
+		XCloseDisplay(m_x11_display);
+		m_x11_display = NULL;
+	}
+}
+
+void GLInjectInput::DrawCursor(uint8_t* image_data, int image_stride, unsigned int image_width, unsigned int image_height, Window window, int64_t timestamp) {
+
+	if(window == None)
+		return;
+
+	// the window position is cached, it is only read again when the window is moved, resized or reparented
+	// (window managers send a synthetic ConfigureNotify when they move the frame of a reparented window)
+	if(window != m_cursor_window) {
+		if(m_cursor_window != None)
+			XSelectInput(m_x11_display, m_cursor_window, NoEventMask);
+		XSelectInput(m_x11_display, window, StructureNotifyMask);
+		m_cursor_window = window;
+		m_window_position_valid = false;
+	}
+
+	// the cursor image is cached, it is only read again when XFixes reports that it has changed
+	while(XPending(m_x11_display) > 0) {
+		XEvent event;
+		XNextEvent(m_x11_display, &event);
+		if(event.type == m_xfixes_event_base + XFixesCursorNotify)
+			m_cursor_changed = true;
+		if((event.type == ConfigureNotify || event.type == ReparentNotify) && event.xany.window == m_cursor_window)
+			m_window_position_valid = false;
+	}
+	if(!m_window_position_valid) {
+		Window child;
+		if(!XTranslateCoordinates(m_x11_display, m_cursor_window, DefaultRootWindow(m_x11_display), 0, 0, &m_window_x, &m_window_y, &child))
+			return;
+		m_window_position_valid = true;
+	}
+	if(m_cursor_changed) {
+		m_cursor_changed = false;
+		XFixesCursorImage *xcim = XFixesGetCursorImage(m_x11_display);
+		if(xcim == NULL) {
+			m_cursor_width = 0;
+			m_cursor_height = 0;
+		} else {
+			// XFixesCursorImage uses 'long' instead of 'int' to store the cursor images, only 32 bits are actually used.
+			m_cursor_width = xcim->width;
+			m_cursor_height = xcim->height;
+			m_cursor_xhot = xcim->xhot;
+			m_cursor_yhot = xcim->yhot;
+			m_cursor_image.resize((size_t) m_cursor_width * (size_t) m_cursor_height);
+			for(size_t i = 0; i < m_cursor_image.size(); ++i) {
+				m_cursor_image[i] = (uint32_t) xcim->pixels[i];
+			}
+			XFree(xcim);
+		}
+	}
+	if(m_cursor_width == 0 || m_cursor_height == 0)
+		return;
+
+	// get the position of the cursor
+	// The pointer can only be sampled when the frame is read, which is a bit later than when the frame was captured. To compensate for this,
+	// the position at the capture time is interpolated between the previous sample and the current one.
+	Window root, child;
+	int root_x, root_y, win_x, win_y;
+	unsigned int mask;
+	int64_t pointer_time = hrt_time_micro();
+	if(!XQueryPointer(m_x11_display, DefaultRootWindow(m_x11_display), &root, &child, &root_x, &root_y, &win_x, &win_y, &mask))
+		return;
+	int cursor_x = root_x, cursor_y = root_y;
+	if(m_pointer_time != (int64_t) AV_NOPTS_VALUE && pointer_time - m_pointer_time <= MAX_POINTER_SAMPLE_AGE && timestamp < pointer_time) {
+		double frac = (double) std::max((int64_t) 0, timestamp - m_pointer_time) / (double) std::max((int64_t) 1, pointer_time - m_pointer_time);
+		cursor_x = m_pointer_x + (int) lrint(frac * (double) (root_x - m_pointer_x));
+		cursor_y = m_pointer_y + (int) lrint(frac * (double) (root_y - m_pointer_y));
+	}
+	m_pointer_time = pointer_time;
+	m_pointer_x = root_x;
+	m_pointer_y = root_y;
+
+	// draw the cursor
+	CursorBlend_BGRA(m_cursor_image.data(), m_cursor_width, m_cursor_height, cursor_x - m_cursor_xhot - m_window_x, cursor_y - m_cursor_yhot - m_window_y,
+					 image_data, image_stride, image_width, image_height);
+
 }
 
 bool GLInjectInput::SwitchStream(SharedData* lock, const SSRVideoStream& stream) {
@@ -262,26 +406,49 @@ bool GLInjectInput::SwitchStream(SharedData* lock, const SSRVideoStream& stream)
 	return true;
 }
 
+void GLInjectInput::SelectStream(SharedData* lock) {
+
+	// The streams are sorted by creation time, so the stream index counts back from the end. If the selected stream can't be read,
+	// the next older stream is used instead, unless this input is exclusive. If there are not enough streams, this input has nothing to capture.
+	auto &streams = lock->m_stream_watcher->GetStreams();
+	if(m_exclusive) {
+		if(streams.size() > m_stream_index) {
+			const SSRVideoStream &stream = streams[streams.size() - 1 - m_stream_index];
+			if(lock->m_stream_reader != NULL && lock->m_stream_reader->GetStream() == stream)
+				return;
+			if(SwitchStream(lock, stream))
+				return;
+			Logger::LogError("[GLInjectInput::SelectStream] " + Logger::tr("Error: Stream %1 can't be read! Another stream won't be used instead, "
+																		   "because it is already captured by another input.").arg(m_stream_index + 1));
+		}
+		lock->m_stream_reader.reset();
+		return;
+	}
+	for(size_t i = (streams.size() > m_stream_index)? streams.size() - m_stream_index : 0; i > 0; ) {
+		--i;
+		if(lock->m_stream_reader != NULL && lock->m_stream_reader->GetStream() == streams[i])
+			return;
+		if(SwitchStream(lock, streams[i]))
+			return;
+	}
+	lock->m_stream_reader.reset();
+
+}
+
 void GLInjectInput::StreamAddCallback(const SSRVideoStream& stream, void* userdata) {
+	Q_UNUSED(stream);
 	GLInjectInput *input = (GLInjectInput*) userdata;
 	SharedData *lock = input->m_shared_data.data(); // data is already locked, this is only a callback function
-	input->SwitchStream(lock, stream);
+	input->SelectStream(lock);
 }
 
 void GLInjectInput::StreamRemoveCallback(const SSRVideoStream& stream, size_t pos, void* userdata) {
+	Q_UNUSED(pos);
 	GLInjectInput *input = (GLInjectInput*) userdata;
 	SharedData *lock = input->m_shared_data.data(); // data is already locked, this is only a callback function
-	if(lock->m_stream_reader != NULL) {
-		if(lock->m_stream_reader->GetStream() == stream) {
-			lock->m_stream_reader.reset();
-			auto &streams = lock->m_stream_watcher->GetStreams();
-			for(size_t i = pos; i > 0; ) {
-				--i;
-				if(input->SwitchStream(lock, streams[i]))
-					break;
-			}
-		}
-	}
+	if(lock->m_stream_reader != NULL && lock->m_stream_reader->GetStream() == stream)
+		lock->m_stream_reader.reset();
+	input->SelectStream(lock);
 }
 
 void GLInjectInput::InputThread() {
@@ -289,25 +456,29 @@ void GLInjectInput::InputThread() {
 
 		Logger::LogInfo("[GLInjectInput::InputThread] " + Logger::tr("Input thread started."));
 
+		ThreadHeartbeat heartbeat("GLInjectInput");
+
 		// deal with pre-existing streams
 		{
 			SharedLock lock(&m_shared_data);
-			auto &streams = lock->m_stream_watcher->GetStreams();
-			for(size_t i = streams.size(); i > 0; ) {
-				--i;
-				if(SwitchStream(lock.get(), streams[i]))
-					break;
-			}
+			SelectStream(lock.get());
 		}
 
 		int64_t next_watcher_update = hrt_time_micro();
+		int64_t next_overhead_log = hrt_time_micro() + OVERHEAD_LOG_INTERVAL;
 
 		while(!m_should_stop) {
 
+			heartbeat.Beat("wait");
+
+			// when does the synchronizer want the next frame?
+			int64_t next_timestamp = CalculateNextVideoTimestamp();
+
 			// try to get a frame
 			int64_t timestamp;
 			unsigned int width, height;
 			int stride;
+			Window window = None;
 			void *data;
 			{
 				SharedLock lock(&m_shared_data);
@@ -318,6 +489,17 @@ void GLInjectInput::InputThread() {
 					next_watcher_update = hrt_time_micro() + 200000;
 				}
 
+				// log the capture overhead of the application
+				if(lock->m_stream_reader != NULL && lock->m_capturing && hrt_time_micro() >= next_overhead_log) {
+					SSRVideoStreamOverhead overhead;
+					lock->m_stream_reader->GetOverhead(&overhead);
+					Logger::LogInfo("[GLInjectInput::InputThread] " + Logger::tr("Capture overhead of stream '%1': CPU %2/%3/%4 us, GPU %5/%6/%7 us per captured frame (mean/p99/max).")
+									.arg(QString::fromStdString(lock->m_stream_reader->GetStream().m_stream_name))
+									.arg(overhead.cpu_mean).arg(overhead.cpu_p99).arg(overhead.cpu_max)
+									.arg(overhead.gpu_mean).arg(overhead.gpu_p99).arg(overhead.gpu_max));
+					next_overhead_log = hrt_time_micro() + OVERHEAD_LOG_INTERVAL;
+				}
+
 				// do we have a stream reader?
 				if(lock->m_stream_reader == NULL) {
 					PushVideoPing(hrt_time_micro() - MAX_COMMUNICATION_LATENCY);
@@ -326,6 +508,19 @@ void GLInjectInput::InputThread() {
 					continue;
 				}
 
+				// count the frames that the application had to drop (only for the main track)
+				if(m_stream_index == 0) {
+					unsigned int dropped_ring_full, dropped_too_large;
+					lock->m_stream_reader->GetNewDroppedFrames(&dropped_ring_full, &dropped_too_large);
+					if(dropped_ring_full != 0)
+						FrameAccounting::Add(FrameAccounting::REASON_GLINJECT_RING_FULL, dropped_ring_full);
+					if(dropped_too_large != 0)
+						FrameAccounting::Add(FrameAccounting::REASON_GLINJECT_TOO_LARGE, dropped_too_large);
+				}
+
+				// tell the application when the next frame is needed so it can align its fps limiter
+				lock->m_stream_reader->ChangeNextTimestamp((next_timestamp == SINK_TIMESTAMP_NONE || next_timestamp == SINK_TIMESTAMP_ASAP)? 0 : next_timestamp);
+
 				// is a frame ready?
 				data = lock->m_stream_reader->GetFrame(&timestamp, &width, &height, &stride);
 				if(data == NULL) {
@@ -334,15 +529,24 @@ void GLInjectInput::InputThread() {
 					usleep(20000);
 					continue;
 				}
+				window = lock->m_stream_reader->GetWindowID();
 
 			}
 
+			heartbeat.Beat("push");
+
 			// if the stride is negative, change the pointer
 			// this is needed because OpenGL stores frames upside-down
 			if(stride < 0) {
 				data = (char*) data + (size_t) (-stride) * (size_t) (height - 1);
 			}
 
+			// draw the cursor
+			// the frame memory belongs to us until we call NextFrame, so we can draw directly on it
+			if(m_x11_display != NULL) {
+				DrawCursor((uint8_t*) data, stride, width, height, window, timestamp);
+			}
+
 			// push the frame
 			// we can do this even when we don't have the lock because only this thread will change the stream reader
 			PushVideoFrame(width, height, (uint8_t*) data, stride, AV_PIX_FMT_BGRA, SWS_CS_DEFAULT, timestamp);
@@ -28,6 +28,7 @@ along with SimpleScreenRecorder.  If not, see <http://www.gnu.org/licenses/>.
 class SSRVideoStream;
 class SSRVideoStreamWatcher;
 class SSRVideoStreamReader;
+struct SSRVideoStreamOverhead;
 
 class GLInjectInput : public VideoSource {
 
@@ -41,19 +42,40 @@ private:
 
 private:
 	static const int64_t MAX_COMMUNICATION_LATENCY;
+	static const int64_t OVERHEAD_LOG_INTERVAL;
+	static const int64_t MAX_POINTER_SAMPLE_AGE;
 
 private:
 	QString m_channel;
 	bool m_relax_permissions;
 	unsigned int m_flags;
 	unsigned int m_target_fps;
+	unsigned int m_stream_index;
+	bool m_exclusive;
+
+	// only used by the input thread
+	bool m_record_cursor;
+	Display *m_x11_display;
+	int m_xfixes_event_base;
+	bool m_cursor_changed;
+	std::vector<uint32_t> m_cursor_image;
+	unsigned int m_cursor_width, m_cursor_height;
+	int m_cursor_xhot, m_cursor_yhot;
+	Window m_cursor_window; // the window whose position is cached
+	bool m_window_position_valid;
+	int m_window_x, m_window_y;
+	int64_t m_pointer_time; // time of the previous pointer sample (for interpolation)
+	int m_pointer_x, m_pointer_y;
 
 	std::thread m_thread;
 	MutexDataPair<SharedData> m_shared_data;
 	std::atomic<bool> m_should_stop, m_error_occurred;
 
 public:
-	GLInjectInput(const QString& channel, bool relax_permissions, bool record_cursor, bool limit_fps, unsigned int target_fps);
+	// The stream index selects the stream that will be captured: 0 is the newest stream, 1 is the second newest stream, and so on.
+	// Multiple streams can be captured at the same time by creating one input for each stream index. In that case 'exclusive' should be
+	// true, so an input never falls back to an older stream that may already be captured by another input.
+	GLInjectInput(const QString& channel, bool relax_permissions, bool record_cursor, bool limit_fps, unsigned int target_fps, unsigned int stream_index = 0, bool exclusive = false);
 	~GLInjectInput();
 
 	// Reads the current size of the stream. If the stream hasn't been started yet, this will be 0x0.
@@ -64,6 +86,14 @@ public:
 	// This function is thread-safe.
 	double GetFPS();
 
+	// Returns the average and maximum wake-up error of the fps limiter of the application (in microseconds).
+	// This function is thread-safe.
+	void GetPacingError(unsigned int* avg, unsigned int* max);
+
+	// Returns the capture overhead statistics reported by the application. If there is no stream, everything is zero.
+	// This function is thread-safe.
+	void GetOverhead(SSRVideoStreamOverhead* overhead);
+
 	// Start/stop capturing.
 	// This function is thread-safe.
 	void SetCapturing(bool capturing);
@@ -80,6 +110,9 @@ private:
 	void Free();
 
 	bool SwitchStream(SharedData* lock, const SSRVideoStream& stream);
+	void SelectStream(SharedData* lock);
+
+	void DrawCursor(uint8_t* image_data, int image_stride, unsigned int image_width, unsigned int image_height, Window window, int64_t timestamp);
 
 	static void StreamAddCallback(const SSRVideoStream& stream, void* userdata);
 	static void StreamRemoveCallback(const SSRVideoStream& stream, size_t pos, void* userdata);
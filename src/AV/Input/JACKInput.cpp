@@ -24,6 +24,7 @@ along with SimpleScreenRecorder.  If not, see <http://www.gnu.org/licenses/>.
 #include "SampleCast.h"
 
 #include "Logger.h"
+#include "ThreadWatchdog.h"
 
 #if SSR_USE_JACK_METADATA
 #include <jack/metadata.h>
@@ -190,7 +191,10 @@ int JACKInput::ProcessCallback(jack_nframes_t nframes, void* arg) {
 	}
 	*((enum_eventtype*) message) = EVENTTYPE_DATA;
 	message += sizeof(enum_eventtype);
-	((EventData*) message)->m_timestamp = hrt_time_micro() - (int64_t) nframes * (int64_t) 1000000 / (int64_t) input->m_jackthread_sample_rate;
+	// The frame time of the current cycle is based on the audio clock, so it's much less noisy than the current time.
+	// JACK has its own time base, so it has to be converted.
+	int64_t cycle_time = hrt_time_micro() - (int64_t) jack_get_time() + (int64_t) jack_frames_to_time(input->m_jack_client, jack_last_frame_time(input->m_jack_client));
+	((EventData*) message)->m_timestamp = cycle_time - (int64_t) nframes * (int64_t) 1000000 / (int64_t) input->m_jackthread_sample_rate;
 	((EventData*) message)->m_sample_rate = input->m_jackthread_sample_rate;
 	((EventData*) message)->m_sample_count = nframes;
 	message += sizeof(EventData);
@@ -250,8 +254,12 @@ void JACKInput::InputThread() {
 
 		Logger::LogInfo("[JACKInput::InputThread] " + Logger::tr("Input thread started."));
 
+		ThreadHeartbeat heartbeat("JACKInput");
+
 		while(!m_should_stop) {
 
+			heartbeat.Beat("connect");
+
 			// process connect commands
 			// JACK will send notifications when we connect/disconnect ports, so holding the lock while doing this is a bad idea.
 			// It seems that JACK is designed in such a way that a single misbehaving application can lock up the entire server, so let's avoid that.
@@ -276,11 +284,13 @@ void JACKInput::InputThread() {
 			unsigned int message_size;
 			char *message = m_message_queue.PrepareReadMessage(&message_size);
 			if(message == NULL) {
+				heartbeat.Beat("wait");
 				usleep(20000);
 				continue;
 			}
 
 			// read the message
+			heartbeat.Beat("push");
 			assert(message_size >= sizeof(enum_eventtype));
 			enum_eventtype type = *((enum_eventtype*) message);
 			message += sizeof(enum_eventtype);
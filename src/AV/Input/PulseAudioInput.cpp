@@ -22,6 +22,7 @@ along with SimpleScreenRecorder.  If not, see <http://www.gnu.org/licenses/>.
 #if SSR_USE_PULSEAUDIO
 
 #include "Logger.h"
+#include "ThreadWatchdog.h"
 
 // Artificial delay after the first samples have been received (in microseconds). Any samples received during this time will be dropped.
 // This is needed because the first samples sometimes have weird timestamps, especially when PulseAudio is active
@@ -29,6 +30,10 @@ along with SimpleScreenRecorder.  If not, see <http://www.gnu.org/licenses/>.
 // It also eliminates the clicking sound when the microphone is started for the first time.
 const int64_t PulseAudioInput::START_DELAY = 100000;
 
+// Latencies reported by PulseAudio that are larger than this are ignored (in microseconds).
+// This can happen when the timing info is not up to date yet, e.g. right after the stream has been moved.
+const int64_t PulseAudioInput::MAX_LATENCY = 1000000;
+
 static void PulseAudioIterate(pa_mainloop* mainloop) {
 	if(pa_mainloop_prepare(mainloop, 1000) < 0) {
 		Logger::LogError("[PulseAudioIterate] " + Logger::tr("Error: pa_mainloop_prepare failed!", "Don't translate 'pa_mainloop_prepare'"));
@@ -122,7 +127,7 @@ static void PulseAudioConnectStream(pa_mainloop* mainloop, pa_context* context,
 
 	// connect the stream
 	if(pa_stream_connect_record(*stream, source_name.toUtf8().constData(), &buffer_attr,
-								(pa_stream_flags_t) (/*PA_STREAM_INTERPOLATE_TIMING | PA_STREAM_AUTO_TIMING_UPDATE |*/ PA_STREAM_ADJUST_LATENCY)) < 0) {
+								(pa_stream_flags_t) (PA_STREAM_INTERPOLATE_TIMING | PA_STREAM_AUTO_TIMING_UPDATE | PA_STREAM_ADJUST_LATENCY)) < 0) {
 		Logger::LogError("[PulseAudioConnectStream] " + Logger::tr("Error: Could not connect stream! Reason: %1").arg(pa_strerror(pa_context_errno(context))));
 		throw PulseAudioException();
 	}
@@ -334,12 +339,15 @@ void PulseAudioInput::InputThread() {
 
 		Logger::LogInfo("[PulseAudioInput::InputThread] " + Logger::tr("Input thread started."));
 
+		ThreadHeartbeat heartbeat("PulseAudioInput");
+
 		std::vector<uint8_t> buffer;
 		bool has_first_samples = false;
 		int64_t first_timestamp = 0; // value won't be used, but GCC gives a warning otherwise
 
 		while(!m_should_stop) {
 
+			heartbeat.Beat("wait");
 			PulseAudioIterate(m_pa_mainloop);
 
 			// try to read samples
@@ -376,20 +384,27 @@ void PulseAudioInput::InputThread() {
 				if(has_first_samples) {
 					if(timestamp > first_timestamp + START_DELAY) {
 
+						// get the timestamp of the first sample
+						int64_t time = timestamp;
+						if(!m_stream_is_monitor) {
+							time -= (int64_t) samples * (int64_t) 1000000 / (int64_t) m_sample_rate;
+						}
+
 						// get the latency
+						// This is interpolated from the timing info of the device, so it's much less noisy than the time at which we receive the samples.
 						// The latency can be negative for monitors, this means that we got the samples before they were actually played.
 						// But for some reason, PulseAudio doesn't like signed integers ...
-						/*pa_usec_t latency_magnitude;
+						pa_usec_t latency_magnitude;
 						int latency_negative;
-						pa_stream_get_latency(m_pa_stream, &latency_magnitude, &latency_negative);
-						int64_t latency = (latency_negative)? -(int64_t) latency_magnitude : latency_magnitude;*/
+						if(pa_stream_get_latency(m_pa_stream, &latency_magnitude, &latency_negative) == 0) {
+							int64_t latency = (latency_negative)? -(int64_t) latency_magnitude : latency_magnitude;
+							if(latency > -MAX_LATENCY && latency < MAX_LATENCY) {
+								time = timestamp - latency;
+							}
+						}
 
 						// push the samples
-						/*int64_t time = timestamp - latency;*/
-						int64_t time = timestamp;
-						if(!m_stream_is_monitor) {
-							time -= (int64_t) samples * (int64_t) 1000000 / (int64_t) m_sample_rate;
-						}
+						heartbeat.Beat("push");
 						PushAudioSamples(m_channels, m_sample_rate, AV_SAMPLE_FMT_S16, samples, push_data, time);
 
 					}
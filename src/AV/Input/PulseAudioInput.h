@@ -40,7 +40,7 @@ public:
 	};
 
 private:
-	static const int64_t START_DELAY;
+	static const int64_t START_DELAY, MAX_LATENCY;
 
 private:
 	QString m_source_name;
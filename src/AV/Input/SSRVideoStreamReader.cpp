@@ -24,14 +24,17 @@ along with SimpleScreenRecorder.  If not, see <http://www.gnu.org/licenses/>.
 #include <fcntl.h>
 #include <sys/file.h>
 #include <sys/mman.h>
+#include <sys/socket.h>
 #include <sys/stat.h>
 #include <sys/types.h>
+#include <sys/un.h>
 
 SSRVideoStreamReader::SSRVideoStreamReader(const std::string& channel, const SSRVideoStream& stream) {
 
 	m_stream = stream;
 	m_channel_directory = "/dev/shm/ssr-" + ((channel.empty())? "channel-" + GetUserName() : channel);
 	m_filename_main = m_channel_directory + "/video-" + stream.m_stream_name;
+	m_filename_socket = m_channel_directory + "/videofd-" + stream.m_stream_name;
 	m_page_size = sysconf(_SC_PAGE_SIZE);
 
 	m_fd_main = -1;
@@ -46,6 +49,13 @@ SSRVideoStreamReader::SSRVideoStreamReader(const std::string& channel, const SSR
 		fd.m_mmap_size_frame = 0;
 	}
 
+	m_use_memfd = false;
+	m_fd_socket = -1;
+	m_fd_frames = -1;
+	m_mmap_ptr_frames = MAP_FAILED;
+	m_mmap_size_frames = 0;
+	m_frame_slot_size = 0;
+
 	try {
 		Init();
 	} catch(...) {
@@ -84,13 +94,17 @@ void SSRVideoStreamReader::Init() {
 		throw SSRStreamException();
 	}
 
-	// open frame files
-	for(unsigned int i = 0; i < GLINJECT_RING_BUFFER_SIZE; ++i) {
-		FrameData &fd = m_frame_data[i];
-		fd.m_fd_frame = open(fd.m_filename_frame.c_str(), O_RDWR | O_CLOEXEC);
-		if(fd.m_fd_frame == -1) {
-			Logger::LogError("[SSRVideoStreamReader::Init] " + Logger::tr("Error: Can't open video frame file!"));
-			throw SSRStreamException();
+	// connect to the frame buffer socket if the stream uses memfd, otherwise open frame files
+	// The socket is created before the main file, so if it doesn't exist now, the stream uses frame files.
+	m_use_memfd = ConnectFrameBuffer();
+	if(!m_use_memfd) {
+		for(unsigned int i = 0; i < GLINJECT_RING_BUFFER_SIZE; ++i) {
+			FrameData &fd = m_frame_data[i];
+			fd.m_fd_frame = open(fd.m_filename_frame.c_str(), O_RDWR | O_CLOEXEC);
+			if(fd.m_fd_frame == -1) {
+				Logger::LogError("[SSRVideoStreamReader::Init] " + Logger::tr("Error: Can't open video frame file!"));
+				throw SSRStreamException();
+			}
 		}
 	}
 
@@ -98,18 +112,44 @@ void SSRVideoStreamReader::Init() {
 	GLInjectHeader *header = GetGLInjectHeader();
 	header->capture_flags = 0;
 	header->capture_target_fps = 0;
+	__atomic_store_n(&header->capture_next_timestamp, 0, __ATOMIC_RELAXED);
 	std::atomic_thread_fence(std::memory_order_release);
 
+	// ask the application to send the frame buffer
+	if(m_use_memfd) {
+		__atomic_fetch_add(&header->transport_request_counter, 1, __ATOMIC_RELEASE);
+	}
+
 	// initialize frame counter
 	std::atomic_thread_fence(std::memory_order_acquire);
 	m_fps_last_timestamp = hrt_time_micro();
 	m_fps_last_counter = header->frame_counter;
 	m_fps_current = 0.0;
 
+	// initialize dropped frame counters
+	m_dropped_ring_full_last = (header->identifier == GLINJECT_IDENTIFIER)? header->dropped_ring_full : 0;
+	m_dropped_too_large_last = (header->identifier == GLINJECT_IDENTIFIER)? header->dropped_too_large : 0;
+
 }
 
 void SSRVideoStreamReader::Free() {
 
+	// unmap and close memfd
+	if(m_mmap_ptr_frames != MAP_FAILED) {
+		munmap(m_mmap_ptr_frames, m_mmap_size_frames);
+		m_mmap_ptr_frames = MAP_FAILED;
+	}
+	if(m_fd_frames != -1) {
+		close(m_fd_frames);
+		m_fd_frames = -1;
+	}
+
+	// close socket
+	if(m_fd_socket != -1) {
+		close(m_fd_socket);
+		m_fd_socket = -1;
+	}
+
 	for(unsigned int i = 0; i < GLINJECT_RING_BUFFER_SIZE; ++i) {
 		FrameData &fd = m_frame_data[i];
 
@@ -143,6 +183,105 @@ void SSRVideoStreamReader::Free() {
 
 }
 
+bool SSRVideoStreamReader::ConnectFrameBuffer() {
+
+	// the writer doesn't create the socket if the name is too long
+	sockaddr_un addr;
+	if(m_filename_socket.size() >= sizeof(addr.sun_path))
+		return false;
+
+	// create socket
+	m_fd_socket = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC | SOCK_NONBLOCK, 0);
+	if(m_fd_socket == -1) {
+		Logger::LogError("[SSRVideoStreamReader::ConnectFrameBuffer] " + Logger::tr("Error: Can't create frame buffer socket!"));
+		throw SSRStreamException();
+	}
+
+	// try to connect
+	memset(&addr, 0, sizeof(addr));
+	addr.sun_family = AF_UNIX;
+	strcpy(addr.sun_path, m_filename_socket.c_str());
+	if(connect(m_fd_socket, (sockaddr*) &addr, sizeof(addr)) == -1) {
+		if(errno == ENOENT) {
+			close(m_fd_socket);
+			m_fd_socket = -1;
+			return false;
+		}
+		Logger::LogError("[SSRVideoStreamReader::ConnectFrameBuffer] " + Logger::tr("Error: Can't connect to frame buffer socket!"));
+		throw SSRStreamException();
+	}
+
+	Logger::LogInfo("[SSRVideoStreamReader::ConnectFrameBuffer] " + Logger::tr("Stream uses memfd frame buffer."));
+	return true;
+
+}
+
+bool SSRVideoStreamReader::ReceiveFrameBuffer() {
+
+	// try to receive the file descriptor
+	char dummy;
+	iovec iov;
+	iov.iov_base = &dummy;
+	iov.iov_len = 1;
+	union {
+		cmsghdr align;
+		char buffer[CMSG_SPACE(sizeof(int))];
+	} control;
+	memset(&control, 0, sizeof(control));
+	msghdr msg;
+	memset(&msg, 0, sizeof(msg));
+	msg.msg_iov = &iov;
+	msg.msg_iovlen = 1;
+	msg.msg_control = control.buffer;
+	msg.msg_controllen = sizeof(control.buffer);
+	ssize_t res = recvmsg(m_fd_socket, &msg, MSG_DONTWAIT | MSG_CMSG_CLOEXEC);
+	if(res == -1) {
+		if(errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR)
+			return false;
+		Logger::LogError("[SSRVideoStreamReader::ReceiveFrameBuffer] " + Logger::tr("Error: Can't receive frame buffer!"));
+		throw SSRStreamException();
+	}
+	if(res == 0) {
+		Logger::LogError("[SSRVideoStreamReader::ReceiveFrameBuffer] " + Logger::tr("Error: Frame buffer socket was closed without receiving the frame buffer!"));
+		throw SSRStreamException();
+	}
+	for(cmsghdr *cmsg = CMSG_FIRSTHDR(&msg); cmsg != NULL; cmsg = CMSG_NXTHDR(&msg, cmsg)) {
+		if(cmsg->cmsg_level == SOL_SOCKET && cmsg->cmsg_type == SCM_RIGHTS && cmsg->cmsg_len == CMSG_LEN(sizeof(int))) {
+			memcpy(&m_fd_frames, CMSG_DATA(cmsg), sizeof(int));
+			break;
+		}
+	}
+	if(m_fd_frames == -1) {
+		Logger::LogError("[SSRVideoStreamReader::ReceiveFrameBuffer] " + Logger::tr("Error: Frame buffer message did not contain a file descriptor!"));
+		throw SSRStreamException();
+	}
+
+	// the socket is no longer needed
+	close(m_fd_socket);
+	m_fd_socket = -1;
+
+	// check the size
+	GLInjectHeader *header = GetGLInjectHeader();
+	std::atomic_thread_fence(std::memory_order_acquire);
+	m_frame_slot_size = header->frame_slot_size;
+	struct stat statinfo;
+	if(m_frame_slot_size == 0 || fstat(m_fd_frames, &statinfo) == -1 || (size_t) statinfo.st_size < m_frame_slot_size * GLINJECT_RING_BUFFER_SIZE) {
+		Logger::LogError("[SSRVideoStreamReader::ReceiveFrameBuffer] " + Logger::tr("Error: Size of frame buffer is incorrect!"));
+		throw SSRStreamException();
+	}
+
+	// map the entire frame buffer, this mapping never changes
+	m_mmap_size_frames = m_frame_slot_size * GLINJECT_RING_BUFFER_SIZE;
+	m_mmap_ptr_frames = mmap(NULL, m_mmap_size_frames, PROT_READ | PROT_WRITE, MAP_SHARED, m_fd_frames, 0);
+	if(m_mmap_ptr_frames == MAP_FAILED) {
+		Logger::LogError("[SSRVideoStreamReader::ReceiveFrameBuffer] " + Logger::tr("Error: Can't memory-map frame buffer!"));
+		throw SSRStreamException();
+	}
+
+	return true;
+
+}
+
 void SSRVideoStreamReader::GetCurrentSize(unsigned int* width, unsigned int* height) {
 	GLInjectHeader *header = GetGLInjectHeader();
 	std::atomic_thread_fence(std::memory_order_acquire);
@@ -178,6 +317,53 @@ void SSRVideoStreamReader::ChangeCaptureParameters(unsigned int flags, unsigned
 	std::atomic_thread_fence(std::memory_order_release);
 }
 
+void SSRVideoStreamReader::ChangeNextTimestamp(int64_t next_timestamp) {
+	GLInjectHeader *header = GetGLInjectHeader();
+	__atomic_store_n(&header->capture_next_timestamp, next_timestamp, __ATOMIC_RELEASE);
+}
+
+void SSRVideoStreamReader::GetPacingError(unsigned int* avg, unsigned int* max) {
+	GLInjectHeader *header = GetGLInjectHeader();
+	std::atomic_thread_fence(std::memory_order_acquire);
+	if(header->identifier != GLINJECT_IDENTIFIER) {
+		*avg = 0;
+		*max = 0;
+		return;
+	}
+	*avg = header->pacing_error_avg;
+	*max = header->pacing_error_max;
+}
+
+void SSRVideoStreamReader::GetOverhead(SSRVideoStreamOverhead* overhead) {
+	GLInjectHeader *header = GetGLInjectHeader();
+	std::atomic_thread_fence(std::memory_order_acquire);
+	if(header->identifier != GLINJECT_IDENTIFIER) {
+		*overhead = SSRVideoStreamOverhead();
+		return;
+	}
+	overhead->cpu_mean = header->overhead_cpu_mean;
+	overhead->cpu_p99 = header->overhead_cpu_p99;
+	overhead->cpu_max = header->overhead_cpu_max;
+	overhead->gpu_mean = header->overhead_gpu_mean;
+	overhead->gpu_p99 = header->overhead_gpu_p99;
+	overhead->gpu_max = header->overhead_gpu_max;
+}
+
+void SSRVideoStreamReader::GetNewDroppedFrames(unsigned int* ring_full, unsigned int* too_large) {
+	GLInjectHeader *header = GetGLInjectHeader();
+	std::atomic_thread_fence(std::memory_order_acquire);
+	if(header->identifier != GLINJECT_IDENTIFIER) {
+		*ring_full = 0;
+		*too_large = 0;
+		return;
+	}
+	uint32_t dropped_ring_full = header->dropped_ring_full, dropped_too_large = header->dropped_too_large;
+	*ring_full = dropped_ring_full - m_dropped_ring_full_last;
+	*too_large = dropped_too_large - m_dropped_too_large_last;
+	m_dropped_ring_full_last = dropped_ring_full;
+	m_dropped_too_large_last = dropped_too_large;
+}
+
 void SSRVideoStreamReader::Clear() {
 	GLInjectHeader *header = GetGLInjectHeader();
 	std::atomic_thread_fence(std::memory_order_acquire);
@@ -185,6 +371,12 @@ void SSRVideoStreamReader::Clear() {
 	std::atomic_thread_fence(std::memory_order_release);
 }
 
+uint32_t SSRVideoStreamReader::GetWindowID() {
+	GLInjectHeader *header = GetGLInjectHeader();
+	std::atomic_thread_fence(std::memory_order_acquire);
+	return header->window_id;
+}
+
 void* SSRVideoStreamReader::GetFrame(int64_t* timestamp, unsigned int* width, unsigned int* height, int* stride) {
 
 	// make sure that the stream has been initialized
@@ -216,6 +408,17 @@ void* SSRVideoStreamReader::GetFrame(int64_t* timestamp, unsigned int* width, un
 	if(abs(*stride) > SSR_MAX_IMAGE_SIZE * 4)
 		return NULL;
 
+	// with memfd, the frame is in one of the slots of the frame buffer
+	if(m_use_memfd) {
+		if(m_mmap_ptr_frames == MAP_FAILED && !ReceiveFrameBuffer())
+			return NULL;
+		if((size_t) abs(*stride) * (size_t) *height > m_frame_slot_size) {
+			Logger::LogError("[SSRVideoStreamReader::GetFrame] " + Logger::tr("Error: Frame is too large for the frame buffer!"));
+			throw SSRStreamException();
+		}
+		return (char*) m_mmap_ptr_frames + (size_t) (read_pos % GLINJECT_RING_BUFFER_SIZE) * m_frame_slot_size;
+	}
+
 	// read frame
 	FrameData &fd = m_frame_data[read_pos % GLINJECT_RING_BUFFER_SIZE];
 	size_t required_size = (size_t) abs(*stride) * (size_t) *height;
@@ -24,6 +24,12 @@ along with SimpleScreenRecorder.  If not, see <http://www.gnu.org/licenses/>.
 
 #include "../glinject/ShmStructs.h"
 
+// Capture overhead statistics of the application, in microseconds per swap.
+struct SSRVideoStreamOverhead {
+	unsigned int cpu_mean, cpu_p99, cpu_max;
+	unsigned int gpu_mean, gpu_p99, gpu_max;
+};
+
 class SSRVideoStreamReader {
 
 private:
@@ -36,19 +42,27 @@ private:
 
 private:
 	SSRVideoStream m_stream;
-	std::string m_channel_directory, m_filename_main;
+	std::string m_channel_directory, m_filename_main, m_filename_socket;
 	size_t m_page_size;
 
 	int64_t m_fps_last_timestamp;
 	uint32_t m_fps_last_counter;
 	double m_fps_current;
 
+	uint32_t m_dropped_ring_full_last, m_dropped_too_large_last;
+
 	int m_fd_main, m_file_lock;
 	void *m_mmap_ptr_main;
 	size_t m_mmap_size_main;
 
 	FrameData m_frame_data[GLINJECT_RING_BUFFER_SIZE];
 
+	// memfd transport
+	bool m_use_memfd;
+	int m_fd_socket, m_fd_frames;
+	void *m_mmap_ptr_frames;
+	size_t m_mmap_size_frames, m_frame_slot_size;
+
 public:
 	SSRVideoStreamReader(const std::string& channel, const SSRVideoStream& stream);
 	~SSRVideoStreamReader();
@@ -57,6 +71,9 @@ private:
 	void Init();
 	void Free();
 
+	bool ConnectFrameBuffer();
+	bool ReceiveFrameBuffer();
+
 public:
 	// Reads the current size of the stream. If the stream hasn't been started yet, this will be 0x0.
 	void GetCurrentSize(unsigned int* width, unsigned int* height);
@@ -67,10 +84,27 @@ public:
 	// Changes the capture parameters.
 	void ChangeCaptureParameters(unsigned int flags, unsigned int target_fps);
 
+	// Tells the application when the next frame is needed (0 if unknown), the fps limiter will align its phase to this.
+	void ChangeNextTimestamp(int64_t next_timestamp);
+
+	// Returns the average and maximum wake-up error of the fps limiter of the application (in microseconds).
+	void GetPacingError(unsigned int* avg, unsigned int* max);
+
+	// Returns the capture overhead statistics reported by the application.
+	void GetOverhead(SSRVideoStreamOverhead* overhead);
+
+	// Returns the number of frames that the application has dropped since the last call, because the ring buffer was full
+	// or because the frame was too large.
+	void GetNewDroppedFrames(unsigned int* ring_full, unsigned int* too_large);
+
+	// Returns the X11 window ID of the captured window, or 0 if it is not known.
+	uint32_t GetWindowID();
+
 	// Clears the ring buffer (i.e. drops all frames).
 	void Clear();
 
 	// Checks whether a new frame is available, and returns a pointer to the frame memory if it is. Otherwise it returns NULL.
+	// The frame memory is writable (e.g. to draw the cursor) until NextFrame is called.
 	void* GetFrame(int64_t* timestamp, unsigned int* width, unsigned int* height, int* stride);
 
 	// Drops the current frame and goes to the next frame.
@@ -270,6 +270,8 @@ void SSRVideoStreamWatcher::HandleChanges(AddCallback add_callback, RemoveCallba
 			std::string filename = m_channel_directory + "/videoframe" + NumToString(i) + "-" + m_streams[j].m_stream_name;
 			unlink(filename.c_str());
 		}
+		std::string filename_socket = m_channel_directory + "/videofd-" + m_streams[j].m_stream_name;
+		unlink(filename_socket.c_str());
 		std::string filename = m_channel_directory + "/video-" + m_streams[j].m_stream_name;
 		unlink(filename.c_str());
 		Logger::LogInfo("[SSRVideoStreamWatcher::Init] " + Logger::tr("Deleted abandoned stream %1.").arg(QString::fromStdString(m_streams[j].m_stream_name)));
@@ -0,0 +1,348 @@
+/*
+Copyright (c) 2012-2020 Maarten Baert <maarten-baert@hotmail.com>
+
+This file is part of SimpleScreenRecorder.
+
+SimpleScreenRecorder is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+SimpleScreenRecorder is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with SimpleScreenRecorder.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "TestPatternInput.h"
+
+#include "Logger.h"
+#include "ThreadWatchdog.h"
+
+// The size of a text glyph cell in pixels. The glyphs themselves are random 5x6 bitmaps with double-height pixels.
+const unsigned int TestPatternInput::TEXT_GLYPH_WIDTH = 8;
+const unsigned int TestPatternInput::TEXT_GLYPH_HEIGHT = 16;
+
+// The number of pixels the text scrolls per frame.
+const unsigned int TestPatternInput::TEXT_SCROLL_SPEED = 4;
+
+// The number of pixels the noise region moves per frame.
+const unsigned int TestPatternInput::REGION_SPEED = 6;
+
+static const uint32_t COLOR_BARS[] = {
+	0xffc0c0c0, 0xffc0c000, 0xff00c0c0, 0xff00c000, 0xffc000c0, 0xffc00000, 0xff0000c0, 0xff101010,
+};
+static const uint32_t TEXT_BACKGROUND = 0xff1e1e1e;
+static const uint32_t TEXT_COLORS[] = {
+	0xffd0d0d0, 0xffd0d0d0, 0xffd0d0d0, 0xff6a9955, 0xff569cd6, 0xffce9178,
+};
+
+// Returns a position that moves back and forth between 0 and range.
+static unsigned int Bounce(uint64_t position, unsigned int range) {
+	if(range == 0)
+		return 0;
+	unsigned int p = position % (2 * (uint64_t) range);
+	return (p < range)? p : 2 * range - p;
+}
+
+TestPatternInput::TestPatternInput(enum_pattern pattern, unsigned int width, unsigned int height, unsigned int frame_rate) {
+
+	m_pattern = pattern;
+	m_width = width;
+	m_height = height;
+	m_frame_rate = frame_rate;
+
+	if(m_pattern >= PATTERN_COUNT) {
+		Logger::LogError("[TestPatternInput::Init] " + Logger::tr("Error: Unknown test pattern!"));
+		throw TestPatternException();
+	}
+	if(m_width == 0 || m_height == 0) {
+		Logger::LogError("[TestPatternInput::Init] " + Logger::tr("Error: Width or height is zero!"));
+		throw TestPatternException();
+	}
+	if(m_width > SSR_MAX_IMAGE_SIZE || m_height > SSR_MAX_IMAGE_SIZE) {
+		Logger::LogError("[TestPatternInput::Init] " + Logger::tr("Error: Width or height is too large, the maximum width and height is %1!").arg(SSR_MAX_IMAGE_SIZE));
+		throw TestPatternException();
+	}
+	if(m_frame_rate > 1000) {
+		Logger::LogError("[TestPatternInput::Init] " + Logger::tr("Error: Frame rate is too high, the maximum frame rate is %1!").arg(1000));
+		throw TestPatternException();
+	}
+
+	try {
+		Init();
+	} catch(...) {
+		Free();
+		throw;
+	}
+
+}
+
+TestPatternInput::~TestPatternInput() {
+
+	// tell the thread to stop
+	if(m_thread.joinable()) {
+		Logger::LogInfo("[TestPatternInput::~TestPatternInput] " + Logger::tr("Stopping input thread ..."));
+		m_should_stop = true;
+		m_thread.join();
+	}
+
+	// free everything
+	Free();
+
+}
+
+void TestPatternInput::GetCurrentSize(unsigned int* width, unsigned int* height) {
+	*width = m_width;
+	*height = m_height;
+}
+
+double TestPatternInput::GetFPS() {
+	int64_t timestamp = hrt_time_micro();
+	uint32_t frame_counter = m_frame_counter;
+	unsigned int time = timestamp - m_fps_last_timestamp;
+	if(time > 500000) {
+		unsigned int frames = frame_counter - m_fps_last_counter;
+		m_fps_last_timestamp = timestamp;
+		m_fps_last_counter = frame_counter;
+		m_fps_current = (double) frames / ((double) time * 1.0e-6);
+	}
+	return m_fps_current;
+}
+
+TestPatternInput::enum_pattern TestPatternInput::GetPatternFromName(const QString& name) {
+	if(name == "static")
+		return PATTERN_STATIC;
+	if(name == "text")
+		return PATTERN_TEXT;
+	if(name == "noise")
+		return PATTERN_NOISE;
+	if(name == "partial")
+		return PATTERN_PARTIAL;
+	return PATTERN_COUNT;
+}
+
+void TestPatternInput::Init() {
+
+	// allocate the image
+	m_image_stride = grow_align16(m_width * 4);
+	m_image_buffer.Alloc(m_image_stride * m_height);
+	m_rng_state = 12345; // fixed seed, so every run generates the same frames
+
+	// generate the source image
+	// the text source is rounded up to whole lines, so it can scroll without seams
+	m_source_height = (m_pattern == PATTERN_TEXT)? (m_height + TEXT_GLYPH_HEIGHT - 1) / TEXT_GLYPH_HEIGHT * TEXT_GLYPH_HEIGHT : m_height;
+	switch(m_pattern) {
+		case PATTERN_STATIC: {
+			GenerateColorBars(m_image_buffer.GetData());
+			break;
+		}
+		case PATTERN_TEXT: {
+			m_source_buffer.Alloc(m_image_stride * m_source_height);
+			GenerateText(m_source_buffer.GetData());
+			break;
+		}
+		case PATTERN_NOISE: {
+			break;
+		}
+		case PATTERN_PARTIAL: {
+			m_source_buffer.Alloc(m_image_stride * m_source_height);
+			GenerateColorBars(m_source_buffer.GetData());
+			CopySource(0, 0, m_width, m_height);
+			break;
+		}
+		default: assert(false);
+	}
+	m_region_x = 0;
+	m_region_y = 0;
+	m_region_width = std::max(1u, m_width / 4);
+	m_region_height = std::max(1u, m_height / 4);
+
+	// start input thread
+	m_frame_counter = 0;
+	m_fps_last_timestamp = hrt_time_micro();
+	m_fps_last_counter = 0;
+	m_fps_current = 0.0;
+	m_should_stop = false;
+	m_error_occurred = false;
+	m_thread = std::thread(&TestPatternInput::InputThread, this);
+
+}
+
+void TestPatternInput::Free() {
+	// nothing to do, the buffers are freed by their destructors
+}
+
+uint32_t TestPatternInput::NextRandom() {
+	// xorshift32, fast enough to fill full frames with noise
+	uint32_t x = m_rng_state;
+	x ^= x << 13;
+	x ^= x >> 17;
+	x ^= x << 5;
+	m_rng_state = x;
+	return x;
+}
+
+void TestPatternInput::GenerateColorBars(uint8_t* data) {
+	unsigned int bars = sizeof(COLOR_BARS) / sizeof(COLOR_BARS[0]);
+	unsigned int split = m_height * 3 / 4;
+	for(unsigned int y = 0; y < m_height; ++y) {
+		uint32_t *row = (uint32_t*) (data + m_image_stride * y);
+		if(y < split) {
+			for(unsigned int x = 0; x < m_width; ++x) {
+				row[x] = COLOR_BARS[(uint64_t) x * bars / m_width];
+			}
+		} else {
+			for(unsigned int x = 0; x < m_width; ++x) {
+				uint32_t v = (uint64_t) x * 255 / std::max(1u, m_width - 1);
+				row[x] = 0xff000000 | (v << 16) | (v << 8) | v;
+			}
+		}
+	}
+}
+
+void TestPatternInput::GenerateText(uint8_t* data) {
+
+	// clear the background
+	for(unsigned int y = 0; y < m_source_height; ++y) {
+		uint32_t *row = (uint32_t*) (data + m_image_stride * y);
+		std::fill_n(row, m_width, TEXT_BACKGROUND);
+	}
+
+	// draw lines of random glyphs with random lengths, some of them empty
+	unsigned int columns = m_width / TEXT_GLYPH_WIDTH, colors = sizeof(TEXT_COLORS) / sizeof(TEXT_COLORS[0]);
+	for(unsigned int line = 0; line < m_source_height / TEXT_GLYPH_HEIGHT; ++line) {
+		if(NextRandom() % 8 == 0)
+			continue;
+		unsigned int length = NextRandom() % (columns + 1);
+		uint32_t color = TEXT_COLORS[NextRandom() % colors];
+		for(unsigned int column = 0; column < length; ++column) {
+			if(NextRandom() % 6 == 0)
+				continue; // space
+			uint32_t bits = NextRandom();
+			for(unsigned int gy = 0; gy < 6; ++gy) {
+				for(unsigned int gx = 0; gx < 5; ++gx) {
+					if(!((bits >> (gy * 5 + gx)) & 1))
+						continue;
+					unsigned int x = column * TEXT_GLYPH_WIDTH + 1 + gx, y = line * TEXT_GLYPH_HEIGHT + 2 + gy * 2;
+					((uint32_t*) (data + m_image_stride * y))[x] = color;
+					((uint32_t*) (data + m_image_stride * (y + 1)))[x] = color;
+				}
+			}
+		}
+	}
+
+}
+
+void TestPatternInput::CopySource(unsigned int x, unsigned int y, unsigned int w, unsigned int h) {
+	for(unsigned int j = y; j < y + h; ++j) {
+		memcpy(m_image_buffer.GetData() + m_image_stride * j + x * 4, m_source_buffer.GetData() + m_image_stride * j + x * 4, w * 4);
+	}
+}
+
+void TestPatternInput::FillNoise(unsigned int x, unsigned int y, unsigned int w, unsigned int h) {
+	for(unsigned int j = y; j < y + h; ++j) {
+		uint32_t *row = (uint32_t*) (m_image_buffer.GetData() + m_image_stride * j) + x;
+		for(unsigned int i = 0; i < w; ++i) {
+			row[i] = NextRandom() | 0xff000000;
+		}
+	}
+}
+
+void TestPatternInput::UpdateImage(uint64_t frame) {
+	switch(m_pattern) {
+		case PATTERN_STATIC: {
+			break;
+		}
+		case PATTERN_TEXT: {
+			unsigned int offset = (frame * TEXT_SCROLL_SPEED) % m_source_height;
+			for(unsigned int y = 0; y < m_height; ++y) {
+				unsigned int source_y = (y + offset) % m_source_height;
+				memcpy(m_image_buffer.GetData() + m_image_stride * y, m_source_buffer.GetData() + m_image_stride * source_y, m_width * 4);
+			}
+			break;
+		}
+		case PATTERN_NOISE: {
+			FillNoise(0, 0, m_width, m_height);
+			break;
+		}
+		case PATTERN_PARTIAL: {
+			// restore the background, then draw the region at its new position
+			CopySource(m_region_x, m_region_y, m_region_width, m_region_height);
+			m_region_x = Bounce(frame * REGION_SPEED, m_width - m_region_width);
+			m_region_y = Bounce(frame * REGION_SPEED / 2, m_height - m_region_height);
+			FillNoise(m_region_x, m_region_y, m_region_width, m_region_height);
+			break;
+		}
+		default: assert(false);
+	}
+}
+
+void TestPatternInput::InputThread() {
+	try {
+
+		Logger::LogInfo("[TestPatternInput::InputThread] " + Logger::tr("Input thread started."));
+
+		ThreadHeartbeat heartbeat("TestPatternInput");
+
+		int64_t start_timestamp = hrt_time_micro();
+		uint64_t frame = 0;
+
+		while(!m_should_stop) {
+
+			// sleep
+			// with a fixed frame rate, the frames follow an absolute schedule so the sleep errors don't accumulate
+			heartbeat.Beat("wait");
+			int64_t next_timestamp, timestamp = hrt_time_micro();
+			if(m_frame_rate == 0) {
+				next_timestamp = CalculateNextVideoTimestamp();
+				if(next_timestamp == SINK_TIMESTAMP_NONE) {
+					usleep(20000);
+					continue;
+				}
+			} else {
+				next_timestamp = start_timestamp + (int64_t) (frame * 1000000 / m_frame_rate);
+				if(timestamp - next_timestamp > 1000000 / (int64_t) m_frame_rate) {
+					// we can't keep up, skip the frames that were missed rather than generating a burst of frames
+					frame = (uint64_t) (timestamp - start_timestamp) * m_frame_rate / 1000000;
+					next_timestamp = start_timestamp + (int64_t) (frame * 1000000 / m_frame_rate);
+				}
+			}
+			if(next_timestamp != SINK_TIMESTAMP_ASAP) {
+				int64_t wait = next_timestamp - timestamp;
+				if(wait > 21000) {
+					// the thread can't sleep for too long because it still has to check the m_should_stop flag periodically
+					usleep(20000);
+					continue;
+				} else if(wait > 0) {
+					usleep(wait);
+				}
+			}
+
+			// generate the frame
+			heartbeat.Beat("generate");
+			UpdateImage(frame);
+
+			// push the frame
+			// with a fixed frame rate, the frame gets its scheduled timestamp so the sleep jitter doesn't end up in the output
+			heartbeat.Beat("push");
+			timestamp = (m_frame_rate == 0)? hrt_time_micro() : next_timestamp;
+			PushVideoFrame(m_width, m_height, m_image_buffer.GetData(), m_image_stride, AV_PIX_FMT_BGRA, SWS_CS_DEFAULT, timestamp);
+			++m_frame_counter;
+			++frame;
+
+		}
+
+		Logger::LogInfo("[TestPatternInput::InputThread] " + Logger::tr("Input thread stopped."));
+
+	} catch(const std::exception& e) {
+		m_error_occurred = true;
+		Logger::LogError("[TestPatternInput::InputThread] " + Logger::tr("Exception '%1' in input thread.").arg(e.what()));
+	} catch(...) {
+		m_error_occurred = true;
+		Logger::LogError("[TestPatternInput::InputThread] " + Logger::tr("Unknown exception in input thread."));
+	}
+}
@@ -0,0 +1,96 @@
+/*
+Copyright (c) 2012-2020 Maarten Baert <maarten-baert@hotmail.com>
+
+This file is part of SimpleScreenRecorder.
+
+SimpleScreenRecorder is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+SimpleScreenRecorder is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with SimpleScreenRecorder.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+#include "Global.h"
+
+#include "SourceSink.h"
+#include "TempBuffer.h"
+
+// Generates synthetic BGRA frames, so the video path can be tested and profiled without a screen or camera.
+class TestPatternInput : public VideoSource {
+
+public:
+	enum enum_pattern {
+		PATTERN_STATIC, // color bars, only generated once
+		PATTERN_TEXT, // scrolling lines of text-like glyphs, similar to a terminal
+		PATTERN_NOISE, // full-frame random noise, the worst case for the encoder
+		PATTERN_PARTIAL, // static background with a moving noise region, similar to a video playing in a window
+		PATTERN_COUNT // must be last
+	};
+
+private:
+	static const unsigned int TEXT_GLYPH_WIDTH, TEXT_GLYPH_HEIGHT, TEXT_SCROLL_SPEED, REGION_SPEED;
+
+private:
+	enum_pattern m_pattern;
+	unsigned int m_width, m_height;
+	unsigned int m_frame_rate;
+
+	std::atomic<uint32_t> m_frame_counter;
+	int64_t m_fps_last_timestamp;
+	uint32_t m_fps_last_counter;
+	double m_fps_current;
+
+	TempBuffer<uint8_t> m_image_buffer, m_source_buffer;
+	int m_image_stride;
+	unsigned int m_source_height;
+	unsigned int m_region_x, m_region_y, m_region_width, m_region_height;
+	uint32_t m_rng_state;
+
+	std::thread m_thread;
+	std::atomic<bool> m_should_stop, m_error_occurred;
+
+public:
+	// If the frame rate is zero, frames are generated whenever the sink asks for one, otherwise they are generated at exactly the given rate.
+	TestPatternInput(enum_pattern pattern, unsigned int width, unsigned int height, unsigned int frame_rate);
+	~TestPatternInput();
+
+	// Reads the current size of the stream.
+	// This function is thread-safe.
+	void GetCurrentSize(unsigned int* width, unsigned int* height);
+
+	// Returns the total number of generated frames.
+	// This function is thread-safe.
+	double GetFPS();
+
+	// Returns whether an error has occurred in the input thread.
+	// This function is thread-safe.
+	inline bool HasErrorOccurred() { return m_error_occurred; }
+
+public:
+	// Returns the pattern with the given name (as used on the command line), or PATTERN_COUNT if the name is unknown.
+	static enum_pattern GetPatternFromName(const QString& name);
+
+private:
+	void Init();
+	void Free();
+
+private:
+	uint32_t NextRandom();
+	void GenerateColorBars(uint8_t* data);
+	void GenerateText(uint8_t* data);
+	void CopySource(unsigned int x, unsigned int y, unsigned int w, unsigned int h);
+	void FillNoise(unsigned int x, unsigned int y, unsigned int w, unsigned int h);
+	void UpdateImage(uint64_t frame);
+
+private:
+	void InputThread();
+
+};
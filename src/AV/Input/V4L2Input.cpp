@@ -22,6 +22,7 @@ along with SimpleScreenRecorder.  If not, see <http://www.gnu.org/licenses/>.
 #if SSR_USE_V4L2
 
 #include "Logger.h"
+#include "ThreadWatchdog.h"
 #include "AVWrapper.h"
 #include "Synchronizer.h"
 #include "VideoEncoder.h"
@@ -262,9 +263,12 @@ void V4L2Input::InputThread() {
 
 		Logger::LogInfo("[V4L2Input::InputThread] " + Logger::tr("Input thread started."));
 
+		ThreadHeartbeat heartbeat("V4L2Input");
+
 		while(!m_should_stop) {
 
 			// dequeue a buffer
+			heartbeat.Beat("wait");
 			v4l2_buffer buf;
 			memset(&buf, 0, sizeof(buf));
 			buf.type = V4L2_BUF_TYPE_VIDEO_CAPTURE;
@@ -281,6 +285,7 @@ void V4L2Input::InputThread() {
 			++m_frame_counter;
 
 			// push the frame
+			heartbeat.Beat("push");
 			PushVideoFrame(m_width, m_height, (uint8_t*) m_v4l2_buffers[buf.index].m_data, m_v4l2_bytes_per_line, AV_PIX_FMT_YUYV422, m_colorspace, timestamp);
 
 			// requeue the buffer
@@ -0,0 +1,727 @@
+/*
+Copyright (c) 2012-2020 Maarten Baert <maarten-baert@hotmail.com>
+
+This file is part of SimpleScreenRecorder.
+
+SimpleScreenRecorder is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+SimpleScreenRecorder is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with SimpleScreenRecorder.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#include "WaylandInput.h"
+
+#if SSR_USE_WAYLAND
+
+#include "Logger.h"
+#include "ThreadWatchdog.h"
+#include "AVWrapper.h"
+
+#include <poll.h>
+
+// Maximum time between checks of the m_should_stop flag while waiting for the compositor (in microseconds).
+#define WAYLAND_DISPATCH_TIMEOUT 100000
+
+// The highest wl_output version that is used. Version 4 adds the name of the output, older versions of libwayland don't have it.
+#ifdef WL_OUTPUT_NAME_SINCE_VERSION
+#define WAYLAND_OUTPUT_VERSION 4u
+#else
+#define WAYLAND_OUTPUT_VERSION 1u
+#endif
+
+const wl_registry_listener WaylandInput::s_registry_listener = {
+	&WaylandInput::RegistryGlobal,
+	&WaylandInput::RegistryGlobalRemove,
+};
+
+const wl_output_listener WaylandInput::s_output_listener = {
+	&WaylandInput::OutputGeometry,
+	&WaylandInput::OutputMode,
+#ifdef WL_OUTPUT_NAME_SINCE_VERSION
+	&WaylandInput::OutputDone,
+	&WaylandInput::OutputScale,
+	&WaylandInput::OutputName,
+	&WaylandInput::OutputDescription,
+#endif
+};
+
+const zwlr_screencopy_frame_v1_listener WaylandInput::s_frame_listener = {
+	&WaylandInput::FrameBuffer,
+	&WaylandInput::FrameFlags,
+	&WaylandInput::FrameReady,
+	&WaylandInput::FrameFailed,
+	&WaylandInput::FrameDamage,
+	&WaylandInput::FrameLinuxDmabuf,
+	&WaylandInput::FrameBufferDone,
+};
+
+static AVPixelFormat WaylandFormatToPixelFormat(uint32_t format) {
+	switch(format) {
+		case WL_SHM_FORMAT_ARGB8888:
+		case WL_SHM_FORMAT_XRGB8888: return AV_PIX_FMT_BGRA;
+		case WL_SHM_FORMAT_ABGR8888:
+		case WL_SHM_FORMAT_XBGR8888: return AV_PIX_FMT_RGBA;
+		default: return AV_PIX_FMT_NONE;
+	}
+}
+
+WaylandInput::WaylandInput(const QString& output_name, bool record_cursor) {
+
+	m_output_name = output_name;
+	m_record_cursor = record_cursor;
+
+	m_wl_display = NULL;
+	m_wl_registry = NULL;
+	m_wl_shm = NULL;
+	m_wl_output = NULL;
+	m_screencopy_manager = NULL;
+	m_screencopy_version = 0;
+
+	for(unsigned int i = 0; i < BUFFER_COUNT; ++i) {
+		m_shm_buffers[i].m_fd = -1;
+		m_shm_buffers[i].m_data = (uint8_t*) MAP_FAILED;
+		m_shm_buffers[i].m_size = 0;
+		m_shm_buffers[i].m_pool = NULL;
+		m_shm_buffers[i].m_buffer = NULL;
+		m_shm_buffers[i].m_format = 0;
+		m_shm_buffers[i].m_width = 0;
+		m_shm_buffers[i].m_height = 0;
+		m_shm_buffers[i].m_stride = 0;
+		m_frames[i].m_input = this;
+		m_frames[i].m_frame = NULL;
+		m_frames[i].m_state = FRAME_STATE_NONE;
+	}
+
+	m_should_stop = false;
+	m_error_occurred = false;
+
+	{
+		SharedLock lock(&m_shared_data);
+		lock->m_current_width = 0;
+		lock->m_current_height = 0;
+	}
+
+	try {
+		Init();
+	} catch(...) {
+		Free();
+		throw;
+	}
+
+}
+
+WaylandInput::~WaylandInput() {
+
+	// tell the thread to stop
+	if(m_thread.joinable()) {
+		Logger::LogInfo("[WaylandInput::~WaylandInput] " + Logger::tr("Stopping input thread ..."));
+		m_should_stop = true;
+		m_thread.join();
+	}
+
+	// free everything
+	Free();
+
+}
+
+void WaylandInput::GetCurrentSize(unsigned int* width, unsigned int* height) {
+	SharedLock lock(&m_shared_data);
+	*width = lock->m_current_width;
+	*height = lock->m_current_height;
+}
+
+double WaylandInput::GetFPS() {
+	int64_t timestamp = hrt_time_micro();
+	uint32_t frame_counter = m_frame_counter;
+	unsigned int time = timestamp - m_fps_last_timestamp;
+	if(time > 500000) {
+		unsigned int frames = frame_counter - m_fps_last_counter;
+		m_fps_last_timestamp = timestamp;
+		m_fps_last_counter = frame_counter;
+		m_fps_current = (double) frames / ((double) time * 1.0e-6);
+	}
+	return m_fps_current;
+}
+
+void WaylandInput::Init() {
+
+	// connect to the compositor
+	m_wl_display = wl_display_connect(NULL);
+	if(m_wl_display == NULL) {
+		Logger::LogError("[WaylandInput::Init] " + Logger::tr("Error: Can't connect to the Wayland display!", "Don't translate 'Wayland'"));
+		throw WaylandException();
+	}
+
+	// find the globals
+	m_wl_registry = wl_display_get_registry(m_wl_display);
+	if(m_wl_registry == NULL) {
+		Logger::LogError("[WaylandInput::Init] " + Logger::tr("Error: Can't get the Wayland registry!", "Don't translate 'Wayland'"));
+		throw WaylandException();
+	}
+	wl_registry_add_listener(m_wl_registry, &s_registry_listener, this);
+	if(wl_display_roundtrip(m_wl_display) < 0) {
+		Logger::LogError("[WaylandInput::Init] " + Logger::tr("Error: Wayland roundtrip failed!", "Don't translate 'Wayland'"));
+		throw WaylandException();
+	}
+	if(m_wl_shm == NULL) {
+		Logger::LogError("[WaylandInput::Init] " + Logger::tr("Error: The Wayland compositor does not support shared memory buffers!", "Don't translate 'Wayland'"));
+		throw WaylandException();
+	}
+	if(m_screencopy_manager == NULL) {
+		Logger::LogError("[WaylandInput::Init] " + Logger::tr("Error: The Wayland compositor does not support the wlr-screencopy protocol! "
+															  "Screen capture is only supported by wlroots-based compositors such as sway.", "Don't translate 'Wayland' and 'wlr-screencopy'"));
+		throw WaylandException();
+	}
+
+	// find the output by name
+	// The names are sent by the outputs that were bound during the first roundtrip, so this requires another roundtrip.
+	if(wl_display_roundtrip(m_wl_display) < 0) {
+		Logger::LogError("[WaylandInput::Init] " + Logger::tr("Error: Wayland roundtrip failed!", "Don't translate 'Wayland'"));
+		throw WaylandException();
+	}
+	for(std::unique_ptr<OutputInfo> &output : m_wl_outputs) {
+		if(QString::fromStdString(output->m_name) == m_output_name) {
+			m_wl_output = output->m_output;
+			break;
+		}
+	}
+	if(m_wl_output == NULL) {
+		// compositors that don't support wl_output version 4 don't send names, so the output is only known if there is just one
+		if(m_wl_outputs.size() == 1 && m_wl_outputs[0]->m_name.empty()) {
+			Logger::LogWarning("[WaylandInput::Init] " + Logger::tr("Warning: The Wayland compositor does not report output names, using the only output.", "Don't translate 'Wayland'"));
+			m_wl_output = m_wl_outputs[0]->m_output;
+		} else {
+			QStringList names;
+			for(std::unique_ptr<OutputInfo> &output : m_wl_outputs) {
+				names.append((output->m_name.empty())? QString("?") : QString::fromStdString(output->m_name));
+			}
+			Logger::LogError("[WaylandInput::Init] " + Logger::tr("Error: Wayland output '%1' does not exist! Available outputs: %2", "Don't translate 'Wayland'")
+							 .arg(m_output_name).arg(names.join(", ")));
+			throw WaylandException();
+		}
+	}
+
+	Logger::LogInfo("[WaylandInput::Init] " + Logger::tr("Using wlr-screencopy version %1.", "Don't translate 'wlr-screencopy'").arg(m_screencopy_version));
+
+	// request the first frame to get the buffer parameters, so the buffer can be allocated in advance
+	// The frame is not copied yet, the input thread will do that when the first frame is needed.
+	StartFrame(0);
+	WaitForFrame(0, FRAME_STATE_BUFFER_INFO, NULL);
+	PrepareBuffer(0);
+
+	// initialize frame counter
+	m_frame_counter = 0;
+	m_fps_last_timestamp = hrt_time_micro();
+	m_fps_last_counter = 0;
+	m_fps_current = 0.0;
+
+	// start input thread
+	m_thread = std::thread(&WaylandInput::InputThread, this);
+
+}
+
+void WaylandInput::Free() {
+	for(unsigned int i = 0; i < BUFFER_COUNT; ++i) {
+		FreeFrame(i);
+		FreeBuffer(&m_shm_buffers[i]);
+	}
+	if(m_screencopy_manager != NULL) {
+		zwlr_screencopy_manager_v1_destroy(m_screencopy_manager);
+		m_screencopy_manager = NULL;
+	}
+	m_wl_output = NULL;
+	for(std::unique_ptr<OutputInfo> &output : m_wl_outputs) {
+		wl_output_destroy(output->m_output);
+	}
+	m_wl_outputs.clear();
+	if(m_wl_shm != NULL) {
+		wl_shm_destroy(m_wl_shm);
+		m_wl_shm = NULL;
+	}
+	if(m_wl_registry != NULL) {
+		wl_registry_destroy(m_wl_registry);
+		m_wl_registry = NULL;
+	}
+	if(m_wl_display != NULL) {
+		wl_display_disconnect(m_wl_display);
+		m_wl_display = NULL;
+	}
+}
+
+void WaylandInput::AllocateBuffer(ShmBuffer* buffer, uint32_t format, unsigned int width, unsigned int height, unsigned int stride) {
+
+	if(width == 0 || height == 0 || width > SSR_MAX_IMAGE_SIZE || height > SSR_MAX_IMAGE_SIZE || stride < width * 4) {
+		Logger::LogError("[WaylandInput::AllocateBuffer] " + Logger::tr("Error: Invalid Wayland buffer size %1x%2!", "Don't translate 'Wayland'").arg(width).arg(height));
+		throw WaylandException();
+	}
+
+	// create the shared memory file
+	size_t size = (size_t) stride * (size_t) height;
+#ifdef MFD_CLOEXEC
+	buffer->m_fd = memfd_create("simplescreenrecorder-wayland", MFD_CLOEXEC);
+#else
+	{
+		std::string name = "/simplescreenrecorder-wayland-" + std::to_string(getpid());
+		buffer->m_fd = shm_open(name.c_str(), O_RDWR | O_CREAT | O_EXCL | O_CLOEXEC, 0600);
+		if(buffer->m_fd != -1)
+			shm_unlink(name.c_str());
+	}
+#endif
+	if(buffer->m_fd == -1) {
+		Logger::LogError("[WaylandInput::AllocateBuffer] " + Logger::tr("Error: Can't create shared memory file!"));
+		throw WaylandException();
+	}
+	if(ftruncate(buffer->m_fd, size) == -1) {
+		Logger::LogError("[WaylandInput::AllocateBuffer] " + Logger::tr("Error: Can't resize shared memory file!"));
+		throw WaylandException();
+	}
+	buffer->m_data = (uint8_t*) mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED, buffer->m_fd, 0);
+	if(buffer->m_data == MAP_FAILED) {
+		Logger::LogError("[WaylandInput::AllocateBuffer] " + Logger::tr("Error: Can't map shared memory file!"));
+		throw WaylandException();
+	}
+	buffer->m_size = size;
+
+	// share it with the compositor
+	buffer->m_pool = wl_shm_create_pool(m_wl_shm, buffer->m_fd, size);
+	if(buffer->m_pool == NULL) {
+		Logger::LogError("[WaylandInput::AllocateBuffer] " + Logger::tr("Error: Can't create Wayland shared memory pool!", "Don't translate 'Wayland'"));
+		throw WaylandException();
+	}
+	buffer->m_buffer = wl_shm_pool_create_buffer(buffer->m_pool, 0, width, height, stride, format);
+	if(buffer->m_buffer == NULL) {
+		Logger::LogError("[WaylandInput::AllocateBuffer] " + Logger::tr("Error: Can't create Wayland buffer!", "Don't translate 'Wayland'"));
+		throw WaylandException();
+	}
+	buffer->m_format = format;
+	buffer->m_width = width;
+	buffer->m_height = height;
+	buffer->m_stride = stride;
+
+	// save current size
+	{
+		SharedLock lock(&m_shared_data);
+		lock->m_current_width = width;
+		lock->m_current_height = height;
+	}
+
+}
+
+void WaylandInput::FreeBuffer(ShmBuffer* buffer) {
+	if(buffer->m_buffer != NULL) {
+		wl_buffer_destroy(buffer->m_buffer);
+		buffer->m_buffer = NULL;
+	}
+	if(buffer->m_pool != NULL) {
+		wl_shm_pool_destroy(buffer->m_pool);
+		buffer->m_pool = NULL;
+	}
+	if(buffer->m_data != MAP_FAILED) {
+		munmap(buffer->m_data, buffer->m_size);
+		buffer->m_data = (uint8_t*) MAP_FAILED;
+		buffer->m_size = 0;
+	}
+	if(buffer->m_fd != -1) {
+		close(buffer->m_fd);
+		buffer->m_fd = -1;
+	}
+}
+
+void WaylandInput::StartFrame(unsigned int index) {
+
+	// request a new frame, the buffer parameters will be sent later
+	FrameInfo &frame = m_frames[index];
+	frame.m_state = FRAME_STATE_BUFFER_INFO;
+	frame.m_has_shm_buffer = false;
+	frame.m_format = 0;
+	frame.m_width = 0;
+	frame.m_height = 0;
+	frame.m_stride = 0;
+	frame.m_flags = 0;
+	frame.m_frame = zwlr_screencopy_manager_v1_capture_output(m_screencopy_manager, (m_record_cursor)? 1 : 0, m_wl_output);
+	if(frame.m_frame == NULL) {
+		Logger::LogError("[WaylandInput::StartFrame] " + Logger::tr("Error: Can't create screencopy frame!"));
+		throw WaylandException();
+	}
+	zwlr_screencopy_frame_v1_add_listener(frame.m_frame, &s_frame_listener, &frame);
+
+	// send the request right away, so the compositor can answer while we are doing something else
+	if(wl_display_flush(m_wl_display) < 0 && errno != EAGAIN) {
+		Logger::LogError("[WaylandInput::StartFrame] " + Logger::tr("Error: Can't send Wayland requests!", "Don't translate 'Wayland'"));
+		throw WaylandException();
+	}
+
+}
+
+void WaylandInput::PrepareBuffer(unsigned int index) {
+
+	// check the buffer parameters
+	FrameInfo &frame = m_frames[index];
+	if(frame.m_state == FRAME_STATE_FAILED) {
+		Logger::LogError("[WaylandInput::PrepareBuffer] " + Logger::tr("Error: The compositor refused to capture the output!"));
+		throw WaylandException();
+	}
+	if(!frame.m_has_shm_buffer) {
+		Logger::LogError("[WaylandInput::PrepareBuffer] " + Logger::tr("Error: The Wayland compositor does not offer a shared memory buffer for the output!", "Don't translate 'Wayland'"));
+		throw WaylandException();
+	}
+
+	// reallocate the buffer if the output has changed
+	ShmBuffer &buffer = m_shm_buffers[index];
+	if(frame.m_format != buffer.m_format || frame.m_width != buffer.m_width || frame.m_height != buffer.m_height || frame.m_stride != buffer.m_stride) {
+		if(WaylandFormatToPixelFormat(frame.m_format) == AV_PIX_FMT_NONE) {
+			Logger::LogError("[WaylandInput::PrepareBuffer] " + Logger::tr("Error: Unsupported Wayland buffer format 0x%1!", "Don't translate 'Wayland'")
+							 .arg(frame.m_format, 8, 16, QLatin1Char('0')));
+			throw WaylandException();
+		}
+		unsigned int current_width, current_height;
+		GetCurrentSize(&current_width, &current_height);
+		if(current_width != 0 && (frame.m_width != current_width || frame.m_height != current_height))
+			Logger::LogInfo("[WaylandInput::PrepareBuffer] " + Logger::tr("Output size changed to %1x%2.").arg(frame.m_width).arg(frame.m_height));
+		FreeBuffer(&buffer);
+		AllocateBuffer(&buffer, frame.m_format, frame.m_width, frame.m_height, frame.m_stride);
+	}
+
+}
+
+void WaylandInput::CopyFrame(unsigned int index) {
+
+	PrepareBuffer(index);
+
+	// copy the frame into the buffer that belongs to it
+	// If the compositor supports it, the copy is delayed until the output changes. In the mean time, the synchronizer will
+	// just repeat the previous frame.
+	FrameInfo &frame = m_frames[index];
+	frame.m_state = FRAME_STATE_COPYING;
+	if(m_screencopy_version >= 2)
+		zwlr_screencopy_frame_v1_copy_with_damage(frame.m_frame, m_shm_buffers[index].m_buffer);
+	else
+		zwlr_screencopy_frame_v1_copy(frame.m_frame, m_shm_buffers[index].m_buffer);
+	if(wl_display_flush(m_wl_display) < 0 && errno != EAGAIN) {
+		Logger::LogError("[WaylandInput::CopyFrame] " + Logger::tr("Error: Can't send Wayland requests!", "Don't translate 'Wayland'"));
+		throw WaylandException();
+	}
+
+}
+
+void WaylandInput::FreeFrame(unsigned int index) {
+	if(m_frames[index].m_frame != NULL) {
+		zwlr_screencopy_frame_v1_destroy(m_frames[index].m_frame);
+		m_frames[index].m_frame = NULL;
+	}
+	m_frames[index].m_state = FRAME_STATE_NONE;
+}
+
+void WaylandInput::WaitForFrame(unsigned int index, enum_frame_state state, ThreadHeartbeat* heartbeat) {
+	while(m_frames[index].m_state == state && !m_should_stop) {
+		if(heartbeat != NULL)
+			heartbeat->Beat("wait for compositor"); // with damage tracking this can take forever, which is not a stall
+		DispatchEvents(WAYLAND_DISPATCH_TIMEOUT);
+	}
+}
+
+void WaylandInput::DispatchEvents(int64_t timeout) {
+
+	// this is the standard way to wait for events with a timeout, see the documentation of wl_display_prepare_read
+	while(wl_display_prepare_read(m_wl_display) != 0) {
+		if(wl_display_dispatch_pending(m_wl_display) < 0) {
+			Logger::LogError("[WaylandInput::DispatchEvents] " + Logger::tr("Error: Can't dispatch Wayland events!", "Don't translate 'Wayland'"));
+			throw WaylandException();
+		}
+	}
+	if(wl_display_flush(m_wl_display) < 0 && errno != EAGAIN) {
+		wl_display_cancel_read(m_wl_display);
+		Logger::LogError("[WaylandInput::DispatchEvents] " + Logger::tr("Error: Can't send Wayland requests!", "Don't translate 'Wayland'"));
+		throw WaylandException();
+	}
+	pollfd pfd;
+	pfd.fd = wl_display_get_fd(m_wl_display);
+	pfd.events = POLLIN;
+	pfd.revents = 0;
+	timespec ts;
+	ts.tv_sec = timeout / 1000000;
+	ts.tv_nsec = timeout % 1000000 * 1000;
+	int res = ppoll(&pfd, 1, &ts, NULL);
+	if(res <= 0) {
+		wl_display_cancel_read(m_wl_display);
+		if(res < 0 && errno != EINTR) {
+			Logger::LogError("[WaylandInput::DispatchEvents] " + Logger::tr("Error: Can't poll Wayland display!", "Don't translate 'Wayland'"));
+			throw WaylandException();
+		}
+		return;
+	}
+	if(wl_display_read_events(m_wl_display) < 0 || wl_display_dispatch_pending(m_wl_display) < 0) {
+		Logger::LogError("[WaylandInput::DispatchEvents] " + Logger::tr("Error: Can't dispatch Wayland events!", "Don't translate 'Wayland'"));
+		throw WaylandException();
+	}
+
+}
+
+void WaylandInput::RegistryGlobal(void* data, wl_registry* registry, uint32_t name, const char* interface, uint32_t version) {
+	WaylandInput *input = (WaylandInput*) data;
+	if(strcmp(interface, wl_shm_interface.name) == 0) {
+		if(input->m_wl_shm == NULL)
+			input->m_wl_shm = (wl_shm*) wl_registry_bind(registry, name, &wl_shm_interface, 1);
+	} else if(strcmp(interface, wl_output_interface.name) == 0) {
+		std::unique_ptr<OutputInfo> info(new OutputInfo());
+		info->m_output = (wl_output*) wl_registry_bind(registry, name, &wl_output_interface, std::min(version, WAYLAND_OUTPUT_VERSION));
+		wl_output_add_listener(info->m_output, &s_output_listener, info.get());
+		input->m_wl_outputs.push_back(std::move(info));
+	} else if(strcmp(interface, zwlr_screencopy_manager_v1_interface.name) == 0) {
+		if(input->m_screencopy_manager == NULL) {
+			input->m_screencopy_version = std::min(version, 3u);
+			input->m_screencopy_manager = (zwlr_screencopy_manager_v1*) wl_registry_bind(registry, name, &zwlr_screencopy_manager_v1_interface, input->m_screencopy_version);
+		}
+	}
+}
+
+void WaylandInput::RegistryGlobalRemove(void* data, wl_registry* registry, uint32_t name) {
+	Q_UNUSED(data);
+	Q_UNUSED(registry);
+	Q_UNUSED(name);
+	// if the output is removed, the next capture will fail
+}
+
+void WaylandInput::OutputGeometry(void* data, wl_output* output, int32_t x, int32_t y, int32_t physical_width, int32_t physical_height,
+								  int32_t subpixel, const char* make, const char* model, int32_t transform) {
+	Q_UNUSED(data);
+	Q_UNUSED(output);
+	Q_UNUSED(x);
+	Q_UNUSED(y);
+	Q_UNUSED(physical_width);
+	Q_UNUSED(physical_height);
+	Q_UNUSED(subpixel);
+	Q_UNUSED(make);
+	Q_UNUSED(model);
+	Q_UNUSED(transform);
+	// the position of the output is not needed
+}
+
+void WaylandInput::OutputMode(void* data, wl_output* output, uint32_t flags, int32_t width, int32_t height, int32_t refresh) {
+	Q_UNUSED(data);
+	Q_UNUSED(output);
+	Q_UNUSED(flags);
+	Q_UNUSED(width);
+	Q_UNUSED(height);
+	Q_UNUSED(refresh);
+	// the size of the output is taken from the screencopy buffer parameters instead
+}
+
+void WaylandInput::OutputDone(void* data, wl_output* output) {
+	Q_UNUSED(data);
+	Q_UNUSED(output);
+}
+
+void WaylandInput::OutputScale(void* data, wl_output* output, int32_t factor) {
+	Q_UNUSED(data);
+	Q_UNUSED(output);
+	Q_UNUSED(factor);
+}
+
+void WaylandInput::OutputName(void* data, wl_output* output, const char* name) {
+	Q_UNUSED(output);
+	OutputInfo *info = (OutputInfo*) data;
+	info->m_name = name;
+}
+
+void WaylandInput::OutputDescription(void* data, wl_output* output, const char* description) {
+	Q_UNUSED(data);
+	Q_UNUSED(output);
+	Q_UNUSED(description);
+}
+
+void WaylandInput::FrameBuffer(void* data, zwlr_screencopy_frame_v1* frame, uint32_t format, uint32_t width, uint32_t height, uint32_t stride) {
+	Q_UNUSED(frame);
+	FrameInfo *info = (FrameInfo*) data;
+	info->m_has_shm_buffer = true;
+	info->m_format = format;
+	info->m_width = width;
+	info->m_height = height;
+	info->m_stride = stride;
+	// before version 3, there is no buffer_done event and this is the only buffer event
+	if(info->m_input->m_screencopy_version < 3 && info->m_state == FRAME_STATE_BUFFER_INFO)
+		info->m_state = FRAME_STATE_BUFFER_DONE;
+}
+
+void WaylandInput::FrameFlags(void* data, zwlr_screencopy_frame_v1* frame, uint32_t flags) {
+	Q_UNUSED(frame);
+	FrameInfo *info = (FrameInfo*) data;
+	info->m_flags = flags;
+}
+
+void WaylandInput::FrameReady(void* data, zwlr_screencopy_frame_v1* frame, uint32_t tv_sec_hi, uint32_t tv_sec_lo, uint32_t tv_nsec) {
+	Q_UNUSED(frame);
+	Q_UNUSED(tv_sec_hi);
+	Q_UNUSED(tv_sec_lo);
+	Q_UNUSED(tv_nsec);
+	FrameInfo *info = (FrameInfo*) data;
+	info->m_state = FRAME_STATE_READY;
+}
+
+void WaylandInput::FrameFailed(void* data, zwlr_screencopy_frame_v1* frame) {
+	Q_UNUSED(frame);
+	FrameInfo *info = (FrameInfo*) data;
+	info->m_state = FRAME_STATE_FAILED;
+}
+
+void WaylandInput::FrameDamage(void* data, zwlr_screencopy_frame_v1* frame, uint32_t x, uint32_t y, uint32_t width, uint32_t height) {
+	Q_UNUSED(data);
+	Q_UNUSED(frame);
+	Q_UNUSED(x);
+	Q_UNUSED(y);
+	Q_UNUSED(width);
+	Q_UNUSED(height);
+	// the entire buffer is copied anyway, the damage only determines when the frame is sent
+}
+
+void WaylandInput::FrameLinuxDmabuf(void* data, zwlr_screencopy_frame_v1* frame, uint32_t format, uint32_t width, uint32_t height) {
+	Q_UNUSED(data);
+	Q_UNUSED(frame);
+	Q_UNUSED(format);
+	Q_UNUSED(width);
+	Q_UNUSED(height);
+	// only shared memory buffers are used
+}
+
+void WaylandInput::FrameBufferDone(void* data, zwlr_screencopy_frame_v1* frame) {
+	Q_UNUSED(frame);
+	FrameInfo *info = (FrameInfo*) data;
+	if(info->m_state == FRAME_STATE_BUFFER_INFO)
+		info->m_state = FRAME_STATE_BUFFER_DONE;
+}
+
+void WaylandInput::InputThread() {
+	try {
+
+		Logger::LogInfo("[WaylandInput::InputThread] " + Logger::tr("Input thread started."));
+
+		ThreadHeartbeat heartbeat("WaylandInput");
+
+		// the first frame was already requested by Init
+		unsigned int current = 0;
+		int64_t frame_interval = 0;
+		bool retried = false;
+		while(!m_should_stop) {
+
+			// if the copy was not started early, wait until the next frame is needed and then start it
+			if(m_frames[current].m_state != FRAME_STATE_COPYING) {
+
+				// sleep, but keep handling events so the buffer parameters of the next frame are received
+				heartbeat.Beat("wait");
+				int64_t next_timestamp = CalculateNextVideoTimestamp();
+				if(next_timestamp == SINK_TIMESTAMP_NONE) {
+					DispatchEvents(20000);
+					continue;
+				} else if(next_timestamp != SINK_TIMESTAMP_ASAP) {
+					int64_t wait = next_timestamp - hrt_time_micro();
+					if(wait > 0) {
+						// the thread can't sleep for too long because it still has to check the m_should_stop flag periodically
+						DispatchEvents(std::min(wait, (int64_t) 20000));
+						continue;
+					}
+				}
+
+				// copy the frame
+				heartbeat.Beat("capture");
+				if(m_frames[current].m_frame == NULL)
+					StartFrame(current);
+				WaitForFrame(current, FRAME_STATE_BUFFER_INFO, &heartbeat);
+				// a frame that was requested in advance can fail if the output changed in the mean time, so request a new one
+				// (if that one fails too, PrepareBuffer will report the error)
+				if(m_frames[current].m_state == FRAME_STATE_FAILED) {
+					FreeFrame(current);
+					StartFrame(current);
+					WaitForFrame(current, FRAME_STATE_BUFFER_INFO, &heartbeat);
+				}
+				if(m_should_stop)
+					break;
+				CopyFrame(current);
+
+			}
+
+			// request the next frame already, so the buffer parameters are known by the time it is needed
+			unsigned int next = (current + 1) % BUFFER_COUNT;
+			if(m_frames[next].m_frame == NULL)
+				StartFrame(next);
+
+			// wait until the frame is ready
+			WaitForFrame(current, FRAME_STATE_COPYING, &heartbeat);
+			if(m_should_stop)
+				break;
+			// Frames are requested in advance, so the output may have changed since the buffer parameters were sent.
+			// In that case the copy fails, so try again once with a new frame.
+			if(m_frames[current].m_state == FRAME_STATE_FAILED) {
+				if(retried) {
+					Logger::LogError("[WaylandInput::InputThread] " + Logger::tr("Error: The compositor failed to copy the frame!"));
+					throw WaylandException();
+				}
+				retried = true;
+				FreeFrame(current);
+				continue;
+			}
+			retried = false;
+
+			// record the timestamp
+			int64_t timestamp = hrt_time_micro();
+
+			// increase the frame counter
+			++m_frame_counter;
+
+			// If we are falling behind, the next frame is needed right away. In that case the compositor can copy it into the other
+			// buffer while this frame is being converted.
+			int64_t current_timestamp = CalculateNextVideoTimestamp();
+			if(current_timestamp == SINK_TIMESTAMP_ASAP || (current_timestamp != SINK_TIMESTAMP_NONE && frame_interval != 0 && current_timestamp + frame_interval <= timestamp)) {
+				DispatchEvents(0);
+				if(m_frames[next].m_state == FRAME_STATE_FAILED) {
+					FreeFrame(next);
+					StartFrame(next);
+				} else if(m_frames[next].m_state == FRAME_STATE_BUFFER_DONE) {
+					CopyFrame(next);
+				}
+			}
+
+			// push the frame
+			heartbeat.Beat("push");
+			ShmBuffer &buffer = m_shm_buffers[current];
+			uint8_t *image_data = buffer.m_data;
+			int image_stride = buffer.m_stride;
+			if(m_frames[current].m_flags & ZWLR_SCREENCOPY_FRAME_V1_FLAGS_Y_INVERT) {
+				image_data += (size_t) image_stride * (size_t) (buffer.m_height - 1);
+				image_stride = -image_stride;
+			}
+			PushVideoFrame(buffer.m_width, buffer.m_height, image_data, image_stride, WaylandFormatToPixelFormat(buffer.m_format), SWS_CS_DEFAULT, timestamp);
+
+			FreeFrame(current);
+
+			// remember the time between frames
+			if(current_timestamp != SINK_TIMESTAMP_NONE && current_timestamp != SINK_TIMESTAMP_ASAP) {
+				int64_t next_timestamp = CalculateNextVideoTimestamp();
+				if(next_timestamp != SINK_TIMESTAMP_NONE && next_timestamp != SINK_TIMESTAMP_ASAP && next_timestamp > current_timestamp)
+					frame_interval = next_timestamp - current_timestamp;
+			}
+
+			current = next;
+
+		}
+
+		Logger::LogInfo("[WaylandInput::InputThread] " + Logger::tr("Input thread stopped."));
+
+	} catch(const std::exception& e) {
+		m_error_occurred = true;
+		Logger::LogError("[WaylandInput::InputThread] " + Logger::tr("Exception '%1' in input thread.").arg(e.what()));
+	} catch(...) {
+		m_error_occurred = true;
+		Logger::LogError("[WaylandInput::InputThread] " + Logger::tr("Unknown exception in input thread."));
+	}
+}
+
+#endif
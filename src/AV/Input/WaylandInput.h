@@ -0,0 +1,164 @@
+/*
+Copyright (c) 2012-2020 Maarten Baert <maarten-baert@hotmail.com>
+
+This file is part of SimpleScreenRecorder.
+
+SimpleScreenRecorder is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+SimpleScreenRecorder is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with SimpleScreenRecorder.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#pragma once
+#include "Global.h"
+
+#include "SourceSink.h"
+#include "MutexDataPair.h"
+
+#if SSR_USE_WAYLAND
+
+#include <wayland-client.h>
+#include "wlr-screencopy-unstable-v1-client-protocol.h"
+
+class ThreadHeartbeat;
+
+// Captures a Wayland output using the wlr-screencopy protocol (supported by wlroots-based compositors such as sway).
+// Frames are copied into shared memory buffers which are only reallocated when the size or format of the output changes.
+// There are two buffers, so the compositor can copy the next frame while the previous one is being converted. The next frame
+// is requested ahead of time, and all waiting is done by polling the display, so there are no blocking roundtrips per frame.
+// When the compositor supports it, copies wait for damage, so a static screen doesn't use any CPU time.
+// The output is selected by name (e.g. 'DP-1'), which is the same name Qt uses for the screen.
+class WaylandInput : public VideoSource {
+
+private:
+	static constexpr unsigned int BUFFER_COUNT = 2;
+
+private:
+	struct OutputInfo {
+		wl_output *m_output;
+		std::string m_name;
+	};
+	struct ShmBuffer {
+		int m_fd;
+		uint8_t *m_data;
+		size_t m_size;
+		wl_shm_pool *m_pool;
+		wl_buffer *m_buffer;
+		uint32_t m_format;
+		unsigned int m_width, m_height, m_stride;
+	};
+	enum enum_frame_state {
+		FRAME_STATE_NONE,
+		FRAME_STATE_BUFFER_INFO, // waiting for the buffer parameters
+		FRAME_STATE_BUFFER_DONE, // the buffer parameters are known, the frame can be copied
+		FRAME_STATE_COPYING,
+		FRAME_STATE_READY,
+		FRAME_STATE_FAILED,
+	};
+	struct FrameInfo {
+		WaylandInput *m_input;
+		zwlr_screencopy_frame_v1 *m_frame;
+		enum_frame_state m_state;
+		bool m_has_shm_buffer;
+		uint32_t m_format;
+		unsigned int m_width, m_height, m_stride;
+		uint32_t m_flags;
+	};
+	struct SharedData {
+		unsigned int m_current_width, m_current_height;
+	};
+	typedef MutexDataPair<SharedData>::Lock SharedLock;
+
+private:
+	QString m_output_name;
+	bool m_record_cursor;
+
+	std::atomic<uint32_t> m_frame_counter;
+	int64_t m_fps_last_timestamp;
+	uint32_t m_fps_last_counter;
+	double m_fps_current;
+
+	wl_display *m_wl_display;
+	wl_registry *m_wl_registry;
+	wl_shm *m_wl_shm;
+	std::vector<std::unique_ptr<OutputInfo>> m_wl_outputs;
+	wl_output *m_wl_output; // the output that is recorded
+	zwlr_screencopy_manager_v1 *m_screencopy_manager;
+	uint32_t m_screencopy_version;
+
+	// frame i is always copied into buffer i
+	ShmBuffer m_shm_buffers[BUFFER_COUNT];
+	FrameInfo m_frames[BUFFER_COUNT];
+
+	std::thread m_thread;
+	MutexDataPair<SharedData> m_shared_data;
+	std::atomic<bool> m_should_stop, m_error_occurred;
+
+public:
+	WaylandInput(const QString& output_name, bool record_cursor);
+	~WaylandInput();
+
+	// Reads the current size of the stream.
+	// This function is thread-safe.
+	void GetCurrentSize(unsigned int* width, unsigned int* height);
+
+	// Returns the total number of captured frames.
+	// This function is thread-safe.
+	double GetFPS();
+
+	// Returns whether an error has occurred in the input thread.
+	// This function is thread-safe.
+	inline bool HasErrorOccurred() { return m_error_occurred; }
+
+private:
+	void Init();
+	void Free();
+
+private:
+	void AllocateBuffer(ShmBuffer* buffer, uint32_t format, unsigned int width, unsigned int height, unsigned int stride);
+	void FreeBuffer(ShmBuffer* buffer);
+
+	void StartFrame(unsigned int index);
+	void PrepareBuffer(unsigned int index);
+	void CopyFrame(unsigned int index);
+	void FreeFrame(unsigned int index);
+	void WaitForFrame(unsigned int index, enum_frame_state state, ThreadHeartbeat* heartbeat);
+	void DispatchEvents(int64_t timeout);
+
+private:
+	static const wl_registry_listener s_registry_listener;
+	static const wl_output_listener s_output_listener;
+	static const zwlr_screencopy_frame_v1_listener s_frame_listener;
+
+	static void RegistryGlobal(void* data, wl_registry* registry, uint32_t name, const char* interface, uint32_t version);
+	static void RegistryGlobalRemove(void* data, wl_registry* registry, uint32_t name);
+	static void OutputGeometry(void* data, wl_output* output, int32_t x, int32_t y, int32_t physical_width, int32_t physical_height,
+							   int32_t subpixel, const char* make, const char* model, int32_t transform);
+	static void OutputMode(void* data, wl_output* output, uint32_t flags, int32_t width, int32_t height, int32_t refresh);
+	static void OutputDone(void* data, wl_output* output);
+	static void OutputScale(void* data, wl_output* output, int32_t factor);
+	static void OutputName(void* data, wl_output* output, const char* name);
+	static void OutputDescription(void* data, wl_output* output, const char* description);
+	static void FrameBuffer(void* data, zwlr_screencopy_frame_v1* frame, uint32_t format, uint32_t width, uint32_t height, uint32_t stride);
+	static void FrameFlags(void* data, zwlr_screencopy_frame_v1* frame, uint32_t flags);
+	static void FrameReady(void* data, zwlr_screencopy_frame_v1* frame, uint32_t tv_sec_hi, uint32_t tv_sec_lo, uint32_t tv_nsec);
+	static void FrameFailed(void* data, zwlr_screencopy_frame_v1* frame);
+	static void FrameDamage(void* data, zwlr_screencopy_frame_v1* frame, uint32_t x, uint32_t y, uint32_t width, uint32_t height);
+	static void FrameLinuxDmabuf(void* data, zwlr_screencopy_frame_v1* frame, uint32_t format, uint32_t width, uint32_t height);
+	static void FrameBufferDone(void* data, zwlr_screencopy_frame_v1* frame);
+
+private:
+	void InputThread();
+
+};
+
+#endif
@@ -32,9 +32,14 @@ along with SimpleScreenRecorder.  If not, see <http://www.gnu.org/licenses/>.
 #include "X11Input.h"
 
 #include "Logger.h"
+#include "ThreadWatchdog.h"
 #include "AVWrapper.h"
 #include "Synchronizer.h"
 #include "VideoEncoder.h"
+#include "XCBShmCapture.h"
+
+// The number of XCB requests that can be in flight at the same time.
+#define X11INPUT_XCB_PIPELINE_DEPTH 2
 
 /*
 The code in this file is based on the MIT-SHM example code and the x11grab device in libav/ffmpeg (which is GPL):
@@ -268,6 +273,22 @@ void X11Input::Init() {
 		Logger::LogInfo("[X11Input::Init] " + Logger::tr("Not using X11 shared memory."));
 	}
 
+#if SSR_USE_XCB_SHM
+	// use pipelined XCB capture if possible, this way the X server can copy the next frame while we are processing the previous one
+	if(m_x11_use_shm) {
+		try {
+			m_xcb_capture.reset(new XCBShmCapture(X11INPUT_XCB_PIPELINE_DEPTH));
+		} catch(const X11Exception&) {
+			m_xcb_capture.reset();
+		}
+		if(m_xcb_capture != NULL) {
+			Logger::LogInfo("[X11Input::Init] " + Logger::tr("Using pipelined XCB capture.", "Don't translate 'XCB'"));
+		} else {
+			Logger::LogWarning("[X11Input::Init] " + Logger::tr("Warning: Pipelined XCB capture is not available, using Xlib instead.", "Don't translate 'XCB' and 'Xlib'"));
+		}
+	}
+#endif
+
 	// showing the cursor requires XFixes (which should be supported on any modern X server, but let's check it anyway)
 	if(m_record_cursor) {
 		int event, error;
@@ -295,6 +316,9 @@ void X11Input::Init() {
 }
 
 void X11Input::Free() {
+#if SSR_USE_XCB_SHM
+	m_xcb_capture.reset();
+#endif
 	FreeImage();
 	if(m_x11_display != NULL) {
 		XCloseDisplay(m_x11_display);
@@ -459,11 +483,77 @@ void X11Input::UpdateScreenConfiguration() {
 
 }
 
+void X11Input::PushImage(XImage* image, unsigned int grab_x, unsigned int grab_y, unsigned int grab_width, unsigned int grab_height, int64_t timestamp) {
+
+	// clear the dead space
+	for(size_t i = 0; i < m_screen_dead_space.size(); ++i) {
+		Rect rect = m_screen_dead_space[i];
+		if(rect.m_x1 < grab_x)
+			rect.m_x1 = grab_x;
+		if(rect.m_y1 < grab_y)
+			rect.m_y1 = grab_y;
+		if(rect.m_x2 > grab_x + grab_width)
+			rect.m_x2 = grab_x + grab_width;
+		if(rect.m_y2 > grab_y + grab_height)
+			rect.m_y2 = grab_y + grab_height;
+		if(rect.m_x2 > rect.m_x1 && rect.m_y2 > rect.m_y1)
+			X11ImageClearRectangle(image, rect.m_x1 - grab_x, rect.m_y1 - grab_y, rect.m_x2 - rect.m_x1, rect.m_y2 - rect.m_y1);
+	}
+
+	// draw the cursor
+	if(m_record_cursor) {
+		X11ImageDrawCursor(m_x11_display, image, grab_x, grab_y);
+	}
+
+	// increase the frame counter
+	++m_frame_counter;
+
+	// push the frame
+	uint8_t *image_data = (uint8_t*) image->data;
+	int image_stride = image->bytes_per_line;
+	AVPixelFormat x11_image_format = X11ImageGetPixelFormat(image);
+	PushVideoFrame(grab_width, grab_height, image_data, image_stride, x11_image_format, SWS_CS_DEFAULT, timestamp);
+
+}
+
+#if SSR_USE_XCB_SHM
+void X11Input::FinishXCBRequest() {
+
+	// wait for the oldest request
+	ThreadHeartbeat::BeatCurrentThread("capture");
+	uint8_t *data;
+	int stride, grab_x, grab_y;
+	unsigned int grab_width, grab_height;
+	int64_t timestamp;
+	m_xcb_capture->Wait(&data, &stride, &grab_x, &grab_y, &grab_width, &grab_height, &timestamp);
+
+	// wrap the data in an XImage so it can be processed like the other images (this doesn't talk to the X server)
+	XImage *image = XCreateImage(m_x11_display, m_x11_visual, m_x11_depth, ZPixmap, 0, (char*) data, grab_width, grab_height, 32, stride);
+	if(image == NULL) {
+		Logger::LogError("[X11Input::FinishXCBRequest] " + Logger::tr("Error: Can't create image!"));
+		throw X11Exception();
+	}
+	try {
+		ThreadHeartbeat::BeatCurrentThread("push");
+		PushImage(image, grab_x, grab_y, grab_width, grab_height, timestamp);
+	} catch(...) {
+		image->data = NULL;
+		XDestroyImage(image);
+		throw;
+	}
+	image->data = NULL; // the data belongs to XCBShmCapture
+	XDestroyImage(image);
+
+}
+#endif
+
 void X11Input::InputThread() {
 	try {
 
 		Logger::LogInfo("[X11Input::InputThread] " + Logger::tr("Input thread started."));
 
+		ThreadHeartbeat heartbeat("X11Input");
+
 		unsigned int grab_x = m_x, grab_y = m_y, grab_width = m_width, grab_height = m_height;
 		bool has_initial_cursor = false;
 		int64_t last_timestamp = hrt_time_micro();
@@ -471,8 +561,18 @@ void X11Input::InputThread() {
 		while(!m_should_stop) {
 
 			// sleep
+			heartbeat.Beat("wait");
 			int64_t next_timestamp = CalculateNextVideoTimestamp();
 			int64_t timestamp = hrt_time_micro();
+#if SSR_USE_XCB_SHM
+			// if there is time left, finish the pending requests before sleeping
+			// requests are only pipelined when we can't keep up, otherwise it would just add latency
+			if(m_xcb_capture != NULL && m_xcb_capture->HasPending() &&
+			   (next_timestamp == SINK_TIMESTAMP_NONE || (next_timestamp != SINK_TIMESTAMP_ASAP && next_timestamp > timestamp))) {
+				FinishXCBRequest();
+				continue;
+			}
+#endif
 			if(next_timestamp == SINK_TIMESTAMP_NONE) {
 				usleep(20000);
 				continue;
@@ -530,8 +630,22 @@ void X11Input::InputThread() {
 			}
 
 			// get the image
+			heartbeat.Beat("capture");
+#if SSR_USE_XCB_SHM
+			if(m_xcb_capture != NULL) {
+				// the frame is processed later, when the next request has been sent or when there is nothing else to do
+				if(!m_xcb_capture->CanRequest())
+					FinishXCBRequest();
+				m_xcb_capture->Request(grab_x, grab_y, grab_width, grab_height);
+				last_timestamp = timestamp;
+				continue;
+			}
+#endif
+			// the grab can take several milliseconds, so the timestamp is estimated from the time of the request and the reply
+			int64_t request_time;
 			if(m_x11_use_shm) {
 				AllocateImage(grab_width, grab_height);
+				request_time = hrt_time_micro();
 				if(!XShmGetImage(m_x11_display, m_x11_root, m_x11_image, grab_x, grab_y, AllPlanes)) {
 					Logger::LogError("[X11Input::InputThread] " + Logger::tr("Error: Can't get image (using shared memory)!\n"
 									 "    Usually this means the recording area is not completely inside the screen. Or did you change the screen resolution?"));
@@ -542,6 +656,7 @@ void X11Input::InputThread() {
 					XDestroyImage(m_x11_image);
 					m_x11_image = NULL;
 				}
+				request_time = hrt_time_micro();
 				m_x11_image = XGetImage(m_x11_display, m_x11_root, grab_x, grab_y, grab_width, grab_height, AllPlanes, ZPixmap);
 				if(m_x11_image == NULL) {
 					Logger::LogError("[X11Input::InputThread] " + Logger::tr("Error: Can't get image (not using shared memory)!\n"
@@ -550,34 +665,11 @@ void X11Input::InputThread() {
 				}
 			}
 
-			// clear the dead space
-			for(size_t i = 0; i < m_screen_dead_space.size(); ++i) {
-				Rect rect = m_screen_dead_space[i];
-				if(rect.m_x1 < grab_x)
-					rect.m_x1 = grab_x;
-				if(rect.m_y1 < grab_y)
-					rect.m_y1 = grab_y;
-				if(rect.m_x2 > grab_x + grab_width)
-					rect.m_x2 = grab_x + grab_width;
-				if(rect.m_y2 > grab_y + grab_height)
-					rect.m_y2 = grab_y + grab_height;
-				if(rect.m_x2 > rect.m_x1 && rect.m_y2 > rect.m_y1)
-					X11ImageClearRectangle(m_x11_image, rect.m_x1 - grab_x, rect.m_y1 - grab_y, rect.m_x2 - rect.m_x1, rect.m_y2 - rect.m_y1);
-			}
-
-			// draw the cursor
-			if(m_record_cursor) {
-				X11ImageDrawCursor(m_x11_display, m_x11_image, grab_x, grab_y);
-			}
-
-			// increase the frame counter
-			++m_frame_counter;
+			int64_t capture_time = m_timestamp_filter.Filter(request_time, hrt_time_micro(), true);
 
 			// push the frame
-			uint8_t *image_data = (uint8_t*) m_x11_image->data;
-			int image_stride = m_x11_image->bytes_per_line;
-			AVPixelFormat x11_image_format = X11ImageGetPixelFormat(m_x11_image);
-			PushVideoFrame(grab_width, grab_height, image_data, image_stride, x11_image_format, SWS_CS_DEFAULT, timestamp);
+			heartbeat.Beat("push");
+			PushImage(m_x11_image, grab_x, grab_y, grab_width, grab_height, capture_time);
 			last_timestamp = timestamp;
 
 		}
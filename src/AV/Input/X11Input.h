@@ -22,6 +22,9 @@ along with SimpleScreenRecorder.  If not, see <http://www.gnu.org/licenses/>.
 
 #include "SourceSink.h"
 #include "MutexDataPair.h"
+#include "CaptureTimestampFilter.h"
+
+class XCBShmCapture;
 
 class X11Input : public QObject, public VideoSource {
 	Q_OBJECT
@@ -55,6 +58,11 @@ private:
 	XImage *m_x11_image;
 	XShmSegmentInfo m_x11_shm_info;
 	bool m_x11_shm_server_attached;
+	CaptureTimestampFilter m_timestamp_filter;
+
+#if SSR_USE_XCB_SHM
+	std::unique_ptr<XCBShmCapture> m_xcb_capture;
+#endif
 
 	Rect m_screen_bbox;
 	std::vector<Rect> m_screen_rects;
@@ -93,6 +101,11 @@ private:
 	void FreeImage();
 	void UpdateScreenConfiguration();
 
+	void PushImage(XImage* image, unsigned int grab_x, unsigned int grab_y, unsigned int grab_width, unsigned int grab_height, int64_t timestamp);
+#if SSR_USE_XCB_SHM
+	void FinishXCBRequest();
+#endif
+
 private:
 	void InputThread();
 
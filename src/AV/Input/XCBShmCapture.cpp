@@ -0,0 +1,232 @@
+/*
+Copyright (c) 2012-2020 Maarten Baert <maarten-baert@hotmail.com>
+
+This file is part of SimpleScreenRecorder.
+
+SimpleScreenRecorder is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+SimpleScreenRecorder is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with SimpleScreenRecorder.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#include "XCBShmCapture.h"
+
+#if SSR_USE_XCB_SHM
+
+#include "Logger.h"
+
+XCBShmCapture::XCBShmCapture(unsigned int depth) {
+
+	m_depth = std::max(1u, depth);
+
+	m_connection = NULL;
+	m_root = 0;
+	m_root_width = 0;
+	m_root_height = 0;
+	m_bits_per_pixel = 0;
+	m_scanline_pad = 0;
+
+	m_buffers.resize(m_depth);
+	for(Buffer &buffer : m_buffers) {
+		buffer.m_shmid = -1;
+		buffer.m_data = (uint8_t*) -1;
+		buffer.m_size = 0;
+		buffer.m_shmseg = 0;
+		buffer.m_attached = false;
+	}
+	m_next_buffer = 0;
+	m_pending = 0;
+
+	try {
+		Init();
+	} catch(...) {
+		Free();
+		throw;
+	}
+
+}
+
+XCBShmCapture::~XCBShmCapture() {
+	Free();
+}
+
+void XCBShmCapture::Init() {
+
+	// connect to the X server
+	// we need a separate connection because the requests are asynchronous, replies for other code would get in the way
+	int screen_num;
+	m_connection = xcb_connect(NULL, &screen_num);
+	if(xcb_connection_has_error(m_connection)) {
+		Logger::LogError("[XCBShmCapture::Init] " + Logger::tr("Error: Can't open XCB connection!", "Don't translate 'XCB'"));
+		throw X11Exception();
+	}
+
+	// find the root window
+	const xcb_setup_t *setup = xcb_get_setup(m_connection);
+	xcb_screen_iterator_t it = xcb_setup_roots_iterator(setup);
+	for(int i = 0; i < screen_num && it.rem > 0; ++i) {
+		xcb_screen_next(&it);
+	}
+	if(it.rem == 0) {
+		Logger::LogError("[XCBShmCapture::Init] " + Logger::tr("Error: Can't find XCB screen!", "Don't translate 'XCB'"));
+		throw X11Exception();
+	}
+	xcb_screen_t *screen = it.data;
+	m_root = screen->root;
+	m_root_width = screen->width_in_pixels;
+	m_root_height = screen->height_in_pixels;
+
+	// get the pixel format
+	xcb_format_t *formats = xcb_setup_pixmap_formats(setup);
+	int format_count = xcb_setup_pixmap_formats_length(setup);
+	for(int i = 0; i < format_count; ++i) {
+		if(formats[i].depth == screen->root_depth) {
+			m_bits_per_pixel = formats[i].bits_per_pixel;
+			m_scanline_pad = formats[i].scanline_pad;
+			break;
+		}
+	}
+	if(m_bits_per_pixel == 0 || m_bits_per_pixel % 8 != 0 || m_scanline_pad == 0) {
+		Logger::LogError("[XCBShmCapture::Init] " + Logger::tr("Error: Unsupported XCB pixmap format!", "Don't translate 'XCB'"));
+		throw X11Exception();
+	}
+
+	// check MIT-SHM
+	xcb_shm_query_version_reply_t *version = xcb_shm_query_version_reply(m_connection, xcb_shm_query_version(m_connection), NULL);
+	if(version == NULL) {
+		Logger::LogError("[XCBShmCapture::Init] " + Logger::tr("Error: MIT-SHM is not supported by X server!", "Don't translate 'MIT-SHM'"));
+		throw X11Exception();
+	}
+	free(version);
+
+}
+
+void XCBShmCapture::Free() {
+	if(m_connection != NULL) {
+		Clear();
+		for(Buffer &buffer : m_buffers) {
+			FreeBuffer(&buffer);
+		}
+		xcb_disconnect(m_connection);
+		m_connection = NULL;
+	}
+}
+
+void XCBShmCapture::AllocateBuffer(Buffer* buffer, size_t size) {
+	if(buffer->m_attached && buffer->m_size >= size)
+		return; // reuse existing buffer
+	FreeBuffer(buffer);
+	buffer->m_shmid = shmget(IPC_PRIVATE, size, IPC_CREAT | 0700);
+	if(buffer->m_shmid == -1) {
+		Logger::LogError("[XCBShmCapture::AllocateBuffer] " + Logger::tr("Error: Can't get shared memory!"));
+		throw X11Exception();
+	}
+	buffer->m_data = (uint8_t*) shmat(buffer->m_shmid, NULL, SHM_RND);
+	if(buffer->m_data == (uint8_t*) -1) {
+		Logger::LogError("[XCBShmCapture::AllocateBuffer] " + Logger::tr("Error: Can't attach to shared memory!"));
+		throw X11Exception();
+	}
+	buffer->m_size = size;
+	buffer->m_shmseg = xcb_generate_id(m_connection);
+	xcb_generic_error_t *error = xcb_request_check(m_connection, xcb_shm_attach_checked(m_connection, buffer->m_shmseg, buffer->m_shmid, 0));
+	if(error != NULL) {
+		free(error);
+		Logger::LogError("[XCBShmCapture::AllocateBuffer] " + Logger::tr("Error: Can't attach server to shared memory!"));
+		throw X11Exception();
+	}
+	buffer->m_attached = true;
+}
+
+void XCBShmCapture::FreeBuffer(Buffer* buffer) {
+	if(buffer->m_attached) {
+		xcb_shm_detach(m_connection, buffer->m_shmseg);
+		xcb_flush(m_connection);
+		buffer->m_attached = false;
+	}
+	if(buffer->m_data != (uint8_t*) -1) {
+		shmdt(buffer->m_data);
+		buffer->m_data = (uint8_t*) -1;
+	}
+	if(buffer->m_shmid != -1) {
+		shmctl(buffer->m_shmid, IPC_RMID, NULL);
+		buffer->m_shmid = -1;
+	}
+	buffer->m_size = 0;
+}
+
+void XCBShmCapture::Request(int x, int y, unsigned int width, unsigned int height) {
+	assert(CanRequest());
+
+	// prepare the buffer
+	Buffer &buffer = m_buffers[m_next_buffer];
+	size_t stride = (width * m_bits_per_pixel + m_scanline_pad - 1) / m_scanline_pad * m_scanline_pad / 8;
+	AllocateBuffer(&buffer, stride * height);
+	buffer.m_x = x;
+	buffer.m_y = y;
+	buffer.m_width = width;
+	buffer.m_height = height;
+
+	// send the request, but don't wait for the reply
+	buffer.m_request_time = hrt_time_micro();
+	buffer.m_cookie = xcb_shm_get_image(m_connection, m_root, x, y, width, height, ~(uint32_t) 0, XCB_IMAGE_FORMAT_Z_PIXMAP, buffer.m_shmseg, 0);
+	xcb_flush(m_connection);
+
+	m_next_buffer = (m_next_buffer + 1) % m_buffers.size();
+	++m_pending;
+
+}
+
+void XCBShmCapture::Wait(uint8_t** data, int* stride, int* x, int* y, unsigned int* width, unsigned int* height, int64_t* timestamp) {
+	assert(HasPending());
+
+	// get the oldest buffer
+	Buffer &buffer = m_buffers[(m_next_buffer + m_buffers.size() - m_pending) % m_buffers.size()];
+	--m_pending;
+
+	// wait for the reply
+	// If the reply has already arrived, we only know that it arrived before now. Otherwise we know exactly when it arrived.
+	void *reply = NULL;
+	xcb_generic_error_t *error = NULL;
+	int64_t reply_time = hrt_time_micro();
+	bool reply_exact = false;
+	if(!xcb_poll_for_reply(m_connection, buffer.m_cookie.sequence, &reply, &error)) {
+		reply = xcb_shm_get_image_reply(m_connection, buffer.m_cookie, &error);
+		reply_time = hrt_time_micro();
+		reply_exact = true;
+	}
+	if(reply == NULL) {
+		free(error);
+		Logger::LogError("[XCBShmCapture::Wait] " + Logger::tr("Error: Can't get image (using shared memory)!\n"
+						 "    Usually this means the recording area is not completely inside the screen. Or did you change the screen resolution?"));
+		throw X11Exception();
+	}
+	free(reply);
+
+	*data = buffer.m_data;
+	*stride = (buffer.m_width * m_bits_per_pixel + m_scanline_pad - 1) / m_scanline_pad * m_scanline_pad / 8;
+	*x = buffer.m_x;
+	*y = buffer.m_y;
+	*width = buffer.m_width;
+	*height = buffer.m_height;
+	*timestamp = m_timestamp_filter.Filter(buffer.m_request_time, reply_time, reply_exact);
+
+}
+
+void XCBShmCapture::Clear() {
+	while(m_pending != 0) {
+		Buffer &buffer = m_buffers[(m_next_buffer + m_buffers.size() - m_pending) % m_buffers.size()];
+		xcb_discard_reply(m_connection, buffer.m_cookie.sequence);
+		--m_pending;
+	}
+}
+
+#endif
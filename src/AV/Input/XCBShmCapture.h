@@ -0,0 +1,102 @@
+/*
+Copyright (c) 2012-2020 Maarten Baert <maarten-baert@hotmail.com>
+
+This file is part of SimpleScreenRecorder.
+
+SimpleScreenRecorder is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+SimpleScreenRecorder is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with SimpleScreenRecorder.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#pragma once
+#include "Global.h"
+
+#if SSR_USE_XCB_SHM
+
+#include <xcb/xcb.h>
+#include <xcb/shm.h>
+#include <xcb/xcbext.h>
+
+#include "CaptureTimestampFilter.h"
+
+// Captures images from the X server using XCB and MIT-SHM. Unlike XShmGetImage, the requests are asynchronous: multiple requests can be
+// in flight at the same time, each with its own shared memory segment. This way the X server can copy the next image while the previous
+// image is being processed. A depth of 1 is equivalent to the synchronous XShmGetImage.
+// This class uses its own X connection, it should only be used by one thread.
+class XCBShmCapture {
+
+private:
+	struct Buffer {
+		int m_shmid;
+		uint8_t *m_data;
+		size_t m_size;
+		xcb_shm_seg_t m_shmseg;
+		bool m_attached;
+		xcb_shm_get_image_cookie_t m_cookie;
+		int m_x, m_y;
+		unsigned int m_width, m_height;
+		int64_t m_request_time;
+	};
+
+private:
+	unsigned int m_depth;
+
+	xcb_connection_t *m_connection;
+	xcb_window_t m_root;
+	unsigned int m_root_width, m_root_height;
+	unsigned int m_bits_per_pixel, m_scanline_pad;
+
+	std::vector<Buffer> m_buffers;
+	unsigned int m_next_buffer, m_pending;
+
+	CaptureTimestampFilter m_timestamp_filter;
+
+public:
+	XCBShmCapture(unsigned int depth);
+	~XCBShmCapture();
+
+private:
+	void Init();
+	void Free();
+
+	void AllocateBuffer(Buffer* buffer, size_t size);
+	void FreeBuffer(Buffer* buffer);
+
+public:
+	// Returns the number of bits per pixel of the captured images.
+	inline unsigned int GetBitsPerPixel() { return m_bits_per_pixel; }
+
+	// Returns the size of the root window.
+	inline unsigned int GetRootWidth() { return m_root_width; }
+	inline unsigned int GetRootHeight() { return m_root_height; }
+
+	// Returns whether a new request can be started without waiting for an older one first.
+	inline bool CanRequest() { return (m_pending < m_buffers.size()); }
+
+	// Returns whether there are requests that haven't been completed yet.
+	inline bool HasPending() { return (m_pending != 0); }
+
+	// Starts capturing an image. There must be a free buffer (see CanRequest).
+	void Request(int x, int y, unsigned int width, unsigned int height);
+
+	// Waits until the oldest request has been completed and returns the image. There must be a pending request (see HasPending).
+	// The image data remains valid until the buffer is reused by Request, so it should be processed before the next call to Request.
+	// The timestamp is the estimated time when the X server captured the image (see CaptureTimestampFilter).
+	void Wait(uint8_t** data, int* stride, int* x, int* y, unsigned int* width, unsigned int* height, int64_t* timestamp);
+
+	// Drops all pending requests.
+	void Clear();
+
+};
+
+#endif
@@ -81,13 +81,17 @@ bool AudioEncoder::AVCodecIsSupported(const QString& codec_name) {
 	AVCodec *codec = (AVCodec*) avcodec_find_encoder_by_name(codec_name.toUtf8().constData());
 	if(codec == NULL)
 		return false;
+	return AVCodecIsSupported(codec);
+}
+
+bool AudioEncoder::AVCodecIsSupported(const AVCodec* codec) {
 	if(!av_codec_is_encoder(codec))
 		return false;
 	if(codec->type != AVMEDIA_TYPE_AUDIO)
 		return false;
 	for(unsigned int i = 0; i < SUPPORTED_SAMPLE_FORMATS.size(); ++i) {
 		if(AVCodecSupportsSampleFormat(codec, SUPPORTED_SAMPLE_FORMATS[i].m_format)) {
-			//qDebug() << codec_name << "supported by" << SUPPORTED_SAMPLE_FORMATS[i].m_name;
+			//qDebug() << codec->name << "supported by" << SUPPORTED_SAMPLE_FORMATS[i].m_name;
 			return true;
 		}
 	}
@@ -57,6 +57,7 @@ public:
 
 public:
 	static bool AVCodecIsSupported(const QString& codec_name);
+	static bool AVCodecIsSupported(const AVCodec* codec);
 	static void PrepareStream(AVStream* stream, AVCodecContext* codec_context, AVCodec* codec, AVDictionary** options, const std::vector<std::pair<QString, QString> >& codec_options,
 							  unsigned int bit_rate, unsigned int channels, unsigned int sample_rate);
 
@@ -20,9 +20,14 @@ along with SimpleScreenRecorder.  If not, see <http://www.gnu.org/licenses/>.
 #include "BaseEncoder.h"
 
 #include "Logger.h"
+#include "ThreadWatchdog.h"
 #include "AVWrapper.h"
 #include "Muxer.h"
 
+// The maximum time the encoder thread sleeps while waiting for a frame, in microseconds. The thread is woken up as soon as a frame is added,
+// so this only determines how often the heartbeat is updated when there is nothing to encode (e.g. while the recording is paused).
+static const int64_t ENCODER_WAIT_TIMEOUT = 200000;
+
 int ParseCodecOptionInt(const QString& key, const QString& value, int min, int max, int multiply) {
 	bool parsed;
 	int value_int = value.toInt(&parsed);
@@ -54,6 +59,7 @@ BaseEncoder::BaseEncoder(Muxer* muxer, AVStream* stream, AVCodecContext* codec_c
 		SharedLock lock(&m_shared_data);
 		lock->m_total_frames = 0;
 		lock->m_total_packets = 0;
+		lock->m_total_encode_time = 0;
 		lock->m_stats_actual_frame_rate = 0.0;
 		lock->m_stats_previous_pts = AV_NOPTS_VALUE;
 		lock->m_stats_previous_frames = 0;
@@ -95,6 +101,7 @@ void BaseEncoder::StopThread() {
 	if(m_thread.joinable()) {
 		Logger::LogInfo("[BaseEncoder::~BaseEncoder] " + Logger::tr("Stopping encoder thread ..."));
 		m_should_stop = true;
+		NotifyThread();
 		m_thread.join();
 	}
 
@@ -127,6 +134,11 @@ unsigned int BaseEncoder::GetQueuedPacketCount() {
 	return GetMuxer()->GetQueuedPacketCount(GetStream()->index);
 }
 
+int64_t BaseEncoder::GetTotalEncodeTime() {
+	SharedLock lock(&m_shared_data);
+	return lock->m_total_encode_time;
+}
+
 void BaseEncoder::AddFrame(std::unique_ptr<AVFrameWrapper> frame) {
 	assert(frame->GetFrame()->pts != (int64_t) AV_NOPTS_VALUE);
 	SharedLock lock(&m_shared_data);
@@ -142,14 +154,17 @@ void BaseEncoder::AddFrame(std::unique_ptr<AVFrameWrapper> frame) {
 		lock->m_stats_previous_frames = lock->m_total_frames;
 	}
 	lock->m_frame_queue.push_back(std::move(frame));
+	m_frame_condition.notify_one();
 }
 
 void BaseEncoder::Finish() {
 	m_should_finish = true;
+	NotifyThread();
 }
 
 void BaseEncoder::Stop() {
 	m_should_stop = true;
+	NotifyThread();
 }
 
 void BaseEncoder::IncrementPacketCounter() {
@@ -181,19 +196,32 @@ void BaseEncoder::Free() {
 	}
 }
 
+void BaseEncoder::NotifyThread() {
+	// the lock guarantees that the notification can't get lost between checking the queue and starting to wait
+	SharedLock lock(&m_shared_data);
+	m_frame_condition.notify_one();
+}
+
 void BaseEncoder::EncoderThread() {
 
 	try {
 
 		Logger::LogInfo("[BaseEncoder::EncoderThread] " + Logger::tr("Encoder thread started."));
 
+		ThreadHeartbeat heartbeat(QString("Encoder (%1)").arg(m_codec_context->codec->name));
+
 		// normal encoding
 		while(!m_should_stop) {
 
 			// get a frame
+			// The thread sleeps until a frame is added instead of polling the queue, so the number of wakeups follows the frame rate
+			// (or the audio frame size). The timeout only keeps the heartbeat going.
+			heartbeat.Beat("wait");
 			std::unique_ptr<AVFrameWrapper> frame;
 			{
 				SharedLock lock(&m_shared_data);
+				if(lock->m_frame_queue.empty() && !m_should_stop && !m_should_finish)
+					m_frame_condition.wait_for(lock.lock(), std::chrono::microseconds(ENCODER_WAIT_TIMEOUT));
 				if(!lock->m_frame_queue.empty()) {
 					frame = std::move(lock->m_frame_queue.front());
 					lock->m_frame_queue.pop_front();
@@ -203,12 +231,17 @@ void BaseEncoder::EncoderThread() {
 				if(m_should_finish) {
 					break;
 				}
-				usleep(20000);
 				continue;
 			}
 
 			// encode the frame
+			heartbeat.Beat("encode");
+			int64_t encode_start = hrt_time_micro();
 			EncodeFrame(frame.get());
+			{
+				SharedLock lock(&m_shared_data);
+				lock->m_total_encode_time += hrt_time_micro() - encode_start;
+			}
 
 		}
 
@@ -216,6 +249,7 @@ void BaseEncoder::EncoderThread() {
 		if(!m_should_stop && (m_codec_context->codec->capabilities & AV_CODEC_CAP_DELAY)) {
 			Logger::LogInfo("[BaseEncoder::EncoderThread] " + Logger::tr("Flushing encoder ..."));
 			while(!m_should_stop) {
+				heartbeat.Beat("flush");
 				if(!EncodeFrame(NULL)) {
 					break;
 				}
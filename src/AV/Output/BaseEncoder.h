@@ -34,6 +34,7 @@ private:
 	struct SharedData {
 		std::deque<std::unique_ptr<AVFrameWrapper> > m_frame_queue;
 		uint64_t m_total_frames, m_total_packets;
+		int64_t m_total_encode_time;
 		double m_stats_actual_frame_rate;
 		int64_t m_stats_previous_pts;
 		uint64_t m_stats_previous_frames;
@@ -48,6 +49,7 @@ private:
 
 	std::thread m_thread;
 	MutexDataPair<SharedData> m_shared_data;
+	std::condition_variable m_frame_condition; // signals the encoder thread when a frame is added or when it should stop
 	std::atomic<bool> m_should_stop, m_should_finish, m_is_done, m_error_occurred;
 
 protected:
@@ -79,6 +81,10 @@ public:
 
 	unsigned int GetQueuedPacketCount();
 
+	// Returns the total time (in microseconds) that the encoder thread has spent encoding frames.
+	// This function is thread-safe.
+	int64_t GetTotalEncodeTime();
+
 public: // internal
 
 	// Adds a frame to the frame queue. Called by the synchronizer.
@@ -120,6 +126,8 @@ private:
 	void Init(AVCodec* codec, AVDictionary** options);
 	void Free();
 
+	void NotifyThread();
+
 	void EncoderThread();
 
 };
@@ -0,0 +1,171 @@
+/*
+Copyright (c) 2012-2020 Maarten Baert <maarten-baert@hotmail.com>
+
+This file is part of SimpleScreenRecorder.
+
+SimpleScreenRecorder is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+SimpleScreenRecorder is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with SimpleScreenRecorder.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#include "CodecCapabilities.h"
+
+#include "Logger.h"
+#include "AVWrapper.h"
+#include "VideoEncoder.h"
+#include "AudioEncoder.h"
+
+#include <dlfcn.h>
+#include <sys/stat.h>
+
+// Increment this when the probing code changes, to invalidate old caches.
+#define CODEC_CAPABILITIES_CACHE_VERSION 1
+
+static QString GetLibraryKey(void* symbol) {
+	Dl_info info;
+	if(dladdr(symbol, &info) == 0 || info.dli_fname == NULL)
+		return "unknown";
+	struct stat statinfo;
+	if(stat(info.dli_fname, &statinfo) == -1)
+		return QString::fromLocal8Bit(info.dli_fname);
+	return QString::fromLocal8Bit(info.dli_fname) + ":" + QString::number((qint64) statinfo.st_size) + ":" + QString::number((qint64) statinfo.st_mtime);
+}
+
+QString GetCodecCapabilitiesKey() {
+	return QString::number(CODEC_CAPABILITIES_CACHE_VERSION) + ";" + SSR_VERSION + ";"
+			+ QString::number(avformat_version()) + ";" + QString::number(avcodec_version()) + ";" + QString::number(avutil_version()) + ";"
+			+ GetLibraryKey((void*) &avformat_version) + ";" + GetLibraryKey((void*) &avcodec_version);
+}
+
+CodecCapabilities ProbeCodecCapabilities() {
+	CodecCapabilities capabilities;
+
+	// containers
+#if SSR_USE_AV_MUXER_ITERATE
+	const AVOutputFormat *format;
+	void *format_opaque = NULL;
+	while((format = av_muxer_iterate(&format_opaque)) != NULL) {
+#else
+	for(AVOutputFormat *format = av_oformat_next(NULL); format != NULL; format = av_oformat_next(format)) {
+#endif
+		if(format->video_codec == AV_CODEC_ID_NONE)
+			continue;
+		CodecCapabilities::Container c;
+		c.name = format->long_name;
+		c.avname = format->name;
+		c.suffixes = SplitSkipEmptyParts(format->extensions, ',');
+		for(int i = 0; i < c.suffixes.size(); ++i) {
+			c.suffixes[i] = c.suffixes[i].trimmed(); // needed because libav/ffmpeg isn't very consistent when they say 'comma-separated'
+		}
+		capabilities.m_containers.push_back(c);
+	}
+
+	// codecs
+	// The codec is checked directly rather than by name, looking up every codec by name would be quadratic.
+#if SSR_USE_AV_MUXER_ITERATE
+	const AVCodec *codec;
+	void *codec_opaque = NULL;
+	while((codec = av_codec_iterate(&codec_opaque)) != NULL) {
+#else
+	for(AVCodec *codec = av_codec_next(NULL); codec != NULL; codec = av_codec_next(codec)) {
+#endif
+		if(!av_codec_is_encoder(codec))
+			continue;
+		if(codec->type == AVMEDIA_TYPE_VIDEO && VideoEncoder::AVCodecIsSupported(codec)) {
+			CodecCapabilities::Codec c;
+			c.name = codec->long_name;
+			c.avname = codec->name;
+			capabilities.m_video_codecs.push_back(c);
+		}
+		if(codec->type == AVMEDIA_TYPE_AUDIO && AudioEncoder::AVCodecIsSupported(codec)) {
+			CodecCapabilities::Codec c;
+			c.name = codec->long_name;
+			c.avname = codec->name;
+			capabilities.m_audio_codecs.push_back(c);
+		}
+	}
+
+	return capabilities;
+}
+
+static void LoadCodecList(QSettings& settings, const QString& group, std::vector<CodecCapabilities::Codec>* codecs) {
+	int size = settings.beginReadArray(group);
+	codecs->resize(size);
+	for(int i = 0; i < size; ++i) {
+		settings.setArrayIndex(i);
+		(*codecs)[i].name = settings.value("name").toString();
+		(*codecs)[i].avname = settings.value("avname").toString();
+	}
+	settings.endArray();
+}
+
+static void SaveCodecList(QSettings& settings, const QString& group, const std::vector<CodecCapabilities::Codec>& codecs) {
+	settings.beginWriteArray(group, codecs.size());
+	for(unsigned int i = 0; i < codecs.size(); ++i) {
+		settings.setArrayIndex(i);
+		settings.setValue("name", codecs[i].name);
+		settings.setValue("avname", codecs[i].avname);
+	}
+	settings.endArray();
+}
+
+bool LoadCodecCapabilities(const QString& file, const QString& key, CodecCapabilities* capabilities) {
+	if(!QFileInfo(file).exists())
+		return false;
+	QSettings settings(file, QSettings::IniFormat);
+	if(settings.value("key").toString() != key)
+		return false;
+	int size = settings.beginReadArray("containers");
+	capabilities->m_containers.resize(size);
+	for(int i = 0; i < size; ++i) {
+		settings.setArrayIndex(i);
+		capabilities->m_containers[i].name = settings.value("name").toString();
+		capabilities->m_containers[i].avname = settings.value("avname").toString();
+		capabilities->m_containers[i].suffixes = SplitSkipEmptyParts(settings.value("suffixes").toString(), ',');
+	}
+	settings.endArray();
+	LoadCodecList(settings, "video_codecs", &capabilities->m_video_codecs);
+	LoadCodecList(settings, "audio_codecs", &capabilities->m_audio_codecs);
+	return (settings.status() == QSettings::NoError);
+}
+
+void SaveCodecCapabilities(const QString& file, const QString& key, const CodecCapabilities& capabilities) {
+	QSettings settings(file, QSettings::IniFormat);
+	settings.clear();
+	settings.setValue("key", key);
+	settings.beginWriteArray("containers", capabilities.m_containers.size());
+	for(unsigned int i = 0; i < capabilities.m_containers.size(); ++i) {
+		settings.setArrayIndex(i);
+		settings.setValue("name", capabilities.m_containers[i].name);
+		settings.setValue("avname", capabilities.m_containers[i].avname);
+		settings.setValue("suffixes", capabilities.m_containers[i].suffixes.join(","));
+	}
+	settings.endArray();
+	SaveCodecList(settings, "video_codecs", capabilities.m_video_codecs);
+	SaveCodecList(settings, "audio_codecs", capabilities.m_audio_codecs);
+	settings.sync();
+	if(settings.status() != QSettings::NoError)
+		Logger::LogWarning("[SaveCodecCapabilities] " + Logger::tr("Warning: Can't write codec capability cache '%1'.").arg(file));
+}
+
+CodecCapabilities GetCodecCapabilities(const QString& file) {
+	QString key = GetCodecCapabilitiesKey();
+	CodecCapabilities capabilities;
+	if(LoadCodecCapabilities(file, key, &capabilities) && !capabilities.m_containers.empty() &&
+			!capabilities.m_video_codecs.empty() && !capabilities.m_audio_codecs.empty())
+		return capabilities;
+	Logger::LogInfo("[GetCodecCapabilities] " + Logger::tr("Codec capability cache is missing or outdated, probing libav/ffmpeg ..."));
+	capabilities = ProbeCodecCapabilities();
+	SaveCodecCapabilities(file, key, capabilities);
+	return capabilities;
+}
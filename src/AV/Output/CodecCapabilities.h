@@ -0,0 +1,56 @@
+/*
+Copyright (c) 2012-2020 Maarten Baert <maarten-baert@hotmail.com>
+
+This file is part of SimpleScreenRecorder.
+
+SimpleScreenRecorder is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+SimpleScreenRecorder is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with SimpleScreenRecorder.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#pragma once
+#include "Global.h"
+
+// The containers and codecs that can be used for recording.
+// Probing this requires iterating over every muxer and encoder in libavformat and libavcodec, which is slow with large FFmpeg builds,
+// so the result is cached in a file. The cache is keyed by the libav* versions and the size and modification time of the libraries,
+// so it is refreshed automatically (on the next start) when FFmpeg is upgraded or rebuilt.
+struct CodecCapabilities {
+
+	struct Container {
+		QString name, avname;
+		QStringList suffixes;
+	};
+	struct Codec {
+		QString name, avname;
+	};
+
+	std::vector<Container> m_containers;
+	std::vector<Codec> m_video_codecs, m_audio_codecs;
+
+};
+
+// Returns the key that identifies the currently loaded libav* libraries.
+QString GetCodecCapabilitiesKey();
+
+// Probes libavformat and libavcodec. This is slow.
+CodecCapabilities ProbeCodecCapabilities();
+
+// Loads the capabilities from the cache file. Returns false if the file doesn't exist or the key doesn't match.
+bool LoadCodecCapabilities(const QString& file, const QString& key, CodecCapabilities* capabilities);
+
+// Saves the capabilities to the cache file.
+void SaveCodecCapabilities(const QString& file, const QString& key, const CodecCapabilities& capabilities);
+
+// Returns the capabilities from the cache file if it is still valid, otherwise probes the libraries and updates the cache file.
+CodecCapabilities GetCodecCapabilities(const QString& file);
@@ -0,0 +1,149 @@
+/*
+Copyright (c) 2012-2020 Maarten Baert <maarten-baert@hotmail.com>
+
+This file is part of SimpleScreenRecorder.
+
+SimpleScreenRecorder is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+SimpleScreenRecorder is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with SimpleScreenRecorder.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "DegradationController.h"
+
+#include "Logger.h"
+
+// The load is measured over this interval (in microseconds).
+const int64_t DegradationController::MEASUREMENT_INTERVAL = 500000;
+
+// After every change, the controller waits this long (in microseconds) before it changes the level again, so the queue can recover.
+const int64_t DegradationController::SETTLE_TIME = 2000000;
+
+// The encoder has to be overloaded for this long (in microseconds) before the quality is reduced.
+const int64_t DegradationController::STEP_DOWN_TIME = 1000000;
+
+// The encoder has to be underloaded for this long (in microseconds) before the quality is increased again. If this causes a new overload,
+// the time is doubled, up to the maximum.
+const int64_t DegradationController::STEP_UP_TIME = 10000000;
+const int64_t DegradationController::MAX_STEP_UP_TIME = 160000000;
+
+// The encoder is overloaded if it is busy more than this fraction of the time, and underloaded if it would still be busy
+// less than this fraction of the time at the next higher level.
+const double DegradationController::OVERLOAD_BUSY = 0.95;
+const double DegradationController::UNDERLOAD_BUSY = 0.7;
+
+// The encoder is also overloaded if this many frames are waiting, and it can only be underloaded if the queue is (nearly) empty.
+// The output manager starts throttling the inputs at 20 frames, the controller should react before that.
+const unsigned int DegradationController::OVERLOAD_QUEUE_FRAMES = 10;
+const unsigned int DegradationController::UNDERLOAD_QUEUE_FRAMES = 2;
+
+DegradationController::DegradationController(const std::vector<Level>& ladder) {
+	assert(!ladder.empty());
+	m_levels = ladder;
+	m_level = 0;
+	m_last_timestamp = std::numeric_limits<int64_t>::min();
+	m_last_busy_time = 0;
+	m_last_queued_frames = 0;
+	m_busy = 0.0;
+	m_overload_start = std::numeric_limits<int64_t>::min();
+	m_underload_start = std::numeric_limits<int64_t>::min();
+	m_last_change = std::numeric_limits<int64_t>::min();
+	m_last_change_up = false;
+	m_step_up_time = STEP_UP_TIME;
+}
+
+bool DegradationController::Update(int64_t timestamp, unsigned int queued_frames, int64_t busy_time) {
+
+	// measure the load
+	if(m_last_timestamp == std::numeric_limits<int64_t>::min() || busy_time < m_last_busy_time) {
+		m_last_timestamp = timestamp;
+		m_last_busy_time = busy_time;
+		return false;
+	}
+	if(timestamp - m_last_timestamp < MEASUREMENT_INTERVAL)
+		return false;
+	m_busy = clamp((double) (busy_time - m_last_busy_time) / (double) (timestamp - m_last_timestamp), 0.0, 1.0);
+	bool queue_growing = (queued_frames > m_last_queued_frames), queue_shrinking = (queued_frames < m_last_queued_frames);
+	m_last_timestamp = timestamp;
+	m_last_busy_time = busy_time;
+	m_last_queued_frames = queued_frames;
+
+	// The encoder is always busy while it is catching up with the queue, so that is not considered overload as long as the queue is shrinking.
+	// Going up to the next level increases the number of encoded frames, so the load is scaled accordingly.
+	// The quality offset hardly changes the encoding time, so it is ignored. The prediction isn't exact, that's why the threshold is lower than the overload threshold.
+	bool overload = ((queued_frames >= OVERLOAD_QUEUE_FRAMES && !queue_shrinking) || (m_busy >= OVERLOAD_BUSY && queue_growing));
+	bool underload = false;
+	if(m_level != 0 && queued_frames <= UNDERLOAD_QUEUE_FRAMES) {
+		double predicted_busy = m_busy * (double) m_levels[m_level].m_frame_rate_divisor / (double) m_levels[m_level - 1].m_frame_rate_divisor;
+		underload = (predicted_busy <= UNDERLOAD_BUSY);
+	}
+	if(!overload)
+		m_overload_start = std::numeric_limits<int64_t>::min();
+	else if(m_overload_start == std::numeric_limits<int64_t>::min())
+		m_overload_start = timestamp;
+	if(!underload)
+		m_underload_start = std::numeric_limits<int64_t>::min();
+	else if(m_underload_start == std::numeric_limits<int64_t>::min())
+		m_underload_start = timestamp;
+
+	// wait until the previous change has taken effect
+	if(m_last_change != std::numeric_limits<int64_t>::min() && timestamp - m_last_change < SETTLE_TIME) {
+		m_overload_start = std::numeric_limits<int64_t>::min();
+		m_underload_start = std::numeric_limits<int64_t>::min();
+		return false;
+	}
+
+	// step down
+	if(m_overload_start != std::numeric_limits<int64_t>::min() && timestamp - m_overload_start >= STEP_DOWN_TIME && m_level + 1 < m_levels.size()) {
+		if(m_last_change_up && timestamp - m_last_change < m_step_up_time)
+			m_step_up_time = std::min(m_step_up_time * 2, MAX_STEP_UP_TIME);
+		++m_level;
+		m_overload_start = std::numeric_limits<int64_t>::min();
+		m_underload_start = std::numeric_limits<int64_t>::min();
+		m_last_change = timestamp;
+		m_last_change_up = false;
+		return true;
+	}
+
+	// step up
+	if(m_underload_start != std::numeric_limits<int64_t>::min() && timestamp - m_underload_start >= m_step_up_time) {
+		--m_level;
+		m_overload_start = std::numeric_limits<int64_t>::min();
+		m_underload_start = std::numeric_limits<int64_t>::min();
+		m_last_change = timestamp;
+		m_last_change_up = true;
+		return true;
+	}
+
+	return false;
+}
+
+std::vector<DegradationController::Level> DegradationController::ParseLadder(const QString& str) {
+	std::vector<Level> ladder;
+	Level level = {1};
+	ladder.push_back(level);
+	QStringList steps = SplitSkipEmptyParts(str, ',');
+	for(const QString &step : steps) {
+		if(!step.startsWith("fps/"))
+			return std::vector<Level>();
+		bool ok;
+		unsigned int divisor = step.mid(4).toUInt(&ok);
+		if(!ok || divisor <= level.m_frame_rate_divisor || divisor > 100)
+			return std::vector<Level>();
+		level.m_frame_rate_divisor = divisor;
+		ladder.push_back(level);
+	}
+	return ladder;
+}
+
+QString DegradationController::LevelToString(const Level& level) {
+	return Logger::tr("1/%1 of the frames").arg(level.m_frame_rate_divisor);
+}
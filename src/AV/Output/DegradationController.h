@@ -0,0 +1,77 @@
+/*
+Copyright (c) 2012-2020 Maarten Baert <maarten-baert@hotmail.com>
+
+This file is part of SimpleScreenRecorder.
+
+SimpleScreenRecorder is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+SimpleScreenRecorder is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with SimpleScreenRecorder.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+#include "Global.h"
+
+// Reduces the quality of the recording step by step when the video encoder can't keep up, and restores it when the load has decreased.
+// The steps are defined by a ladder where every level is cheaper to encode than the previous one. The load is measured with the
+// encoder queue and the fraction of time the encoder thread is busy. The controller reacts quickly to overload (otherwise the
+// queue keeps growing until frames are lost), but waits much longer before going back up. If going back up causes a new overload
+// right away, the waiting time is doubled so the controller doesn't keep switching between two levels.
+// The only setting is the frame rate divisor. The encoder settings can't be changed while recording in a way that reliably reduces the
+// encoding time (a higher CRF mostly reduces the bitrate, libx264 still does the same analysis for every frame).
+class DegradationController {
+
+public:
+	struct Level {
+		unsigned int m_frame_rate_divisor; // only one out of every N frames is captured
+	};
+
+private:
+	static const int64_t MEASUREMENT_INTERVAL, SETTLE_TIME, STEP_DOWN_TIME, STEP_UP_TIME, MAX_STEP_UP_TIME;
+	static const double OVERLOAD_BUSY, UNDERLOAD_BUSY;
+	static const unsigned int OVERLOAD_QUEUE_FRAMES, UNDERLOAD_QUEUE_FRAMES;
+
+private:
+	std::vector<Level> m_levels;
+	unsigned int m_level;
+
+	int64_t m_last_timestamp, m_last_busy_time;
+	unsigned int m_last_queued_frames;
+	double m_busy;
+	int64_t m_overload_start, m_underload_start;
+	int64_t m_last_change;
+	bool m_last_change_up;
+	int64_t m_step_up_time;
+
+public:
+	// The first level of the ladder should be the normal quality.
+	DegradationController(const std::vector<Level>& ladder);
+
+	// Updates the controller. This should be called regularly with the number of frames waiting for the encoder and the total time (in
+	// microseconds) the encoder has spent encoding so far. Returns true if the level has changed.
+	bool Update(int64_t timestamp, unsigned int queued_frames, int64_t busy_time);
+
+	// Returns the fraction of time the encoder was busy during the last measurement.
+	inline double GetBusyFraction() { return m_busy; }
+
+	inline unsigned int GetLevel() { return m_level; }
+	inline unsigned int GetLevelCount() { return m_levels.size(); }
+	inline const Level& GetCurrentLevel() { return m_levels[m_level]; }
+
+public:
+	// Parses a comma-separated list of steps, e.g. 'fps/2,fps/3'. The frame rate divisor has to increase with every step.
+	// The returned ladder starts with the normal quality. Returns an empty ladder if the string is invalid.
+	static std::vector<Level> ParseLadder(const QString& str);
+
+	// Returns a readable description of a level.
+	static QString LevelToString(const Level& level);
+
+};
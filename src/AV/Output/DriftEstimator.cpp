@@ -0,0 +1,89 @@
+/*
+Copyright (c) 2012-2020 Maarten Baert <maarten-baert@hotmail.com>
+
+This file is part of SimpleScreenRecorder.
+
+SimpleScreenRecorder is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+SimpleScreenRecorder is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with SimpleScreenRecorder.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#include "DriftEstimator.h"
+
+// The minimum spread of the positions (standard deviation, in seconds) before the slope of the fit is fully trusted.
+// With less data the slope is very unreliable, so it is mixed with the nominal speed.
+static const double MIN_POSITION_SPREAD = 1.0;
+
+// The clock ratio will never deviate more than this from 1.0. Anything worse than this is not drift, it's a broken input.
+static const double MAX_CLOCK_DEVIATION = 0.1;
+
+DriftEstimator::DriftEstimator(double time_constant, double max_error, unsigned int max_outliers) {
+	m_time_constant = time_constant;
+	m_max_error = max_error;
+	m_max_outliers = max_outliers;
+	Reset();
+}
+
+void DriftEstimator::Reset() {
+	m_weight = 0.0;
+	m_mean_position = 0.0;
+	m_mean_time = 0.0;
+	m_cov_pp = 0.0;
+	m_cov_pt = 0.0;
+	m_point_count = 0;
+	m_outlier_count = 0;
+}
+
+bool DriftEstimator::AddPoint(double position, double time, double length) {
+
+	// reject outliers
+	if(m_point_count != 0 && fabs(time - GetTime(position)) > m_max_error) {
+		++m_outlier_count;
+		if(m_outlier_count < m_max_outliers)
+			return false;
+		Reset();
+	}
+	m_outlier_count = 0;
+
+	// forget old timestamps
+	double decay = exp(-length / m_time_constant);
+	m_weight *= decay;
+	m_cov_pp *= decay;
+	m_cov_pt *= decay;
+
+	// add the new timestamp (weighted incremental algorithm, this is much more accurate than summing squares)
+	// Longer blocks get a higher weight, so the result doesn't depend on the block size.
+	double weight = fmax(length, 1.0e-6);
+	m_weight += weight;
+	double delta_position = position - m_mean_position;
+	double delta_time = time - m_mean_time;
+	m_mean_position += delta_position * weight / m_weight;
+	m_mean_time += delta_time * weight / m_weight;
+	m_cov_pp += weight * delta_position * (position - m_mean_position);
+	m_cov_pt += weight * delta_position * (time - m_mean_time);
+	++m_point_count;
+
+	return true;
+}
+
+double DriftEstimator::GetTime(double position) {
+	return m_mean_time + GetClockRatio() * (position - m_mean_position);
+}
+
+double DriftEstimator::GetClockRatio() {
+	if(m_cov_pp <= 0.0)
+		return 1.0;
+	// blend smoothly from the nominal speed to the slope of the fit, a sudden change would cause a jump in the drift correction
+	double confidence = fmin(1.0, m_cov_pp / (MIN_POSITION_SPREAD * MIN_POSITION_SPREAD * m_weight));
+	return 1.0 + confidence * clamp(m_cov_pt / m_cov_pp - 1.0, -MAX_CLOCK_DEVIATION, MAX_CLOCK_DEVIATION);
+}
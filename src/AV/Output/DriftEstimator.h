@@ -0,0 +1,59 @@
+/*
+Copyright (c) 2012-2020 Maarten Baert <maarten-baert@hotmail.com>
+
+This file is part of SimpleScreenRecorder.
+
+SimpleScreenRecorder is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+SimpleScreenRecorder is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with SimpleScreenRecorder.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#pragma once
+#include "Global.h"
+
+// Estimates the real timestamp of audio samples based on noisy timestamps. The timestamps are fitted to the sample position
+// with weighted linear regression. Older timestamps gradually lose their weight (exponential forgetting) so slow changes in the speed
+// of the audio clock can still be tracked. Unlike simple low-pass filtering of the timestamps, this doesn't lag behind when the audio
+// clock runs slightly too fast or too slow, which is exactly the situation that drift correction has to deal with.
+class DriftEstimator {
+
+private:
+	double m_time_constant, m_max_error;
+	unsigned int m_max_outliers;
+
+	double m_weight, m_mean_position, m_mean_time, m_cov_pp, m_cov_pt;
+	unsigned int m_point_count, m_outlier_count;
+
+public:
+	// 'time_constant' is the time (in seconds) after which old timestamps have lost most of their weight.
+	// Timestamps that are more than 'max_error' seconds away from the fit are ignored, unless this happens 'max_outliers' times in a row.
+	DriftEstimator(double time_constant, double max_error, unsigned int max_outliers);
+
+	// Removes all timestamps.
+	void Reset();
+
+	// Adds a timestamp. 'position' is the position of the first sample (i.e. the number of samples before it divided by the sample rate),
+	// 'time' is the timestamp of that sample and 'length' is the length of the block of samples (all in seconds).
+	// Returns false if the timestamp was rejected as an outlier. If there are too many outliers in a row, the input has most likely
+	// jumped (e.g. because samples were lost), so the estimator starts over with the new timestamp.
+	bool AddPoint(double position, double time, double length);
+
+	// Returns the estimated timestamp of the sample at the given position (in seconds).
+	double GetTime(double position);
+
+	// Returns the estimated speed of the audio clock relative to the system clock (time per position).
+	double GetClockRatio();
+
+	inline unsigned int GetPointCount() { return m_point_count; }
+
+};
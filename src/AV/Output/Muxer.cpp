@@ -20,15 +20,27 @@ along with SimpleScreenRecorder.  If not, see <http://www.gnu.org/licenses/>.
 #include "Muxer.h"
 
 #include "Logger.h"
+#include "ThreadWatchdog.h"
 #include "AVWrapper.h"
 #include "BaseEncoder.h"
 #include "VideoEncoder.h"
 #include "AudioEncoder.h"
+#include "UDPTransport.h"
+#include "MuxerJournal.h"
+
+// Returns whether the output is a local file (as opposed to a network stream).
+static bool IsLocalFile(const QString& file) {
+	const char *protocol = avio_find_protocol_name(QFile::encodeName(file).constData());
+	if(protocol != NULL)
+		return (strcmp(protocol, "file") == 0);
+	return !file.contains("://");
+}
 
-Muxer::Muxer(const QString& container_name, const QString& output_file) {
+Muxer::Muxer(const QString& container_name, const QString& output_file, bool use_journal) {
 
 	m_container_name = container_name;
 	m_output_file = output_file;
+	m_use_journal = use_journal;
 
 	m_format_context = NULL;
 	m_started = false;
@@ -36,6 +48,7 @@ Muxer::Muxer(const QString& container_name, const QString& output_file) {
 	// initialize stream data
 	for(int i = 0; i < MUXER_MAX_STREAMS; ++i) {
 		StreamLock lock(&m_stream_data[i]);
+		lock->m_held_packets = 0;
 		lock->m_is_done = false;
 		m_encoders[i] = NULL;
 	}
@@ -52,6 +65,7 @@ Muxer::Muxer(const QString& container_name, const QString& output_file) {
 	// initialize thread signals
 	m_is_done = false;
 	m_error_occurred = false;
+	m_first_video_packet_time = AV_NOPTS_VALUE;
 
 	try {
 		Init();
@@ -141,12 +155,53 @@ void Muxer::Start() {
 		assert(m_encoders[i] != NULL);
 	}
 
+	// start the UDP transport
+	// This is done here because the nominal bit rate is only known after the encoders have been created.
+	if(UDPTransport::IsTransportURL(m_output_file)) {
+		unsigned int bit_rate = 0;
+		for(unsigned int i = 0; i < m_format_context->nb_streams; ++i) {
+			bit_rate += m_encoders[i]->GetCodecContext()->bit_rate;
+		}
+		m_udp_transport.reset(new UDPTransport(m_output_file, bit_rate));
+		unsigned int buffer_size = UDP_TRANSPORT_PAYLOAD_SIZE * 4;
+		uint8_t *buffer = (uint8_t*) av_malloc(buffer_size);
+		if(buffer == NULL) {
+			Logger::LogError("[Muxer::Start] " + Logger::tr("Error: Can't allocate I/O buffer!"));
+			throw std::bad_alloc();
+		}
+		m_format_context->pb = avio_alloc_context(buffer, buffer_size, 1, m_udp_transport.get(), NULL, &UDPTransport::AVIOWritePacket, NULL);
+		if(m_format_context->pb == NULL) {
+			av_free(buffer);
+			Logger::LogError("[Muxer::Start] " + Logger::tr("Error: Can't allocate I/O context!"));
+			throw LibavException();
+		}
+	}
+
 	// write header
 	if(avformat_write_header(m_format_context, NULL) != 0) {
 		Logger::LogError("[Muxer::Start] " + Logger::tr("Error: Can't write header!", "Don't translate 'header'"));
 		throw LibavException();
 	}
 
+	// create the recovery journal
+	// This only makes sense for local files, the journal has to be written next to the output file.
+	if(m_use_journal) {
+		if(!IsLocalFile(m_output_file)) {
+			Logger::LogWarning("[Muxer::Start] " + Logger::tr("Warning: The recovery journal can only be used for local files, the recording can't be recovered after a crash."));
+		} else {
+			AVCodecContext *codec_contexts[MUXER_MAX_STREAMS];
+			for(unsigned int i = 0; i < m_format_context->nb_streams; ++i) {
+				codec_contexts[i] = m_encoders[i]->GetCodecContext();
+			}
+			try {
+				m_journal.reset(new MuxerJournal(MuxerJournal::GetJournalFile(m_output_file), m_output_file, m_format_context, codec_contexts,
+												 MuxerJournal::HasContiguousPackets(m_format_context->oformat)));
+			} catch(const LibavException&) {
+				Logger::LogWarning("[Muxer::Start] " + Logger::tr("Warning: Can't create recovery journal, the recording can't be recovered after a crash."));
+			}
+		}
+	}
+
 	m_started = true;
 	m_thread = std::thread(&Muxer::MuxerThread, this);
 
@@ -166,6 +221,21 @@ double Muxer::GetActualBitRate() {
 	return lock->m_stats_actual_bit_rate;
 }
 
+bool Muxer::RenameOutputFile(const QString& new_file) {
+	assert(m_started);
+	if(m_udp_transport != NULL)
+		return false;
+	// The muxer only uses the file name when the file is opened, the open file descriptor remains valid after renaming.
+	if(rename(QFile::encodeName(m_output_file).constData(), QFile::encodeName(new_file).constData()) != 0) {
+		Logger::LogWarning("[Muxer::RenameOutputFile] " + Logger::tr("Warning: Can't rename output file '%1' to '%2'!").arg(m_output_file).arg(new_file));
+		return false;
+	}
+	if(m_journal != NULL && !m_journal->Rename(MuxerJournal::GetJournalFile(new_file)))
+		Logger::LogWarning("[Muxer::RenameOutputFile] " + Logger::tr("Warning: Can't rename the recovery journal!"));
+	m_output_file = new_file;
+	return true;
+}
+
 uint64_t Muxer::GetTotalBytes() {
 	SharedLock lock(&m_shared_data);
 	return lock->m_total_bytes;
@@ -188,7 +258,7 @@ unsigned int Muxer::GetQueuedPacketCount(unsigned int stream_index) {
 	assert(m_started);
 	assert(stream_index < m_format_context->nb_streams);
 	StreamLock lock(&m_stream_data[stream_index]);
-	return lock->m_packet_queue.size();
+	return lock->m_packet_queue.size() - lock->m_held_packets;
 }
 
 void Muxer::Init() {
@@ -213,7 +283,13 @@ void Muxer::Init() {
 	m_format_context->oformat = format;
 
 	// open file
-	if(avio_open(&m_format_context->pb, QFile::encodeName(m_output_file).constData(), AVIO_FLAG_WRITE) < 0) {
+	// The UDP transport is started later (in Start) because it needs the bit rate of the encoders.
+	if(UDPTransport::IsTransportURL(m_output_file)) {
+		if(strcmp(format->name, "mpegts") != 0) {
+			Logger::LogError("[Muxer::Init] " + Logger::tr("Error: The 'tsudp://' transport can only be used with the MPEG-TS container!"));
+			throw NetworkException();
+		}
+	} else if(avio_open(&m_format_context->pb, QFile::encodeName(m_output_file).constData(), AVIO_FLAG_WRITE) < 0) {
 		Logger::LogError("[Muxer::Init] " + Logger::tr("Error: Can't open output file!"));
 		throw LibavException();
 	}
@@ -224,10 +300,13 @@ void Muxer::Free() {
 	if(m_format_context != NULL) {
 
 		// write trailer (needed to free private muxer data)
+		bool finished = false;
 		if(m_started) {
 			if(av_write_trailer(m_format_context) != 0) {
 				// we can't throw exceptions here because this is called from the destructor
 				Logger::LogError("[Muxer::Free] " + Logger::tr("Error: Can't write trailer, continuing anyway.", "Don't translate 'trailer'"));
+			} else {
+				finished = true;
 			}
 			m_started = false;
 		}
@@ -241,11 +320,39 @@ void Muxer::Free() {
 		}
 
 		// close file
-		if(m_format_context->pb != NULL) {
-			avio_close(m_format_context->pb);
+		if(m_udp_transport != NULL) {
+			if(m_format_context->pb != NULL) {
+				avio_flush(m_format_context->pb);
+				m_udp_transport->Flush();
+				if(!m_udp_transport->WaitForQueue(2000000))
+					Logger::LogWarning("[Muxer::Free] " + Logger::tr("Warning: Not all data could be sent before the timeout."));
+				av_freep(&m_format_context->pb->buffer);
+#if SSR_USE_AVIO_CONTEXT_FREE
+				avio_context_free(&m_format_context->pb);
+#else
+				av_freep(&m_format_context->pb);
+#endif
+			}
+			UDPTransport::Stats stats = m_udp_transport->GetStats();
+			Logger::LogInfo("[Muxer::Free] " + Logger::tr("Sent %1 datagrams (%2 FEC packets), dropped %3 datagrams.")
+							.arg(stats.m_sent_datagrams).arg(stats.m_sent_fec_packets).arg(stats.m_dropped_datagrams));
+			m_udp_transport.reset();
+		} else if(m_format_context->pb != NULL) {
+			if(avio_close(m_format_context->pb) < 0)
+				finished = false;
 			m_format_context->pb = NULL;
 		}
 
+		// the journal is only needed if the file could not be finished
+		if(m_journal != NULL) {
+			if(finished) {
+				m_journal->Remove();
+			} else {
+				Logger::LogWarning("[Muxer::Free] " + Logger::tr("Warning: The output file was not finished correctly, the journal has been kept so it can be recovered with 'ssr-recover'."));
+			}
+			m_journal.reset();
+		}
+
 		// free everything
 #if SSR_USE_AVFORMAT_FREE_CONTEXT
 		avformat_free_context(m_format_context);
@@ -274,7 +381,11 @@ AVCodec* Muxer::FindCodec(const QString& codec_name) {
 
 AVStream* Muxer::AddStream(AVCodec* codec, AVCodecContext** codec_context) {
 	assert(!m_started);
-	assert(m_format_context->nb_streams < MUXER_MAX_STREAMS);
+
+	if(m_format_context->nb_streams >= MUXER_MAX_STREAMS) {
+		Logger::LogError("[Muxer::AddStream] " + Logger::tr("Error: Too many streams, the maximum is %1!").arg(MUXER_MAX_STREAMS));
+		throw LibavException();
+	}
 
 	Logger::LogInfo("[Muxer::AddStream] " + Logger::tr("Using codec %1 (%2).").arg(codec->name).arg(codec->long_name));
 
@@ -332,29 +443,54 @@ AVStream* Muxer::AddStream(AVCodec* codec, AVCodecContext** codec_context) {
 	return stream;
 }
 
+// Returns the time of a packet in seconds. The exact value is not critical, it's only used for interleaving and bitrate statistics.
+static double GetPacketTime(AVPacket* packet, double time_base) {
+	if(packet->dts != (int64_t) AV_NOPTS_VALUE)
+		return (double) packet->dts * time_base;
+	if(packet->pts != (int64_t) AV_NOPTS_VALUE)
+		return (double) packet->pts * time_base;
+	return 0.0;
+}
+
 void Muxer::MuxerThread() {
 	try {
 
 		Logger::LogInfo("[Muxer::MuxerThread] " + Logger::tr("Muxer thread started."));
 
+		ThreadHeartbeat heartbeat("Muxer");
+
 		double total_time = 0.0;
 
 		// start muxing
 		for( ; ; ) {
 
-			// get a packet from a stream that isn't done yet
+			heartbeat.Beat("wait");
+
+			// get the packet with the lowest timestamp from the streams that aren't done yet
+			// When there is a journal, the muxer does the interleaving itself rather than using av_interleaved_write_frame, so every packet
+			// is written to the output file immediately. This is needed for the journal, which has to know where each packet ends up in the file.
+			// Packets are held back until all streams have a packet, unless that would take longer than MAX_INTERLEAVE_DELAY.
+			// Without a journal (e.g. when streaming) this delay isn't needed, so the packets are passed to av_interleaved_write_frame right away.
 			std::unique_ptr<AVPacketWrapper> packet;
-			unsigned int current_stream = 0, streams_done = 0;
+			unsigned int current_stream = INVALID_STREAM, streams_done = 0;
+			bool streams_waiting = false;
+			double current_time = 0.0, current_delay = 0.0;
 			for(unsigned int i = 0; i < m_format_context->nb_streams; ++i) {
 				StreamLock lock(&m_stream_data[i]);
 				if(lock->m_packet_queue.empty()) {
 					if(lock->m_is_done)
 						++streams_done;
+					else
+						streams_waiting = true;
 				} else {
-					current_stream = i;
-					packet = std::move(lock->m_packet_queue.front());
-					lock->m_packet_queue.pop_front();
-					break;
+					double time_base = ToDouble(m_encoders[i]->GetCodecContext()->time_base);
+					double front_time = GetPacketTime(lock->m_packet_queue.front()->GetPacket(), time_base);
+					double back_time = GetPacketTime(lock->m_packet_queue.back()->GetPacket(), time_base);
+					if(current_stream == INVALID_STREAM || front_time < current_time) {
+						current_stream = i;
+						current_time = front_time;
+					}
+					current_delay = std::max(current_delay, back_time - front_time);
 				}
 			}
 
@@ -363,22 +499,34 @@ void Muxer::MuxerThread() {
 				break;
 			}
 
-			// if there is no packet, wait and try again later
-			if(packet == NULL) {
+			// if there is no packet (or we should wait for other streams), wait and try again later
+			if(current_stream == INVALID_STREAM) {
 				usleep(20000);
 				continue;
 			}
+			// Packets that are held back aren't a backlog, the encoders shouldn't be throttled because of them.
+			// (av_interleaved_write_frame also holds back packets, but those aren't in the queue either.)
+			if(m_journal != NULL && streams_waiting && current_delay < MAX_INTERLEAVE_DELAY) {
+				for(unsigned int i = 0; i < m_format_context->nb_streams; ++i) {
+					StreamLock lock(&m_stream_data[i]);
+					lock->m_held_packets = lock->m_packet_queue.size();
+				}
+				usleep(20000);
+				continue;
+			}
+			{
+				StreamLock lock(&m_stream_data[current_stream]);
+				packet = std::move(lock->m_packet_queue.front());
+				lock->m_packet_queue.pop_front();
+				if(lock->m_held_packets != 0)
+					--lock->m_held_packets;
+			}
 
-			// try to figure out the time (the exact value is not critical, it's only used for bitrate statistics)
+			// update the total time (used for bitrate statistics)
 			AVStream *stream = m_encoders[current_stream]->GetStream();
 			AVCodecContext *codec_context = m_encoders[current_stream]->GetCodecContext();
-			double packet_time = 0.0;
-			if(packet->GetPacket()->dts != (int64_t) AV_NOPTS_VALUE)
-				packet_time = (double) packet->GetPacket()->dts * ToDouble(codec_context->time_base);
-			else if(packet->GetPacket()->pts != (int64_t) AV_NOPTS_VALUE)
-				packet_time = (double) packet->GetPacket()->pts * ToDouble(codec_context->time_base);
-			if(packet_time > total_time)
-				total_time = packet_time;
+			if(current_time > total_time)
+				total_time = current_time;
 
 			// prepare packet
 			packet->GetPacket()->stream_index = current_stream;
@@ -394,13 +542,36 @@ void Muxer::MuxerThread() {
 #endif
 
 			// write the packet (again, why does libav/ffmpeg call this a frame?)
-			if(av_interleaved_write_frame(m_format_context, packet->GetPacket()) != 0) {
-				Logger::LogError("[Muxer::MuxerThread] " + Logger::tr("Error: Can't write frame to muxer!"));
-				throw LibavException();
+			heartbeat.Beat("write");
+			if(m_journal == NULL) {
+				if(av_interleaved_write_frame(m_format_context, packet->GetPacket()) != 0) {
+					Logger::LogError("[Muxer::MuxerThread] " + Logger::tr("Error: Can't write frame to muxer!"));
+					throw LibavException();
+				}
+				// the data is now owned by libav/ffmpeg, so don't free it
+				packet->SetFreeOnDestruct(false);
+			} else {
+				// av_write_frame doesn't take ownership of the packet, so it will be freed by the wrapper.
+				m_journal->BeginPacket(current_stream, packet->GetPacket(), avio_tell(m_format_context->pb));
+				if(av_write_frame(m_format_context, packet->GetPacket()) < 0) {
+					Logger::LogError("[Muxer::MuxerThread] " + Logger::tr("Error: Can't write frame to muxer!"));
+					throw LibavException();
+				}
+				m_journal->EndPacket(avio_tell(m_format_context->pb));
+				if(m_journal->IsFlushNeeded()) {
+					avio_flush(m_format_context->pb); // the journal should never refer to data that is still in the buffer
+					m_journal->Flush();
+				}
 			}
 
-			// the data is now owned by libav/ffmpeg, so don't free it
-			packet->SetFreeOnDestruct(false);
+			if(m_first_video_packet_time == (int64_t) AV_NOPTS_VALUE && codec_context->codec_type == AVMEDIA_TYPE_VIDEO)
+				m_first_video_packet_time = hrt_time_micro();
+
+			// check the transport
+			if(m_udp_transport != NULL && m_udp_transport->HasErrorOccurred()) {
+				Logger::LogError("[Muxer::MuxerThread] " + Logger::tr("Error: The UDP transport has stopped!"));
+				throw NetworkException();
+			}
 
 			// update the byte counter
 			{
@@ -22,18 +22,21 @@ along with SimpleScreenRecorder.  If not, see <http://www.gnu.org/licenses/>.
 
 #include "MutexDataPair.h"
 
-#define MUXER_MAX_STREAMS 2
+#define MUXER_MAX_STREAMS 10
 
 class AVPacketWrapper;
 class BaseEncoder;
 class VideoEncoder;
 class AudioEncoder;
+class UDPTransport;
+class MuxerJournal;
 
 class Muxer {
 
 private:
 	struct StreamData {
 		std::deque<std::unique_ptr<AVPacketWrapper> > m_packet_queue;
+		unsigned int m_held_packets; // the number of packets at the front of the queue that are held back for interleaving
 		bool m_is_done;
 	};
 	typedef MutexDataPair<StreamData>::Lock StreamLock;
@@ -48,10 +51,16 @@ private:
 	static constexpr unsigned int INVALID_STREAM = std::numeric_limits<unsigned int>::max();
 	static constexpr double NOPTS_DOUBLE = -std::numeric_limits<double>::max();
 
+	// The maximum amount of time (in seconds) that packets are held back while waiting for packets from other streams (only with a journal).
+	static constexpr double MAX_INTERLEAVE_DELAY = 10.0;
+
 private:
 	QString m_container_name, m_output_file;
+	bool m_use_journal;
 
 	AVFormatContext *m_format_context;
+	std::unique_ptr<UDPTransport> m_udp_transport;
+	std::unique_ptr<MuxerJournal> m_journal;
 	bool m_started;
 	BaseEncoder *m_encoders[MUXER_MAX_STREAMS];
 
@@ -59,9 +68,11 @@ private:
 	MutexDataPair<StreamData> m_stream_data[MUXER_MAX_STREAMS];
 	MutexDataPair<SharedData> m_shared_data;
 	std::atomic<bool> m_is_done, m_error_occurred;
+	std::atomic<int64_t> m_first_video_packet_time;
 
 public:
-	Muxer(const QString& container_name, const QString& output_file);
+	// If use_journal is true, a recovery journal is written next to the output file (only for local files).
+	Muxer(const QString& container_name, const QString& output_file, bool use_journal);
 	~Muxer();
 
 	// Adds a video or audio encoder.
@@ -76,6 +87,11 @@ public:
 	// Tells the muxer to stop. It can take some time before the muxer really stops.
 	void Finish();
 
+	// Renames the output file (and the journal) while the muxer is running. This is used when an output was created before
+	// the recording started and the file name depends on the start time. This only works for local files.
+	// Returns false if the file could not be renamed, the old name is kept in that case.
+	bool RenameOutputFile(const QString& new_file);
+
 	// Returns the bit rate of the output stream.
 	// This function is thread-safe.
 	double GetActualBitRate();
@@ -84,6 +100,11 @@ public:
 	// This function is thread-safe.
 	uint64_t GetTotalBytes();
 
+	// Returns the time (hrt_time_micro) at which the first video packet was written to the output, or AV_NOPTS_VALUE if no video packet
+	// has been written yet.
+	// This function is thread-safe and lock-free.
+	inline int64_t GetFirstVideoPacketTime() { return m_first_video_packet_time; }
+
 	// Returns whether the muxing is done. If this returns true, the object can be deleted.
 	// Note: If an error occurred in the mixing thread, this function will return false.
 	// This function is thread-safe and lock-free.
@@ -106,7 +127,8 @@ public: // internal
 	// This function is thread-safe.
 	void AddPacket(unsigned int stream_index, std::unique_ptr<AVPacketWrapper> packet);
 
-	// Returns the total number of packets in the queue of a stream. Called by the encoder.
+	// Returns the total number of packets in the queue of a stream, excluding packets that are only held back for interleaving.
+	// Called by the encoder.
 	// This function is thread-safe.
 	unsigned int GetQueuedPacketCount(unsigned int stream_index);
 
@@ -0,0 +1,237 @@
+/*
+Copyright (c) 2012-2020 Maarten Baert <maarten-baert@hotmail.com>
+
+This file is part of SimpleScreenRecorder.
+
+SimpleScreenRecorder is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+SimpleScreenRecorder is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with SimpleScreenRecorder.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#include "MuxerJournal.h"
+
+#include "Logger.h"
+#include "AVWrapper.h"
+
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <sys/types.h>
+
+static void CopyName(char* dest, const char* src) {
+	memset(dest, 0, JOURNAL_NAME_SIZE);
+	if(src != NULL)
+		strncpy(dest, src, JOURNAL_NAME_SIZE - 1);
+}
+
+MuxerJournal::MuxerJournal(const QString& filename, const QString& output_file, AVFormatContext* format_context, AVCodecContext** codec_contexts, bool contiguous_packets) {
+
+	m_filename = filename;
+	m_fd = -1;
+	m_output_fd = -1;
+
+	m_next_flush_time = hrt_time_micro() + FLUSH_INTERVAL;
+	m_next_sync_time = hrt_time_micro() + SYNC_INTERVAL;
+
+	try {
+		Init(output_file, format_context, codec_contexts, contiguous_packets);
+	} catch(...) {
+		Free();
+		throw;
+	}
+
+}
+
+MuxerJournal::~MuxerJournal() {
+	Free();
+}
+
+void MuxerJournal::BeginPacket(unsigned int stream_index, AVPacket* packet, uint64_t offset) {
+	if(m_fd == -1)
+		return;
+	JournalPacket record;
+	memset(&record, 0, sizeof(record));
+	record.identifier = JOURNAL_PACKET_IDENTIFIER;
+	record.stream_index = stream_index;
+	record.flags = (packet->flags & AV_PKT_FLAG_KEY)? JOURNAL_PACKET_FLAG_KEY : 0;
+	record.pts = (packet->pts == (int64_t) AV_NOPTS_VALUE)? JOURNAL_NOPTS_VALUE : packet->pts;
+	record.dts = (packet->dts == (int64_t) AV_NOPTS_VALUE)? JOURNAL_NOPTS_VALUE : packet->dts;
+	record.duration = packet->duration;
+	record.offset = offset;
+	record.size = 0;
+	m_buffer.insert(m_buffer.end(), (uint8_t*) &record, (uint8_t*) &record + sizeof(record));
+}
+
+void MuxerJournal::EndPacket(uint64_t offset) {
+	if(m_fd == -1)
+		return;
+	assert(m_buffer.size() >= sizeof(JournalPacket));
+	JournalPacket *record = (JournalPacket*) (m_buffer.data() + m_buffer.size() - sizeof(JournalPacket));
+	record->size = offset - record->offset;
+}
+
+bool MuxerJournal::IsFlushNeeded() {
+	return (m_fd != -1 && hrt_time_micro() >= m_next_flush_time);
+}
+
+void MuxerJournal::Flush() {
+	if(m_fd == -1)
+		return;
+	int64_t timestamp = hrt_time_micro();
+	m_next_flush_time = timestamp + FLUSH_INTERVAL;
+	if(!WriteBuffer())
+		return;
+
+	// Sync the output file and then the journal occasionally, so they aren't lost entirely when the machine crashes. The output file
+	// goes first so the synced part of the journal never refers to data that only existed in the page cache. Records that were written
+	// after the last sync can still refer to missing data, those packets are ignored during recovery.
+	if(timestamp >= m_next_sync_time) {
+		m_next_sync_time = timestamp + SYNC_INTERVAL;
+		fdatasync(m_output_fd);
+		fdatasync(m_fd);
+	}
+
+}
+
+void MuxerJournal::Remove() {
+	if(m_fd == -1)
+		return;
+	close(m_fd);
+	m_fd = -1;
+	unlink(QFile::encodeName(m_filename).constData());
+	if(m_output_fd != -1) {
+		close(m_output_fd);
+		m_output_fd = -1;
+	}
+}
+
+bool MuxerJournal::Rename(const QString& filename) {
+	// the file descriptor remains valid, only the name is used later
+	if(rename(QFile::encodeName(m_filename).constData(), QFile::encodeName(filename).constData()) != 0)
+		return false;
+	m_filename = filename;
+	return true;
+}
+
+QString MuxerJournal::GetJournalFile(const QString& output_file) {
+	return output_file + ".ssrjournal";
+}
+
+bool MuxerJournal::HasContiguousPackets(const AVOutputFormat* format) {
+	// The MOV muxer family writes the data of each packet directly to the 'mdat' atom (unless fragmentation is enabled, which SSR doesn't do).
+	// 'ismv' is excluded because it is fragmented by default.
+	const char *names[] = {"mov", "mp4", "ipod", "3gp", "3g2", "psp", "f4v"};
+	for(const char *name : names) {
+		if(strcmp(format->name, name) == 0)
+			return true;
+	}
+	return false;
+}
+
+void MuxerJournal::Init(const QString& output_file, AVFormatContext* format_context, AVCodecContext** codec_contexts, bool contiguous_packets) {
+
+	// open the output file, only to sync it
+	// libavformat doesn't expose its file descriptor, but syncing any file descriptor of the file has the same effect.
+	m_output_fd = open(QFile::encodeName(output_file).constData(), O_RDONLY | O_CLOEXEC);
+	if(m_output_fd == -1) {
+		Logger::LogError("[MuxerJournal::Init] " + Logger::tr("Error: Can't open output file '%1'!").arg(output_file));
+		throw LibavException();
+	}
+
+	// create the journal
+	QByteArray filename = QFile::encodeName(m_filename);
+	m_fd = open(filename.constData(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+	if(m_fd == -1) {
+		Logger::LogError("[MuxerJournal::Init] " + Logger::tr("Error: Can't create journal file '%1'!").arg(m_filename));
+		throw LibavException();
+	}
+
+	// write the header
+	JournalHeader header;
+	memset(&header, 0, sizeof(header));
+	header.identifier = JOURNAL_IDENTIFIER;
+	header.version = JOURNAL_VERSION;
+	header.flags = (contiguous_packets)? JOURNAL_FLAG_CONTIGUOUS_PACKETS : 0;
+	CopyName(header.container_name, format_context->oformat->name);
+	header.stream_count = format_context->nb_streams;
+	header.data_start = avio_tell(format_context->pb);
+	m_buffer.insert(m_buffer.end(), (uint8_t*) &header, (uint8_t*) &header + sizeof(header));
+
+	// write the streams
+	for(unsigned int i = 0; i < format_context->nb_streams; ++i) {
+		AVStream *stream = format_context->streams[i];
+		AVCodecContext *codec_context = codec_contexts[i];
+		JournalStream info;
+		memset(&info, 0, sizeof(info));
+		info.type = (codec_context->codec_type == AVMEDIA_TYPE_VIDEO)? JOURNAL_STREAM_TYPE_VIDEO : JOURNAL_STREAM_TYPE_AUDIO;
+		CopyName(info.codec_name, avcodec_get_name(codec_context->codec_id));
+		info.time_base_num = stream->time_base.num;
+		info.time_base_den = stream->time_base.den;
+		if(codec_context->codec_type == AVMEDIA_TYPE_VIDEO) {
+			info.width = codec_context->width;
+			info.height = codec_context->height;
+			info.sample_aspect_ratio_num = codec_context->sample_aspect_ratio.num;
+			info.sample_aspect_ratio_den = codec_context->sample_aspect_ratio.den;
+			CopyName(info.pixel_format, av_get_pix_fmt_name(codec_context->pix_fmt));
+		} else {
+			info.sample_rate = codec_context->sample_rate;
+			info.channels = codec_context->channels;
+			info.frame_size = codec_context->frame_size;
+			CopyName(info.sample_format, av_get_sample_fmt_name(codec_context->sample_fmt));
+		}
+		info.bit_rate = codec_context->bit_rate;
+		info.extradata_size = (codec_context->extradata == NULL)? 0 : codec_context->extradata_size;
+		m_buffer.insert(m_buffer.end(), (uint8_t*) &info, (uint8_t*) &info + sizeof(info));
+		if(info.extradata_size != 0)
+			m_buffer.insert(m_buffer.end(), codec_context->extradata, codec_context->extradata + info.extradata_size);
+	}
+
+	// The header is written immediately so the journal is usable even if the recording stops right away.
+	if(!WriteBuffer())
+		throw LibavException();
+
+	Logger::LogInfo("[MuxerJournal::Init] " + Logger::tr("Writing recovery journal to '%1'.").arg(m_filename));
+
+}
+
+void MuxerJournal::Free() {
+	if(m_fd != -1) {
+		WriteBuffer();
+		if(m_fd != -1) {
+			close(m_fd);
+			m_fd = -1;
+		}
+	}
+	if(m_output_fd != -1) {
+		close(m_output_fd);
+		m_output_fd = -1;
+	}
+}
+
+bool MuxerJournal::WriteBuffer() {
+	size_t pos = 0;
+	while(pos < m_buffer.size()) {
+		ssize_t done = write(m_fd, m_buffer.data() + pos, m_buffer.size() - pos);
+		if(done < 0) {
+			if(errno == EINTR)
+				continue;
+			Logger::LogWarning("[MuxerJournal::WriteBuffer] " + Logger::tr("Warning: Can't write to journal file, the recording can't be recovered after a crash!"));
+			close(m_fd);
+			m_fd = -1;
+			m_buffer.clear();
+			return false;
+		}
+		pos += done;
+	}
+	m_buffer.clear();
+	return true;
+}
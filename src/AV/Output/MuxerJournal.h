@@ -0,0 +1,78 @@
+/*
+Copyright (c) 2012-2020 Maarten Baert <maarten-baert@hotmail.com>
+
+This file is part of SimpleScreenRecorder.
+
+SimpleScreenRecorder is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+SimpleScreenRecorder is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with SimpleScreenRecorder.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#pragma once
+#include "Global.h"
+
+#include "../recover/JournalStructs.h"
+
+// Writes the crash recovery journal for the muxer (see recover/JournalStructs.h).
+// Writing the journal never stops the recording: if an error occurs, a warning is logged and the journal is abandoned.
+class MuxerJournal {
+
+private:
+	static constexpr int64_t FLUSH_INTERVAL = 500000, SYNC_INTERVAL = 5000000;
+
+private:
+	QString m_filename;
+	int m_fd, m_output_fd;
+
+	std::vector<uint8_t> m_buffer;
+	int64_t m_next_flush_time, m_next_sync_time;
+
+public:
+	// Creates the journal. This should be called after the container header has been written.
+	MuxerJournal(const QString& filename, const QString& output_file, AVFormatContext* format_context, AVCodecContext** codec_contexts, bool contiguous_packets);
+	~MuxerJournal();
+
+	// Adds a packet record. This should be called right before the packet is written to the muxer, with the current position in the output file.
+	// The record is buffered until the next flush.
+	void BeginPacket(unsigned int stream_index, AVPacket* packet, uint64_t offset);
+
+	// Completes the last packet record. This should be called right after the packet was written, with the new position in the output file.
+	void EndPacket(uint64_t offset);
+
+	// Returns whether the journal should be flushed now.
+	bool IsFlushNeeded();
+
+	// Writes the buffered records to the journal file. The output file should be flushed first.
+	// Occasionally the output file and the journal are also synced to the disk, in that order.
+	void Flush();
+
+	// Closes and deletes the journal, this should be called when the output file has been finished successfully.
+	void Remove();
+
+	// Renames the journal, this should be called when the output file has been renamed. Returns false if this failed.
+	bool Rename(const QString& filename);
+
+public:
+	// Returns the name of the journal for a given output file.
+	static QString GetJournalFile(const QString& output_file);
+
+	// Returns whether the given libavformat muxer writes every packet as one contiguous block.
+	static bool HasContiguousPackets(const AVOutputFormat* format);
+
+private:
+	void Init(const QString& output_file, AVFormatContext* format_context, AVCodecContext** codec_contexts, bool contiguous_packets);
+	void Free();
+
+	bool WriteBuffer();
+
+};
@@ -20,6 +20,8 @@ along with SimpleScreenRecorder.  If not, see <http://www.gnu.org/licenses/>.
 #include "OutputManager.h"
 
 #include "Logger.h"
+#include "ThreadBudget.h"
+#include "ThreadWatchdog.h"
 
 const size_t OutputManager::THROTTLE_THRESHOLD_FRAMES = 20;
 const size_t OutputManager::THROTTLE_THRESHOLD_PACKETS = 100;
@@ -40,6 +42,9 @@ OutputManager::OutputManager(const OutputSettings& output_settings) {
 	m_fragmented = false;
 	m_fragment_length = 5;
 
+	m_degradation_level = 0;
+	m_frame_rate_divisor = 1;
+
 	// initialize shared data
 	{
 		SharedLock lock(&m_shared_data);
@@ -79,7 +84,14 @@ OutputManager::~OutputManager() {
 
 void OutputManager::Finish() {
 
-	// stop the synchronizer
+	// stop the synchronizers
+	// The additional video tracks use the segment timing of the main track, so they have to be stopped first.
+	for(std::unique_ptr<Synchronizer> &synchronizer : m_extra_synchronizers) {
+		if(synchronizer != NULL) {
+			synchronizer->NewSegment(); // needed to make sure that all data is sent to the encoders
+			synchronizer.reset();
+		}
+	}
 	if(m_synchronizer != NULL) {
 		m_synchronizer->NewSegment(); // needed to make sure that all data is sent to the encoders
 		m_synchronizer.reset();
@@ -106,10 +118,22 @@ bool OutputManager::IsFinished() {
 	}
 }
 
-void OutputManager::AddVideoFrame(std::unique_ptr<AVFrameWrapper> frame) {
+void OutputManager::NewSegment() {
+	// the additional video tracks use the segment timing of the main track, so they have to finish their segment first
+	for(std::unique_ptr<Synchronizer> &synchronizer : m_extra_synchronizers) {
+		synchronizer->NewSegment();
+	}
+	m_synchronizer->NewSegment();
+}
+
+void OutputManager::AddVideoFrame(std::unique_ptr<AVFrameWrapper> frame, unsigned int video_track) {
 	assert(frame->GetFrame()->pts != (int64_t) AV_NOPTS_VALUE);
 	SharedLock lock(&m_shared_data);
-	if(m_fragmented) {
+	if(video_track != 0) {
+		// additional video tracks are never fragmented
+		assert(video_track <= lock->m_extra_video_encoders.size());
+		lock->m_extra_video_encoders[video_track - 1]->AddFrame(std::move(frame));
+	} else if(m_fragmented) {
 		int64_t fragment_begin = m_fragment_length * m_output_format.m_video_frame_rate * (lock->m_fragment_number - 1);
 		int64_t fragment_end = m_fragment_length * m_output_format.m_video_frame_rate * lock->m_fragment_number;
 		if(frame->GetFrame()->pts < fragment_end) {
@@ -144,14 +168,20 @@ void OutputManager::AddAudioFrame(std::unique_ptr<AVFrameWrapper> frame) {
 	}
 }
 
-int64_t OutputManager::GetVideoFrameDelay() {
+int64_t OutputManager::GetVideoFrameDelay(unsigned int video_track) {
 	unsigned int frames = 0, packets = 0;
 	{
 		SharedLock lock(&m_shared_data);
-		frames += lock->m_video_frame_queue.size();
-		if(lock->m_video_encoder != NULL) {
-			frames += lock->m_video_encoder->GetQueuedFrameCount();
-			packets += lock->m_video_encoder->GetQueuedPacketCount();
+		VideoEncoder *video_encoder = NULL;
+		if(video_track == 0) {
+			frames += lock->m_video_frame_queue.size();
+			video_encoder = lock->m_video_encoder;
+		} else if(video_track <= lock->m_extra_video_encoders.size()) {
+			video_encoder = lock->m_extra_video_encoders[video_track - 1];
+		}
+		if(video_encoder != NULL) {
+			frames += video_encoder->GetQueuedFrameCount();
+			packets += video_encoder->GetQueuedPacketCount();
 		}
 	}
 	int64_t interval = 0;
@@ -168,11 +198,58 @@ int64_t OutputManager::GetVideoFrameDelay() {
 	return interval;
 }
 
+unsigned int OutputManager::GetQueuedAudioFrameCount() {
+	SharedLock lock(&m_shared_data);
+	unsigned int frames = lock->m_audio_frame_queue.size();
+	if(lock->m_audio_encoder != NULL)
+		frames += lock->m_audio_encoder->GetQueuedFrameCount();
+	return frames;
+}
+
+void OutputManager::UpdateDegradation() {
+
+	if(m_degradation_controller == NULL)
+		return;
+
+	// measure the load of the main video encoder
+	unsigned int queued_frames;
+	int64_t encode_time;
+	{
+		SharedLock lock(&m_shared_data);
+		if(lock->m_video_encoder == NULL)
+			return;
+		queued_frames = lock->m_video_frame_queue.size() + lock->m_video_encoder->GetQueuedFrameCount();
+		encode_time = lock->m_video_encoder->GetTotalEncodeTime();
+	}
+	unsigned int old_level = m_degradation_controller->GetLevel();
+	if(!m_degradation_controller->Update(hrt_time_micro(), queued_frames, encode_time))
+		return;
+
+	// apply the new level, the synchronizers of all video tracks use the same frame rate divisor
+	unsigned int level = m_degradation_controller->GetLevel();
+	const DegradationController::Level &settings = m_degradation_controller->GetCurrentLevel();
+	if(level > old_level) {
+		Logger::LogWarning("[OutputManager::UpdateDegradation] " + Logger::tr("Warning: The encoder can't keep up (busy %1%, %2 frames queued), reducing the quality to level %3 of %4 (%5).")
+						   .arg((unsigned int) lrint(m_degradation_controller->GetBusyFraction() * 100.0)).arg(queued_frames)
+						   .arg(level).arg(m_degradation_controller->GetLevelCount() - 1).arg(DegradationController::LevelToString(settings)));
+	} else {
+		Logger::LogInfo("[OutputManager::UpdateDegradation] " + Logger::tr("The encoder load has decreased (busy %1%), increasing the quality to level %2 of %3 (%4).")
+						.arg((unsigned int) lrint(m_degradation_controller->GetBusyFraction() * 100.0))
+						.arg(level).arg(m_degradation_controller->GetLevelCount() - 1).arg(DegradationController::LevelToString(settings)));
+	}
+	m_degradation_level = level;
+	m_frame_rate_divisor = settings.m_frame_rate_divisor;
+
+}
+
 unsigned int OutputManager::GetTotalQueuedFrameCount() {
 	SharedLock lock(&m_shared_data);
 	unsigned int frames = lock->m_video_frame_queue.size();
 	if(lock->m_video_encoder != NULL)
 		frames += lock->m_video_encoder->GetQueuedFrameCount() + lock->m_video_encoder->GetFrameLatency();
+	for(VideoEncoder *video_encoder : lock->m_extra_video_encoders) {
+		frames += video_encoder->GetQueuedFrameCount() + video_encoder->GetFrameLatency();
+	}
 	return frames;
 }
 
@@ -190,6 +267,15 @@ double OutputManager::GetActualBitRate() {
 	return lock->m_muxer->GetActualBitRate();
 }
 
+bool OutputManager::RenameOutputFile(const QString& new_file) {
+	if(m_fragmented)
+		return false;
+	SharedLock lock(&m_shared_data);
+	if(lock->m_muxer == NULL)
+		return false;
+	return lock->m_muxer->RenameOutputFile(new_file);
+}
+
 uint64_t OutputManager::GetTotalBytes() {
 	SharedLock lock(&m_shared_data);
 	if(lock->m_muxer == NULL)
@@ -197,8 +283,31 @@ uint64_t OutputManager::GetTotalBytes() {
 	return lock->m_muxer->GetTotalBytes();
 }
 
+int64_t OutputManager::GetFirstVideoPacketTime() {
+	SharedLock lock(&m_shared_data);
+	if(lock->m_muxer == NULL)
+		return AV_NOPTS_VALUE;
+	return lock->m_muxer->GetFirstVideoPacketTime();
+}
+
 void OutputManager::Init() {
 
+	// the fragment queues only support a single video track
+	if(m_fragmented && !m_output_settings.video_extra_tracks.empty()) {
+		Logger::LogError("[OutputManager::Init] " + Logger::tr("Error: Additional video tracks can't be used with fragmented output!"));
+		throw LibavException();
+	}
+
+	// create the degradation controller
+	if(!m_output_settings.video_degradation_ladder.isEmpty() && !m_output_settings.video_codec_avname.isEmpty()) {
+		std::vector<DegradationController::Level> ladder = DegradationController::ParseLadder(m_output_settings.video_degradation_ladder);
+		if(ladder.size() < 2) {
+			Logger::LogError("[OutputManager::Init] " + Logger::tr("Error: The degradation ladder is not valid!"));
+			throw LibavException();
+		}
+		m_degradation_controller.reset(new DegradationController(ladder));
+	}
+
 	// start muxer and encoders
 	StartFragment();
 
@@ -225,10 +334,22 @@ void OutputManager::Init() {
 		} else {
 			m_output_format.m_audio_enabled = false;
 		}
+		for(VideoEncoder *video_encoder : lock->m_extra_video_encoders) {
+			OutputFormat output_format = m_output_format;
+			output_format.m_video_width = video_encoder->GetWidth();
+			output_format.m_video_height = video_encoder->GetHeight();
+			output_format.m_video_pixel_format = video_encoder->GetPixelFormat();
+			output_format.m_video_colorspace = video_encoder->GetColorSpace();
+			output_format.m_audio_enabled = false; // audio is only added to the main track
+			m_extra_output_formats.push_back(output_format);
+		}
 	}
 
-	// start synchronizer
+	// start synchronizers
 	m_synchronizer.reset(new Synchronizer(this));
+	for(unsigned int i = 0; i < m_extra_output_formats.size(); ++i) {
+		m_extra_synchronizers.emplace_back(new Synchronizer(this, i + 1));
+	}
 
 	// start fragment thread
 	if(m_fragmented) {
@@ -239,7 +360,8 @@ void OutputManager::Init() {
 
 void OutputManager::Free() {
 
-	// stop the synchronizer
+	// stop the synchronizers (the main track last, see Finish)
+	m_extra_synchronizers.clear();
 	m_synchronizer.reset();
 
 	// stop the encoders and muxers
@@ -247,6 +369,7 @@ void OutputManager::Free() {
 		SharedLock lock(&m_shared_data);
 		lock->m_video_encoder = NULL; // deleted by muxer
 		lock->m_audio_encoder = NULL; // deleted by muxer
+		lock->m_extra_video_encoders.clear(); // deleted by muxer
 		lock->m_muxer.reset();
 	}
 
@@ -269,15 +392,34 @@ void OutputManager::StartFragment() {
 	} else {
 		filename = m_output_settings.file;
 	}
-	std::unique_ptr<Muxer> muxer(new Muxer(m_output_settings.container_avname, filename));
+	// all video encoders share the thread budget, unless the user has chosen the number of threads
+	std::vector<std::pair<QString, QString> > video_options = m_output_settings.video_options;
+	bool has_threads = false;
+	for(const std::pair<QString, QString> &option : video_options) {
+		if(option.first == "threads")
+			has_threads = true;
+	}
+	if(!has_threads) {
+		unsigned int threads = ThreadBudget::GetVideoEncoderThreads(1 + m_output_settings.video_extra_tracks.size());
+		video_options.emplace_back("threads", QString::number(threads));
+	}
+
+	std::unique_ptr<Muxer> muxer(new Muxer(m_output_settings.container_avname, filename, m_output_settings.recovery_journal));
 	VideoEncoder *video_encoder = NULL;
 	AudioEncoder *audio_encoder = NULL;
 	if(!m_output_settings.video_codec_avname.isEmpty())
-		video_encoder = muxer->AddVideoEncoder(m_output_settings.video_codec_avname, m_output_settings.video_options, m_output_settings.video_kbit_rate * 1000,
+		video_encoder = muxer->AddVideoEncoder(m_output_settings.video_codec_avname, video_options, m_output_settings.video_kbit_rate * 1000,
 											   m_output_settings.video_width, m_output_settings.video_height, m_output_settings.video_frame_rate);
 	if(!m_output_settings.audio_codec_avname.isEmpty())
 		audio_encoder = muxer->AddAudioEncoder(m_output_settings.audio_codec_avname, m_output_settings.audio_options, m_output_settings.audio_kbit_rate * 1000,
 											   m_output_settings.audio_channels, m_output_settings.audio_sample_rate);
+	std::vector<VideoEncoder*> extra_video_encoders;
+	if(video_encoder != NULL) {
+		for(const std::pair<unsigned int, unsigned int> &track : m_output_settings.video_extra_tracks) {
+			extra_video_encoders.push_back(muxer->AddVideoEncoder(m_output_settings.video_codec_avname, video_options, m_output_settings.video_kbit_rate * 1000,
+																  track.first, track.second, m_output_settings.video_frame_rate));
+		}
+	}
 	muxer->Start();
 
 	// acquire lock and share the muxer and encoders
@@ -285,6 +427,7 @@ void OutputManager::StartFragment() {
 	lock->m_muxer = std::move(muxer);
 	lock->m_video_encoder = video_encoder;
 	lock->m_audio_encoder = audio_encoder;
+	lock->m_extra_video_encoders = std::move(extra_video_encoders);
 
 	// increment fragment number
 	// It's important that this is done here (i.e. after the encoders have been set up), because the fragment number
@@ -326,6 +469,7 @@ void OutputManager::StopFragment() {
 		muxer = std::move(lock->m_muxer);
 		lock->m_video_encoder = NULL; // deleted by muxer
 		lock->m_audio_encoder = NULL; // deleted by muxer
+		lock->m_extra_video_encoders.clear(); // deleted by muxer
 	}
 
 	// wait until the muxer is finished
@@ -333,6 +477,7 @@ void OutputManager::StopFragment() {
 	assert(muxer != NULL);
 	muxer->Finish();
 	while(!muxer->IsDone() && !muxer->HasErrorOccurred()) {
+		ThreadHeartbeat::BeatCurrentThread("wait for muxer"); // if the muxer is stuck, its own heartbeat will show it
 		usleep(200000);
 	}
 
@@ -346,9 +491,12 @@ void OutputManager::FragmentThread() {
 
 		Logger::LogInfo("[OutputManager::FragmentThread] " + Logger::tr("Fragment thread started."));
 
+		ThreadHeartbeat heartbeat("OutputManager");
+
 		while(!m_should_stop) {
 
 			// should we start a new fragment?
+			heartbeat.Beat("wait");
 			bool finishing = m_should_finish, next_fragment = false;
 			{
 				SharedLock lock(&m_shared_data);
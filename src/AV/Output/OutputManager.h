@@ -25,6 +25,7 @@ along with SimpleScreenRecorder.  If not, see <http://www.gnu.org/licenses/>.
 #include "AudioEncoder.h"
 #include "Synchronizer.h"
 #include "OutputSettings.h"
+#include "DegradationController.h"
 
 class OutputManager {
 
@@ -40,6 +41,7 @@ private:
 		std::unique_ptr<Muxer> m_muxer;
 		VideoEncoder *m_video_encoder;
 		AudioEncoder *m_audio_encoder;
+		std::vector<VideoEncoder*> m_extra_video_encoders;
 
 	};
 	typedef MutexDataPair<SharedData>::Lock SharedLock;
@@ -50,11 +52,16 @@ private:
 private:
 	OutputSettings m_output_settings;
 	OutputFormat m_output_format;
+	std::vector<OutputFormat> m_extra_output_formats;
 
 	bool m_fragmented;
 	int64_t m_fragment_length;
 
 	std::unique_ptr<Synchronizer> m_synchronizer;
+	std::vector<std::unique_ptr<Synchronizer> > m_extra_synchronizers;
+
+	std::unique_ptr<DegradationController> m_degradation_controller; // only used by the synchronizer thread of the main track
+	std::atomic<unsigned int> m_degradation_level, m_frame_rate_divisor;
 
 	std::thread m_thread;
 	MutexDataPair<SharedData> m_shared_data;
@@ -71,9 +78,12 @@ public:
 	// Returns whether the encoders and muxer have finished.
 	bool IsFinished();
 
-	// Adds a video frame to the frame queue. Called by the synchronizer.
+	// Starts a new segment in the synchronizers of all video tracks, see Synchronizer::NewSegment.
+	void NewSegment();
+
+	// Adds a video frame to the frame queue of a video track. Track 0 is the main video track. Called by the synchronizer.
 	// This function is thread-safe.
-	void AddVideoFrame(std::unique_ptr<AVFrameWrapper> frame);
+	void AddVideoFrame(std::unique_ptr<AVFrameWrapper> frame, unsigned int video_track = 0);
 
 	// Adds an audio frame to the frame queue. Called by the synchronizer.
 	// This function is thread-safe.
@@ -82,7 +92,25 @@ public:
 	// Returns an additional delay (in us) between frames, based on the queue size, to avoid memory problems.
 	// As long as the queues are relatively small, this function will just return 0.
 	// This function is thread-safe.
-	int64_t GetVideoFrameDelay();
+	int64_t GetVideoFrameDelay(unsigned int video_track = 0);
+
+	// Returns the number of audio frames that are waiting to be encoded. Used by the synchronizer in audio-only mode.
+	// This function is thread-safe.
+	unsigned int GetQueuedAudioFrameCount();
+
+	// Checks the load of the video encoder and reduces or restores the quality if needed. Called by the synchronizer of the main track.
+	void UpdateDegradation();
+
+	// Returns the current level of the degradation controller (0 is the normal quality).
+	// This function is thread-safe and lock-free.
+	inline unsigned int GetDegradationLevel() { return m_degradation_level; }
+
+	// Returns the current frame rate divisor, only one out of every N frames should be captured.
+	// This function is thread-safe and lock-free.
+	inline unsigned int GetFrameRateDivisor() { return m_frame_rate_divisor; }
+
+	// Renames the output file, see Muxer::RenameOutputFile. Fragmented output can't be renamed.
+	bool RenameOutputFile(const QString& new_file);
 
 	// Returns the total number of frames in the queue.
 	// This function is thread-safe.
@@ -100,6 +128,11 @@ public:
 	// This function is thread-safe.
 	uint64_t GetTotalBytes();
 
+	// Returns the time at which the first video packet was written to the output, see Muxer::GetFirstVideoPacketTime.
+	// With fragmented output, this is the first video packet of the current fragment.
+	// This function is thread-safe.
+	int64_t GetFirstVideoPacketTime();
+
 private:
 	void Init();
 	void Free();
@@ -112,6 +145,9 @@ private:
 public:
 	inline const OutputSettings* GetOutputSettings() { return &m_output_settings; }
 	inline const OutputFormat* GetOutputFormat() { return &m_output_format; }
+	inline const OutputFormat* GetOutputFormat(unsigned int video_track) { return (video_track == 0)? &m_output_format : &m_extra_output_formats[video_track - 1]; }
 	inline Synchronizer* GetSynchronizer() { return m_synchronizer.get(); }
+	inline Synchronizer* GetSynchronizer(unsigned int video_track) { return (video_track == 0)? m_synchronizer.get() : m_extra_synchronizers[video_track - 1].get(); }
+	inline unsigned int GetVideoTrackCount() { return 1 + m_extra_synchronizers.size(); }
 
 };
@@ -24,6 +24,7 @@ struct OutputSettings {
 
 	QString file;
 	QString container_avname;
+	bool recovery_journal; // write a journal next to the output file so it can be recovered after a crash (only for local files)
 
 	QString video_codec_avname;
 	unsigned int video_kbit_rate;
@@ -31,11 +32,14 @@ struct OutputSettings {
 	unsigned int video_width, video_height;
 	unsigned int video_frame_rate;
 	bool video_allow_frame_skipping;
+	std::vector<std::pair<unsigned int, unsigned int> > video_extra_tracks; // width and height of each additional video track
+	QString video_degradation_ladder; // steps for the degradation controller, empty to disable it
 
 	QString audio_codec_avname;
 	unsigned int audio_kbit_rate;
 	std::vector<std::pair<QString, QString> > audio_options;
 	unsigned int audio_channels, audio_sample_rate;
+	bool audio_fast_path; // if video is disabled, send complete audio frames to the encoder directly instead of using the synchronizer thread
 
 };
 
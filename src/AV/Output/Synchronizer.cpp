@@ -26,11 +26,17 @@ along with SimpleScreenRecorder.  If not, see <http://www.gnu.org/licenses/>.
 #include "VideoEncoder.h"
 #include "AudioEncoder.h"
 #include "SampleCast.h"
+#include "FrameAccounting.h"
 #include "SyncDiagram.h"
 
-// The amount of filtering applied to audio timestamps to reduce noise. Higher values reduce timestamp noise (and associated drift correction),
-// but if the value is too high, it will take more time to detect gaps.
-const int64_t Synchronizer::AUDIO_TIMESTAMP_FILTER = 20;
+// The amount of filtering applied to audio timestamps to reduce noise. The timestamps are fitted to the number of samples received
+// (see DriftEstimator), the time constant determines how long old timestamps are remembered. Higher values reduce timestamp noise
+// (and associated drift correction), but if the value is too high, it will take more time to adapt when the speed of the audio clock changes.
+// Timestamps that don't match the fit are ignored, unless it happens several times in a row. This way a single late timestamp
+// (e.g. because the input thread wasn't scheduled in time) is ignored, while real gaps are still detected quickly.
+const double Synchronizer::AUDIO_TIMESTAMP_TIME_CONSTANT = 10.0;
+const double Synchronizer::AUDIO_TIMESTAMP_MAX_ERROR = 0.02;
+const unsigned int Synchronizer::AUDIO_TIMESTAMP_MAX_OUTLIERS = 5;
 
 // These values change how fast the synchronizer does drift correction.
 // If this value is too low, the error will not be corrected fast enough. But if the value is too high, the audio
@@ -51,12 +57,23 @@ const double Synchronizer::DRIFT_ERROR_THRESHOLD = 0.05;
 // The maximum block size for drift correction, in seconds. This is needed to avoid numerical problems in the feedback system.
 const double Synchronizer::DRIFT_MAX_BLOCK = 0.5;
 
+// The maximum drift correction that can be done without the resampler. When the input and output sample rates are the same, the resampler
+// is bypassed and drift is corrected by occasionally dropping or inserting a sample (see SampleSlipper), which is a lot faster.
+// This only sounds good for small corrections, if the correction is larger the synchronizer switches to the resampler for the rest of the segment.
+const double Synchronizer::BYPASS_MAX_DRIFT_CORRECTION = 0.002;
+
 // The maximum number of video frames and audio samples that will be buffered. This should be enough to cope with the fact that video and
 // audio don't arrive at the same time, but not too high because that would cause memory problems if one of the inputs fails.
 // The limit for audio can be set very high, because audio uses almost no memory.
 const size_t Synchronizer::MAX_VIDEO_FRAMES_BUFFERED = 30;
 const size_t Synchronizer::MAX_AUDIO_SAMPLES_BUFFERED = 1000000;
 
+// The number of audio samples waiting to be processed at which the audio is considered backlogged (see IsAudioBacklogged).
+// Normally these are the samples in the audio buffer of the synchronizer. With the audio fast path the audio buffer never fills up
+// because the samples are sent to the encoder immediately, so the samples in the encoder queue (frames times frame size) are counted instead.
+// The same limit is used in both cases, so file inputs are throttled at the same point regardless of the path the audio takes.
+const size_t Synchronizer::AUDIO_BACKLOG_SAMPLES = MAX_AUDIO_SAMPLES_BUFFERED / 2;
+
 // The maximum delay between video frames, in microseconds. If the delay is longer, duplicates will be inserted.
 // This is needed because some video codecs/players can't handle long delays.
 const int64_t Synchronizer::MAX_FRAME_DELAY = 200000;
@@ -193,11 +210,12 @@ static std::unique_ptr<AVFrameWrapper> CreateAudioFrame(unsigned int channels, u
 
 }
 
-Synchronizer::Synchronizer(OutputManager *output_manager) {
+Synchronizer::Synchronizer(OutputManager *output_manager, unsigned int video_track) {
 
 	m_output_manager = output_manager;
 	m_output_settings = m_output_manager->GetOutputSettings();
-	m_output_format = m_output_manager->GetOutputFormat();
+	m_output_format = m_output_manager->GetOutputFormat(video_track);
+	m_video_track = video_track;
 	assert(m_output_format->m_video_enabled || m_output_format->m_audio_enabled);
 
 	try {
@@ -241,18 +259,25 @@ void Synchronizer::Init() {
 		VideoLock videolock(&m_video_data);
 		videolock->m_last_timestamp = std::numeric_limits<int64_t>::min();
 		videolock->m_next_timestamp = SINK_TIMESTAMP_ASAP;
+		videolock->m_count_missed_frames = false;
 	}
 
+	// Without video there is nothing to synchronize, so the synchronizer thread isn't needed. The audio input sends complete frames
+	// to the encoder directly, which means that the encoder is only woken up when there is a new frame.
+	m_audio_fast_path = (!m_output_format->m_video_enabled && m_output_settings->audio_fast_path);
+
 	// initialize audio
 	if(m_output_format->m_audio_enabled) {
 		AudioLock audiolock(&m_audio_data);
 		audiolock->m_fast_resampler.reset(new FastResampler(m_output_format->m_audio_channels, 0.9f));
+		audiolock->m_sample_slipper.reset(new SampleSlipper(m_output_format->m_audio_channels, 0.9f));
+		audiolock->m_drift_estimator.reset(new DriftEstimator(AUDIO_TIMESTAMP_TIME_CONSTANT, AUDIO_TIMESTAMP_MAX_ERROR, AUDIO_TIMESTAMP_MAX_OUTLIERS));
 		InitAudioSegment(audiolock.get());
 		audiolock->m_warn_desync = true;
 	}
 
 	// create sync diagram
-	if(CommandLineOptions::GetSyncDiagram()) {
+	if(CommandLineOptions::GetSyncDiagram() && m_video_track == 0) {
 		m_sync_diagram.reset(new SyncDiagram(4));
 		m_sync_diagram->SetChannelName(0, SyncDiagram::tr("Video in"));
 		m_sync_diagram->SetChannelName(1, SyncDiagram::tr("Audio in"));
@@ -282,7 +307,12 @@ void Synchronizer::Init() {
 	// start synchronizer thread
 	m_should_stop = false;
 	m_error_occurred = false;
-	m_thread = std::thread(&Synchronizer::SynchronizerThread, this);
+	if(m_audio_fast_path) {
+		m_fast_path_flush.m_audio_frames = 0;
+		Logger::LogInfo("[Synchronizer::Init] " + Logger::tr("Video is disabled, using the audio fast path."));
+	} else {
+		m_thread = std::thread(&Synchronizer::SynchronizerThread, this);
+	}
 
 }
 
@@ -292,6 +322,12 @@ void Synchronizer::Free() {
 
 void Synchronizer::NewSegment() {
 
+	// the input is disconnected while the recording is paused, so the gap before the next frame doesn't mean that frames were missed
+	if(m_output_format->m_video_enabled) {
+		VideoLock videolock(&m_video_data);
+		videolock->m_count_missed_frames = false;
+	}
+
 	if(m_output_format->m_audio_enabled) {
 		AudioLock audiolock(&m_audio_data);
 		InitAudioSegment(audiolock.get());
@@ -307,12 +343,38 @@ int64_t Synchronizer::GetTotalTime() {
 	return GetTotalTime(lock.get());
 }
 
+int64_t Synchronizer::GetSegmentFirstTimestamp() {
+	SharedLock lock(&m_shared_data);
+	return lock->m_segment_first_timestamp;
+}
+
+bool Synchronizer::GetSegmentTiming(int64_t* time_offset, int64_t* segment_start_time, int64_t* segment_stop_time) {
+	SharedLock lock(&m_shared_data);
+	if(!lock->m_segment_video_started || !lock->m_segment_audio_started)
+		return false;
+	*time_offset = lock->m_time_offset;
+	GetSegmentStartStop(lock.get(), segment_start_time, segment_stop_time);
+	return true;
+}
+
 int64_t Synchronizer::GetNextVideoTimestamp() {
 	assert(m_output_format->m_video_enabled);
 	VideoLock videolock(&m_video_data);
 	return videolock->m_next_timestamp;
 }
 
+bool Synchronizer::IsVideoBacklogged() {
+	assert(m_output_format->m_video_enabled);
+	// Only half of the buffer is used, so there is still room for frames that arrive while the source is waiting.
+	// The buffer also fills up when the audio is behind, so this keeps the video and audio sources at the same pace.
+	{
+		SharedLock lock(&m_shared_data);
+		if(lock->m_video_buffer.size() >= MAX_VIDEO_FRAMES_BUFFERED / 2)
+			return true;
+	}
+	return (m_output_manager->GetVideoFrameDelay(m_video_track) != 0);
+}
+
 void Synchronizer::ReadVideoFrame(unsigned int width, unsigned int height, const uint8_t* data, int stride, AVPixelFormat format, int colorspace, int64_t timestamp) {
 	assert(m_output_format->m_video_enabled);
 
@@ -330,12 +392,20 @@ void Synchronizer::ReadVideoFrame(unsigned int width, unsigned int height, const
 	}
 
 	// drop the frame if it is too early (before converting it)
-	if(videolock->m_next_timestamp != SINK_TIMESTAMP_ASAP && timestamp < videolock->m_next_timestamp - (int64_t) (1000000 / m_output_format->m_video_frame_rate))
+	if(videolock->m_next_timestamp != SINK_TIMESTAMP_ASAP && timestamp < videolock->m_next_timestamp - (int64_t) (1000000 / m_output_format->m_video_frame_rate)) {
+		if(m_video_track == 0)
+			FrameAccounting::Add(FrameAccounting::REASON_SYNC_TOO_EARLY);
 		return;
+	}
 
 	// update the timestamps
+	// When the degradation controller has reduced the frame rate, frames are requested less often and the gaps are filled later.
+	int64_t frame_interval = (int64_t) (1000000 / m_output_format->m_video_frame_rate) * (int64_t) m_output_manager->GetFrameRateDivisor();
+	if(m_video_track == 0 && videolock->m_count_missed_frames && videolock->m_next_timestamp != SINK_TIMESTAMP_ASAP && timestamp >= videolock->m_next_timestamp + frame_interval)
+		FrameAccounting::Add(FrameAccounting::REASON_INPUT_MISSED, (timestamp - videolock->m_next_timestamp) / frame_interval);
+	videolock->m_count_missed_frames = true;
 	videolock->m_last_timestamp = timestamp;
-	videolock->m_next_timestamp = std::max(videolock->m_next_timestamp + (int64_t) (1000000 / m_output_format->m_video_frame_rate), timestamp);
+	videolock->m_next_timestamp = std::max(videolock->m_next_timestamp + frame_interval, timestamp);
 
 	// create the converted frame
 	std::unique_ptr<AVFrameWrapper> converted_frame = CreateVideoFrame(m_output_format->m_video_width, m_output_format->m_video_height, m_output_format->m_video_pixel_format, NULL);
@@ -349,7 +419,10 @@ void Synchronizer::ReadVideoFrame(unsigned int width, unsigned int height, const
 
 	// avoid memory problems by limiting the video buffer size
 	if(lock->m_video_buffer.size() >= MAX_VIDEO_FRAMES_BUFFERED) {
-		if(lock->m_segment_audio_started) {
+		if(m_video_track == 0)
+			FrameAccounting::Add(FrameAccounting::REASON_SYNC_OVERFLOW);
+		// Additional video tracks may have to wait for the main track to start, in that case the oldest frames are dropped as well.
+		if(lock->m_segment_audio_started && m_video_track == 0) {
 			if(lock->m_warn_drop_video) {
 				lock->m_warn_drop_video = false;
 				Logger::LogWarning("[Synchronizer::ReadVideoFrame] " + Logger::tr("Warning: Video buffer overflow, some frames will be lost. The audio input seems to be too slow."));
@@ -368,6 +441,8 @@ void Synchronizer::ReadVideoFrame(unsigned int width, unsigned int height, const
 		lock->m_segment_video_started = true;
 		lock->m_segment_video_start_time = timestamp;
 		lock->m_segment_video_stop_time = timestamp;
+		if(lock->m_segment_first_timestamp == AV_NOPTS_VALUE)
+			lock->m_segment_first_timestamp = timestamp;
 	}
 
 	// store the frame
@@ -375,7 +450,7 @@ void Synchronizer::ReadVideoFrame(unsigned int width, unsigned int height, const
 	lock->m_video_buffer.push_back(std::move(converted_frame));
 
 	// increase the segment stop time
-	lock->m_segment_video_stop_time = timestamp + (int64_t) (1000000 / m_output_format->m_video_frame_rate);
+	lock->m_segment_video_stop_time = timestamp + frame_interval;
 
 }
 
@@ -393,6 +468,14 @@ void Synchronizer::ReadVideoPing(int64_t timestamp) {
 
 }
 
+bool Synchronizer::IsAudioBacklogged() {
+	assert(m_output_format->m_audio_enabled);
+	if(m_audio_fast_path)
+		return ((size_t) m_output_manager->GetQueuedAudioFrameCount() * (size_t) m_output_format->m_audio_frame_size >= AUDIO_BACKLOG_SAMPLES);
+	SharedLock lock(&m_shared_data);
+	return (lock->m_audio_buffer.GetSize() / m_output_format->m_audio_channels >= AUDIO_BACKLOG_SAMPLES);
+}
+
 void Synchronizer::ReadAudioSamples(unsigned int channels, unsigned int sample_rate, AVSampleFormat format, unsigned int sample_count, const uint8_t* data, int64_t timestamp) {
 	assert(m_output_format->m_audio_enabled);
 
@@ -416,7 +499,6 @@ void Synchronizer::ReadAudioSamples(unsigned int channels, unsigned int sample_r
 	// update the timestamps
 	int64_t previous_timestamp;
 	if(audiolock->m_first_timestamp == (int64_t) AV_NOPTS_VALUE) {
-		audiolock->m_filtered_timestamp = timestamp;
 		audiolock->m_first_timestamp = timestamp;
 		previous_timestamp = timestamp;
 	} else {
@@ -425,8 +507,12 @@ void Synchronizer::ReadAudioSamples(unsigned int channels, unsigned int sample_r
 	audiolock->m_last_timestamp = timestamp;
 
 	// filter the timestamp
-	int64_t timestamp_delta = (int64_t) sample_count * (int64_t) 1000000 / (int64_t) sample_rate;
-	audiolock->m_filtered_timestamp += (timestamp - audiolock->m_filtered_timestamp) / AUDIO_TIMESTAMP_FILTER;
+	double input_position = audiolock->m_input_position;
+	double input_time = (double) (timestamp - audiolock->m_first_timestamp) * 1.0e-6;
+	double input_length = (double) sample_count / (double) sample_rate;
+	audiolock->m_input_position += input_length;
+	audiolock->m_drift_estimator->AddPoint(input_position, input_time, input_length);
+	audiolock->m_filtered_timestamp = audiolock->m_first_timestamp + (int64_t) round(audiolock->m_drift_estimator->GetTime(input_position) * 1.0e6);
 
 	// calculate drift
 	double current_drift = GetAudioDrift(audiolock.get());
@@ -445,6 +531,8 @@ void Synchronizer::ReadAudioSamples(unsigned int channels, unsigned int sample_r
 
 	// reset filter and recalculate drift if necessary
 	if(audiolock->m_drop_samples || audiolock->m_insert_samples) {
+		audiolock->m_drift_estimator->Reset();
+		audiolock->m_drift_estimator->AddPoint(input_position, input_time, input_length);
 		audiolock->m_filtered_timestamp = timestamp;
 		current_drift = GetAudioDrift(audiolock.get());
 	}
@@ -474,6 +562,12 @@ void Synchronizer::ReadAudioSamples(unsigned int channels, unsigned int sample_r
 
 	}
 
+	// the resampler can only be bypassed if the sample rates match
+	if(audiolock->m_resampler_bypass && sample_rate != m_output_format->m_audio_sample_rate) {
+		audiolock->m_resampler_bypass = false;
+		audiolock->m_fast_resampler.reset(new FastResampler(m_output_format->m_audio_channels, 0.9f));
+	}
+
 	// insert zeros
 	unsigned int sample_count_out = 0;
 	if(audiolock->m_insert_samples) {
@@ -484,10 +578,16 @@ void Synchronizer::ReadAudioSamples(unsigned int channels, unsigned int sample_r
 		if(n > 0) {
 
 			// insert zeros
-			audiolock->m_temp_input_buffer.Alloc(n * m_output_format->m_audio_channels);
-			std::fill_n(audiolock->m_temp_input_buffer.GetData(), n * m_output_format->m_audio_channels, 0.0f);
-			sample_count_out = audiolock->m_fast_resampler->Resample((double) sample_rate / (double) m_output_format->m_audio_sample_rate, 1.0,
-																	 audiolock->m_temp_input_buffer.GetData(), n, &audiolock->m_temp_output_buffer, sample_count_out);
+			if(audiolock->m_resampler_bypass) {
+				audiolock->m_temp_output_buffer.Alloc(n * m_output_format->m_audio_channels);
+				std::fill_n(audiolock->m_temp_output_buffer.GetData(), n * m_output_format->m_audio_channels, 0.0f);
+				sample_count_out = n;
+			} else {
+				audiolock->m_temp_input_buffer.Alloc(n * m_output_format->m_audio_channels);
+				std::fill_n(audiolock->m_temp_input_buffer.GetData(), n * m_output_format->m_audio_channels, 0.0f);
+				sample_count_out = audiolock->m_fast_resampler->Resample((double) sample_rate / (double) m_output_format->m_audio_sample_rate, 1.0,
+																		 audiolock->m_temp_input_buffer.GetData(), n, &audiolock->m_temp_output_buffer, sample_count_out);
+			}
 
 			// recalculate drift
 			current_drift = GetAudioDrift(audiolock.get(), sample_count_out);
@@ -496,16 +596,13 @@ void Synchronizer::ReadAudioSamples(unsigned int channels, unsigned int sample_r
 
 	}
 
-	// increase filtered timestamp
-	audiolock->m_filtered_timestamp += timestamp_delta;
-
 	// do drift correction
 	// The point of drift correction is to keep video and audio in sync even when the clocks are not running at exactly the same speed.
 	// This can happen because the sample rate of the sound card is not always 100% accurate. Even a 0.1% error will result in audio that is
 	// seconds too early or too late at the end of a one hour video. This problem doesn't occur on all computers though (I'm not sure why).
 	// Another cause of desynchronization is problems/glitches with PulseAudio (e.g. jumps in time when switching between sources).
-	double drift_correction_dt = fmin((double) (timestamp - previous_timestamp) * 1.0e-6, DRIFT_MAX_BLOCK);
-	audiolock->m_average_drift = clamp(audiolock->m_average_drift + DRIFT_CORRECTION_I * current_drift * drift_correction_dt, -0.5, 0.5);
+	double length = (double) sample_count / (double) sample_rate;
+	double drift_correction = UpdateDriftCorrection(&audiolock->m_average_drift, current_drift, (double) (timestamp - previous_timestamp) * 1.0e-6, length);
 	if(audiolock->m_average_drift < -0.02 && audiolock->m_warn_desync) {
 		audiolock->m_warn_desync = false;
 		Logger::LogWarning("[Synchronizer::ReadAudioSamples] " + Logger::tr("Warning: Audio input is more than 2% too slow!"));
@@ -514,8 +611,6 @@ void Synchronizer::ReadAudioSamples(unsigned int channels, unsigned int sample_r
 		audiolock->m_warn_desync = false;
 		Logger::LogWarning("[Synchronizer::ReadAudioSamples] " + Logger::tr("Warning: Audio input is more than 2% too fast!"));
 	}
-	double length = (double) sample_count / (double) sample_rate;
-	double drift_correction = clamp(DRIFT_CORRECTION_P * current_drift + audiolock->m_average_drift, -0.5, 0.5) * fmin(1.0, DRIFT_MAX_BLOCK / length);
 
 	//qDebug() << "current_drift" << current_drift << "average_drift" << audiolock->m_average_drift << "drift_correction" << drift_correction;
 
@@ -541,9 +636,20 @@ void Synchronizer::ReadAudioSamples(unsigned int channels, unsigned int sample_r
 		assert(false);
 	}
 
+	// switch to the resampler if the drift correction is too large to bypass it
+	if(audiolock->m_resampler_bypass && !CanBypassResampler(drift_correction)) {
+		Logger::LogInfo("[Synchronizer::ReadAudioSamples] " + Logger::tr("Drift correction is too large to bypass the resampler, switching to the resampler."));
+		audiolock->m_resampler_bypass = false;
+		audiolock->m_fast_resampler.reset(new FastResampler(m_output_format->m_audio_channels, 0.9f)); // don't reuse old samples from a previous segment
+	}
+
 	// resample
-	sample_count_out = audiolock->m_fast_resampler->Resample((double) sample_rate / (double) m_output_format->m_audio_sample_rate, 1.0 / (1.0 - drift_correction),
-															 data_float, sample_count, &audiolock->m_temp_output_buffer, sample_count_out);
+	if(audiolock->m_resampler_bypass) {
+		sample_count_out = audiolock->m_sample_slipper->Process(1.0 / (1.0 - drift_correction), data_float, sample_count, &audiolock->m_temp_output_buffer, sample_count_out);
+	} else {
+		sample_count_out = audiolock->m_fast_resampler->Resample((double) sample_rate / (double) m_output_format->m_audio_sample_rate, 1.0 / (1.0 - drift_correction),
+																 data_float, sample_count, &audiolock->m_temp_output_buffer, sample_count_out);
+	}
 	audiolock->m_samples_written += sample_count_out;
 
 	SharedLock lock(&m_shared_data);
@@ -569,6 +675,8 @@ void Synchronizer::ReadAudioSamples(unsigned int channels, unsigned int sample_r
 		lock->m_segment_audio_started = true;
 		lock->m_segment_audio_start_time = timestamp;
 		lock->m_segment_audio_stop_time = timestamp;
+		if(lock->m_segment_first_timestamp == AV_NOPTS_VALUE)
+			lock->m_segment_first_timestamp = timestamp;
 	}
 
 	// store the samples
@@ -578,6 +686,24 @@ void Synchronizer::ReadAudioSamples(unsigned int channels, unsigned int sample_r
 	double new_sample_length = (double) (lock->m_segment_audio_samples_read + lock->m_audio_buffer.GetSize() / m_output_format->m_audio_channels) / (double) m_output_format->m_audio_sample_rate;
 	lock->m_segment_audio_stop_time = lock->m_segment_audio_start_time + (int64_t) round(new_sample_length * 1.0e6);
 
+	// In fast path mode, do what the synchronizer thread would do, but only when there is at least one complete frame.
+	// Just like in the synchronizer thread, the frames are delivered after the shared data is unlocked.
+	if(m_audio_fast_path && lock->m_partial_audio_frame_samples + lock->m_audio_buffer.GetSize() / m_output_format->m_audio_channels >= m_output_format->m_audio_frame_size) {
+		DetachBuffers(lock.get(), &m_fast_path_flush, 0);
+		std::lock_guard<std::mutex> deliverylock(m_delivery_mutex);
+		lock.unlock();
+		DeliverFrames(&m_fast_path_flush);
+	}
+
+}
+
+double Synchronizer::UpdateDriftCorrection(double* average_drift, double current_drift, double dt, double length) {
+	*average_drift = clamp(*average_drift + DRIFT_CORRECTION_I * current_drift * fmin(dt, DRIFT_MAX_BLOCK), -0.5, 0.5);
+	return clamp(DRIFT_CORRECTION_P * current_drift + *average_drift, -0.5, 0.5) * fmin(1.0, DRIFT_MAX_BLOCK / length);
+}
+
+bool Synchronizer::CanBypassResampler(double drift_correction) {
+	return (fabs(drift_correction) <= BYPASS_MAX_DRIFT_CORRECTION);
 }
 
 void Synchronizer::ReadAudioHole() {
@@ -599,13 +725,18 @@ void Synchronizer::InitAudioSegment(AudioData* audiolock) {
 	audiolock->m_last_timestamp = std::numeric_limits<int64_t>::min();
 	audiolock->m_first_timestamp = AV_NOPTS_VALUE;
 	audiolock->m_samples_written = 0;
+	audiolock->m_input_position = 0.0;
+	audiolock->m_drift_estimator->Reset();
 	audiolock->m_average_drift = 0.0;
 	audiolock->m_drop_samples = false;
 	audiolock->m_insert_samples = false;
+	audiolock->m_resampler_bypass = true;
+	audiolock->m_sample_slipper->Reset();
 }
 
 double Synchronizer::GetAudioDrift(AudioData* audiolock, unsigned int extra_samples) {
-	double sample_length = ((double) (audiolock->m_samples_written + extra_samples) + audiolock->m_fast_resampler->GetOutputLatency()) / (double) m_output_format->m_audio_sample_rate;
+	double latency = (audiolock->m_resampler_bypass)? 0.0 : audiolock->m_fast_resampler->GetOutputLatency();
+	double sample_length = ((double) (audiolock->m_samples_written + extra_samples) + latency) / (double) m_output_format->m_audio_sample_rate;
 	double time_length = (double) (audiolock->m_filtered_timestamp - audiolock->m_first_timestamp) * 1.0e-6;
 	return sample_length - time_length;
 }
@@ -632,6 +763,8 @@ void Synchronizer::InitSegment(SharedData* lock) {
 	lock->m_segment_audio_can_drop = true;
 	lock->m_segment_audio_samples_read = 0;
 	lock->m_segment_video_accumulated_delay = 0;
+	lock->m_segment_video_throttled_frames = 0;
+	lock->m_segment_first_timestamp = AV_NOPTS_VALUE;
 }
 
 int64_t Synchronizer::GetTotalTime(Synchronizer::SharedData* lock) {
@@ -658,23 +791,46 @@ void Synchronizer::GetSegmentStartStop(SharedData* lock, int64_t* segment_start_
 }
 
 void Synchronizer::FlushBuffers(SharedData* lock) {
+	// This is only used when starting a new segment or stopping, so it's fine to do everything while the shared data is locked.
+	FlushData flush;
+	DetachBuffers(lock, &flush, (m_output_format->m_video_enabled)? m_output_manager->GetVideoFrameDelay(m_video_track) : 0);
+	std::lock_guard<std::mutex> deliverylock(m_delivery_mutex);
+	DeliverFrames(&flush);
+}
+
+void Synchronizer::DetachBuffers(SharedData* lock, FlushData* flush, int64_t video_frame_delay) {
+	flush->m_video_frames.clear();
+	flush->m_audio_frames = 0;
+
 	if(!lock->m_segment_video_started || !lock->m_segment_audio_started)
 		return;
 
 	int64_t segment_start_time, segment_stop_time;
 	GetSegmentStartStop(lock, &segment_start_time, &segment_stop_time);
 
-	// flush video
+	// Additional video tracks use the segment timing of the main track, otherwise every track would start its segments at its own
+	// first frame, and the tracks would drift apart after pausing. Frames from before the start of the main segment are dropped.
+	// The main synchronizer never locks the shared data of the additional tracks, so this can't deadlock.
+	if(m_video_track != 0) {
+		Synchronizer *main_synchronizer = m_output_manager->GetSynchronizer(0);
+		int64_t main_start_time, main_stop_time;
+		if(main_synchronizer == NULL || !main_synchronizer->GetSegmentTiming(&lock->m_time_offset, &main_start_time, &main_stop_time))
+			return;
+		segment_start_time = main_start_time;
+		segment_stop_time = std::min(segment_stop_time, main_stop_time);
+	}
+
+	// detach video
 	if(m_output_format->m_video_enabled)
-		FlushVideoBuffer(lock, segment_start_time, segment_stop_time);
+		DetachVideoBuffer(lock, flush, video_frame_delay, segment_start_time, segment_stop_time);
 
-	// flush audio
+	// detach audio
 	if(m_output_format->m_audio_enabled)
-		FlushAudioBuffer(lock, segment_start_time, segment_stop_time);
+		DetachAudioBuffer(lock, flush, segment_start_time, segment_stop_time);
 
 }
 
-void Synchronizer::FlushVideoBuffer(Synchronizer::SharedData* lock, int64_t segment_start_time, int64_t segment_stop_time) {
+void Synchronizer::DetachVideoBuffer(SharedData* lock, FlushData* flush, int64_t video_frame_delay, int64_t segment_start_time, int64_t segment_stop_time) {
 
 	// Sometimes long delays between video frames can occur, e.g. when a game is showing a loading screen.
 	// Not all codecs/players can handle that. It's also a problem for streaming. To fix this, long delays should be avoided by
@@ -688,9 +844,16 @@ void Synchronizer::FlushVideoBuffer(Synchronizer::SharedData* lock, int64_t segm
 	// (1) The queue is not empty, but there is a gap between frames that is too large.
 	// (2) The queue is empty and the last timestamp is too long ago (relative to the end of the video segment).
 	// It is perfectly possible that *both* happen, each possibly multiple times, in just one function call.
+	// The frames are only detached here, the duplicate frames are created later by DeliverFrames (without holding the lock).
+	// The frame delay is sampled once before the lock is taken, since the encoder queue can't be checked after every frame anymore.
 
 	int64_t segment_stop_video_pts = (lock->m_time_offset + (segment_stop_time - segment_start_time)) * (int64_t) m_output_format->m_video_frame_rate / (int64_t) 1000000;
 	int64_t delay_time_per_frame = 1000000 / m_output_format->m_video_frame_rate;
+
+	// When the degradation controller has reduced the frame rate, the gaps between frames are intentional. Filling them with
+	// duplicate frames would give the encoder just as much work as before, so these gaps are allowed even without frame skipping.
+	int64_t max_frames_skipped = std::max(m_max_frames_skipped, (int64_t) m_output_manager->GetFrameRateDivisor() - 1);
+
 	for( ; ; ) {
 
 		// get/predict the timestamp of the next frame
@@ -705,29 +868,33 @@ void Synchronizer::FlushVideoBuffer(Synchronizer::SharedData* lock, int64_t segm
 		while(lock->m_segment_video_accumulated_delay >= delay_time_per_frame && lock->m_video_pts < segment_stop_video_pts) {
 			lock->m_segment_video_accumulated_delay -= delay_time_per_frame;
 			lock->m_video_pts += 1;
-			//Logger::LogInfo("[Synchronizer::FlushVideoBuffer] Delay [" + QString::number(lock->m_video_pts - 1) + "] acc " + QString::number(lock->m_segment_video_accumulated_delay) + ".");
+			++lock->m_segment_video_throttled_frames;
+			//Logger::LogInfo("[Synchronizer::DetachVideoBuffer] Delay [" + QString::number(lock->m_video_pts - 1) + "] acc " + QString::number(lock->m_segment_video_accumulated_delay) + ".");
 		}
 
 		// insert duplicate frames if needed, up to either the next frame or the segment end
 		if(lock->m_last_video_frame_data != NULL) {
-			while(lock->m_video_pts + m_max_frames_skipped < std::min(next_pts, segment_stop_video_pts)) {
+			while(lock->m_video_pts + max_frames_skipped < std::min(next_pts, segment_stop_video_pts)) {
 
-				// create duplicate frame
-				std::unique_ptr<AVFrameWrapper> duplicate_frame = CreateVideoFrame(m_output_format->m_video_width, m_output_format->m_video_height, m_output_format->m_video_pixel_format, lock->m_last_video_frame_data);
-				duplicate_frame->GetFrame()->pts = lock->m_video_pts + m_max_frames_skipped;
+				// detach duplicate frame
+				FlushedVideoFrame duplicate_frame;
+				duplicate_frame.m_duplicate_data = lock->m_last_video_frame_data;
+				duplicate_frame.m_pts = lock->m_video_pts + max_frames_skipped;
 
 				// add new block to sync diagram
 				if(m_sync_diagram != NULL) {
-					double t = (double) duplicate_frame->GetFrame()->pts / (double) m_output_format->m_video_frame_rate;
+					double t = (double) duplicate_frame.m_pts / (double) m_output_format->m_video_frame_rate;
 					m_sync_diagram->AddBlock(2, t, t + 1.0 / (double) m_output_format->m_video_frame_rate, QColor(255, 196, 0));
 				}
 
-				// send the frame to the encoder
-				lock->m_segment_video_accumulated_delay = std::max((int64_t) 0, lock->m_segment_video_accumulated_delay - m_max_frames_skipped * delay_time_per_frame);
-				lock->m_video_pts = duplicate_frame->GetFrame()->pts + 1;
-				//Logger::LogInfo("[Synchronizer::FlushVideoBuffer] Encoded video frame [" + QString::number(duplicate_frame->GetFrame()->pts) + "] (duplicate) acc " + QString::number(lock->m_segment_video_accumulated_delay) + ".");
-				m_output_manager->AddVideoFrame(std::move(duplicate_frame));
-				lock->m_segment_video_accumulated_delay += m_output_manager->GetVideoFrameDelay();
+				// send the frame to the encoder (later)
+				lock->m_segment_video_accumulated_delay = std::max((int64_t) 0, lock->m_segment_video_accumulated_delay - max_frames_skipped * delay_time_per_frame);
+				lock->m_video_pts = duplicate_frame.m_pts + 1;
+				//Logger::LogInfo("[Synchronizer::DetachVideoBuffer] Encoded video frame [" + QString::number(duplicate_frame.m_pts) + "] (duplicate) acc " + QString::number(lock->m_segment_video_accumulated_delay) + ".");
+				flush->m_video_frames.push_back(std::move(duplicate_frame));
+				lock->m_segment_video_accumulated_delay += video_frame_delay;
+				if(m_video_track == 0)
+					FrameAccounting::Add(FrameAccounting::REASON_SYNC_DUPLICATE);
 
 			}
 		}
@@ -743,8 +910,17 @@ void Synchronizer::FlushVideoBuffer(Synchronizer::SharedData* lock, int64_t segm
 		lock->m_last_video_frame_data = frame->GetFrameData();
 
 		// if the frame is too early, drop it
+		// If output frames were skipped because of the video frame delay, the frame that would have been used is the one that gets dropped.
 		if(frame->GetFrame()->pts < lock->m_video_pts) {
-			//Logger::LogInfo("[Synchronizer::FlushVideoBuffer] Dropped video frame [" + QString::number(frame->GetFrame()->pts) + "] acc " + QString::number(lock->m_segment_video_accumulated_delay) + ".");
+			//Logger::LogInfo("[Synchronizer::DetachVideoBuffer] Dropped video frame [" + QString::number(frame->GetFrame()->pts) + "] acc " + QString::number(lock->m_segment_video_accumulated_delay) + ".");
+			if(lock->m_segment_video_throttled_frames > 0) {
+				--lock->m_segment_video_throttled_frames;
+				if(m_video_track == 0)
+					FrameAccounting::Add(FrameAccounting::REASON_OUTPUT_THROTTLE);
+			} else {
+				if(m_video_track == 0)
+					FrameAccounting::Add(FrameAccounting::REASON_SYNC_COLLISION);
+			}
 			continue;
 		}
 
@@ -758,18 +934,22 @@ void Synchronizer::FlushVideoBuffer(Synchronizer::SharedData* lock, int64_t segm
 			m_sync_diagram->AddBlock(2, t, t + 1.0 / (double) m_output_format->m_video_frame_rate, QColor(255, 0, 0));
 		}
 
-		// send the frame to the encoder
+		// send the frame to the encoder (later)
 		lock->m_segment_video_accumulated_delay = std::max((int64_t) 0, lock->m_segment_video_accumulated_delay - (frame->GetFrame()->pts - lock->m_video_pts) * delay_time_per_frame);
 		lock->m_video_pts = frame->GetFrame()->pts + 1;
-		//Logger::LogInfo("[Synchronizer::FlushBuffers] Encoded video frame [" + QString::number(frame->GetFrame()->pts) + "].");
-		m_output_manager->AddVideoFrame(std::move(frame));
-		lock->m_segment_video_accumulated_delay += m_output_manager->GetVideoFrameDelay();
+		lock->m_segment_video_throttled_frames = 0;
+		//Logger::LogInfo("[Synchronizer::DetachVideoBuffer] Encoded video frame [" + QString::number(frame->GetFrame()->pts) + "].");
+		FlushedVideoFrame flushed_frame;
+		flushed_frame.m_pts = frame->GetFrame()->pts;
+		flushed_frame.m_frame = std::move(frame);
+		flush->m_video_frames.push_back(std::move(flushed_frame));
+		lock->m_segment_video_accumulated_delay += video_frame_delay;
 
 	}
 
 }
 
-void Synchronizer::FlushAudioBuffer(Synchronizer::SharedData* lock, int64_t segment_start_time, int64_t segment_stop_time) {
+void Synchronizer::DetachAudioBuffer(SharedData* lock, FlushData* flush, int64_t segment_start_time, int64_t segment_stop_time) {
 
 	double sample_length = (double) (segment_stop_time - lock->m_segment_audio_start_time) * 1.0e-6;
 	int64_t samples_max = (int64_t) ceil(sample_length * (double) m_output_format->m_audio_sample_rate) - lock->m_segment_audio_samples_read;
@@ -801,87 +981,116 @@ void Synchronizer::FlushAudioBuffer(Synchronizer::SharedData* lock, int64_t segm
 		}
 
 		int64_t samples_left = std::min(samples_max, (int64_t) lock->m_audio_buffer.GetSize() / m_output_format->m_audio_channels);
+		if(samples_left <= 0)
+			return;
 
 		// add new block to sync diagram
-		if(m_sync_diagram != NULL && samples_left > 0) {
+		if(m_sync_diagram != NULL) {
 			double t = (double) lock->m_audio_samples / (double) m_output_format->m_audio_sample_rate;
 			m_sync_diagram->AddBlock(3, t, t + (double) samples_left / (double) m_output_format->m_audio_sample_rate, QColor(0, 255, 0));
 		}
 
-		// send the samples to the encoder
-		while(samples_left > 0) {
-
-			lock->m_segment_audio_can_drop = false;
-
-			// copy samples until either the partial frame is full or there are no samples left
-			//TODO// do direct copy/conversion to new audio frame?
-			int64_t n = std::min((int64_t) (m_output_format->m_audio_frame_size - lock->m_partial_audio_frame_samples), samples_left);
-			lock->m_audio_buffer.Pop(lock->m_partial_audio_frame.GetData() + lock->m_partial_audio_frame_samples * m_output_format->m_audio_channels, n * m_output_format->m_audio_channels);
+		lock->m_segment_audio_can_drop = false;
+
+		// Complete frames are moved out of the queue (together with the partial frame), the conversion to the final sample format is done by DeliverFrames.
+		// The pts of each frame is equal to the number of samples at the end of the frame.
+		unsigned int frame_size = m_output_format->m_audio_frame_size, channels = m_output_format->m_audio_channels;
+		unsigned int frames = (lock->m_partial_audio_frame_samples + samples_left) / frame_size;
+		if(frames != 0) {
+			int64_t n = (int64_t) frames * (int64_t) frame_size - (int64_t) lock->m_partial_audio_frame_samples;
+			flush->m_audio_samples.Alloc(frames * frame_size * channels);
+			memcpy(flush->m_audio_samples.GetData(), lock->m_partial_audio_frame.GetData(), lock->m_partial_audio_frame_samples * channels * sizeof(float));
+			lock->m_audio_buffer.Pop(flush->m_audio_samples.GetData() + lock->m_partial_audio_frame_samples * channels, n * channels);
+			flush->m_audio_frames = frames;
+			flush->m_audio_first_pts = lock->m_audio_samples - lock->m_partial_audio_frame_samples + frame_size;
 			lock->m_segment_audio_samples_read += n;
-			lock->m_partial_audio_frame_samples += n;
+			lock->m_partial_audio_frame_samples = 0;
 			lock->m_audio_samples += n;
 			samples_left -= n;
+		}
 
-			// is the partial frame full?
-			if(lock->m_partial_audio_frame_samples == m_output_format->m_audio_frame_size) {
+		// copy the remaining samples to the partial frame
+		lock->m_audio_buffer.Pop(lock->m_partial_audio_frame.GetData() + lock->m_partial_audio_frame_samples * channels, samples_left * channels);
+		lock->m_segment_audio_samples_read += samples_left;
+		lock->m_partial_audio_frame_samples += samples_left;
+		lock->m_audio_samples += samples_left;
 
-				// allocate a frame
+	}
+
+}
+
+void Synchronizer::DeliverFrames(FlushData* flush) {
+
+	// send the video frames to the encoder
+	for(FlushedVideoFrame &flushed_frame : flush->m_video_frames) {
+		std::unique_ptr<AVFrameWrapper> frame = std::move(flushed_frame.m_frame);
+		if(frame == NULL) {
+			frame = CreateVideoFrame(m_output_format->m_video_width, m_output_format->m_video_height, m_output_format->m_video_pixel_format, flushed_frame.m_duplicate_data);
+			flushed_frame.m_duplicate_data.reset();
+		}
+		frame->GetFrame()->pts = flushed_frame.m_pts;
+		m_output_manager->AddVideoFrame(std::move(frame), m_video_track);
+	}
+	flush->m_video_frames.clear();
+
+	// send the audio frames to the encoder
+	for(unsigned int i = 0; i < flush->m_audio_frames; ++i) {
+
+		// allocate a frame
 #if SSR_USE_AVUTIL_PLANAR_SAMPLE_FMT
-				unsigned int planes = (m_output_format->m_audio_sample_format == AV_SAMPLE_FMT_S16P ||
-									   m_output_format->m_audio_sample_format == AV_SAMPLE_FMT_FLTP)? m_output_format->m_audio_channels : 1;
+		unsigned int planes = (m_output_format->m_audio_sample_format == AV_SAMPLE_FMT_S16P ||
+							   m_output_format->m_audio_sample_format == AV_SAMPLE_FMT_FLTP)? m_output_format->m_audio_channels : 1;
 #else
-				unsigned int planes = 1;
+		unsigned int planes = 1;
 #endif
-				std::unique_ptr<AVFrameWrapper> audio_frame = CreateAudioFrame(m_output_format->m_audio_channels, m_output_format->m_audio_sample_rate,
-																			   m_output_format->m_audio_frame_size, planes, m_output_format->m_audio_sample_format);
-				audio_frame->GetFrame()->pts = lock->m_audio_samples;
-
-				// copy/convert the samples
-				switch(m_output_format->m_audio_sample_format) {
-					case AV_SAMPLE_FMT_S16: {
-						float *data_in = (float*) lock->m_partial_audio_frame.GetData();
-						int16_t *data_out = (int16_t*) audio_frame->GetFrame()->data[0];
-						SampleCopy(m_output_format->m_audio_frame_size * m_output_format->m_audio_channels, data_in, 1, data_out, 1);
-						break;
-					}
-					case AV_SAMPLE_FMT_FLT: {
-						float *data_in = (float*) lock->m_partial_audio_frame.GetData();
-						float *data_out = (float*) audio_frame->GetFrame()->data[0];
-						memcpy(data_out, data_in, m_output_format->m_audio_frame_size * m_output_format->m_audio_channels * sizeof(float));
-						break;
-					}
+		std::unique_ptr<AVFrameWrapper> audio_frame = CreateAudioFrame(m_output_format->m_audio_channels, m_output_format->m_audio_sample_rate,
+																	   m_output_format->m_audio_frame_size, planes, m_output_format->m_audio_sample_format);
+		audio_frame->GetFrame()->pts = flush->m_audio_first_pts + (int64_t) i * (int64_t) m_output_format->m_audio_frame_size;
+
+		// copy/convert the samples
+		float *samples = flush->m_audio_samples.GetData() + (size_t) i * (size_t) (m_output_format->m_audio_frame_size * m_output_format->m_audio_channels);
+		switch(m_output_format->m_audio_sample_format) {
+			case AV_SAMPLE_FMT_S16: {
+				float *data_in = samples;
+				int16_t *data_out = (int16_t*) audio_frame->GetFrame()->data[0];
+				SampleCopy(m_output_format->m_audio_frame_size * m_output_format->m_audio_channels, data_in, 1, data_out, 1);
+				break;
+			}
+			case AV_SAMPLE_FMT_FLT: {
+				float *data_in = samples;
+				float *data_out = (float*) audio_frame->GetFrame()->data[0];
+				memcpy(data_out, data_in, m_output_format->m_audio_frame_size * m_output_format->m_audio_channels * sizeof(float));
+				break;
+			}
 #if SSR_USE_AVUTIL_PLANAR_SAMPLE_FMT
-					case AV_SAMPLE_FMT_S16P: {
-						for(unsigned int p = 0; p < planes; ++p) {
-							float *data_in = (float*) lock->m_partial_audio_frame.GetData() + p;
-							int16_t *data_out = (int16_t*) audio_frame->GetFrame()->data[p];
-							SampleCopy(m_output_format->m_audio_frame_size, data_in, planes, data_out, 1);
-						}
-						break;
-					}
-					case AV_SAMPLE_FMT_FLTP: {
-						for(unsigned int p = 0; p < planes; ++p) {
-							float *data_in = (float*) lock->m_partial_audio_frame.GetData() + p;
-							float *data_out = (float*) audio_frame->GetFrame()->data[p];
-							SampleCopy(m_output_format->m_audio_frame_size, data_in, planes, data_out, 1);
-						}
-						break;
-					}
-#endif
-					default: {
-						assert(false);
-						break;
-					}
+			case AV_SAMPLE_FMT_S16P: {
+				for(unsigned int p = 0; p < planes; ++p) {
+					float *data_in = samples + p;
+					int16_t *data_out = (int16_t*) audio_frame->GetFrame()->data[p];
+					SampleCopy(m_output_format->m_audio_frame_size, data_in, planes, data_out, 1);
 				}
-				lock->m_partial_audio_frame_samples = 0;
-
-				//Logger::LogInfo("[Synchronizer::FlushAudioBuffer] Encoded audio frame [" + QString::number(lock->m_partial_audio_frame->pts) + "].");
-				m_output_manager->AddAudioFrame(std::move(audio_frame));
+				break;
+			}
+			case AV_SAMPLE_FMT_FLTP: {
+				for(unsigned int p = 0; p < planes; ++p) {
+					float *data_in = samples + p;
+					float *data_out = (float*) audio_frame->GetFrame()->data[p];
+					SampleCopy(m_output_format->m_audio_frame_size, data_in, planes, data_out, 1);
+				}
+				break;
+			}
+#endif
+			default: {
+				assert(false);
+				break;
 			}
-
 		}
 
+		//Logger::LogInfo("[Synchronizer::DeliverFrames] Encoded audio frame [" + QString::number(audio_frame->GetFrame()->pts) + "].");
+		m_output_manager->AddAudioFrame(std::move(audio_frame));
+
 	}
+	flush->m_audio_frames = 0;
 
 }
 
@@ -890,11 +1099,23 @@ void Synchronizer::SynchronizerThread() {
 
 		Logger::LogInfo("[Synchronizer::SynchronizerThread] " + Logger::tr("Synchronizer thread started."));
 
+		FlushData flush;
+		flush.m_audio_frames = 0;
 		while(!m_should_stop) {
 
+			// the main track also checks the load of the encoder
+			if(m_video_track == 0 && m_output_format->m_video_enabled)
+				m_output_manager->UpdateDegradation();
+
+			// The buffers are detached while the shared data is locked, but the frames are sent to the encoders after the lock is released,
+			// so the inputs don't have to wait for the conversions and the encoder queues. The delivery mutex is locked before the
+			// shared data is unlocked, this guarantees that frames from different flushes can't end up in the wrong order.
+			int64_t video_frame_delay = (m_output_format->m_video_enabled)? m_output_manager->GetVideoFrameDelay(m_video_track) : 0;
+			std::unique_lock<std::mutex> deliverylock;
 			{
 				SharedLock lock(&m_shared_data);
-				FlushBuffers(lock.get());
+				DetachBuffers(lock.get(), &flush, video_frame_delay);
+				deliverylock = std::unique_lock<std::mutex>(m_delivery_mutex);
 				if(m_sync_diagram != NULL) {
 					double time_in = (double) hrt_time_micro() * 1.0e-6;
 					double time_out = (double) GetTotalTime(lock.get()) * 1.0e-6;
@@ -905,6 +1126,8 @@ void Synchronizer::SynchronizerThread() {
 					m_sync_diagram->Update();
 				}
 			}
+			DeliverFrames(&flush);
+			deliverylock.unlock();
 
 			usleep(20000);
 
@@ -24,6 +24,8 @@ along with SimpleScreenRecorder.  If not, see <http://www.gnu.org/licenses/>.
 #include "MutexDataPair.h"
 #include "FastScaler.h"
 #include "FastResampler.h"
+#include "SampleSlipper.h"
+#include "DriftEstimator.h"
 #include "QueueBuffer.h"
 #include "TempBuffer.h"
 #include "AVWrapper.h"
@@ -42,20 +44,25 @@ private:
 
 		int64_t m_last_timestamp; // the timestamp of the last received video frame (for gap detection)
 		int64_t m_next_timestamp; // the preferred timestamp of the next frame (for rate control)
+		bool m_count_missed_frames; // whether missed frames can be counted (false until the first frame of the segment has arrived)
 
 	};
 	struct AudioData {
 
 		std::unique_ptr<FastResampler> m_fast_resampler;
+		std::unique_ptr<SampleSlipper> m_sample_slipper;
+		std::unique_ptr<DriftEstimator> m_drift_estimator;
 		TempBuffer<float> m_temp_input_buffer;
 		TempBuffer<float> m_temp_output_buffer;
 
 		int64_t m_filtered_timestamp; // the timestamp after noise filtering
+		double m_input_position; // total length of all samples received in the current segment, based on the sample rate (for noise filtering)
 		int64_t m_last_timestamp; // the timestamp of the last received audio frame (to detect non-monotonic timestamps)
 		int64_t m_first_timestamp; // the timestamp of the first audio frame in the current segment (for drift correction)
 		int64_t m_samples_written; // total number of samples written to the queue in the current segment (for drift correction)
 		double m_average_drift; // drift averaged over time (for drift correction)
 		bool m_drop_samples, m_insert_samples;
+		bool m_resampler_bypass; // whether the resampler is bypassed in the current segment (only possible if the sample rates match)
 
 		bool m_warn_desync;
 
@@ -76,29 +83,52 @@ private:
 		bool m_segment_audio_can_drop; // whether audio samples can still be dropped (i.e. no samples have been sent to the encoder yet)
 		int64_t m_segment_audio_samples_read; // the number of samples that have been read from the audio buffer (including dropped samples)
 		int64_t m_segment_video_accumulated_delay; // sum of all video frame delays that were applied so far
+		int64_t m_segment_video_throttled_frames; // number of output frames skipped because of the video frame delay that haven't been accounted for yet
+		int64_t m_segment_first_timestamp; // the timestamp of the first video frame or audio sample in the current segment (for the start latency)
 
 		std::shared_ptr<AVFrameData> m_last_video_frame_data;
 
 		bool m_warn_drop_video;
 
+	};
+	struct FlushedVideoFrame {
+		std::unique_ptr<AVFrameWrapper> m_frame; // NULL for duplicate frames
+		std::shared_ptr<AVFrameData> m_duplicate_data; // image data of duplicate frames
+		int64_t m_pts;
+	};
+	struct FlushData {
+
+		// video frames in the order in which they should be sent to the encoder
+		std::vector<FlushedVideoFrame> m_video_frames;
+
+		// samples for complete audio frames, still in the internal format
+		TempBuffer<float> m_audio_samples;
+		unsigned int m_audio_frames;
+		int64_t m_audio_first_pts;
+
 	};
 	typedef MutexDataPair<VideoData>::Lock VideoLock;
 	typedef MutexDataPair<AudioData>::Lock AudioLock;
 	typedef MutexDataPair<SharedData>::Lock SharedLock;
 
 private:
-	static const int64_t AUDIO_TIMESTAMP_FILTER;
+	static const double AUDIO_TIMESTAMP_TIME_CONSTANT, AUDIO_TIMESTAMP_MAX_ERROR;
+	static const unsigned int AUDIO_TIMESTAMP_MAX_OUTLIERS;
 	static const double DRIFT_CORRECTION_P, DRIFT_CORRECTION_I;
 	static const double DRIFT_ERROR_THRESHOLD, DRIFT_MAX_BLOCK;
+	static const double BYPASS_MAX_DRIFT_CORRECTION;
 	static const size_t MAX_VIDEO_FRAMES_BUFFERED, MAX_AUDIO_SAMPLES_BUFFERED;
+	static const size_t AUDIO_BACKLOG_SAMPLES;
 	static const int64_t MAX_FRAME_DELAY;
 
 private:
 	OutputManager *m_output_manager;
 	const OutputSettings *m_output_settings;
 	const OutputFormat *m_output_format;
+	unsigned int m_video_track;
 
 	int64_t m_max_frames_skipped;
+	bool m_audio_fast_path; // whether complete audio frames are sent to the encoder by the audio input (only used without video)
 
 	std::unique_ptr<SyncDiagram> m_sync_diagram;
 
@@ -106,11 +136,14 @@ private:
 	MutexDataPair<VideoData> m_video_data;
 	MutexDataPair<AudioData> m_audio_data;
 	MutexDataPair<SharedData> m_shared_data;
+	std::mutex m_delivery_mutex; // keeps frames in order while they are being sent to the encoders, always locked after the shared data
+	FlushData m_fast_path_flush; // used by the audio input in fast path mode, protected by the audio data
 	std::atomic<bool> m_should_stop, m_error_occurred;
 
 public:
 	// The arguments 'video_encoder' and 'audio_encoder' can be NULL to disable video or audio.
-	Synchronizer(OutputManager* output_manager);
+	// Additional video tracks (video_track != 0) get their own synchronizer without audio.
+	Synchronizer(OutputManager* output_manager, unsigned int video_track = 0);
 	~Synchronizer();
 
 private:
@@ -130,17 +163,37 @@ public:
 	// This function is thread-safe.
 	int64_t GetTotalTime();
 
+	// Returns the timestamp of the first video frame or audio sample that was accepted in the current segment,
+	// or AV_NOPTS_VALUE if nothing has been received yet. This is used to measure the start latency.
+	// This function is thread-safe.
+	int64_t GetSegmentFirstTimestamp();
+
+	// Returns the length of all previous segments and the start and stop time of the current segment. Returns false if the current
+	// segment hasn't started yet. Additional video tracks use this to follow the timing of the main track.
+	// This function is thread-safe.
+	bool GetSegmentTiming(int64_t* time_offset, int64_t* segment_start_time, int64_t* segment_stop_time);
+
 	// Returns whether an error has occurred in the synchronizer thread.
 	// This function is thread-safe.
 	inline bool HasErrorOccurred() { return m_error_occurred; }
 
+	// Updates the PI controller of the drift correction with the drift (in seconds) at the start of a block of audio, and returns
+	// the drift correction factor for that block. 'dt' is the time since the previous block, 'length' is the length of the block.
+	// This is used by ReadAudioSamples, and by the benchmarks so they use exactly the same controller.
+	static double UpdateDriftCorrection(double* average_drift, double current_drift, double dt, double length);
+
+	// Returns whether the drift correction factor is small enough to bypass the resampler.
+	static bool CanBypassResampler(double drift_correction);
+
 	//inline VideoEncoder* GetVideoEncoder() { return m_video_encoder; }
 	//inline AudioEncoder* GetAudioEncoder() { return m_audio_encoder; }
 
 public: // internal
 	virtual int64_t GetNextVideoTimestamp() override;
+	virtual bool IsVideoBacklogged() override;
 	virtual void ReadVideoFrame(unsigned int width, unsigned int height, const uint8_t* data, int stride, AVPixelFormat format, int colorspace, int64_t timestamp) override;
 	virtual void ReadVideoPing(int64_t timestamp) override;
+	virtual bool IsAudioBacklogged() override;
 	virtual void ReadAudioSamples(unsigned int channels, unsigned int sample_rate, AVSampleFormat format, unsigned int sample_count, const uint8_t* data, int64_t timestamp) override;
 	virtual void ReadAudioHole() override;
 
@@ -152,8 +205,10 @@ private:
 	int64_t GetTotalTime(SharedData* lock);
 	void GetSegmentStartStop(SharedData* lock, int64_t* segment_start_time, int64_t* segment_stop_time);
 	void FlushBuffers(SharedData* lock);
-	void FlushVideoBuffer(SharedData* lock, int64_t segment_start_time, int64_t segment_stop_time);
-	void FlushAudioBuffer(SharedData* lock, int64_t segment_start_time, int64_t segment_stop_time);
+	void DetachBuffers(SharedData* lock, FlushData* flush, int64_t video_frame_delay);
+	void DetachVideoBuffer(SharedData* lock, FlushData* flush, int64_t video_frame_delay, int64_t segment_start_time, int64_t segment_stop_time);
+	void DetachAudioBuffer(SharedData* lock, FlushData* flush, int64_t segment_start_time, int64_t segment_stop_time);
+	void DeliverFrames(FlushData* flush);
 
 private:
 	void SynchronizerThread();
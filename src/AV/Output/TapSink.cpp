@@ -0,0 +1,255 @@
+/*
+Copyright (c) 2012-2020 Maarten Baert <maarten-baert@hotmail.com>
+
+This file is part of SimpleScreenRecorder.
+
+SimpleScreenRecorder is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+SimpleScreenRecorder is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with SimpleScreenRecorder.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#include "TapSink.h"
+
+#include "Logger.h"
+#include "SampleCast.h"
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/types.h>
+
+TapSink::TapSink(const QString& filename, unsigned int width, unsigned int height, unsigned int frame_rate, unsigned int audio_channels) {
+
+	m_filename = filename;
+	m_width = width;
+	m_height = height;
+	m_frame_rate = std::max(1u, frame_rate);
+	m_audio_channels = audio_channels;
+
+	m_fd = -1;
+	m_mmap_ptr = MAP_FAILED;
+	m_mmap_size = 0;
+
+	{
+		SharedLock lock(&m_shared_data);
+		lock->m_next_frame_time = SINK_TIMESTAMP_ASAP;
+	}
+
+	try {
+		Init();
+	} catch(...) {
+		Free();
+		throw;
+	}
+
+}
+
+TapSink::~TapSink() {
+
+	// disconnect
+	ConnectVideoSource(NULL);
+	ConnectAudioSource(NULL);
+
+	Free();
+
+}
+
+void TapSink::Init() {
+
+	// calculate the layout
+	// The data is aligned to pages so readers can map it efficiently.
+	size_t page_size = sysconf(_SC_PAGE_SIZE);
+	size_t header_size = sizeof(TapHeader) + sizeof(TapVideoFrameInfo) * TAP_VIDEO_RING_SIZE + sizeof(TapAudioPacketInfo) * TAP_AUDIO_RING_SIZE;
+	unsigned int video_stride = grow_align16(m_width * 4);
+	size_t video_slot_size = grow_align16((size_t) video_stride * m_height);
+	size_t audio_slot_size = grow_align16(TAP_AUDIO_PACKET_MAX_SAMPLES * m_audio_channels * sizeof(float));
+	size_t video_data_offset = (header_size + page_size - 1) / page_size * page_size;
+	size_t audio_data_offset = video_data_offset + video_slot_size * TAP_VIDEO_RING_SIZE;
+	m_mmap_size = (audio_data_offset + audio_slot_size * TAP_AUDIO_RING_SIZE + page_size - 1) / page_size * page_size;
+
+	// replace any stale file left behind by a previous instance
+	// The file is unlinked first because readers may still have the old file mapped. Other files are never touched.
+	QByteArray filename = QFile::encodeName(m_filename);
+	struct stat statinfo;
+	if(lstat(filename.constData(), &statinfo) == 0) {
+		if(!IsTapFile(filename.constData(), statinfo)) {
+			Logger::LogError("[TapSink::Init] " + Logger::tr("Error: Can't create tap file '%1', a different file with the same name already exists!").arg(m_filename));
+			throw SSRStreamException();
+		}
+		if(unlink(filename.constData()) == -1) {
+			Logger::LogError("[TapSink::Init] " + Logger::tr("Error: Can't remove old tap file '%1'!").arg(m_filename));
+			throw SSRStreamException();
+		}
+	}
+
+	// create the file
+	// The frames and audio are private, so the file is only accessible to the current user (like the GLInject files).
+	m_fd = open(filename.constData(), O_RDWR | O_CREAT | O_EXCL | O_CLOEXEC, 0600);
+	if(m_fd == -1) {
+		Logger::LogError("[TapSink::Init] " + Logger::tr("Error: Can't create tap file '%1'!").arg(m_filename));
+		throw SSRStreamException();
+	}
+	if(ftruncate(m_fd, m_mmap_size) == -1) {
+		Logger::LogError("[TapSink::Init] " + Logger::tr("Error: Can't resize tap file!"));
+		throw SSRStreamException();
+	}
+
+	// map the file
+	m_mmap_ptr = mmap(NULL, m_mmap_size, PROT_READ | PROT_WRITE, MAP_SHARED, m_fd, 0);
+	if(m_mmap_ptr == MAP_FAILED) {
+		Logger::LogError("[TapSink::Init] " + Logger::tr("Error: Can't memory-map tap file!"));
+		throw SSRStreamException();
+	}
+
+	// initialize the header (the file is already filled with zeros), the identifier is written last
+	TapHeader *header = GetTapHeader();
+	header->version = TAP_VERSION;
+	header->writer_pid = getpid();
+	header->video_width = m_width;
+	header->video_height = m_height;
+	header->video_stride = video_stride;
+	header->video_frame_rate = m_frame_rate;
+	header->video_slot_size = video_slot_size;
+	header->video_data_offset = video_data_offset;
+	header->audio_channels = m_audio_channels;
+	header->audio_slot_size = audio_slot_size;
+	header->audio_data_offset = audio_data_offset;
+	std::atomic_thread_fence(std::memory_order_release);
+	header->identifier = TAP_IDENTIFIER;
+	std::atomic_thread_fence(std::memory_order_release);
+
+	Logger::LogInfo("[TapSink::Init] " + Logger::tr("Created tap file '%1'.").arg(m_filename));
+
+}
+
+bool TapSink::IsTapFile(const char* filename, const struct stat& statinfo) {
+	if(!S_ISREG(statinfo.st_mode) || statinfo.st_uid != geteuid() || (size_t) statinfo.st_size < sizeof(TapHeader))
+		return false;
+	int fd = open(filename, O_RDONLY | O_NOFOLLOW | O_CLOEXEC);
+	if(fd == -1)
+		return false;
+	uint32_t identifier;
+	bool result = (pread(fd, &identifier, sizeof(identifier), offsetof(TapHeader, identifier)) == (ssize_t) sizeof(identifier) && identifier == TAP_IDENTIFIER);
+	close(fd);
+	return result;
+}
+
+void TapSink::Free() {
+	if(m_mmap_ptr != MAP_FAILED) {
+		munmap(m_mmap_ptr, m_mmap_size);
+		m_mmap_ptr = MAP_FAILED;
+	}
+	if(m_fd != -1) {
+		close(m_fd);
+		m_fd = -1;
+		unlink(QFile::encodeName(m_filename).constData());
+	}
+}
+
+int64_t TapSink::GetNextVideoTimestamp() {
+	SharedLock lock(&m_shared_data);
+	return lock->m_next_frame_time;
+}
+
+void TapSink::ReadVideoFrame(unsigned int width, unsigned int height, const uint8_t* data, int stride, AVPixelFormat format, int colorspace, int64_t timestamp) {
+
+	// check the timestamp
+	{
+		SharedLock lock(&m_shared_data);
+		if(lock->m_next_frame_time == SINK_TIMESTAMP_ASAP) {
+			lock->m_next_frame_time = timestamp + 1000000 / m_frame_rate;
+		} else {
+			if(timestamp < lock->m_next_frame_time - 1000000 / m_frame_rate)
+				return;
+			lock->m_next_frame_time = std::max(lock->m_next_frame_time + 1000000 / m_frame_rate, timestamp);
+		}
+	}
+
+	// check the size (the scaler can't handle sizes below 2)
+	if(width < 2 || height < 2 || m_width < 2 || m_height < 2)
+		return;
+
+	// start writing the slot
+	TapHeader *header = GetTapHeader();
+	uint32_t frame = header->video_frame_counter;
+	unsigned int slot = frame % TAP_VIDEO_RING_SIZE;
+	TapVideoFrameInfo *info = GetTapVideoFrameInfo(m_mmap_ptr, slot);
+	++info->sequence;
+	std::atomic_thread_fence(std::memory_order_release);
+	info->frame_number = frame;
+	info->timestamp = timestamp;
+
+	// scale the frame directly into the slot
+	uint8_t *image_data = (uint8_t*) m_mmap_ptr + header->video_data_offset + (size_t) header->video_slot_size * slot;
+	int image_stride = header->video_stride;
+	m_fast_scaler.Scale(width, height, format, colorspace, &data, &stride,
+						m_width, m_height, AV_PIX_FMT_BGRA, SWS_CS_DEFAULT, &image_data, &image_stride);
+
+	// finish writing the slot
+	std::atomic_thread_fence(std::memory_order_release);
+	++info->sequence;
+	std::atomic_thread_fence(std::memory_order_release);
+	header->video_frame_counter = frame + 1;
+
+}
+
+void TapSink::ReadAudioSamples(unsigned int channels, unsigned int sample_rate, AVSampleFormat format, unsigned int sample_count, const uint8_t* data, int64_t timestamp) {
+
+	if(m_audio_channels == 0 || channels == 0)
+		return;
+
+	// split large packets
+	unsigned int sample_size = channels * ((format == AV_SAMPLE_FMT_S16)? 2 : 4);
+	while(sample_count != 0) {
+		unsigned int count = std::min(sample_count, (unsigned int) TAP_AUDIO_PACKET_MAX_SAMPLES);
+		WriteAudioPacket(channels, sample_rate, format, count, data, timestamp);
+		sample_count -= count;
+		data += (size_t) count * sample_size;
+		timestamp += (int64_t) count * (int64_t) 1000000 / (int64_t) sample_rate;
+	}
+
+}
+
+void TapSink::WriteAudioPacket(unsigned int channels, unsigned int sample_rate, AVSampleFormat format, unsigned int sample_count, const uint8_t* data, int64_t timestamp) {
+
+	// start writing the slot
+	TapHeader *header = GetTapHeader();
+	uint32_t packet = header->audio_packet_counter;
+	unsigned int slot = packet % TAP_AUDIO_RING_SIZE;
+	TapAudioPacketInfo *info = GetTapAudioPacketInfo(m_mmap_ptr, slot);
+	++info->sequence;
+	std::atomic_thread_fence(std::memory_order_release);
+	info->packet_number = packet;
+	info->timestamp = timestamp;
+	info->sample_rate = sample_rate;
+	info->sample_count = sample_count;
+
+	// convert the samples directly into the slot
+	float *out_data = (float*) ((uint8_t*) m_mmap_ptr + header->audio_data_offset + (size_t) header->audio_slot_size * slot);
+	switch(format) {
+		case AV_SAMPLE_FMT_S16: SampleChannelRemap(sample_count, (const int16_t*) data, channels, out_data, m_audio_channels); break;
+		case AV_SAMPLE_FMT_S32: SampleChannelRemap(sample_count, (const int32_t*) data, channels, out_data, m_audio_channels); break;
+		case AV_SAMPLE_FMT_FLT: SampleChannelRemap(sample_count, (const float*) data, channels, out_data, m_audio_channels); break;
+		default: {
+			assert(false); // unsupported sample format
+			break;
+		}
+	}
+
+	// finish writing the slot
+	std::atomic_thread_fence(std::memory_order_release);
+	++info->sequence;
+	std::atomic_thread_fence(std::memory_order_release);
+	header->audio_packet_counter = packet + 1;
+
+}
@@ -0,0 +1,80 @@
+/*
+Copyright (c) 2012-2020 Maarten Baert <maarten-baert@hotmail.com>
+
+This file is part of SimpleScreenRecorder.
+
+SimpleScreenRecorder is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+SimpleScreenRecorder is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with SimpleScreenRecorder.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#pragma once
+#include "Global.h"
+
+#include "SourceSink.h"
+#include "MutexDataPair.h"
+#include "FastScaler.h"
+
+#include "../tap/TapStructs.h"
+
+// Republishes the recorded video frames and audio samples in a shared memory file, so other local processes can use them
+// without decoding the output file (see tap/TapStructs.h for the file format and tap/SSRTapReader.h for the reader).
+// The frames are converted to BGRA at the output size. Readers can never block the recording: if they are too slow, they miss frames.
+class TapSink : public VideoSink, public AudioSink {
+
+private:
+	struct SharedData {
+		int64_t m_next_frame_time;
+	};
+	typedef MutexDataPair<SharedData>::Lock SharedLock;
+
+private:
+	QString m_filename;
+	unsigned int m_width, m_height, m_frame_rate, m_audio_channels;
+
+	int m_fd;
+	void *m_mmap_ptr;
+	size_t m_mmap_size;
+
+	FastScaler m_fast_scaler;
+
+	MutexDataPair<SharedData> m_shared_data;
+
+public:
+	TapSink(const QString& filename, unsigned int width, unsigned int height, unsigned int frame_rate, unsigned int audio_channels);
+	~TapSink();
+
+	// Returns the preferred next video timestamp.
+	// This function is thread-safe.
+	virtual int64_t GetNextVideoTimestamp() override;
+
+	// Reads a video frame from the video source.
+	// This function is thread-safe, but only one video source should be connected.
+	virtual void ReadVideoFrame(unsigned int width, unsigned int height, const uint8_t* data, int stride, AVPixelFormat format, int colorspace, int64_t timestamp) override;
+
+	// Reads audio samples from the audio source.
+	// This function is thread-safe, but only one audio source should be connected.
+	virtual void ReadAudioSamples(unsigned int channels, unsigned int sample_rate, AVSampleFormat format, unsigned int sample_count, const uint8_t* data, int64_t timestamp) override;
+
+private:
+	void Init();
+	void Free();
+
+	// Returns whether the existing file is a tap file that was created by this user and can be replaced safely.
+	static bool IsTapFile(const char* filename, const struct stat& statinfo);
+
+	void WriteAudioPacket(unsigned int channels, unsigned int sample_rate, AVSampleFormat format, unsigned int sample_count, const uint8_t* data, int64_t timestamp);
+
+	inline TapHeader* GetTapHeader() { return (TapHeader*) m_mmap_ptr; }
+
+};
@@ -0,0 +1,466 @@
+/*
+Copyright (c) 2012-2020 Maarten Baert <maarten-baert@hotmail.com>
+
+This file is part of SimpleScreenRecorder.
+
+SimpleScreenRecorder is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+SimpleScreenRecorder is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with SimpleScreenRecorder.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#include "UDPTransport.h"
+
+#include "Logger.h"
+
+#include <fcntl.h>
+#include <netdb.h>
+#include <netinet/in.h>
+#include <poll.h>
+#include <sys/types.h>
+
+static void WriteBE16(uint8_t* p, uint16_t x) {
+	p[0] = x >> 8;
+	p[1] = x;
+}
+static void WriteBE32(uint8_t* p, uint32_t x) {
+	p[0] = x >> 24;
+	p[1] = x >> 16;
+	p[2] = x >> 8;
+	p[3] = x;
+}
+
+static void WriteRTPHeader(uint8_t* p, unsigned int payload_type, uint16_t sequence, uint32_t ssrc) {
+	p[0] = 0x80; // version 2, no padding, no extension, no CSRC
+	p[1] = payload_type;
+	WriteBE16(p + 2, sequence);
+	WriteBE32(p + 4, (uint32_t) (hrt_time_micro() * 9 / 100)); // 90kHz clock
+	WriteBE32(p + 8, ssrc);
+}
+
+UDPTransport::UDPTransport(const QString& url, unsigned int nominal_bit_rate) {
+
+	m_url = url;
+	m_latency = 500;
+	m_nominal_bit_rate = nominal_bit_rate;
+	m_fec_group_size = 0;
+	m_ttl = -1;
+
+	m_socket = -1;
+
+	m_pending.m_size = 0;
+
+	m_rtp_sequence = 0;
+	m_rtp_fec_sequence = 0;
+	m_rtp_ssrc = 0;
+	m_fec_base = 0;
+	m_fec_length_recovery = 0;
+	m_fec_count = 0;
+
+	{
+		SharedLock lock(&m_shared_data);
+		lock->m_queue.resize(UDP_TRANSPORT_MAX_QUEUE);
+		lock->m_queue_read = 0;
+		lock->m_queue_size = 0;
+		lock->m_input_bytes = 0;
+		lock->m_sender_busy = false;
+		lock->m_end_of_stream = false;
+		lock->m_stats.m_sent_datagrams = 0;
+		lock->m_stats.m_sent_bytes = 0;
+		lock->m_stats.m_sent_fec_packets = 0;
+		lock->m_stats.m_dropped_datagrams = 0;
+		lock->m_stats.m_pacing_bit_rate = 0.0;
+		lock->m_stats.m_queued_datagrams = 0;
+	}
+
+	m_should_stop = false;
+	m_error_occurred = false;
+
+	try {
+		Init();
+	} catch(...) {
+		Free();
+		throw;
+	}
+
+}
+
+UDPTransport::~UDPTransport() {
+
+	// tell the thread to stop
+	if(m_thread.joinable()) {
+		Logger::LogInfo("[UDPTransport::~UDPTransport] " + Logger::tr("Stopping sender thread ..."));
+		m_should_stop = true;
+		m_thread.join();
+	}
+
+	// free everything
+	Free();
+
+}
+
+bool UDPTransport::IsTransportURL(const QString& url) {
+	return url.startsWith("tsudp://", Qt::CaseInsensitive);
+}
+
+void UDPTransport::Write(const uint8_t* data, size_t size) {
+	while(size != 0) {
+		size_t n = std::min(size, (size_t) (UDP_TRANSPORT_PAYLOAD_SIZE - m_pending.m_size));
+		memcpy(m_pending.m_data + UDP_TRANSPORT_HEADER_SPACE + m_pending.m_size, data, n);
+		m_pending.m_size += n;
+		data += n;
+		size -= n;
+		if(m_pending.m_size == UDP_TRANSPORT_PAYLOAD_SIZE) {
+			QueueDatagram(m_pending);
+			m_pending.m_size = 0;
+		}
+	}
+}
+
+void UDPTransport::Flush() {
+	if(m_pending.m_size != 0) {
+		QueueDatagram(m_pending);
+		m_pending.m_size = 0;
+	}
+	SharedLock lock(&m_shared_data);
+	lock->m_end_of_stream = true;
+}
+
+bool UDPTransport::WaitForQueue(int64_t timeout) {
+	int64_t end = hrt_time_micro() + timeout;
+	for( ; ; ) {
+		{
+			SharedLock lock(&m_shared_data);
+			if(lock->m_queue_size == 0 && !lock->m_sender_busy)
+				return true;
+		}
+		if(m_error_occurred || hrt_time_micro() >= end)
+			return false;
+		usleep(1000);
+	}
+}
+
+UDPTransport::Stats UDPTransport::GetStats() {
+	SharedLock lock(&m_shared_data);
+	return lock->m_stats;
+}
+
+#if SSR_USE_AVIO_WRITE_PACKET_CONST
+int UDPTransport::AVIOWritePacket(void* opaque, const uint8_t* buf, int buf_size) {
+#else
+int UDPTransport::AVIOWritePacket(void* opaque, uint8_t* buf, int buf_size) {
+#endif
+	UDPTransport *transport = (UDPTransport*) opaque;
+	transport->Write(buf, buf_size);
+	return buf_size;
+}
+
+void UDPTransport::Init() {
+
+	// parse the URL
+	QRegExp url_regex("^tsudp://(\\[[^\\]]+\\]|[^:/?\\[\\]]+):([0-9]+)/?(\\?(.*))?$", Qt::CaseInsensitive, QRegExp::RegExp);
+	if(url_regex.indexIn(m_url) < 0) {
+		Logger::LogError("[UDPTransport::Init] " + Logger::tr("Error: Invalid URL '%1', expected 'tsudp://HOST:PORT[?OPTIONS]'!").arg(m_url));
+		throw NetworkException();
+	}
+	QString host = url_regex.cap(1);
+	if(host.startsWith("["))
+		host = host.mid(1, host.length() - 2);
+	unsigned int port = url_regex.cap(2).toUInt();
+	if(port == 0 || port > 65533) {
+		Logger::LogError("[UDPTransport::Init] " + Logger::tr("Error: Invalid port %1!").arg(port));
+		throw NetworkException();
+	}
+	QStringList options = url_regex.cap(4).split('&', QString::SkipEmptyParts);
+	for(const QString &option : options) {
+		QString key = option.section('=', 0, 0), value = option.section('=', 1);
+		bool ok = false;
+		unsigned int number = value.toUInt(&ok);
+		if(key == "latency" && ok) {
+			m_latency = clamp(number, 10u, 10000u);
+		} else if(key == "bitrate" && ok) {
+			m_nominal_bit_rate = clamp(number, 1u, 10000000u) * 1000;
+		} else if(key == "fec" && ok) {
+			m_fec_group_size = (number < 2)? 0 : std::min(number, 100u);
+		} else if(key == "ttl" && ok) {
+			m_ttl = clamp(number, 1u, 255u);
+		} else {
+			Logger::LogWarning("[UDPTransport::Init] " + Logger::tr("Warning: Unknown or invalid transport option '%1', ignored.").arg(option));
+		}
+	}
+
+	// resolve the address
+	addrinfo hints, *result = NULL;
+	memset(&hints, 0, sizeof(hints));
+	hints.ai_family = AF_UNSPEC;
+	hints.ai_socktype = SOCK_DGRAM;
+	hints.ai_flags = AI_NUMERICSERV;
+	int error = getaddrinfo(host.toUtf8().constData(), QString::number(port).toUtf8().constData(), &hints, &result);
+	if(error != 0 || result == NULL) {
+		Logger::LogError("[UDPTransport::Init] " + Logger::tr("Error: Can't resolve host '%1': %2").arg(host).arg(gai_strerror(error)));
+		throw NetworkException();
+	}
+	memcpy(&m_address_data, result->ai_addr, result->ai_addrlen);
+	m_address_length = result->ai_addrlen;
+	int family = result->ai_family;
+	freeaddrinfo(result);
+
+	// FEC packets go to the next-next port
+	memcpy(&m_address_fec, &m_address_data, m_address_length);
+	if(family == AF_INET6)
+		((sockaddr_in6*) &m_address_fec)->sin6_port = htons(port + 2);
+	else
+		((sockaddr_in*) &m_address_fec)->sin_port = htons(port + 2);
+
+	// create the socket
+	// The socket is non-blocking because a stalled network should never stop the sender thread from dropping old data.
+	m_socket = socket(family, SOCK_DGRAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+	if(m_socket == -1) {
+		Logger::LogError("[UDPTransport::Init] " + Logger::tr("Error: Can't create socket!"));
+		throw NetworkException();
+	}
+	int send_buffer = 1024 * 1024;
+	setsockopt(m_socket, SOL_SOCKET, SO_SNDBUF, &send_buffer, sizeof(send_buffer));
+	if(m_ttl >= 0) {
+		if(family == AF_INET6) {
+			setsockopt(m_socket, IPPROTO_IPV6, IPV6_MULTICAST_HOPS, &m_ttl, sizeof(m_ttl));
+			setsockopt(m_socket, IPPROTO_IPV6, IPV6_UNICAST_HOPS, &m_ttl, sizeof(m_ttl));
+		} else {
+			setsockopt(m_socket, IPPROTO_IP, IP_MULTICAST_TTL, &m_ttl, sizeof(m_ttl));
+			setsockopt(m_socket, IPPROTO_IP, IP_TTL, &m_ttl, sizeof(m_ttl));
+		}
+	}
+
+	// initialize RTP
+	m_rtp_ssrc = (uint32_t) (hrt_time_micro() ^ ((int64_t) getpid() << 16));
+	m_rtp_sequence = (uint16_t) m_rtp_ssrc;
+
+	Logger::LogInfo("[UDPTransport::Init] " + Logger::tr("Sending MPEG-TS to %1 port %2 (%3, latency %4 ms).")
+					.arg(host).arg(port).arg((m_fec_group_size == 0)? Logger::tr("raw UDP") : Logger::tr("RTP with FEC every %1 packets").arg(m_fec_group_size)).arg(m_latency));
+
+	// start sender thread
+	m_thread = std::thread(&UDPTransport::SenderThread, this);
+
+}
+
+void UDPTransport::Free() {
+	if(m_socket != -1) {
+		close(m_socket);
+		m_socket = -1;
+	}
+}
+
+void UDPTransport::QueueDatagram(Datagram& datagram) {
+	datagram.m_queue_time = hrt_time_micro();
+	SharedLock lock(&m_shared_data);
+	if(lock->m_queue_size == lock->m_queue.size()) {
+		// the queue is full, drop the oldest datagram
+		lock->m_queue_read = (lock->m_queue_read + 1) % lock->m_queue.size();
+		--lock->m_queue_size;
+		++lock->m_stats.m_dropped_datagrams;
+	}
+	Datagram &d = lock->m_queue[(lock->m_queue_read + lock->m_queue_size) % lock->m_queue.size()];
+	d.m_queue_time = datagram.m_queue_time;
+	d.m_size = datagram.m_size;
+	memcpy(d.m_data + UDP_TRANSPORT_HEADER_SPACE, datagram.m_data + UDP_TRANSPORT_HEADER_SPACE, datagram.m_size);
+	++lock->m_queue_size;
+	lock->m_input_bytes += datagram.m_size;
+}
+
+void UDPTransport::PrepareDatagram(Datagram& datagram) {
+
+	// raw UDP: only the payload is sent
+	datagram.m_fec = false;
+	if(m_fec_group_size == 0) {
+		datagram.m_offset = UDP_TRANSPORT_HEADER_SPACE;
+		return;
+	}
+
+	// RTP: add the header right before the payload
+	datagram.m_offset = UDP_TRANSPORT_HEADER_SPACE - UDP_TRANSPORT_RTP_HEADER_SIZE;
+	uint16_t sequence = m_rtp_sequence++;
+	WriteRTPHeader(datagram.m_data + datagram.m_offset, UDP_TRANSPORT_RTP_PAYLOAD_TYPE_MP2T, sequence, m_rtp_ssrc);
+
+	// update the parity of the current FEC group
+	if(m_fec_count == 0) {
+		m_fec_base = sequence;
+		m_fec_length_recovery = 0;
+		memset(m_fec_payload, 0, UDP_TRANSPORT_PAYLOAD_SIZE);
+	}
+	const uint8_t *payload = datagram.m_data + UDP_TRANSPORT_HEADER_SPACE;
+	for(unsigned int i = 0; i < datagram.m_size; ++i) {
+		m_fec_payload[i] ^= payload[i];
+	}
+	m_fec_length_recovery ^= datagram.m_size;
+	++m_fec_count;
+
+	// add a FEC packet to the batch when the group is complete
+	if(m_fec_count == m_fec_group_size)
+		AddFECPacket(datagram.m_queue_time);
+
+}
+
+void UDPTransport::AddFECPacket(int64_t queue_time) {
+
+	// This doesn't invalidate the datagrams in the batch because the batch has enough space reserved.
+	m_batch.emplace_back();
+	Datagram &fec = m_batch.back();
+	fec.m_queue_time = queue_time;
+	fec.m_offset = 0;
+	fec.m_size = UDP_TRANSPORT_PAYLOAD_SIZE;
+	fec.m_fec = true;
+	WriteRTPHeader(fec.m_data, UDP_TRANSPORT_RTP_PAYLOAD_TYPE_FEC, m_rtp_fec_sequence++, m_rtp_ssrc);
+	uint8_t *header = fec.m_data + UDP_TRANSPORT_RTP_HEADER_SIZE;
+	WriteBE16(header, m_fec_base);
+	header[2] = m_fec_count;
+	header[3] = 0;
+	WriteBE16(header + 4, m_fec_length_recovery);
+	memcpy(fec.m_data + UDP_TRANSPORT_HEADER_SPACE, m_fec_payload, UDP_TRANSPORT_PAYLOAD_SIZE);
+	m_fec_count = 0;
+
+}
+
+unsigned int UDPTransport::SendBatch(unsigned int first, unsigned int count) {
+	mmsghdr messages[UDP_TRANSPORT_BATCH_SIZE * 2];
+	iovec vectors[UDP_TRANSPORT_BATCH_SIZE * 2];
+	count = std::min(count, (unsigned int) (UDP_TRANSPORT_BATCH_SIZE * 2));
+	for(unsigned int i = 0; i < count; ++i) {
+		Datagram &d = m_batch[first + i];
+		vectors[i].iov_base = d.m_data + d.m_offset;
+		vectors[i].iov_len = UDP_TRANSPORT_HEADER_SPACE - d.m_offset + d.m_size;
+		memset(&messages[i], 0, sizeof(mmsghdr));
+		messages[i].msg_hdr.msg_name = (d.m_fec)? &m_address_fec : &m_address_data;
+		messages[i].msg_hdr.msg_namelen = m_address_length;
+		messages[i].msg_hdr.msg_iov = &vectors[i];
+		messages[i].msg_hdr.msg_iovlen = 1;
+	}
+	int sent = sendmmsg(m_socket, messages, count, 0);
+	if(sent < 0) {
+		if(errno == EAGAIN || errno == EWOULDBLOCK || errno == ENOBUFS || errno == EINTR)
+			return 0;
+		Logger::LogError("[UDPTransport::SendBatch] " + Logger::tr("Error: Can't send datagrams: %1").arg(strerror(errno)));
+		throw NetworkException();
+	}
+	return sent;
+}
+
+void UDPTransport::SenderThread() {
+	try {
+
+		Logger::LogInfo("[UDPTransport::SenderThread] " + Logger::tr("Sender thread started."));
+
+		const unsigned int datagram_bytes = UDP_TRANSPORT_HEADER_SPACE + UDP_TRANSPORT_PAYLOAD_SIZE;
+		m_batch.reserve(UDP_TRANSPORT_BATCH_SIZE * 2);
+		unsigned int batch_sent = 0;
+
+		int64_t last_time = hrt_time_micro(), rate_time = last_time;
+		uint64_t rate_bytes = 0;
+		double tokens = 0.0, input_bit_rate = 0.0, pacing_bit_rate = 0.0;
+
+		while(!m_should_stop) {
+
+			int64_t timestamp = hrt_time_micro();
+			unsigned int queue_size;
+			{
+				SharedLock lock(&m_shared_data);
+
+				// estimate the input bit rate (this is used when the encoder bit rate is unknown, e.g. with constant quality)
+				if(timestamp - rate_time >= 250000) {
+					double bit_rate = (double) ((lock->m_input_bytes - rate_bytes) * 8) * 1.0e6 / (double) (timestamp - rate_time);
+					input_bit_rate = (input_bit_rate == 0.0)? bit_rate : input_bit_rate * 0.75 + bit_rate * 0.25;
+					rate_time = timestamp;
+					rate_bytes = lock->m_input_bytes;
+				}
+
+				// drop datagrams that have exceeded the latency budget
+				while(lock->m_queue_size != 0 && lock->m_queue[lock->m_queue_read].m_queue_time < timestamp - (int64_t) m_latency * 1000) {
+					lock->m_queue_read = (lock->m_queue_read + 1) % lock->m_queue.size();
+					--lock->m_queue_size;
+					++lock->m_stats.m_dropped_datagrams;
+				}
+
+				// Pace at the nominal bit rate with some headroom for bursts (keyframes), but never slower than what is needed to
+				// drain the current backlog within half the latency budget.
+				double backlog_bit_rate = (double) (lock->m_queue_size * UDP_TRANSPORT_PAYLOAD_SIZE * 8) / ((double) m_latency * 0.5e-3);
+				pacing_bit_rate = std::max(std::max(std::max((double) m_nominal_bit_rate, input_bit_rate) * 1.25, backlog_bit_rate), 256000.0);
+				tokens = std::min(tokens + pacing_bit_rate / 8.0 * (double) (timestamp - last_time) * 1.0e-6, (double) (datagram_bytes * UDP_TRANSPORT_BATCH_SIZE));
+				last_time = timestamp;
+
+				// get a new batch if the previous one was sent completely
+				if(batch_sent == m_batch.size()) {
+					m_batch.clear();
+					batch_sent = 0;
+					unsigned int count = std::min(std::min((unsigned int) lock->m_queue_size, (unsigned int) UDP_TRANSPORT_BATCH_SIZE), (unsigned int) (tokens / datagram_bytes));
+					for(unsigned int i = 0; i < count; ++i) {
+						m_batch.push_back(lock->m_queue[lock->m_queue_read]);
+						lock->m_queue_read = (lock->m_queue_read + 1) % lock->m_queue.size();
+						--lock->m_queue_size;
+						PrepareDatagram(m_batch[m_batch.size() - 1]);
+					}
+					// at the end of the stream, the last group is protected even if it is incomplete
+					if(lock->m_queue_size == 0 && lock->m_end_of_stream && m_fec_count != 0)
+						AddFECPacket(timestamp);
+				}
+
+				queue_size = lock->m_queue_size;
+				lock->m_sender_busy = (batch_sent != m_batch.size());
+				lock->m_stats.m_pacing_bit_rate = pacing_bit_rate;
+				lock->m_stats.m_queued_datagrams = queue_size;
+			}
+
+			// wait if there is nothing to send
+			if(batch_sent == m_batch.size()) {
+				if(queue_size == 0) {
+					usleep(1000);
+				} else {
+					double delay = ((double) datagram_bytes - tokens) * 8.0 / pacing_bit_rate * 1.0e6;
+					usleep(clamp((int64_t) delay, (int64_t) 100, (int64_t) 20000));
+				}
+				continue;
+			}
+
+			// send the batch
+			unsigned int sent = SendBatch(batch_sent, m_batch.size() - batch_sent);
+			if(sent == 0) {
+				// the socket buffer is full, wait until there is space
+				pollfd pfd = {m_socket, POLLOUT, 0};
+				poll(&pfd, 1, 10);
+				continue;
+			}
+			uint64_t sent_bytes = 0, sent_fec = 0;
+			for(unsigned int i = batch_sent; i < batch_sent + sent; ++i) {
+				sent_bytes += UDP_TRANSPORT_HEADER_SPACE - m_batch[i].m_offset + m_batch[i].m_size;
+				if(m_batch[i].m_fec)
+					++sent_fec;
+			}
+			batch_sent += sent;
+			tokens -= (double) sent_bytes;
+			{
+				SharedLock lock(&m_shared_data);
+				lock->m_stats.m_sent_datagrams += sent - sent_fec;
+				lock->m_stats.m_sent_fec_packets += sent_fec;
+				lock->m_stats.m_sent_bytes += sent_bytes;
+				lock->m_sender_busy = (batch_sent != m_batch.size());
+			}
+
+		}
+
+		Logger::LogInfo("[UDPTransport::SenderThread] " + Logger::tr("Sender thread stopped."));
+
+	} catch(const std::exception& e) {
+		m_error_occurred = true;
+		Logger::LogError("[UDPTransport::SenderThread] " + Logger::tr("Exception '%1' in sender thread.").arg(e.what()));
+	} catch(...) {
+		m_error_occurred = true;
+		Logger::LogError("[UDPTransport::SenderThread] " + Logger::tr("Unknown exception in sender thread."));
+	}
+}
@@ -0,0 +1,146 @@
+/*
+Copyright (c) 2012-2020 Maarten Baert <maarten-baert@hotmail.com>
+
+This file is part of SimpleScreenRecorder.
+
+SimpleScreenRecorder is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+SimpleScreenRecorder is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with SimpleScreenRecorder.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#pragma once
+#include "Global.h"
+
+#include "MutexDataPair.h"
+
+#include <sys/socket.h>
+
+// MPEG-TS packets are always 188 bytes, and 7 of them fit in a standard 1500-byte MTU.
+#define UDP_TRANSPORT_TS_PACKET_SIZE 188
+#define UDP_TRANSPORT_PAYLOAD_SIZE (UDP_TRANSPORT_TS_PACKET_SIZE * 7)
+#define UDP_TRANSPORT_RTP_HEADER_SIZE 12
+#define UDP_TRANSPORT_FEC_HEADER_SIZE 6
+#define UDP_TRANSPORT_HEADER_SPACE (UDP_TRANSPORT_RTP_HEADER_SIZE + UDP_TRANSPORT_FEC_HEADER_SIZE)
+#define UDP_TRANSPORT_BATCH_SIZE 16
+#define UDP_TRANSPORT_MAX_QUEUE 4096
+#define UDP_TRANSPORT_RTP_PAYLOAD_TYPE_MP2T 33
+#define UDP_TRANSPORT_RTP_PAYLOAD_TYPE_FEC 96
+
+// A low-latency transport for MPEG-TS over UDP, used by the muxer for 'tsudp://HOST:PORT[?OPTIONS]' URLs.
+// The muxer writes the stream into a queue, and a separate thread sends it in paced batches of 1316-byte datagrams with sendmmsg.
+// The muxer never waits for the network: if the queue holds more than the latency budget, the oldest datagrams are dropped.
+// Options (separated by '&'):
+// - latency=MS: The maximum time a datagram can spend in the queue (default 500).
+// - bitrate=KBIT: The nominal bit rate used for pacing (default: the sum of the encoder bit rates, or the measured rate).
+// - fec=N: Send RTP (RFC 2250) instead of raw datagrams, and send one XOR parity packet for every N data packets to PORT + 2.
+//   A receiver can recover one lost packet per group. The parity packets use a custom format that is not compatible with any
+//   standard FEC scheme, so only the receiver in the benchmark understands them. Other receivers can still play the data packets.
+//   The parity packet is an RTP packet (payload type 96) followed by a 6-byte header (16-bit sequence number of the first packet
+//   of the group, 8-bit group size, 8-bit reserved, 16-bit XOR of the payload lengths) and the XOR of all payloads (zero-padded
+//   to 1316 bytes). The last group of the stream can be smaller than N.
+// - ttl=N: The time-to-live (or hop limit) for multicast destinations.
+// Retransmission is not supported since it requires a return channel, use FEC instead.
+class UDPTransport {
+
+public:
+	struct Stats {
+		uint64_t m_sent_datagrams, m_sent_bytes, m_sent_fec_packets;
+		uint64_t m_dropped_datagrams;
+		double m_pacing_bit_rate;
+		unsigned int m_queued_datagrams;
+	};
+
+private:
+	struct Datagram {
+		int64_t m_queue_time;
+		unsigned int m_offset, m_size; // the datagram starts at m_offset, the payload (m_size bytes) always starts at UDP_TRANSPORT_HEADER_SPACE
+		bool m_fec;
+		uint8_t m_data[UDP_TRANSPORT_HEADER_SPACE + UDP_TRANSPORT_PAYLOAD_SIZE];
+	};
+	struct SharedData {
+		std::vector<Datagram> m_queue; // ring buffer
+		size_t m_queue_read, m_queue_size;
+		uint64_t m_input_bytes;
+		bool m_sender_busy, m_end_of_stream;
+		Stats m_stats;
+	};
+	typedef MutexDataPair<SharedData>::Lock SharedLock;
+
+private:
+	QString m_url;
+	unsigned int m_latency, m_nominal_bit_rate, m_fec_group_size;
+	int m_ttl;
+
+	int m_socket;
+	sockaddr_storage m_address_data, m_address_fec;
+	socklen_t m_address_length;
+
+	// only used by the muxer thread
+	Datagram m_pending;
+
+	// only used by the sender thread
+	std::vector<Datagram> m_batch;
+	uint16_t m_rtp_sequence, m_rtp_fec_sequence;
+	uint32_t m_rtp_ssrc;
+	uint16_t m_fec_base, m_fec_length_recovery;
+	unsigned int m_fec_count;
+	uint8_t m_fec_payload[UDP_TRANSPORT_PAYLOAD_SIZE];
+
+	std::thread m_thread;
+	MutexDataPair<SharedData> m_shared_data;
+	std::atomic<bool> m_should_stop, m_error_occurred;
+
+public:
+	UDPTransport(const QString& url, unsigned int nominal_bit_rate);
+	~UDPTransport();
+
+	// Returns whether the URL should be handled by this transport.
+	static bool IsTransportURL(const QString& url);
+
+	// Adds data to the stream. This never blocks. Called by the muxer.
+	void Write(const uint8_t* data, size_t size);
+
+	// Queues the last incomplete datagram and ends the stream, so the parity of the last incomplete FEC group is sent as well.
+	// Called by the muxer after writing the trailer.
+	void Flush();
+
+	// Waits until the queue is empty or the timeout expires. Returns whether the queue is empty.
+	bool WaitForQueue(int64_t timeout);
+
+	// Returns the transport statistics.
+	// This function is thread-safe.
+	Stats GetStats();
+
+	// Returns whether an error has occurred in the sender thread.
+	// This function is thread-safe and lock-free.
+	inline bool HasErrorOccurred() { return m_error_occurred; }
+
+	// Callback for avio_alloc_context.
+#if SSR_USE_AVIO_WRITE_PACKET_CONST
+	static int AVIOWritePacket(void* opaque, const uint8_t* buf, int buf_size);
+#else
+	static int AVIOWritePacket(void* opaque, uint8_t* buf, int buf_size);
+#endif
+
+private:
+	void Init();
+	void Free();
+
+	void QueueDatagram(Datagram& datagram);
+	void PrepareDatagram(Datagram& datagram);
+	void AddFECPacket(int64_t queue_time);
+	unsigned int SendBatch(unsigned int first, unsigned int count);
+
+	void SenderThread();
+
+};
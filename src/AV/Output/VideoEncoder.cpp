@@ -22,8 +22,11 @@ along with SimpleScreenRecorder.  If not, see <http://www.gnu.org/licenses/>.
 #include "Logger.h"
 #include "AVWrapper.h"
 #include "Muxer.h"
+#include "ThreadBudget.h"
 #include "X264Presets.h"
 
+std::atomic<int64_t> VideoEncoder::s_benchmark_frame_delay(0);
+
 const std::vector<VideoEncoder::PixelFormatData> VideoEncoder::SUPPORTED_PIXEL_FORMATS = {
 	{"nv12", AV_PIX_FMT_NV12, true},
 	{"yuv420", AV_PIX_FMT_YUV420P, true},
@@ -99,13 +102,17 @@ bool VideoEncoder::AVCodecIsSupported(const QString& codec_name) {
 	AVCodec *codec = (AVCodec*) avcodec_find_encoder_by_name(codec_name.toUtf8().constData());
 	if(codec == NULL)
 		return false;
+	return AVCodecIsSupported(codec);
+}
+
+bool VideoEncoder::AVCodecIsSupported(const AVCodec* codec) {
 	if(!av_codec_is_encoder(codec))
 		return false;
 	if(codec->type != AVMEDIA_TYPE_VIDEO)
 		return false;
 	for(unsigned int i = 0; i < SUPPORTED_PIXEL_FORMATS.size(); ++i) {
 		if(AVCodecSupportsPixelFormat(codec, SUPPORTED_PIXEL_FORMATS[i].m_format)) {
-			//qDebug() << codec_name << "supported by" << SUPPORTED_PIXEL_FORMATS[i].m_name;
+			//qDebug() << codec->name << "supported by" << SUPPORTED_PIXEL_FORMATS[i].m_name;
 			return true;
 		}
 	}
@@ -144,7 +151,7 @@ void VideoEncoder::PrepareStream(AVStream* stream, AVCodecContext* codec_context
 	codec_context->sample_aspect_ratio.num = 1;
 	codec_context->sample_aspect_ratio.den = 1;
 	stream->sample_aspect_ratio = codec_context->sample_aspect_ratio;
-	codec_context->thread_count = std::max(1, (int) std::thread::hardware_concurrency());
+	codec_context->thread_count = ThreadBudget::GetVideoEncoderThreads(1);
 
 	// parse options
 	QString pixel_format_name;
@@ -208,6 +215,9 @@ void VideoEncoder::PrepareStream(AVStream* stream, AVCodecContext* codec_context
 bool VideoEncoder::EncodeFrame(AVFrameWrapper* frame) {
 
 	if(frame != NULL) {
+		int64_t delay = s_benchmark_frame_delay;
+		if(delay != 0)
+			usleep(delay);
 #if SSR_USE_AVFRAME_WIDTH_HEIGHT
 		assert(frame->GetFrame()->width == GetCodecContext()->width);
 		assert(frame->GetFrame()->height == GetCodecContext()->height);
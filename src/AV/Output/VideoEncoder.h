@@ -33,6 +33,7 @@ private:
 
 private:
 	static const std::vector<PixelFormatData> SUPPORTED_PIXEL_FORMATS;
+	static std::atomic<int64_t> s_benchmark_frame_delay;
 
 private:
 #if !SSR_USE_AVCODEC_ENCODE_VIDEO2
@@ -53,8 +54,14 @@ public:
 	unsigned int GetHeight();
 	unsigned int GetFrameRate();
 
+	// Slows down all video encoders by sleeping for the given time (in microseconds) before every frame. This is only used by the
+	// benchmark to simulate an encoder that can't keep up. The sleep is counted as encoding time.
+	// This function is thread-safe and lock-free.
+	inline static void SetBenchmarkFrameDelay(int64_t delay) { s_benchmark_frame_delay = delay; }
+
 public:
 	static bool AVCodecIsSupported(const QString& codec_name);
+	static bool AVCodecIsSupported(const AVCodec* codec);
 	static void PrepareStream(AVStream* stream, AVCodecContext* codec_context, AVCodec* codec, AVDictionary** options, const std::vector<std::pair<QString, QString> >& codec_options,
 							  unsigned int bit_rate, unsigned int width, unsigned int height, unsigned int frame_rate);
 
@@ -0,0 +1,108 @@
+/*
+Copyright (c) 2012-2020 Maarten Baert <maarten-baert@hotmail.com>
+
+This file is part of SimpleScreenRecorder.
+
+SimpleScreenRecorder is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+SimpleScreenRecorder is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with SimpleScreenRecorder.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#include "SampleSlipper.h"
+
+SampleSlipper::SampleSlipper(unsigned int channels, float gain) {
+	assert(channels > 0);
+	m_channels = channels;
+	m_gain = gain;
+	Reset();
+}
+
+void SampleSlipper::Reset() {
+	m_slip = 0.0;
+}
+
+unsigned int SampleSlipper::Process(double drift_ratio, const float* samples_in, unsigned int sample_count_in, TempBuffer<float>* samples_out, unsigned int sample_offset_out) {
+
+	// update the slip, and limit it so we never slip more than one sample per block (and don't build up a large backlog)
+	m_slip = clamp(m_slip + (double) sample_count_in * (1.0 - 1.0 / drift_ratio), -2.0, 2.0);
+	int slip = 0;
+	if(sample_count_in >= SLIP_LENGTH + 2) {
+		if(m_slip >= 1.0)
+			slip = 1;
+		else if(m_slip <= -1.0)
+			slip = -1;
+	}
+	m_slip -= (double) slip;
+
+	// reserve memory
+	unsigned int sample_count_out = sample_count_in - slip;
+	samples_out->Alloc((sample_offset_out + sample_count_out) * m_channels, (sample_offset_out != 0));
+	float *out = samples_out->GetData() + sample_offset_out * m_channels;
+
+	// copy the samples, and stretch or squeeze one short section by one sample if needed
+	unsigned int pos = (slip == 0)? sample_count_in : FindQuietPoint(samples_in, sample_count_in);
+	for(unsigned int i = 0; i < pos * m_channels; ++i) {
+		out[i] = samples_in[i] * m_gain;
+	}
+	if(slip != 0) {
+		out += pos * m_channels;
+		double step = (double) (SLIP_LENGTH + slip) / (double) SLIP_LENGTH;
+		for(unsigned int j = 0; j < SLIP_LENGTH; ++j) {
+			double p = (double) j * step;
+			unsigned int index = (unsigned int) p;
+			float frac = (float) (p - (double) index), *in1 = (float*) samples_in + (pos + index) * m_channels, *in2 = in1 + m_channels;
+			for(unsigned int c = 0; c < m_channels; ++c) {
+				out[c] = (in1[c] + (in2[c] - in1[c]) * frac) * m_gain;
+			}
+			out += m_channels;
+		}
+		const float *in = samples_in + (pos + SLIP_LENGTH + slip) * m_channels;
+		for(unsigned int i = 0; i < (sample_count_in - pos - SLIP_LENGTH - slip) * m_channels; ++i) {
+			out[i] = in[i] * m_gain;
+		}
+	}
+
+	return sample_offset_out + sample_count_out;
+}
+
+unsigned int SampleSlipper::FindQuietPoint(const float* samples, unsigned int sample_count) {
+
+	// calculate the energy of each step
+	unsigned int steps = sample_count / SEARCH_STEP, window = SLIP_LENGTH / SEARCH_STEP;
+	assert(steps >= window);
+	m_step_energy.Alloc(steps);
+	for(unsigned int s = 0; s < steps; ++s) {
+		float energy = 0.0f;
+		for(unsigned int i = s * SEARCH_STEP * m_channels; i < (s + 1) * SEARCH_STEP * m_channels; ++i) {
+			energy += samples[i] * samples[i];
+		}
+		m_step_energy[s] = energy;
+	}
+
+	// find the section with the lowest energy (the slipped section must end before the last sample)
+	float energy = 0.0f;
+	for(unsigned int s = 0; s < window; ++s) {
+		energy += m_step_energy[s];
+	}
+	float best_energy = energy;
+	unsigned int best_pos = 0;
+	for(unsigned int s = 1; s + window <= steps && s * SEARCH_STEP + SLIP_LENGTH + 1 < sample_count; ++s) {
+		energy += m_step_energy[s + window - 1] - m_step_energy[s - 1];
+		if(energy < best_energy) {
+			best_energy = energy;
+			best_pos = s * SEARCH_STEP;
+		}
+	}
+
+	return best_pos;
+}
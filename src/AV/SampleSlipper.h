@@ -0,0 +1,55 @@
+/*
+Copyright (c) 2012-2020 Maarten Baert <maarten-baert@hotmail.com>
+
+This file is part of SimpleScreenRecorder.
+
+SimpleScreenRecorder is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+SimpleScreenRecorder is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with SimpleScreenRecorder.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#pragma once
+#include "Global.h"
+#include "TempBuffer.h"
+
+// A replacement for FastResampler for the case where the input and output sample rates are the same. The samples are simply copied,
+// and clock drift is absorbed by occasionally dropping or inserting a single sample. This is done at a quiet point in the audio, with a
+// short crossfade (actually a very short stretch of linear interpolation), so it's practically inaudible. This only works for small
+// amounts of drift (typically a few hundred ppm at most), larger corrections should be done with the resampler.
+class SampleSlipper {
+
+private:
+	static constexpr unsigned int SLIP_LENGTH = 32, SEARCH_STEP = 4;
+
+private:
+	unsigned int m_channels;
+	float m_gain;
+
+	double m_slip; // accumulated number of samples that should be dropped (positive) or inserted (negative)
+	TempBuffer<float> m_step_energy;
+
+public:
+	SampleSlipper(unsigned int channels, float gain);
+
+	// Forgets any accumulated drift.
+	void Reset();
+
+	// Copies input audio to the output, dropping or inserting samples as needed. The drift ratio has the same meaning as in FastResampler,
+	// i.e. the number of output samples is the number of input samples divided by the drift ratio (on average).
+	// Returns the new output offset (like FastResampler::Resample).
+	unsigned int Process(double drift_ratio, const float* samples_in, unsigned int sample_count_in, TempBuffer<float>* samples_out, unsigned int sample_offset_out);
+
+private:
+	unsigned int FindQuietPoint(const float* samples, unsigned int sample_count);
+
+};
@@ -68,6 +68,20 @@ int64_t VideoSource::CalculateNextVideoTimestamp() {
 	return SINK_TIMESTAMP_NONE;
 }
 
+bool VideoSource::HasVideoSinks() {
+	SharedLock lock(&m_shared_data);
+	return !lock->m_sinks.empty();
+}
+
+bool VideoSource::IsVideoBacklogged() {
+	SharedLock lock(&m_shared_data);
+	for(SinkData &s : lock->m_sinks) {
+		if(static_cast<VideoSink*>(s.sink)->IsVideoBacklogged())
+			return true;
+	}
+	return false;
+}
+
 void VideoSource::PushVideoFrame(unsigned int width, unsigned int height, const uint8_t* data, int stride, AVPixelFormat format, int colorspace, int64_t timestamp) {
 	SharedLock lock(&m_shared_data);
 	for(SinkData &s : lock->m_sinks) {
@@ -82,6 +96,20 @@ void VideoSource::PushVideoPing(int64_t timestamp) {
 	}
 }
 
+bool AudioSource::HasAudioSinks() {
+	SharedLock lock(&m_shared_data);
+	return !lock->m_sinks.empty();
+}
+
+bool AudioSource::IsAudioBacklogged() {
+	SharedLock lock(&m_shared_data);
+	for(SinkData &s : lock->m_sinks) {
+		if(static_cast<AudioSink*>(s.sink)->IsAudioBacklogged())
+			return true;
+	}
+	return false;
+}
+
 void AudioSource::PushAudioSamples(unsigned int channels, unsigned int sample_rate, AVSampleFormat format, unsigned int sample_count, const uint8_t* data, int64_t timestamp) {
 	SharedLock lock(&m_shared_data);
 	for(SinkData &s : lock->m_sinks) {
@@ -72,6 +72,8 @@ class VideoSource : private BaseSource {
 protected:
 	VideoSource() {}
 	int64_t CalculateNextVideoTimestamp();
+	bool HasVideoSinks();
+	bool IsVideoBacklogged();
 	void PushVideoFrame(unsigned int width, unsigned int height, const uint8_t* data, int stride, AVPixelFormat format, int colorspace, int64_t timestamp);
 	void PushVideoPing(int64_t timestamp);
 };
@@ -84,6 +86,9 @@ public:
 	inline void ConnectVideoSource(VideoSource* source, int priority = 0) { ConnectBaseSource(source, priority); }
 public:
 	virtual int64_t GetNextVideoTimestamp() { return SINK_TIMESTAMP_NONE; }
+	// Returns whether the sink can't keep up with the frames it receives. Live sources can ignore this,
+	// but sources that can produce frames faster than real time (e.g. files) should wait until this returns false.
+	virtual bool IsVideoBacklogged() { return false; }
 	virtual void ReadVideoFrame(unsigned int width, unsigned int height, const uint8_t* data, int stride, AVPixelFormat format, int colorspace, int64_t timestamp) = 0;
 	virtual void ReadVideoPing(int64_t timestamp) {}
 };
@@ -92,6 +97,8 @@ class AudioSource : private BaseSource {
 	friend class AudioSink;
 protected:
 	AudioSource() {}
+	bool HasAudioSinks();
+	bool IsAudioBacklogged();
 	void PushAudioSamples(unsigned int channels, unsigned int sample_rate, AVSampleFormat format, unsigned int sample_count, const uint8_t* data, int64_t timestamp);
 	void PushAudioHole();
 };
@@ -103,6 +110,8 @@ protected:
 public:
 	inline void ConnectAudioSource(AudioSource* source, int priority = 0) { ConnectBaseSource(source, priority); }
 public:
+	// Same as IsVideoBacklogged, but for audio.
+	virtual bool IsAudioBacklogged() { return false; }
 	virtual void ReadAudioSamples(unsigned int channels, unsigned int sample_rate, AVSampleFormat format, unsigned int sample_count, const uint8_t* data, int64_t timestamp) = 0;
 	virtual void ReadAudioHole() {}
 };
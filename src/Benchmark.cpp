@@ -20,14 +20,36 @@ along with SimpleScreenRecorder.  If not, see <http://www.gnu.org/licenses/>.
 #include "Benchmark.h"
 
 #include "AVWrapper.h"
+#include "CaptureTimestampFilter.h"
+#include "CodecCapabilities.h"
 #include "CPUFeatures.h"
+#include "DegradationController.h"
+#include "DriftEstimator.h"
+#include "FastResampler.h"
+#include "FastScaler.h"
 #include "FastScaler_Convert.h"
 #include "FastScaler_Scale.h"
 #include "Logger.h"
+#include "SampleSlipper.h"
+#include "OutputManager.h"
+#include "OutputSettings.h"
+#include "Synchronizer.h"
 #include "TempBuffer.h"
+#include "TestPatternInput.h"
+#include "ThreadBudget.h"
+#include "UDPTransport.h"
+#include "VideoEncoder.h"
+#include "XCBShmCapture.h"
 
+#include <deque>
 #include <random>
 
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <poll.h>
+#include <sys/resource.h>
+#include <sys/socket.h>
+
 struct ImageGeneric {
 
 	TempBuffer<uint8_t> m_buffer;
@@ -88,6 +110,44 @@ std::unique_ptr<ImageGeneric> NewImageBGR(unsigned int w, unsigned int h, std::m
 typedef std::unique_ptr<ImageGeneric> (*NewImageFunc)(unsigned int, unsigned int, std::mt19937&);
 typedef void (*ConvertFunc)(unsigned int, unsigned int, const uint8_t*, int, uint8_t* const*, const int*);
 
+// Returns the output settings for a benchmark that records to a temporary file. Settings that aren't set here are zero or empty,
+// so video and audio are disabled until a codec is selected.
+OutputSettings NewBenchmarkSettings(const QString& name) {
+	OutputSettings settings = OutputSettings();
+	settings.file = QDir::tempPath() + QString("/simplescreenrecorder-benchmark-%1-%2.mkv").arg(name).arg(getpid());
+	settings.container_avname = "matroska";
+	settings.recovery_journal = false;
+	settings.video_allow_frame_skipping = true;
+	return settings;
+}
+
+// Creates the output for a benchmark. If this fails, a warning is shown and NULL is returned, the benchmark should be skipped in that case.
+std::unique_ptr<OutputManager> NewBenchmarkOutput(const OutputSettings& settings, const QString& benchmark_name, const QString& description) {
+	try {
+		return std::unique_ptr<OutputManager>(new OutputManager(settings));
+	} catch(...) {
+		Logger::LogWarning("[" + benchmark_name + "] " + Logger::tr("Warning: Can't create output, skipping %1 benchmark.").arg(description));
+		QFile::remove(settings.file);
+		return std::unique_ptr<OutputManager>();
+	}
+}
+
+// Finishes the output of a benchmark, deletes it and removes the file. Returns the time needed to finish, which is the encoder backlog.
+// If total_bytes is not NULL, it is set to the size of the output before the output is deleted.
+int64_t FinishBenchmarkOutput(std::unique_ptr<OutputManager>* output_manager, const QString& file, uint64_t* total_bytes = NULL) {
+	int64_t t1 = hrt_time_micro();
+	(*output_manager)->Finish();
+	while(!(*output_manager)->IsFinished()) {
+		usleep(1000);
+	}
+	int64_t t2 = hrt_time_micro();
+	if(total_bytes != NULL)
+		*total_bytes = (*output_manager)->GetTotalBytes();
+	output_manager->reset();
+	QFile::remove(file);
+	return t2 - t1;
+}
+
 template<void (*T)(unsigned int, unsigned int, const uint8_t*, int, uint8_t*, int)>
 void PlaneWrapper(unsigned int w, unsigned int h, const uint8_t* in_data, int in_stride, uint8_t* const* out_data, const int* out_stride) {
 	T(w, h, in_data, in_stride, out_data[0], out_stride[0]);
@@ -248,6 +308,989 @@ void BenchmarkConvert(unsigned int w, unsigned int h, AVPixelFormat in_format, A
 
 }
 
+#if SSR_USE_XCB_SHM
+
+// This benchmark needs an X server, e.g. 'Xvfb :99 -screen 0 3840x2160x24' combined with DISPLAY=:99.
+void BenchmarkXCBCapture(unsigned int w, unsigned int h) {
+
+	const unsigned int depth_max = 3;
+	const unsigned int warmup_frames = 5, run_frames = 50;
+
+	std::mt19937 rng(12345);
+	std::unique_ptr<ImageGeneric> image_out = NewImageYUV420(w, h, rng);
+	FastScaler fast_scaler;
+
+	// run test
+	unsigned int time_depth[depth_max] = {};
+	for(unsigned int depth = 1; depth <= depth_max; ++depth) {
+		std::unique_ptr<XCBShmCapture> capture;
+		try {
+			capture.reset(new XCBShmCapture(depth));
+		} catch(const X11Exception&) {
+			Logger::LogWarning("[BenchmarkXCBCapture] " + Logger::tr("Warning: Can't connect to the X server, skipping capture benchmark."));
+			return;
+		}
+		if(capture->GetBitsPerPixel() != 32) {
+			Logger::LogWarning("[BenchmarkXCBCapture] " + Logger::tr("Warning: The X server doesn't use 32 bits per pixel, skipping capture benchmark."));
+			return;
+		}
+		if(capture->GetRootWidth() < w || capture->GetRootHeight() < h) {
+			Logger::LogInfo("[BenchmarkXCBCapture] " + Logger::tr("Screen is smaller than %1x%2, skipping.").arg(w).arg(h));
+			return;
+		}
+		unsigned int requested = 0, completed = 0;
+		int64_t t1 = 0;
+		while(completed < warmup_frames + run_frames) {
+			while(capture->CanRequest() && requested < warmup_frames + run_frames) {
+				capture->Request(0, 0, w, h);
+				++requested;
+			}
+			uint8_t *data;
+			int stride, x, y;
+			unsigned int width, height;
+			int64_t timestamp;
+			capture->Wait(&data, &stride, &x, &y, &width, &height, &timestamp);
+			fast_scaler.Scale(width, height, AV_PIX_FMT_BGRA, SWS_CS_ITU709, &data, &stride,
+							  w, h, AV_PIX_FMT_YUV420P, SWS_CS_ITU709, image_out->m_data.data(), image_out->m_stride.data());
+			++completed;
+			if(completed == warmup_frames)
+				t1 = hrt_time_micro();
+		}
+		int64_t t2 = hrt_time_micro();
+		time_depth[depth - 1] = (t2 - t1) / run_frames;
+	}
+
+	// print result
+	QString size = QString("%1x%2").arg(w).arg(h);
+	Logger::LogInfo("[BenchmarkXCBCapture] " + Logger::tr("Capture %1 + YUV420  |  Depth 1 %2 us (%3 fps)  |  Depth 2 %4 us (%5 fps)  |  Depth 3 %6 us (%7 fps)")
+					.arg(size, 9)
+					.arg(time_depth[0], 6).arg(1000000 / std::max(1u, time_depth[0]), 4)
+					.arg(time_depth[1], 6).arg(1000000 / std::max(1u, time_depth[1]), 4)
+					.arg(time_depth[2], 6).arg(1000000 / std::max(1u, time_depth[2]), 4));
+
+}
+
+#endif
+
+// Assigns frames to output frames like Synchronizer::DetachVideoBuffer does (without the segment and delay handling), relative to the first
+// frame. Frames that are too early are dropped (pts -1), and output frames that didn't get a frame are counted as gaps (they are filled
+// with duplicates).
+void PlaceVideoFrames(const std::vector<int64_t>& timestamps, unsigned int frame_rate, std::vector<int64_t>* pts, unsigned int* drops, unsigned int* gaps) {
+	int64_t video_pts = 0;
+	pts->clear();
+	*drops = 0;
+	*gaps = 0;
+	for(int64_t timestamp : timestamps) {
+		int64_t next_pts = (timestamp - timestamps[0]) * (int64_t) frame_rate / (int64_t) 1000000;
+		if(next_pts > video_pts)
+			--next_pts;
+		if(next_pts < video_pts) {
+			pts->push_back(-1);
+			++*drops;
+			continue;
+		}
+		*gaps += next_pts - video_pts;
+		video_pts = next_pts + 1;
+		pts->push_back(next_pts);
+	}
+}
+
+// Simulates two minutes of synchronous X11 captures at 60 fps while the X server is busy with other clients, and compares three ways
+// to timestamp the frames: the time of the request (the old method), the midpoint of the request and the reply, and CaptureTimestampFilter.
+// The server load is scripted with a fixed seed: each request has a chance of waiting behind requests of other clients, and the copy
+// itself takes 3 ms with a little noise. Like X11Input, the next capture is scheduled based on the previous timestamp. The error is
+// measured relative to the middle of the copy, the jitter is the RMS change of the error between frames. The frames are placed like
+// the synchronizer does, frames that end up in a different output frame than they would with the real capture time are misplaced.
+void BenchmarkCaptureTimestamps(const QString& trace_name, double load_probability, double load_mean) {
+
+	const unsigned int frame_rate = 60, frames = 60 * 120;
+	const double copy_time = 0.003, copy_noise = 0.0002, sleep_overshoot = 0.0001, reply_latency = 0.00005;
+	const int64_t frame_interval = 1000000 / frame_rate;
+
+	// generate the script
+	std::mt19937 rng(12345);
+	std::normal_distribution<double> copy_dist(copy_time, copy_noise);
+	std::exponential_distribution<double> overshoot_dist(1.0 / sleep_overshoot), load_dist(1.0 / load_mean);
+	std::uniform_real_distribution<double> load_chance_dist(0.0, 1.0);
+	std::vector<int64_t> overshoots, queue_delays, copy_times;
+	for(unsigned int i = 0; i < frames; ++i) {
+		overshoots.push_back(lrint(overshoot_dist(rng) * 1.0e6));
+		queue_delays.push_back((load_chance_dist(rng) < load_probability)? lrint(load_dist(rng) * 1.0e6) : 0);
+		copy_times.push_back(lrint(std::max(0.0, copy_dist(rng)) * 1.0e6));
+	}
+
+	double error_rms[3], jitter_rms[3];
+	unsigned int drops[3], gaps[3], misplaced[3];
+	for(unsigned int method = 0; method < 3; ++method) {
+
+		// run the capture loop
+		CaptureTimestampFilter filter;
+		std::vector<int64_t> timestamps, capture_times;
+		int64_t next_timestamp = 1000000, last_reply = 0;
+		for(unsigned int i = 0; i < frames; ++i) {
+			int64_t request_time = std::max(next_timestamp + overshoots[i], last_reply);
+			int64_t copy_start = request_time + queue_delays[i];
+			last_reply = copy_start + copy_times[i] + lrint(reply_latency * 1.0e6);
+			int64_t timestamp;
+			if(method == 0)
+				timestamp = request_time;
+			else if(method == 1)
+				timestamp = (request_time + last_reply) / 2;
+			else
+				timestamp = filter.Filter(request_time, last_reply, true);
+			timestamps.push_back(timestamp);
+			capture_times.push_back(copy_start + copy_times[i] / 2);
+			next_timestamp = std::max(next_timestamp + frame_interval, timestamp);
+		}
+
+		// calculate the error
+		double error_sum = 0.0, jitter_sum = 0.0;
+		for(unsigned int i = 0; i < frames; ++i) {
+			double error = (double) (timestamps[i] - capture_times[i]);
+			error_sum += error * error;
+			if(i != 0) {
+				double change = error - (double) (timestamps[i - 1] - capture_times[i - 1]);
+				jitter_sum += change * change;
+			}
+		}
+		error_rms[method] = sqrt(error_sum / (double) frames);
+		jitter_rms[method] = sqrt(jitter_sum / (double) (frames - 1));
+
+		// place the frames
+		std::vector<int64_t> pts, real_pts;
+		unsigned int real_drops, real_gaps;
+		PlaceVideoFrames(timestamps, frame_rate, &pts, &drops[method], &gaps[method]);
+		PlaceVideoFrames(capture_times, frame_rate, &real_pts, &real_drops, &real_gaps);
+		misplaced[method] = 0;
+		for(unsigned int i = 0; i < frames; ++i) {
+			if(pts[i] != real_pts[i])
+				++misplaced[method];
+		}
+
+	}
+
+	// print result
+	Logger::LogInfo("[BenchmarkCaptureTimestamps] " + Logger::tr("%1  |  Request %2 us jitter %3 us drops %4 gaps %5 misplaced %6  |  Midpoint %7 us jitter %8 us drops %9 gaps %10 misplaced %11  |  Filter %12 us jitter %13 us drops %14 gaps %15 misplaced %16")
+					.arg(trace_name)
+					.arg(error_rms[0], 5, 'f', 0).arg(jitter_rms[0], 5, 'f', 0).arg(drops[0], 3).arg(gaps[0], 3).arg(misplaced[0], 4)
+					.arg(error_rms[1], 5, 'f', 0).arg(jitter_rms[1], 5, 'f', 0).arg(drops[1], 3).arg(gaps[1], 3).arg(misplaced[1], 4)
+					.arg(error_rms[2], 5, 'f', 0).arg(jitter_rms[2], 5, 'f', 0).arg(drops[2], 3).arg(gaps[2], 3).arg(misplaced[2], 4));
+
+}
+
+// Receiver for the UDP transport benchmark. It binds to a free port on localhost (and PORT + 2 for FEC packets), checks the MPEG-TS
+// sync bytes, measures the gaps between datagrams, and recovers lost RTP packets with the FEC packets. Every 'loss_interval'-th RTP packet
+// is dropped on purpose to test the FEC.
+struct UDPBenchmarkReceiver {
+
+	int m_socket_data, m_socket_fec;
+	unsigned int m_port;
+	unsigned int m_loss_interval;
+
+	std::thread m_thread;
+	std::atomic<bool> m_should_stop;
+
+	// results (only valid after the thread has stopped)
+	uint64_t m_bytes, m_datagrams, m_bad_datagrams, m_lost, m_recovered;
+	int64_t m_first_time, m_last_time, m_gap_max;
+	double m_jitter;
+
+	// FEC state
+	std::vector<std::vector<uint8_t> > m_history; // payloads indexed by sequence number modulo history size
+	std::vector<int> m_history_sequence;
+	int m_highest_sequence;
+	std::deque<std::vector<uint8_t> > m_pending_fec; // FEC packets can arrive before the last data packets of their group
+
+	UDPBenchmarkReceiver(unsigned int loss_interval) {
+		m_socket_data = -1;
+		m_socket_fec = -1;
+		m_loss_interval = loss_interval;
+		m_should_stop = false;
+		m_bytes = m_datagrams = m_bad_datagrams = m_lost = m_recovered = 0;
+		m_first_time = m_last_time = m_gap_max = 0;
+		m_jitter = 0.0;
+		m_history.resize(1024);
+		m_history_sequence.resize(1024, -1);
+		m_highest_sequence = -1;
+		for(unsigned int attempt = 0; attempt < 20 && m_socket_fec == -1; ++attempt) {
+			Close();
+			m_socket_data = Bind(0);
+			if(m_socket_data == -1)
+				break;
+			sockaddr_in address;
+			socklen_t address_length = sizeof(address);
+			getsockname(m_socket_data, (sockaddr*) &address, &address_length);
+			m_port = ntohs(address.sin_port);
+			if(m_port <= 65533)
+				m_socket_fec = Bind(m_port + 2);
+		}
+		if(m_socket_fec == -1) {
+			Close();
+			throw NetworkException();
+		}
+		m_thread = std::thread(&UDPBenchmarkReceiver::ReceiverThread, this);
+	}
+	~UDPBenchmarkReceiver() {
+		Stop();
+		Close();
+	}
+
+	static int Bind(unsigned int port) {
+		int s = socket(AF_INET, SOCK_DGRAM | SOCK_CLOEXEC, 0);
+		if(s == -1)
+			return -1;
+		int receive_buffer = 4 * 1024 * 1024;
+		setsockopt(s, SOL_SOCKET, SO_RCVBUF, &receive_buffer, sizeof(receive_buffer));
+		sockaddr_in address;
+		memset(&address, 0, sizeof(address));
+		address.sin_family = AF_INET;
+		address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+		address.sin_port = htons(port);
+		if(bind(s, (sockaddr*) &address, sizeof(address)) == -1) {
+			close(s);
+			return -1;
+		}
+		return s;
+	}
+	void Close() {
+		if(m_socket_data != -1) {
+			close(m_socket_data);
+			m_socket_data = -1;
+		}
+		if(m_socket_fec != -1) {
+			close(m_socket_fec);
+			m_socket_fec = -1;
+		}
+	}
+	void Stop() {
+		if(m_thread.joinable()) {
+			m_should_stop = true;
+			m_thread.join();
+			// nothing comes after the last group, so the remaining FEC packets can't wait for more packets
+			for(std::vector<uint8_t> &fec : m_pending_fec) {
+				ReceiveFEC(fec.data(), fec.size(), true);
+			}
+			m_pending_fec.clear();
+		}
+	}
+
+	bool CheckPayload(const uint8_t* data, size_t size) {
+		if(size == 0 || size % UDP_TRANSPORT_TS_PACKET_SIZE != 0)
+			return false;
+		for(size_t p = 0; p < size; p += UDP_TRANSPORT_TS_PACKET_SIZE) {
+			if(data[p] != 0x47)
+				return false;
+		}
+		return true;
+	}
+
+	void ReceiveData(const uint8_t* data, size_t size, int64_t timestamp) {
+		if(size >= UDP_TRANSPORT_RTP_HEADER_SIZE && data[0] == 0x80) {
+			uint16_t sequence = (data[2] << 8) | data[3];
+			if(m_highest_sequence == -1 || (int16_t) (sequence - (uint16_t) m_highest_sequence) > 0)
+				m_highest_sequence = sequence;
+			if(m_loss_interval != 0 && sequence % m_loss_interval == 0) {
+				++m_lost;
+				return;
+			}
+			data += UDP_TRANSPORT_RTP_HEADER_SIZE;
+			size -= UDP_TRANSPORT_RTP_HEADER_SIZE;
+			m_history[sequence % m_history.size()].assign(data, data + size);
+			m_history_sequence[sequence % m_history.size()] = sequence;
+		}
+		if(!CheckPayload(data, size))
+			++m_bad_datagrams;
+		if(m_datagrams == 0) {
+			m_first_time = timestamp;
+		} else {
+			int64_t gap = timestamp - m_last_time;
+			m_gap_max = std::max(m_gap_max, gap);
+		}
+		m_last_time = timestamp;
+		m_bytes += size;
+		++m_datagrams;
+	}
+
+	// Returns false if the FEC packet should be tried again later.
+	bool ReceiveFEC(const uint8_t* data, size_t size, bool end_of_stream) {
+		if(size != UDP_TRANSPORT_HEADER_SPACE + UDP_TRANSPORT_PAYLOAD_SIZE)
+			return true;
+		const uint8_t *header = data + UDP_TRANSPORT_RTP_HEADER_SIZE;
+		uint16_t base = (header[0] << 8) | header[1];
+		unsigned int count = header[2];
+		unsigned int length = (header[4] << 8) | header[5];
+		if(!end_of_stream && (m_highest_sequence == -1 || (int16_t) ((uint16_t) m_highest_sequence - (uint16_t) (base + count)) < 0))
+			return false; // wait until the packet after the group has arrived
+		int missing = -1;
+		for(unsigned int i = 0; i < count; ++i) {
+			uint16_t sequence = base + i;
+			if(m_history_sequence[sequence % m_history.size()] != sequence) {
+				if(missing != -1)
+					return false; // more than one packet is missing, try again when more packets have arrived
+				missing = sequence;
+			}
+		}
+		if(missing == -1)
+			return true;
+		std::vector<uint8_t> payload(data + UDP_TRANSPORT_HEADER_SPACE, data + size);
+		for(unsigned int i = 0; i < count; ++i) {
+			uint16_t sequence = base + i;
+			if(sequence == missing)
+				continue;
+			std::vector<uint8_t> &other = m_history[sequence % m_history.size()];
+			for(size_t j = 0; j < other.size(); ++j) {
+				payload[j] ^= other[j];
+			}
+			length ^= other.size();
+		}
+		if(length <= payload.size() && CheckPayload(payload.data(), length)) {
+			m_history[missing % m_history.size()].assign(payload.begin(), payload.begin() + length);
+			m_history_sequence[missing % m_history.size()] = missing;
+			++m_recovered;
+		}
+		return true;
+	}
+
+	void ReceiverThread() {
+		const unsigned int batch = 32;
+		std::vector<uint8_t> buffers(batch * 2048);
+		mmsghdr messages[batch];
+		iovec vectors[batch];
+		int64_t previous_transit = 0;
+		while(!m_should_stop) {
+			pollfd pfds[2] = {{m_socket_data, POLLIN, 0}, {m_socket_fec, POLLIN, 0}};
+			if(poll(pfds, 2, 10) <= 0)
+				continue;
+			for(unsigned int s = 0; s < 2; ++s) {
+				if(!(pfds[s].revents & POLLIN))
+					continue;
+				for(unsigned int i = 0; i < batch; ++i) {
+					vectors[i].iov_base = buffers.data() + i * 2048;
+					vectors[i].iov_len = 2048;
+					memset(&messages[i], 0, sizeof(mmsghdr));
+					messages[i].msg_hdr.msg_iov = &vectors[i];
+					messages[i].msg_hdr.msg_iovlen = 1;
+				}
+				int received = recvmmsg(pfds[s].fd, messages, batch, MSG_DONTWAIT, NULL);
+				int64_t timestamp = hrt_time_micro();
+				for(int i = 0; i < received; ++i) {
+					const uint8_t *data = buffers.data() + i * 2048;
+					size_t size = messages[i].msg_len;
+					if(s == 0) {
+						// RFC 3550 interarrival jitter (RTP only, the RTP timestamp is the send time)
+						if(size >= UDP_TRANSPORT_RTP_HEADER_SIZE && data[0] == 0x80) {
+							uint32_t rtp_time = ((uint32_t) data[4] << 24) | ((uint32_t) data[5] << 16) | ((uint32_t) data[6] << 8) | (uint32_t) data[7];
+							int64_t transit = (int64_t) (uint32_t) (timestamp * 9 / 100) - (int64_t) rtp_time;
+							if(m_datagrams != 0)
+								m_jitter += ((double) std::abs(transit - previous_transit) * 100.0 / 9.0 - m_jitter) / 16.0;
+							previous_transit = transit;
+						}
+						ReceiveData(data, size, timestamp);
+					} else {
+						m_pending_fec.emplace_back(data, data + size);
+					}
+				}
+			}
+			for(size_t i = 0; i < m_pending_fec.size(); ) {
+				if(ReceiveFEC(m_pending_fec[i].data(), m_pending_fec[i].size(), false))
+					m_pending_fec.erase(m_pending_fec.begin() + i);
+				else
+					++i;
+			}
+			while(m_pending_fec.size() > 64) {
+				m_pending_fec.pop_front();
+			}
+		}
+	}
+
+};
+
+// Sends a synthetic MPEG-TS stream through the UDP transport to a receiver on localhost, with a burst every 500 ms (like a keyframe).
+void BenchmarkUDPTransport(unsigned int kbit_rate, unsigned int fec, unsigned int loss_interval) {
+
+	const int64_t duration = 2000000;
+
+	std::unique_ptr<UDPBenchmarkReceiver> receiver;
+	std::unique_ptr<UDPTransport> transport;
+	try {
+		receiver.reset(new UDPBenchmarkReceiver(loss_interval));
+		transport.reset(new UDPTransport(QString("tsudp://127.0.0.1:%1?latency=500&fec=%2").arg(receiver->m_port).arg(fec), kbit_rate * 1000));
+	} catch(const NetworkException&) {
+		Logger::LogWarning("[BenchmarkUDPTransport] " + Logger::tr("Warning: Can't create sockets on localhost, skipping UDP transport benchmark."));
+		return;
+	}
+
+	// generate the stream
+	std::vector<uint8_t> packet(UDP_TRANSPORT_TS_PACKET_SIZE, 0xff);
+	packet[0] = 0x47;
+	packet[1] = 0x01;
+	packet[2] = 0x00;
+	uint64_t bytes_total = 0, bytes_burst = 0;
+	int64_t start = hrt_time_micro(), next_burst = start;
+	for(int64_t t = start; t < start + duration; t = hrt_time_micro()) {
+		if(t >= next_burst) {
+			bytes_burst += kbit_rate * 1000 / 8 / 10; // 100ms worth of data at once
+			next_burst += 500000;
+		}
+		uint64_t bytes_target = (uint64_t) (t - start) * kbit_rate / 8000 + bytes_burst;
+		while(bytes_total < bytes_target) {
+			packet[3] = 0x10 | ((bytes_total / UDP_TRANSPORT_TS_PACKET_SIZE) & 0x0f); // payload only, continuity counter
+			transport->Write(packet.data(), packet.size());
+			bytes_total += packet.size();
+		}
+		usleep(1000);
+	}
+	transport->Flush();
+	transport->WaitForQueue(2000000);
+	usleep(20000);
+	UDPTransport::Stats stats = transport->GetStats();
+	transport.reset();
+	receiver->Stop();
+
+	// print result
+	int64_t receive_time = std::max((int64_t) 1, receiver->m_last_time - receiver->m_first_time);
+	Logger::LogInfo("[BenchmarkUDPTransport] " + Logger::tr("%1 kbit/s FEC %2  |  Received %3 kbit/s  |  Max gap %4 us  |  Jitter %5 us  |  Lost %6 recovered %7  |  Dropped %8  |  Invalid %9")
+					.arg(kbit_rate, 6).arg(fec, 2)
+					.arg((unsigned int) (receiver->m_bytes * 8000 / receive_time), 6)
+					.arg((unsigned int) receiver->m_gap_max, 6)
+					.arg((unsigned int) receiver->m_jitter, 4)
+					.arg((unsigned int) receiver->m_lost).arg((unsigned int) receiver->m_recovered)
+					.arg((unsigned int) stats.m_dropped_datagrams)
+					.arg((unsigned int) receiver->m_bad_datagrams));
+
+}
+
+// Compares probing libav/ffmpeg for supported containers and codecs with loading the result from the cache.
+void BenchmarkCodecCapabilities() {
+
+	QString file = QDir::tempPath() + QString("/simplescreenrecorder-benchmark-codec-cache-%1.conf").arg(getpid());
+	QString key = GetCodecCapabilitiesKey();
+
+	int64_t t1 = hrt_time_micro();
+	CodecCapabilities probed = ProbeCodecCapabilities();
+	int64_t t2 = hrt_time_micro();
+	SaveCodecCapabilities(file, key, probed);
+	int64_t t3 = hrt_time_micro();
+	CodecCapabilities loaded;
+	bool valid = LoadCodecCapabilities(file, key, &loaded);
+	int64_t t4 = hrt_time_micro();
+	QFile::remove(file);
+
+	if(!valid || loaded.m_containers.size() != probed.m_containers.size() ||
+			loaded.m_video_codecs.size() != probed.m_video_codecs.size() || loaded.m_audio_codecs.size() != probed.m_audio_codecs.size()) {
+		Logger::LogWarning("[BenchmarkCodecCapabilities] " + Logger::tr("Warning: Cached codec capabilities don't match the probed capabilities!"));
+	}
+
+	// print result
+	Logger::LogInfo("[BenchmarkCodecCapabilities] " + Logger::tr("%1 containers, %2 video codecs, %3 audio codecs  |  Probe %4 us  |  Save %5 us  |  Load %6 us")
+					.arg((unsigned int) probed.m_containers.size(), 3).arg((unsigned int) probed.m_video_codecs.size(), 3).arg((unsigned int) probed.m_audio_codecs.size(), 3)
+					.arg((unsigned int) (t2 - t1), 6).arg((unsigned int) (t3 - t2), 6).arg((unsigned int) (t4 - t3), 6));
+
+}
+
+// Compares the CPU time of the audio path with the resampler and with the bypass (SampleSlipper), for 48 kHz stereo audio with a small drift correction.
+void BenchmarkAudioPath() {
+
+	const unsigned int channels = 2, block = 480, blocks = 6000; // 60 seconds
+	const double drift_ratio = 1.0 / (1.0 - 0.0001);
+
+	std::mt19937 rng(12345);
+	std::uniform_real_distribution<float> dist(-0.5f, 0.5f);
+	std::vector<float> samples(block * channels);
+	for(float &s : samples) {
+		s = dist(rng);
+	}
+
+	FastResampler resampler(channels, 0.9f);
+	SampleSlipper slipper(channels, 0.9f);
+	TempBuffer<float> output;
+	uint64_t count_resampler = 0, count_slipper = 0;
+	int64_t t1 = hrt_time_micro();
+	for(unsigned int i = 0; i < blocks; ++i) {
+		count_resampler += resampler.Resample(1.0, drift_ratio, samples.data(), block, &output, 0);
+	}
+	int64_t t2 = hrt_time_micro();
+	for(unsigned int i = 0; i < blocks; ++i) {
+		count_slipper += slipper.Process(drift_ratio, samples.data(), block, &output, 0);
+	}
+	int64_t t3 = hrt_time_micro();
+
+	// print result
+	Logger::LogInfo("[BenchmarkAudioPath] " + Logger::tr("60 s stereo 48 kHz  |  Resampler %1 us (%2 samples)  |  Bypass %3 us (%4 samples, %5%)")
+					.arg((unsigned int) (t2 - t1), 7).arg((unsigned int) count_resampler)
+					.arg((unsigned int) (t3 - t2), 7).arg((unsigned int) count_slipper)
+					.arg(100 * (t3 - t2) / std::max((int64_t) 1, t2 - t1), 3));
+
+}
+
+// Simulates a long recording where the audio clock runs slightly too fast or too slow, with the drift correction controller of the synchronizer
+// but with the resampler bypassed, and checks that the audio stays in sync.
+void BenchmarkAudioBypassSync(double clock_error) {
+
+	const unsigned int channels = 2, sample_rate = 48000, block = 480, blocks = 360000; // one hour
+	std::vector<float> samples(block * channels, 0.0f);
+	SampleSlipper slipper(channels, 1.0f);
+	TempBuffer<float> output;
+	uint64_t samples_written = 0;
+	double average_drift = 0.0, drift = 0.0, max_drift = 0.0;
+	bool bypass_ok = true;
+	for(unsigned int i = 0; i < blocks; ++i) {
+		double block_length = (double) block / (double) sample_rate;
+		double time = (double) i * block_length * (1.0 + clock_error);
+		drift = (double) samples_written / (double) sample_rate - time;
+		if(i >= blocks / 60) // ignore the first minute
+			max_drift = std::max(max_drift, fabs(drift));
+		double correction = Synchronizer::UpdateDriftCorrection(&average_drift, drift, block_length * (1.0 + clock_error), block_length);
+		if(!Synchronizer::CanBypassResampler(correction))
+			bypass_ok = false;
+		samples_written += slipper.Process(1.0 / (1.0 - correction), samples.data(), block, &output, 0);
+	}
+
+	// print result
+	Logger::LogInfo("[BenchmarkAudioBypassSync] " + Logger::tr("Clock error %1 ppm, one hour  |  Final drift %2 ms  |  Max drift %3 ms  |  %4")
+					.arg(clock_error * 1.0e6, 5, 'f', 0).arg(drift * 1.0e3, 6, 'f', 3).arg(max_drift * 1.0e3, 6, 'f', 3)
+					.arg((bypass_ok && max_drift < 0.001)? Logger::tr("OK") : Logger::tr("FAILED")));
+
+}
+
+// Replays a synthetic audio timestamp trace through the drift correction controller of the synchronizer,
+// once with the old exponential timestamp filter and once with DriftEstimator. The traces are generated with a fixed seed,
+// so the results are deterministic. The audio clock runs 0.1% too fast. The 'jitter' of the correction is the RMS change of the
+// drift correction factor between blocks, this is what causes audible speed fluctuations.
+void BenchmarkDriftEstimation(const QString& trace_name, double jitter_mean, double spike_probability, double spike_length) {
+
+	const double duration = 120.0, block = 0.01, clock_error = 0.001;
+
+	// generate the trace
+	std::mt19937 rng(12345);
+	std::exponential_distribution<double> jitter_dist(1.0 / jitter_mean);
+	std::uniform_real_distribution<double> spike_dist(0.0, 1.0);
+	std::vector<double> timestamps;
+	for(double position = 0.0; position < duration; position += block) {
+		double t = position * (1.0 + clock_error) + jitter_dist(rng);
+		if(spike_dist(rng) < spike_probability)
+			t += spike_length;
+		timestamps.push_back(t);
+	}
+
+	double jitter[2], final_drift[2];
+	for(unsigned int method = 0; method < 2; ++method) {
+		DriftEstimator estimator(10.0, 0.02, 5);
+		double filtered = timestamps[0], written = 0.0, average_drift = 0.0, last_correction = 0.0, jitter_sum = 0.0, drift = 0.0;
+		for(size_t i = 0; i < timestamps.size(); ++i) {
+			double position = (double) i * block;
+			if(method == 0) {
+				filtered += (timestamps[i] - filtered) / 20.0;
+			} else {
+				estimator.AddPoint(position, timestamps[i], block);
+				filtered = estimator.GetTime(position);
+			}
+			drift = written - (filtered - timestamps[0]);
+			double correction = Synchronizer::UpdateDriftCorrection(&average_drift, drift, block, block);
+			written += block * (1.0 - correction);
+			if(method == 0)
+				filtered += block;
+			if(i != 0)
+				jitter_sum += (correction - last_correction) * (correction - last_correction);
+			last_correction = correction;
+		}
+		jitter[method] = sqrt(jitter_sum / (double) (timestamps.size() - 1));
+		final_drift[method] = drift;
+	}
+
+	// print result
+	Logger::LogInfo("[BenchmarkDriftEstimation] " + Logger::tr("%1  |  Filter jitter %2 ppm drift %3 ms  |  Regression jitter %4 ppm drift %5 ms")
+					.arg(trace_name)
+					.arg(jitter[0] * 1.0e6, 7, 'f', 1).arg(final_drift[0] * 1.0e3, 6, 'f', 2)
+					.arg(jitter[1] * 1.0e6, 7, 'f', 1).arg(final_drift[1] * 1.0e3, 6, 'f', 2));
+
+}
+
+// Feeds video and audio to the synchronizer from two threads at the same time and measures how long the inputs are blocked.
+// Audio resampling is cheap, so the time spent in ReadAudioSamples is mostly the time spent waiting for the synchronizer lock.
+void BenchmarkSynchronizer(unsigned int frame_rate) {
+
+	const int64_t duration = 2000000;
+	const unsigned int width = 1280, height = 720, audio_block = 480;
+
+	OutputSettings settings = NewBenchmarkSettings("sync");
+	settings.video_codec_avname = "mpeg4";
+	settings.video_kbit_rate = 5000;
+	settings.video_width = width;
+	settings.video_height = height;
+	settings.video_frame_rate = frame_rate;
+	settings.audio_codec_avname = "pcm_s16le";
+	settings.audio_kbit_rate = 0;
+	settings.audio_channels = 2;
+	settings.audio_sample_rate = 48000;
+
+	std::unique_ptr<OutputManager> output_manager = NewBenchmarkOutput(settings, "BenchmarkSynchronizer", "synchronizer");
+	if(output_manager == NULL)
+		return;
+	Synchronizer *synchronizer = output_manager->GetSynchronizer();
+
+	std::mt19937 rng(12345);
+	std::unique_ptr<ImageGeneric> image = NewImageBGRA(width, height, rng);
+	std::vector<float> samples(audio_block * 2, 0.0f);
+
+	// push video and audio in real time
+	int64_t start = hrt_time_micro();
+	int64_t video_time = 0, video_max = 0, audio_time = 0, audio_max = 0;
+	unsigned int video_count = 0, audio_count = 0;
+	std::thread video_thread([&]() {
+		for(int64_t next = start; next < start + duration; next += 1000000 / frame_rate) {
+			int64_t delay = next - hrt_time_micro();
+			if(delay > 0)
+				usleep(delay);
+			int64_t t1 = hrt_time_micro();
+			synchronizer->ReadVideoFrame(width, height, image->m_data[0], image->m_stride[0], AV_PIX_FMT_BGRA, SWS_CS_DEFAULT, t1);
+			int64_t t2 = hrt_time_micro();
+			video_time += t2 - t1;
+			video_max = std::max(video_max, t2 - t1);
+			++video_count;
+		}
+	});
+	for(int64_t next = start; next < start + duration; next += (int64_t) audio_block * 1000000 / 48000) {
+		int64_t delay = next - hrt_time_micro();
+		if(delay > 0)
+			usleep(delay);
+		int64_t t1 = hrt_time_micro();
+		synchronizer->ReadAudioSamples(2, 48000, AV_SAMPLE_FMT_FLT, audio_block, (const uint8_t*) samples.data(), t1);
+		int64_t t2 = hrt_time_micro();
+		audio_time += t2 - t1;
+		audio_max = std::max(audio_max, t2 - t1);
+		++audio_count;
+	}
+	video_thread.join();
+
+	FinishBenchmarkOutput(&output_manager, settings.file);
+
+	// print result
+	Logger::LogInfo("[BenchmarkSynchronizer] " + Logger::tr("%1 fps + audio  |  Video avg %2 us max %3 us  |  Audio avg %4 us max %5 us")
+					.arg(frame_rate, 3)
+					.arg((unsigned int) (video_time / std::max(1u, video_count)), 5).arg((unsigned int) video_max, 6)
+					.arg((unsigned int) (audio_time / std::max(1u, audio_count)), 5).arg((unsigned int) audio_max, 6));
+
+}
+
+// Records a test pattern with mpeg4 and measures the input and output frame rate, the encoder backlog and the file size.
+// Patterns that are harder to compress (e.g. noise) show how the rest of the pipeline behaves when the encoder can't keep up.
+void BenchmarkTestPattern(const QString& pattern_name) {
+
+	const int64_t duration = 2000000;
+	const unsigned int width = 1280, height = 720, frame_rate = 60;
+
+	OutputSettings settings = NewBenchmarkSettings("pattern");
+	settings.video_codec_avname = "mpeg4";
+	settings.video_kbit_rate = 5000;
+	settings.video_width = width;
+	settings.video_height = height;
+	settings.video_frame_rate = frame_rate;
+
+	std::unique_ptr<OutputManager> output_manager = NewBenchmarkOutput(settings, "BenchmarkTestPattern", "test pattern");
+	if(output_manager == NULL)
+		return;
+
+	// record the test pattern through the complete synchronizer/encoder/muxer path
+	std::unique_ptr<TestPatternInput> input(new TestPatternInput(TestPatternInput::GetPatternFromName(pattern_name), width, height, frame_rate));
+	output_manager->GetSynchronizer()->ConnectVideoSource(input.get());
+	usleep(duration);
+	double fps_in = input->GetFPS(), fps_out = output_manager->GetActualFrameRate();
+	output_manager->GetSynchronizer()->ConnectVideoSource(NULL);
+	input.reset();
+
+	uint64_t total_bytes = 0;
+	int64_t backlog = FinishBenchmarkOutput(&output_manager, settings.file, &total_bytes);
+
+	// print result
+	Logger::LogInfo("[BenchmarkTestPattern] " + Logger::tr("%1  |  In %2 fps  |  Out %3 fps  |  Backlog %4 ms  |  Size %5 KiB")
+					.arg(pattern_name, -7)
+					.arg(fps_in, 5, 'f', 1).arg(fps_out, 5, 'f', 1)
+					.arg((unsigned int) ((backlog + 500) / 1000), 5)
+					.arg((unsigned int) (total_bytes / 1024), 6));
+
+}
+
+// Simulates a recording at 60 fps with an encoder that is artificially slowed down to 150% load for 40 seconds, and compares the
+// existing throttling with the degradation controller. The simulation doesn't use real time, so it is fast and deterministic.
+// Frames are lost when the queue is full, like in the synchronizer.
+void BenchmarkDegradation(const QString& ladder_name) {
+
+	const unsigned int frame_rate = 60, max_queue = 30;
+	const int64_t duration = 120000000, tick = 1000000 / frame_rate;
+
+	std::vector<DegradationController::Level> ladder = DegradationController::ParseLadder(ladder_name);
+	DegradationController controller(ladder);
+
+	unsigned int queue = 0, max_queue_seen = 0, level_changes = 0, final_level = 0;
+	uint64_t frames_captured = 0, frames_encoded = 0, frames_lost = 0;
+	int64_t busy_time = 0, current_frame_left = 0;
+	QString transitions;
+	for(int64_t time = 0, frame = 0; time < duration; time += tick, ++frame) {
+
+		// encoding a frame takes 10ms, except between 20s and 60s where it takes 25ms
+		int64_t cost = (time >= 20000000 && time < 60000000)? 25000 : 10000;
+		const DegradationController::Level &level = controller.GetCurrentLevel();
+
+		// capture
+		if(frame % level.m_frame_rate_divisor == 0) {
+			++frames_captured;
+			if(queue >= max_queue) {
+				++frames_lost;
+			} else {
+				++queue;
+			}
+		}
+		max_queue_seen = std::max(max_queue_seen, queue);
+
+		// encode
+		int64_t available = tick;
+		while(available > 0 && (queue != 0 || current_frame_left != 0)) {
+			if(current_frame_left == 0) {
+				--queue;
+				current_frame_left = cost;
+			}
+			int64_t n = std::min(available, current_frame_left);
+			current_frame_left -= n;
+			available -= n;
+			busy_time += n;
+			if(current_frame_left == 0)
+				++frames_encoded;
+		}
+
+		// update the controller
+		if(controller.Update(time, queue, busy_time)) {
+			++level_changes;
+			transitions += QString(" %1s:L%2").arg(time / 1000000).arg(controller.GetLevel());
+		}
+		final_level = controller.GetLevel();
+
+	}
+
+	// print result
+	Logger::LogInfo("[BenchmarkDegradation] " + Logger::tr("%1  |  Captured %2  |  Encoded %3  |  Lost %4  |  Max queue %5  |  Changes %6  |  Final level %7 |%8")
+					.arg(ladder_name.isEmpty()? QString("(none)") : ladder_name, -23)
+					.arg((unsigned int) frames_captured, 5).arg((unsigned int) frames_encoded, 5).arg((unsigned int) frames_lost, 5)
+					.arg(max_queue_seen, 2).arg(level_changes, 2).arg(final_level).arg(transitions));
+
+}
+
+// Records the noise test pattern with libx264 using a given number of encoder threads (zero means the thread budget).
+// To see the effect of the thread budget, run the benchmark in a constrained cgroup, e.g. 'systemd-run --user --scope -p CPUQuota=400% ...'.
+// Using more threads than available CPUs increases the latency because the encoder threads and the capture thread compete for the same CPU time.
+void BenchmarkThreadBudget(unsigned int threads) {
+
+	const int64_t duration = 3000000;
+	const unsigned int width = 1920, height = 1080, frame_rate = 60;
+
+	if(!AVCodecIsInstalled("libx264")) {
+		Logger::LogWarning("[BenchmarkThreadBudget] " + Logger::tr("Warning: libx264 is not installed, skipping thread budget benchmark."));
+		return;
+	}
+
+	QString threads_name = (threads == 0)? Logger::tr("Budget %1").arg(ThreadBudget::GetVideoEncoderThreads(1)) : Logger::tr("Fixed %1").arg(threads);
+	OutputSettings settings = NewBenchmarkSettings("threads");
+	settings.video_codec_avname = "libx264";
+	settings.video_options.emplace_back("crf", "23");
+	settings.video_options.emplace_back("preset", "veryfast");
+	if(threads != 0)
+		settings.video_options.emplace_back("threads", QString::number(threads));
+	settings.video_width = width;
+	settings.video_height = height;
+	settings.video_frame_rate = frame_rate;
+
+	std::unique_ptr<OutputManager> output_manager = NewBenchmarkOutput(settings, "BenchmarkThreadBudget", "thread budget");
+	if(output_manager == NULL)
+		return;
+
+	// record the test pattern, the input fps drops when the capture thread doesn't get enough CPU time
+	std::unique_ptr<TestPatternInput> input(new TestPatternInput(TestPatternInput::GetPatternFromName("noise"), width, height, frame_rate));
+	output_manager->GetSynchronizer()->ConnectVideoSource(input.get());
+	usleep(duration);
+	double fps_in = input->GetFPS(), fps_out = output_manager->GetActualFrameRate();
+	output_manager->GetSynchronizer()->ConnectVideoSource(NULL);
+	input.reset();
+
+	int64_t backlog = FinishBenchmarkOutput(&output_manager, settings.file);
+
+	// print result
+	Logger::LogInfo("[BenchmarkThreadBudget] " + Logger::tr("%1  |  In %2 fps  |  Out %3 fps  |  Backlog %4 ms")
+					.arg(threads_name, -9)
+					.arg(fps_in, 5, 'f', 1).arg(fps_out, 5, 'f', 1)
+					.arg((unsigned int) ((backlog + 500) / 1000), 5));
+
+}
+
+// Records a test pattern at 30 fps with an mpeg4 encoder that is slowed down to 50ms per frame (150% load) between 2s and 12s,
+// and tracks the level of the degradation controller. This checks the complete path (encoder load, controller, frame rate divisor
+// in the synchronizer) with a real encoder. With a ladder, the level should go down during the slowdown and back to zero afterwards.
+void BenchmarkDegradationOutput(const QString& ladder_name) {
+
+	const int64_t duration = 26000000, slow_start = 2000000, slow_end = 12000000, slow_delay = 50000;
+	const unsigned int width = 1280, height = 720, frame_rate = 30;
+
+	OutputSettings settings = NewBenchmarkSettings("degradation");
+	settings.video_codec_avname = "mpeg4";
+	settings.video_kbit_rate = 5000;
+	settings.video_width = width;
+	settings.video_height = height;
+	settings.video_frame_rate = frame_rate;
+	settings.video_degradation_ladder = ladder_name;
+
+	std::unique_ptr<OutputManager> output_manager = NewBenchmarkOutput(settings, "BenchmarkDegradationOutput", "degradation");
+	if(output_manager == NULL)
+		return;
+
+	// record the test pattern and slow down the encoder for a while
+	std::unique_ptr<TestPatternInput> input(new TestPatternInput(TestPatternInput::GetPatternFromName("text"), width, height, frame_rate));
+	output_manager->GetSynchronizer()->ConnectVideoSource(input.get());
+	unsigned int max_queue = 0, level_changes = 0, max_level = 0, level = 0;
+	QString transitions;
+	int64_t start = hrt_time_micro();
+	for( ; ; ) {
+		int64_t time = hrt_time_micro() - start;
+		if(time >= duration)
+			break;
+		VideoEncoder::SetBenchmarkFrameDelay((time >= slow_start && time < slow_end)? slow_delay : 0);
+		max_queue = std::max(max_queue, output_manager->GetTotalQueuedFrameCount());
+		unsigned int new_level = output_manager->GetDegradationLevel();
+		if(new_level != level) {
+			level = new_level;
+			++level_changes;
+			transitions += QString(" %1s:L%2").arg((double) time * 1.0e-6, 0, 'f', 1).arg(level);
+		}
+		max_level = std::max(max_level, level);
+		usleep(100000);
+	}
+	output_manager->GetSynchronizer()->ConnectVideoSource(NULL);
+	input.reset();
+	VideoEncoder::SetBenchmarkFrameDelay(0);
+
+	FinishBenchmarkOutput(&output_manager, settings.file);
+
+	// print result
+	Logger::LogInfo("[BenchmarkDegradationOutput] " + Logger::tr("%1  |  Max queue %2  |  Max level %3  |  Changes %4  |  Final level %5 |%6")
+					.arg(ladder_name.isEmpty()? QString("(none)") : ladder_name, -11)
+					.arg(max_queue, 3).arg(max_level).arg(level_changes, 2).arg(level).arg(transitions));
+
+}
+
+// Records audio only (like a voice recording) and measures the CPU time and the number of wakeups, with the audio sent through the
+// synchronizer thread and with the fast path where the audio input sends complete frames to the encoder directly.
+void BenchmarkAudioOnly(bool fast_path) {
+
+	// The real-time run is kept short, the CPU time is extrapolated to one hour.
+	const int64_t duration = 5000000;
+	const unsigned int audio_block = 480;
+
+	OutputSettings settings = NewBenchmarkSettings("audio");
+	settings.audio_codec_avname = (AVCodecIsInstalled("aac"))? "aac" : "pcm_s16le";
+	settings.audio_kbit_rate = 128;
+	settings.audio_channels = 2;
+	settings.audio_sample_rate = 48000;
+	settings.audio_fast_path = fast_path;
+
+	std::unique_ptr<OutputManager> output_manager = NewBenchmarkOutput(settings, "BenchmarkAudioOnly", "audio-only");
+	if(output_manager == NULL)
+		return;
+	Synchronizer *synchronizer = output_manager->GetSynchronizer();
+
+	std::vector<float> samples(audio_block * 2);
+	for(unsigned int i = 0; i < audio_block; ++i) {
+		samples[i * 2] = samples[i * 2 + 1] = 0.1f * (float) sin((double) i * 2.0 * M_PI / (double) audio_block);
+	}
+
+	// push audio in real time, like the audio input would
+	struct rusage usage1, usage2;
+	getrusage(RUSAGE_SELF, &usage1);
+	int64_t start = hrt_time_micro();
+	for(int64_t next = start; next < start + duration; next += (int64_t) audio_block * 1000000 / 48000) {
+		int64_t delay = next - hrt_time_micro();
+		if(delay > 0)
+			usleep(delay);
+		synchronizer->ReadAudioSamples(2, 48000, AV_SAMPLE_FMT_FLT, audio_block, (const uint8_t*) samples.data(), hrt_time_micro());
+	}
+	int64_t end = hrt_time_micro();
+	getrusage(RUSAGE_SELF, &usage2);
+
+	FinishBenchmarkOutput(&output_manager, settings.file);
+
+	// print result
+	// The wakeups are the voluntary context switches of all threads, including the thread that pushes the audio.
+	int64_t cpu_time = ((int64_t) usage2.ru_utime.tv_sec - (int64_t) usage1.ru_utime.tv_sec + (int64_t) usage2.ru_stime.tv_sec - (int64_t) usage1.ru_stime.tv_sec) * 1000000
+			+ ((int64_t) usage2.ru_utime.tv_usec - (int64_t) usage1.ru_utime.tv_usec + (int64_t) usage2.ru_stime.tv_usec - (int64_t) usage1.ru_stime.tv_usec);
+	double wall_time = (double) (end - start) * 1.0e-6;
+	Logger::LogInfo("[BenchmarkAudioOnly] " + Logger::tr("%1 %2  |  CPU %3%  |  Wakeups %4/s  |  CPU time per hour %5 s")
+					.arg(settings.audio_codec_avname, -9).arg((fast_path)? "fast path  " : "sync thread")
+					.arg((double) cpu_time * 1.0e-4 / wall_time, 6, 'f', 3)
+					.arg((double) (usage2.ru_nvcsw - usage1.ru_nvcsw) / wall_time, 6, 'f', 1)
+					.arg((double) cpu_time * 1.0e-6 / wall_time * 3600.0, 6, 'f', 1));
+
+}
+
+// Measures the time between starting a recording and the first video packet being written to the output file, with an output that is
+// created when the recording starts (cold) and with an output that was created in advance (armed, see '--arm-output').
+// In both cases the recording starts at the same point, the creation of a cold output is part of the start latency.
+void BenchmarkStartLatency(bool armed) {
+
+	const unsigned int width = 1920, height = 1080, frame_rate = 60;
+
+	OutputSettings settings = NewBenchmarkSettings("start");
+	if(AVCodecIsInstalled("libx264")) {
+		settings.video_codec_avname = "libx264";
+		settings.video_options.emplace_back("crf", "23");
+		settings.video_options.emplace_back("preset", "medium");
+	} else {
+		settings.video_codec_avname = "mpeg4";
+		settings.video_kbit_rate = 5000;
+	}
+	settings.video_width = width;
+	settings.video_height = height;
+	settings.video_frame_rate = frame_rate;
+
+	// the input is created first, like in the recording page
+	std::unique_ptr<TestPatternInput> input(new TestPatternInput(TestPatternInput::PATTERN_TEXT, width, height, frame_rate));
+
+	std::unique_ptr<OutputManager> output_manager;
+	int64_t start_time = 0, create_time = 0, first_packet_time = AV_NOPTS_VALUE;
+	if(armed) {
+		int64_t t1 = hrt_time_micro();
+		output_manager = NewBenchmarkOutput(settings, "BenchmarkStartLatency", "start latency");
+		create_time = hrt_time_micro() - t1;
+		if(output_manager == NULL)
+			return;
+		usleep(100000); // an armed output is normally idle for a while before the recording starts
+	}
+	start_time = hrt_time_micro();
+	if(!armed) {
+		output_manager = NewBenchmarkOutput(settings, "BenchmarkStartLatency", "start latency");
+		create_time = hrt_time_micro() - start_time;
+		if(output_manager == NULL)
+			return;
+	}
+
+	// start the recording and wait for the first video packet
+	output_manager->GetSynchronizer()->ConnectVideoSource(input.get());
+	for(unsigned int i = 0; i < 10000; ++i) {
+		first_packet_time = output_manager->GetFirstVideoPacketTime();
+		if(first_packet_time != AV_NOPTS_VALUE)
+			break;
+		usleep(1000);
+	}
+	output_manager->GetSynchronizer()->ConnectVideoSource(NULL);
+	input.reset();
+
+	FinishBenchmarkOutput(&output_manager, settings.file);
+
+	// print result
+	int64_t latency = (first_packet_time == AV_NOPTS_VALUE)? -1 : first_packet_time - start_time;
+	Logger::LogInfo("[BenchmarkStartLatency] " + Logger::tr("%1 %2  |  Create output %3 us  |  Start latency %4 us")
+					.arg(settings.video_codec_avname, -7).arg((armed)? "armed" : "cold ")
+					.arg((unsigned int) create_time, 7)
+					.arg((int) latency, 7));
+
+}
+
 void Benchmark() {
 
 	Logger::LogInfo("[Benchmark] " + Logger::tr("Starting scaler benchmark ..."));
@@ -272,4 +1315,64 @@ void Benchmark() {
 	BenchmarkConvert(1920, 1080, AV_PIX_FMT_BGRA, AV_PIX_FMT_BGR24  , "BGRA", "BGR   ", NewImageBGRA, NewImageBGR   , PlaneWrapper<Convert_BGRA_BGR_Fallback>);
 #endif
 
+#if SSR_USE_XCB_SHM
+	Logger::LogInfo("[Benchmark] " + Logger::tr("Starting X11 capture benchmark ..."));
+	BenchmarkXCBCapture(1920, 1080);
+	BenchmarkXCBCapture(2560, 1440);
+	BenchmarkXCBCapture(3840, 2160);
+#endif
+
+	Logger::LogInfo("[Benchmark] " + Logger::tr("Starting capture timestamp benchmark ..."));
+	BenchmarkCaptureTimestamps("Idle server", 0.0, 0.001);
+	BenchmarkCaptureTimestamps("Light load ", 0.1, 0.002);
+	BenchmarkCaptureTimestamps("Heavy load ", 0.3, 0.006);
+
+	Logger::LogInfo("[Benchmark] " + Logger::tr("Starting UDP transport benchmark ..."));
+	BenchmarkUDPTransport(5000, 0, 0);
+	BenchmarkUDPTransport(20000, 0, 0);
+	BenchmarkUDPTransport(50000, 0, 0);
+	BenchmarkUDPTransport(20000, 10, 50); // drop 2% of the packets and recover them with FEC
+
+	Logger::LogInfo("[Benchmark] " + Logger::tr("Starting codec capability benchmark ..."));
+	BenchmarkCodecCapabilities();
+
+	Logger::LogInfo("[Benchmark] " + Logger::tr("Starting drift estimation benchmark ..."));
+	BenchmarkDriftEstimation("Device clock     ", 0.00005, 0.0, 0.0);
+	BenchmarkDriftEstimation("Scheduler jitter ", 0.002, 0.01, 0.03);
+
+	Logger::LogInfo("[Benchmark] " + Logger::tr("Starting audio path benchmark ..."));
+	BenchmarkAudioPath();
+	BenchmarkAudioBypassSync(0.0001);
+	BenchmarkAudioBypassSync(-0.0005);
+
+	Logger::LogInfo("[Benchmark] " + Logger::tr("Starting synchronizer benchmark ..."));
+	BenchmarkSynchronizer(60);
+	BenchmarkSynchronizer(144);
+
+	Logger::LogInfo("[Benchmark] " + Logger::tr("Starting audio-only benchmark ..."));
+	BenchmarkAudioOnly(false);
+	BenchmarkAudioOnly(true);
+
+	Logger::LogInfo("[Benchmark] " + Logger::tr("Starting degradation benchmark ..."));
+	BenchmarkDegradation("");
+	BenchmarkDegradation("fps/2");
+	BenchmarkDegradation("fps/2,fps/3");
+	BenchmarkDegradationOutput("");
+	BenchmarkDegradationOutput("fps/2,fps/3");
+
+	Logger::LogInfo("[Benchmark] " + Logger::tr("Starting thread budget benchmark ..."));
+	Logger::LogInfo("[Benchmark] " + Logger::tr("Available CPUs: %1 (system %2)").arg(ThreadBudget::GetAvailableCPUs()).arg(ThreadBudget::GetSystemCPUs()));
+	BenchmarkThreadBudget(ThreadBudget::GetSystemCPUs());
+	BenchmarkThreadBudget(0);
+
+	Logger::LogInfo("[Benchmark] " + Logger::tr("Starting start latency benchmark ..."));
+	BenchmarkStartLatency(false);
+	BenchmarkStartLatency(true);
+
+	Logger::LogInfo("[Benchmark] " + Logger::tr("Starting test pattern benchmark ..."));
+	BenchmarkTestPattern("static");
+	BenchmarkTestPattern("text");
+	BenchmarkTestPattern("noise");
+	BenchmarkTestPattern("partial");
+
 }
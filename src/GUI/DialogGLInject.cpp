@@ -112,9 +112,23 @@ DialogGLInject::DialogGLInject(PageInput* parent)
 											"This stops the application from wasting CPU time for frames that won't be recorded, and sometimes results in smoother video\n"
 											"(this depends on the application)."));
 		m_checkbox_limit_fps->setChecked(m_parent->GetGLInjectLimitFPS());
+		QLabel *label_stream_count = new QLabel(tr("Number of streams:"), groupbox_stream);
+		m_spinbox_stream_count = new QSpinBox(groupbox_stream);
+		m_spinbox_stream_count->setRange(1, 8);
+		m_spinbox_stream_count->setValue(m_parent->GetGLInjectStreamCount());
+		m_spinbox_stream_count->setToolTip(tr("The number of OpenGL streams that will be recorded at the same time, starting with the newest stream.\n"
+											  "The first stream is used as the main video track, every other stream is written to a separate video track\n"
+											  "with the same size. This is useful for applications that create multiple OpenGL windows."));
 
 		QVBoxLayout *layout = new QVBoxLayout(groupbox_stream);
 		layout->addWidget(m_checkbox_limit_fps);
+		{
+			QHBoxLayout *layout2 = new QHBoxLayout();
+			layout->addLayout(layout2);
+			layout2->addWidget(label_stream_count);
+			layout2->addWidget(m_spinbox_stream_count);
+			layout2->addStretch();
+		}
 	}
 
 	QPushButton *pushbutton_close = new QPushButton(tr("Close"), this);
@@ -153,6 +167,7 @@ void DialogGLInject::OnWriteBack() {
 	m_parent->SetGLInjectWorkingDirectory(m_lineedit_working_directory->text());
 	m_parent->SetGLInjectAutoLaunch(m_checkbox_auto_launch->isChecked());
 	m_parent->SetGLInjectLimitFPS(m_checkbox_limit_fps->isChecked());
+	m_parent->SetGLInjectStreamCount(m_spinbox_stream_count->value());
 }
 
 void DialogGLInject::OnLaunchNow() {
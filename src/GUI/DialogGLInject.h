@@ -37,6 +37,7 @@ private:
 	QCheckBox *m_checkbox_auto_launch;
 
 	QCheckBox *m_checkbox_limit_fps;
+	QSpinBox *m_spinbox_stream_count;
 
 public:
 	DialogGLInject(PageInput* parent);
@@ -70,11 +70,21 @@ MainWindow::MainWindow()
 
 	// warning for non-X11 window systems (e.g. Wayland)
 	if(!IsPlatformX11()) {
+#if SSR_USE_WAYLAND
+		MessageBox(QMessageBox::Warning, NULL, MainWindow::WINDOW_CAPTION,
+				   MainWindow::tr("You are using a non-X11 window system (e.g. Wayland). SimpleScreenRecorder can only record Wayland compositors that "
+								  "support the wlr-screencopy protocol (such as sway), using the 'Record Wayland output' option. "
+								  "Several other features will most likely not work properly. "
+								  "If your compositor is not supported, you should log out, choose a X11/Xorg session at the login screen, and then log back in.",
+								  "Don't translate 'wlr-screencopy'"),
+				   BUTTON_OK, BUTTON_OK);
+#else
 		MessageBox(QMessageBox::Warning, NULL, MainWindow::WINDOW_CAPTION,
 				   MainWindow::tr("You are using a non-X11 window system (e.g. Wayland) which is currently not supported by SimpleScreenRecorder. "
 								  "Several features will most likely not work properly. "
 								  "In order to solve this, you should log out, choose a X11/Xorg session at the login screen, and then log back in."),
 				   BUTTON_OK, BUTTON_OK);
+#endif
 	}
 
 	// warning for glitch with proprietary NVIDIA drivers
@@ -36,6 +36,9 @@ ENUMSTRINGS(PageInput::enum_video_area) = {
 #if SSR_USE_V4L2
 	{PageInput::VIDEO_AREA_V4L2, "v4l2"},
 #endif
+#if SSR_USE_WAYLAND
+	{PageInput::VIDEO_AREA_WAYLAND, "wayland"},
+#endif
 };
 
 ENUMSTRINGS(PageInput::enum_audio_backend) = {
@@ -66,6 +69,19 @@ static std::vector<QRect> GetScreenGeometries() {
 	return screen_geometries;
 }
 
+#if SSR_USE_WAYLAND
+// Returns the names of the screens, in the same order as GetScreenGeometries. On Wayland, these are the names of the outputs.
+static QStringList GetScreenNames() {
+	QStringList screen_names;
+#if QT_VERSION >= QT_VERSION_CHECK(5, 0, 0)
+	for(QScreen *screen :  QApplication::screens()) {
+		screen_names.append(screen->name());
+	}
+#endif
+	return screen_names;
+}
+#endif
+
 static QRect CombineScreenGeometries(const std::vector<QRect>& screen_geometries) {
 	QRect combined_geometry;
 	for(const QRect &geometry : screen_geometries) {
@@ -281,6 +297,9 @@ PageInput::PageInput(MainWindow* main_window)
 #endif
 #if SSR_USE_V4L2
 			QRadioButton *radio_area_v4l2 = new QRadioButton(tr("Record V4L2 device"), groupbox_video);
+#endif
+#if SSR_USE_WAYLAND
+			QRadioButton *radio_area_wayland = new QRadioButton(tr("Record Wayland output"), groupbox_video);
 #endif
 			m_buttongroup_video_area->addButton(radio_area_screen, VIDEO_AREA_SCREEN);
 			m_buttongroup_video_area->addButton(radio_area_fixed, VIDEO_AREA_FIXED);
@@ -290,9 +309,15 @@ PageInput::PageInput(MainWindow* main_window)
 #endif
 #if SSR_USE_V4L2
 			m_buttongroup_video_area->addButton(radio_area_v4l2, VIDEO_AREA_V4L2);
+#endif
+#if SSR_USE_WAYLAND
+			m_buttongroup_video_area->addButton(radio_area_wayland, VIDEO_AREA_WAYLAND);
 #endif
 			m_combobox_screens = new QComboBoxWithSignal(groupbox_video);
 			m_combobox_screens->setToolTip(tr("Select what monitor should be recorded in a multi-monitor configuration."));
+			m_checkbox_separate_screens = new QCheckBox(tr("Separate track per screen"), groupbox_video);
+			m_checkbox_separate_screens->setToolTip(tr("Record every screen with its own capture thread and write it to a separate video track, rather than\n"
+													   "recording one large rectangle that includes the unused space between the screens."));
 			m_checkbox_follow_fullscreen = new QCheckBox(tr("Record entire screen with cursor"), groupbox_video);
 			m_checkbox_follow_fullscreen->setToolTip(tr("Record the entire screen on which the cursor is located, rather than following the cursor position."));
 			m_pushbutton_video_select_rectangle = new QPushButton(tr("Select rectangle..."), groupbox_video);
@@ -308,6 +333,13 @@ PageInput::PageInput(MainWindow* main_window)
 #if SSR_USE_V4L2
 			m_lineedit_v4l2_device = new QLineEdit(groupbox_video);
 			m_lineedit_v4l2_device->setToolTip(tr("The V4L2 device to record (e.g. /dev/video0)."));
+#endif
+#if SSR_USE_WAYLAND
+			m_combobox_wayland_output = new QComboBox(groupbox_video);
+			m_combobox_wayland_output->setEditable(true);
+			m_combobox_wayland_output->setSizePolicy(QSizePolicy::Expanding, QSizePolicy::Fixed);
+			m_combobox_wayland_output->setToolTip(tr("The name of the Wayland output (monitor) to record, e.g. DP-1. This requires a compositor that supports the wlr-screencopy protocol, such as sway.",
+													 "Don't translate 'Wayland' and 'wlr-screencopy'"));
 #endif
 			m_label_video_x = new QLabel(tr("Left:"), groupbox_video);
 			m_spinbox_video_x = new QSpinBoxWithSignal(groupbox_video);
@@ -355,6 +387,9 @@ PageInput::PageInput(MainWindow* main_window)
 			connect(m_combobox_screens, SIGNAL(popupShown()), this, SLOT(OnIdentifyScreens()));
 			connect(m_combobox_screens, SIGNAL(popupHidden()), this, SLOT(OnStopIdentifyScreens()));
 			connect(m_checkbox_follow_fullscreen, SIGNAL(clicked()), this, SLOT(OnUpdateVideoAreaFields()));
+#if SSR_USE_WAYLAND
+			connect(m_combobox_wayland_output, SIGNAL(editTextChanged(QString)), this, SLOT(OnUpdateVideoAreaFields()));
+#endif
 			connect(m_spinbox_video_x, SIGNAL(focusIn()), this, SLOT(OnUpdateRecordingFrame()));
 			connect(m_spinbox_video_x, SIGNAL(focusOut()), this, SLOT(OnUpdateRecordingFrame()));
 			connect(m_spinbox_video_x, SIGNAL(valueChanged(int)), this, SLOT(OnUpdateRecordingFrame()));
@@ -380,6 +415,7 @@ PageInput::PageInput(MainWindow* main_window)
 				layout->addLayout(layout2);
 				layout2->addWidget(radio_area_screen);
 				layout2->addWidget(m_combobox_screens);
+				layout2->addWidget(m_checkbox_separate_screens);
 			}
 			layout->addWidget(radio_area_fixed);
 			{
@@ -398,6 +434,14 @@ PageInput::PageInput(MainWindow* main_window)
 				layout2->addWidget(radio_area_v4l2);
 				layout2->addWidget(m_lineedit_v4l2_device);
 			}
+#endif
+#if SSR_USE_WAYLAND
+			{
+				QHBoxLayout *layout2 = new QHBoxLayout();
+				layout->addLayout(layout2);
+				layout2->addWidget(radio_area_wayland);
+				layout2->addWidget(m_combobox_wayland_output);
+			}
 #endif
 			{
 				QHBoxLayout *layout2 = new QHBoxLayout();
@@ -630,8 +674,12 @@ void PageInput::LoadProfileSettings(QSettings* settings) {
 	SetVideoArea(StringToEnum(settings->value("input/video_area", QString()).toString(), VIDEO_AREA_SCREEN));
 	SetVideoAreaScreen(settings->value("input/video_area_screen", 0).toUInt());
 	SetVideoAreaFollowFullscreen(settings->value("input/video_area_follow_fullscreen", false).toBool());
+	SetVideoAreaSeparateScreens(settings->value("input/video_area_separate_screens", false).toBool());
 #if SSR_USE_V4L2
 	SetVideoV4L2Device(settings->value("input/video_v4l2_device", "/dev/video0").toString());
+#endif
+#if SSR_USE_WAYLAND
+	SetVideoWaylandOutput(settings->value("input/video_wayland_output_name", GetScreenNames().value(0)).toString());
 #endif
 	SetVideoX(settings->value("input/video_x", 0).toUInt());
 	SetVideoY(settings->value("input/video_y", 0).toUInt());
@@ -661,6 +709,7 @@ void PageInput::LoadProfileSettings(QSettings* settings) {
 	SetGLInjectWorkingDirectory(settings->value("input/glinject_working_directory", "").toString());
 	SetGLInjectAutoLaunch(settings->value("input/glinject_auto_launch", false).toBool());
 	SetGLInjectLimitFPS(settings->value("input/glinject_limit_fps", false).toBool());
+	SetGLInjectStreamCount(settings->value("input/glinject_stream_count", 1).toUInt());
 #endif
 
 	// update things
@@ -675,8 +724,12 @@ void PageInput::SaveProfileSettings(QSettings* settings) {
 	settings->setValue("input/video_area", EnumToString(GetVideoArea()));
 	settings->setValue("input/video_area_screen", GetVideoAreaScreen());
 	settings->setValue("input/video_area_follow_fullscreen", GetVideoAreaFollowFullscreen());
+	settings->setValue("input/video_area_separate_screens", GetVideoAreaSeparateScreens());
 #if SSR_USE_V4L2
 	settings->setValue("input/video_v4l2_device", GetVideoV4L2Device());
+#endif
+#if SSR_USE_WAYLAND
+	settings->setValue("input/video_wayland_output_name", GetVideoWaylandOutput());
 #endif
 	settings->setValue("input/video_x", GetVideoX());
 	settings->setValue("input/video_y", GetVideoY());
@@ -706,6 +759,7 @@ void PageInput::SaveProfileSettings(QSettings* settings) {
 	settings->setValue("input/glinject_working_directory", GetGLInjectWorkingDirectory());
 	settings->setValue("input/glinject_auto_launch", GetGLInjectAutoLaunch());
 	settings->setValue("input/glinject_limit_fps", GetGLInjectLimitFPS());
+	settings->setValue("input/glinject_stream_count", GetGLInjectStreamCount());
 #endif
 }
 
@@ -957,6 +1011,15 @@ void PageInput::SetVideoAreaFromRubberBand() {
 	SetVideoH(r.height());
 }
 
+std::vector<QRect> PageInput::GetVideoAreaScreenGeometries() {
+	if(GetVideoArea() != VIDEO_AREA_SCREEN || GetVideoAreaScreen() != 0 || !GetVideoAreaSeparateScreens())
+		return std::vector<QRect>();
+	std::vector<QRect> screen_geometries = GetScreenGeometries();
+	if(screen_geometries.size() < 2)
+		return std::vector<QRect>();
+	return screen_geometries;
+}
+
 void PageInput::LoadScreenConfigurations() {
 	std::vector<QRect> screen_geometries = GetScreenGeometries();
 	QRect combined_geometry = CombineScreenGeometries(screen_geometries);
@@ -968,6 +1031,13 @@ void PageInput::LoadScreenConfigurations() {
 		m_combobox_screens->addItem(tr("Screen %1: %2x%3 at %4,%5", "This appears in the screen selection combobox")
 									.arg(i + 1).arg(geometry.width()).arg(geometry.height()).arg(geometry.x()).arg(geometry.y()));
 	}
+#if SSR_USE_WAYLAND
+	// the Wayland outputs are selected by name, so the current name is kept even if the output is gone
+	QString selected_output = GetVideoWaylandOutput();
+	m_combobox_wayland_output->clear();
+	m_combobox_wayland_output->addItems(GetScreenNames());
+	SetVideoWaylandOutput(selected_output);
+#endif
 	// update the video x/y/w/h in case the position or size of the selected screen changed
 	OnUpdateVideoAreaFields();
 }
@@ -1026,6 +1096,9 @@ void PageInput::OnUpdateVideoAreaFields() {
 #endif
 #if SSR_USE_V4L2
 			m_lineedit_v4l2_device->setEnabled(false);
+#endif
+#if SSR_USE_WAYLAND
+			m_combobox_wayland_output->setEnabled(false);
 #endif
 			m_checkbox_record_cursor->setEnabled(true);
 			GroupEnabled({m_label_video_x, m_spinbox_video_x, m_label_video_y, m_spinbox_video_y,
@@ -1038,6 +1111,7 @@ void PageInput::OnUpdateVideoAreaFields() {
 			} else {
 				rect = CombineScreenGeometries(screen_geometries);
 			}
+			m_checkbox_separate_screens->setEnabled(sc == 0 && screen_geometries.size() > 1);
 			SetVideoX(rect.left());
 			SetVideoY(rect.top());
 			SetVideoW(rect.width());
@@ -1047,6 +1121,7 @@ void PageInput::OnUpdateVideoAreaFields() {
 		case VIDEO_AREA_FIXED: {
 			m_combobox_screens->setEnabled(false);
 			m_checkbox_follow_fullscreen->setEnabled(false);
+			m_checkbox_separate_screens->setEnabled(false);
 			m_pushbutton_video_select_rectangle->setEnabled(true);
 			m_pushbutton_video_select_window->setEnabled(true);
 #if SSR_USE_OPENGL_RECORDING
@@ -1054,6 +1129,9 @@ void PageInput::OnUpdateVideoAreaFields() {
 #endif
 #if SSR_USE_V4L2
 			m_lineedit_v4l2_device->setEnabled(false);
+#endif
+#if SSR_USE_WAYLAND
+			m_combobox_wayland_output->setEnabled(false);
 #endif
 			m_checkbox_record_cursor->setEnabled(true);
 			GroupEnabled({m_label_video_x, m_spinbox_video_x, m_label_video_y, m_spinbox_video_y,
@@ -1063,11 +1141,15 @@ void PageInput::OnUpdateVideoAreaFields() {
 		case VIDEO_AREA_CURSOR: {
 			m_combobox_screens->setEnabled(false);
 			m_checkbox_follow_fullscreen->setEnabled(true);
+			m_checkbox_separate_screens->setEnabled(false);
 #if SSR_USE_OPENGL_RECORDING
 			m_pushbutton_video_opengl_settings->setEnabled(false);
 #endif
 #if SSR_USE_V4L2
 			m_lineedit_v4l2_device->setEnabled(false);
+#endif
+#if SSR_USE_WAYLAND
+			m_combobox_wayland_output->setEnabled(false);
 #endif
 			m_checkbox_record_cursor->setEnabled(true);
 			if(m_checkbox_follow_fullscreen->isChecked()) {
@@ -1095,11 +1177,15 @@ void PageInput::OnUpdateVideoAreaFields() {
 		case VIDEO_AREA_GLINJECT: {
 			m_combobox_screens->setEnabled(false);
 			m_checkbox_follow_fullscreen->setEnabled(false);
+			m_checkbox_separate_screens->setEnabled(false);
 			m_pushbutton_video_select_rectangle->setEnabled(false);
 			m_pushbutton_video_select_window->setEnabled(false);
 			m_pushbutton_video_opengl_settings->setEnabled(true);
 #if SSR_USE_V4L2
 			m_lineedit_v4l2_device->setEnabled(false);
+#endif
+#if SSR_USE_WAYLAND
+			m_combobox_wayland_output->setEnabled(false);
 #endif
 			m_checkbox_record_cursor->setEnabled(true);
 			GroupEnabled({m_label_video_x, m_spinbox_video_x, m_label_video_y, m_spinbox_video_y,
@@ -1111,17 +1197,50 @@ void PageInput::OnUpdateVideoAreaFields() {
 		case VIDEO_AREA_V4L2: {
 			m_combobox_screens->setEnabled(false);
 			m_checkbox_follow_fullscreen->setEnabled(false);
+			m_checkbox_separate_screens->setEnabled(false);
 			m_pushbutton_video_select_rectangle->setEnabled(false);
 			m_pushbutton_video_select_window->setEnabled(false);
 #if SSR_USE_OPENGL_RECORDING
 			m_pushbutton_video_opengl_settings->setEnabled(false);
 #endif
 			m_lineedit_v4l2_device->setEnabled(true);
+#if SSR_USE_WAYLAND
+			m_combobox_wayland_output->setEnabled(false);
+#endif
 			m_checkbox_record_cursor->setEnabled(false);
 			GroupEnabled({m_label_video_x, m_spinbox_video_x, m_label_video_y, m_spinbox_video_y}, false);
 			GroupEnabled({m_label_video_w, m_spinbox_video_w, m_label_video_h, m_spinbox_video_h}, true);
 			break;
 		}
+#endif
+#if SSR_USE_WAYLAND
+		case VIDEO_AREA_WAYLAND: {
+			m_combobox_screens->setEnabled(false);
+			m_checkbox_follow_fullscreen->setEnabled(false);
+			m_checkbox_separate_screens->setEnabled(false);
+			m_pushbutton_video_select_rectangle->setEnabled(false);
+			m_pushbutton_video_select_window->setEnabled(false);
+#if SSR_USE_OPENGL_RECORDING
+			m_pushbutton_video_opengl_settings->setEnabled(false);
+#endif
+#if SSR_USE_V4L2
+			m_lineedit_v4l2_device->setEnabled(false);
+#endif
+			m_combobox_wayland_output->setEnabled(true);
+			m_checkbox_record_cursor->setEnabled(true);
+			GroupEnabled({m_label_video_x, m_spinbox_video_x, m_label_video_y, m_spinbox_video_y,
+						  m_label_video_w, m_spinbox_video_w, m_label_video_h, m_spinbox_video_h}, false);
+			// the actual size is only known when the input is started, but Qt uses the same names for the screens
+			int output = GetScreenNames().indexOf(GetVideoWaylandOutput());
+			std::vector<QRect> screen_geometries = GetScreenGeometries();
+			if(output >= 0 && (size_t) output < screen_geometries.size()) {
+				SetVideoX(0);
+				SetVideoY(0);
+				SetVideoW(screen_geometries[output].width());
+				SetVideoH(screen_geometries[output].height());
+			}
+			break;
+		}
 #endif
 		default: break;
 	}
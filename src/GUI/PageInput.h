@@ -113,6 +113,9 @@ public:
 #endif
 #if SSR_USE_V4L2
 		VIDEO_AREA_V4L2,
+#endif
+#if SSR_USE_WAYLAND
+		VIDEO_AREA_WAYLAND,
 #endif
 		VIDEO_AREA_COUNT // must be last
 	};
@@ -150,6 +153,7 @@ private:
 	QString m_glinject_command, m_glinject_working_directory;
 	bool m_glinject_auto_launch;
 	bool m_glinject_limit_fps;
+	unsigned int m_glinject_stream_count;
 #endif
 
 	std::vector<ScreenLabelWindow*> m_screen_labels;
@@ -158,6 +162,7 @@ private:
 
 	QButtonGroup *m_buttongroup_video_area;
 	QComboBoxWithSignal *m_combobox_screens;
+	QCheckBox *m_checkbox_separate_screens;
 	QCheckBox *m_checkbox_follow_fullscreen;
 	QPushButton *m_pushbutton_video_select_rectangle, *m_pushbutton_video_select_window;
 #if SSR_USE_OPENGL_RECORDING
@@ -165,6 +170,9 @@ private:
 #endif
 #if SSR_USE_V4L2
 	QLineEdit *m_lineedit_v4l2_device;
+#endif
+#if SSR_USE_WAYLAND
+	QComboBox *m_combobox_wayland_output;
 #endif
 	QLabel *m_label_video_x, *m_label_video_y, *m_label_video_w, *m_label_video_h;
 	QSpinBoxWithSignal *m_spinbox_video_x, *m_spinbox_video_y, *m_spinbox_video_w, *m_spinbox_video_h;
@@ -206,6 +214,9 @@ private:
 public:
 	bool Validate();
 
+	// Returns the geometry of every screen if each screen should be recorded separately, or an empty vector otherwise.
+	std::vector<QRect> GetVideoAreaScreenGeometries();
+
 #if SSR_USE_ALSA
 	QString GetALSASourceName();
 #endif
@@ -273,8 +284,12 @@ public:
 	inline enum_video_area GetVideoArea() { return (enum_video_area) clamp(m_buttongroup_video_area->checkedId(), 0, VIDEO_AREA_COUNT - 1); }
 	inline unsigned int GetVideoAreaScreen() { return m_combobox_screens->currentIndex(); }
 	inline bool GetVideoAreaFollowFullscreen() { return m_checkbox_follow_fullscreen->isChecked(); }
+	inline bool GetVideoAreaSeparateScreens() { return m_checkbox_separate_screens->isChecked(); }
 #if SSR_USE_V4L2
 	inline QString GetVideoV4L2Device() { return m_lineedit_v4l2_device->text(); }
+#endif
+#if SSR_USE_WAYLAND
+	inline QString GetVideoWaylandOutput() { return m_combobox_wayland_output->currentText(); }
 #endif
 	inline unsigned int GetVideoX() { return m_spinbox_video_x->value(); }
 	inline unsigned int GetVideoY() { return m_spinbox_video_y->value(); }
@@ -304,14 +319,19 @@ public:
 	inline QString GetGLInjectWorkingDirectory() { return m_glinject_working_directory; }
 	inline bool GetGLInjectAutoLaunch() { return m_glinject_auto_launch; }
 	inline bool GetGLInjectLimitFPS() { return m_glinject_limit_fps; }
+	inline unsigned int GetGLInjectStreamCount() { return m_glinject_stream_count; }
 #endif
 
 	inline void SetProfile(unsigned int profile) { m_profile_box->SetProfile(profile); }
 	inline void SetVideoArea(enum_video_area area) { QAbstractButton *b = m_buttongroup_video_area->button(area); if(b != NULL) b->setChecked(true); }
 	inline void SetVideoAreaScreen(unsigned int screen) { m_combobox_screens->setCurrentIndex(clamp(screen, 0u, (unsigned int) m_combobox_screens->count() - 1)); }
 	inline void SetVideoAreaFollowFullscreen(bool follow_fulscreen) { m_checkbox_follow_fullscreen->setChecked(follow_fulscreen); }
+	inline void SetVideoAreaSeparateScreens(bool separate_screens) { m_checkbox_separate_screens->setChecked(separate_screens); }
 #if SSR_USE_V4L2
 	inline void SetVideoV4L2Device(const QString& device) { m_lineedit_v4l2_device->setText(device); }
+#endif
+#if SSR_USE_WAYLAND
+	inline void SetVideoWaylandOutput(const QString& output) { m_combobox_wayland_output->setEditText(output); }
 #endif
 	inline void SetVideoX(unsigned int x) { m_spinbox_video_x->setValue(x); }
 	inline void SetVideoY(unsigned int y) { m_spinbox_video_y->setValue(y); }
@@ -341,6 +361,7 @@ public:
 	inline void SetGLInjectWorkingDirectory(const QString& glinject_working_directory) { m_glinject_working_directory = glinject_working_directory; }
 	inline void SetGLInjectAutoLaunch(bool auto_launch) { m_glinject_auto_launch = auto_launch; }
 	inline void SetGLInjectLimitFPS(bool limit_fps) { m_glinject_limit_fps = limit_fps; }
+	inline void SetGLInjectStreamCount(unsigned int stream_count) { m_glinject_stream_count = clamp(stream_count, 1u, 8u); }
 #endif
 
 };
@@ -19,6 +19,7 @@ along with SimpleScreenRecorder.  If not, see <http://www.gnu.org/licenses/>.
 
 #include "PageOutput.h"
 
+#include "CommandLineOptions.h"
 #include "Dialogs.h"
 #include "EnumStrings.h"
 #include "HiddenScrollArea.h"
@@ -28,6 +29,7 @@ along with SimpleScreenRecorder.  If not, see <http://www.gnu.org/licenses/>.
 #include "PageInput.h"
 
 #include "AVWrapper.h"
+#include "CodecCapabilities.h"
 #include "VideoEncoder.h"
 #include "AudioEncoder.h"
 
@@ -112,27 +114,20 @@ PageOutput::PageOutput(MainWindow* main_window)
 		m_audio_codecs[AUDIO_CODEC_AAC].avname = "aac";
 	}
 
-	// load AV container list
+	// load AV container and codec lists
+	// (probing libav/ffmpeg is slow, so this uses a cache that is refreshed when the libraries change)
+	CodecCapabilities capabilities = GetCodecCapabilities(GetApplicationUserDir() + "/codec-cache.conf");
 	m_containers_av.clear();
-#if SSR_USE_AV_MUXER_ITERATE
-	const AVOutputFormat *format;
-	void *format_opaque = NULL;
-	while((format = av_muxer_iterate(&format_opaque)) != NULL) {
-#else
-	for(AVOutputFormat *format = av_oformat_next(NULL); format != NULL; format = av_oformat_next(format)) {
-#endif
-		if(format->video_codec == AV_CODEC_ID_NONE)
-			continue;
+	for(const CodecCapabilities::Container &container : capabilities.m_containers) {
 		ContainerData c;
-		c.name = format->long_name;
-		c.avname = format->name;
-		c.suffixes = SplitSkipEmptyParts(format->extensions, ',');
+		c.name = container.name;
+		c.avname = container.avname;
+		c.suffixes = container.suffixes;
 		if(c.suffixes.isEmpty()) {
 			c.filter = "";
 		} else {
 			c.filter = tr("%1 files", "This appears in the file dialog, e.g. 'MP4 files'").arg(c.avname) + " (*." + c.suffixes[0];
 			for(int i = 1; i < c.suffixes.size(); ++i) {
-				c.suffixes[i] = c.suffixes[i].trimmed(); // needed because libav/ffmpeg isn't very consistent when they say 'comma-separated'
 				c.filter += " *." + c.suffixes[i];
 			}
 			c.filter += ")";
@@ -140,31 +135,19 @@ PageOutput::PageOutput(MainWindow* main_window)
 		m_containers_av.push_back(c);
 	}
 	std::sort(m_containers_av.begin(), m_containers_av.end());
-
-	// load AV codec list
 	m_video_codecs_av.clear();
+	for(const CodecCapabilities::Codec &codec : capabilities.m_video_codecs) {
+		VideoCodecData c;
+		c.name = codec.name;
+		c.avname = codec.avname;
+		m_video_codecs_av.push_back(c);
+	}
 	m_audio_codecs_av.clear();
-#if SSR_USE_AV_MUXER_ITERATE
-	const AVCodec *codec;
-	void *codec_opaque = NULL;
-	while((codec = av_codec_iterate(&codec_opaque)) != NULL) {
-#else
-	for(AVCodec *codec = av_codec_next(NULL); codec != NULL; codec = av_codec_next(codec)) {
-#endif
-		if(!av_codec_is_encoder(codec))
-			continue;
-		if(codec->type == AVMEDIA_TYPE_VIDEO && VideoEncoder::AVCodecIsSupported(codec->name)) {
-			VideoCodecData c;
-			c.name = codec->long_name;
-			c.avname = codec->name;
-			m_video_codecs_av.push_back(c);
-		}
-		if(codec->type == AVMEDIA_TYPE_AUDIO && AudioEncoder::AVCodecIsSupported(codec->name)) {
-			AudioCodecData c;
-			c.name = codec->long_name;
-			c.avname = codec->name;
-			m_audio_codecs_av.push_back(c);
-		}
+	for(const CodecCapabilities::Codec &codec : capabilities.m_audio_codecs) {
+		AudioCodecData c;
+		c.name = codec.name;
+		c.avname = codec.avname;
+		m_audio_codecs_av.push_back(c);
 	}
 	std::sort(m_video_codecs_av.begin(), m_video_codecs_av.end());
 	std::sort(m_audio_codecs_av.begin(), m_audio_codecs_av.end());
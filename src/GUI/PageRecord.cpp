@@ -29,18 +29,28 @@ along with SimpleScreenRecorder.  If not, see <http://www.gnu.org/licenses/>.
 #include "DialogRecordSchedule.h"
 
 #include "HotkeyListener.h"
+#include "ThreadWatchdog.h"
+#include "FrameAccounting.h"
 
 #include "Muxer.h"
 #include "VideoEncoder.h"
 #include "AudioEncoder.h"
 #include "Synchronizer.h"
+#include "TapSink.h"
+#include "TestPatternInput.h"
+#include "FileVideoInput.h"
+#include "FileAudioInput.h"
 #include "X11Input.h"
 #if SSR_USE_OPENGL_RECORDING
 #include "GLInjectInput.h"
+#include "SSRVideoStreamReader.h"
 #endif
 #if SSR_USE_V4L2
 #include "V4L2Input.h"
 #endif
+#if SSR_USE_WAYLAND
+#include "WaylandInput.h"
+#endif
 #if SSR_USE_ALSA
 #include "ALSAInput.h"
 #endif
@@ -54,7 +64,8 @@ along with SimpleScreenRecorder.  If not, see <http://www.gnu.org/licenses/>.
 #include "VideoPreviewer.h"
 #include "AudioPreviewer.h"
 
-static QString GetNewSegmentFile(const QString& file, bool add_timestamp) {
+// If 'current_file' is given, that file may be returned even though it exists (it is the file that would be renamed).
+static QString GetNewSegmentFile(const QString& file, bool add_timestamp, const QString& current_file = QString()) {
 	QFileInfo fi(file);
 	QDateTime now = QDateTime::currentDateTime();
 	QString newfile;
@@ -75,10 +86,21 @@ static QString GetNewSegmentFile(const QString& file, bool add_timestamp) {
 		if(!fi.suffix().isEmpty())
 			newfile += "." + fi.suffix();
 		newfile = fi.path() + "/" + newfile;
-	} while(QFileInfo(newfile).exists());
+	} while(newfile != current_file && QFileInfo(newfile).exists());
 	return newfile;
 }
 
+// Calculates the size of an additional video track from the size of its own input. With scaling, the track is scaled by the same factor
+// as the main track, so screens and streams with a different aspect ratio are not distorted. Only even sizes are allowed.
+static std::pair<unsigned int, unsigned int> GetExtraTrackSize(unsigned int width, unsigned int height, bool scaling,
+															   unsigned int main_in_width, unsigned int main_in_height, unsigned int main_out_width, unsigned int main_out_height) {
+	if(scaling) {
+		width = (unsigned int) ((uint64_t) width * (uint64_t) main_out_width / (uint64_t) main_in_width);
+		height = (unsigned int) ((uint64_t) height * (uint64_t) main_out_height / (uint64_t) main_in_height);
+	}
+	return std::make_pair(std::max(2u, width / 2 * 2), std::max(2u, height / 2 * 2));
+}
+
 static std::vector<std::pair<QString, QString> > GetOptionsFromString(const QString& str) {
 	std::vector<std::pair<QString, QString> > options;
 	QStringList optionlist = SplitSkipEmptyParts(str, ',');
@@ -137,6 +159,9 @@ public:
 
 };
 
+// threads that don't make progress for this long are reported by the watchdog (in microseconds)
+static const int64_t THREAD_WATCHDOG_THRESHOLD = 2000000;
+
 // sound notification sequences
 #if SSR_USE_ALSA
 static const std::array<SimpleSynth::Note, 1> SEQUENCE_RECORD_START = {{
@@ -173,6 +198,8 @@ PageRecord::PageRecord(MainWindow* main_window)
 
 	m_stdin_reentrant = false;
 
+	m_thread_watchdog.reset(new ThreadWatchdog(THREAD_WATCHDOG_THRESHOLD));
+
 	QGroupBox *groupbox_recording = new QGroupBox(tr("Recording"), this);
 	{
 		m_pushbutton_record = new QPushButton(groupbox_recording);
@@ -406,6 +433,10 @@ PageRecord::PageRecord(MainWindow* main_window)
 	m_stdin_notifier = new QSocketNotifier(0, QSocketNotifier::Read, this);
 	connect(m_stdin_notifier, SIGNAL(activated(int)), this, SLOT(OnStdin()));
 
+	// standard input can't be used for commands if one of the input files is read from it
+	if(CommandLineOptions::GetVideoFile() == "-" || CommandLineOptions::GetAudioFile() == "-")
+		m_stdin_notifier->setEnabled(false);
+
 	m_timer_schedule = new QTimer(this);
 	m_timer_schedule->setSingleShot(true);
 	m_timer_update_info = new QTimer(this);
@@ -547,6 +578,9 @@ void PageRecord::StartPage() {
 	m_video_area_follow_fullscreen = page_input->GetVideoAreaFollowFullscreen();
 #if SSR_USE_V4L2
 	m_v4l2_device = page_input->GetVideoV4L2Device();
+#endif
+#if SSR_USE_WAYLAND
+	m_wayland_output = page_input->GetVideoWaylandOutput();
 #endif
 	m_video_x = page_input->GetVideoX();
 	m_video_y = page_input->GetVideoY();
@@ -563,6 +597,32 @@ void PageRecord::StartPage() {
 	}
 	m_video_in_width = page_input->GetVideoW();
 	m_video_in_height = page_input->GetVideoH();
+	{
+		// when every screen is recorded separately, the main track records the first screen and the other screens get their own tracks
+		std::vector<QRect> screen_geometries = page_input->GetVideoAreaScreenGeometries();
+		m_video_extra_screens.clear();
+		if(!screen_geometries.empty()) {
+			m_video_x = screen_geometries[0].x();
+			m_video_y = screen_geometries[0].y();
+			m_video_in_width = screen_geometries[0].width();
+			m_video_in_height = screen_geometries[0].height();
+			m_video_extra_screens.assign(screen_geometries.begin() + 1, screen_geometries.end());
+		}
+	}
+	m_video_test_pattern = !CommandLineOptions::GetTestPattern().isNull();
+	if(m_video_test_pattern) {
+		// the test pattern replaces the selected video input, it uses the same size unless a size was given on the command line
+		if(CommandLineOptions::GetTestPatternWidth() != 0) {
+			m_video_in_width = CommandLineOptions::GetTestPatternWidth();
+			m_video_in_height = CommandLineOptions::GetTestPatternHeight();
+		}
+		m_video_extra_screens.clear();
+	}
+	m_video_from_file = !CommandLineOptions::GetVideoFile().isNull();
+	if(m_video_from_file) {
+		// the size is read from the file when the input is created
+		m_video_extra_screens.clear();
+	}
 	m_video_frame_rate = page_input->GetVideoFrameRate();
 	m_video_scaling = page_input->GetVideoScalingEnabled();
 	m_video_scaled_width = page_input->GetVideoScaledW();
@@ -571,6 +631,9 @@ void PageRecord::StartPage() {
 
 	// get the audio input settings
 	m_audio_enabled = page_input->GetAudioEnabled();
+	m_audio_from_file = !CommandLineOptions::GetAudioFile().isNull();
+	if(m_audio_from_file)
+		m_audio_enabled = true;
 	m_audio_channels = 2;
 	m_audio_sample_rate = 48000;
 	m_audio_backend = page_input->GetAudioBackend();
@@ -598,6 +661,7 @@ void PageRecord::StartPage() {
 	QString glinject_working_directory = page_input->GetGLInjectWorkingDirectory();
 	bool glinject_auto_launch = page_input->GetGLInjectAutoLaunch();
 	bool glinject_limit_fps = page_input->GetGLInjectLimitFPS();
+	unsigned int glinject_stream_count = page_input->GetGLInjectStreamCount();
 #endif
 
 	// get file settings
@@ -605,10 +669,16 @@ void PageRecord::StartPage() {
 	m_file_protocol = page_output->GetFileProtocol();
 	m_separate_files = page_output->GetSeparateFiles();
 	m_add_timestamp = page_output->GetAddTimestamp();
+	m_arm_output = CommandLineOptions::GetArmOutput();
+	m_output_armed = false;
+	m_output_start_time = AV_NOPTS_VALUE;
+	m_start_latency = AV_NOPTS_VALUE;
+	m_start_was_armed = false;
 
 	// get the output settings
 	m_output_settings.file = QString(); // will be set later
 	m_output_settings.container_avname = page_output->GetContainerAVName();
+	m_output_settings.recovery_journal = CommandLineOptions::GetRecoveryJournal();
 
 	m_output_settings.video_codec_avname = page_output->GetVideoCodecAVName();
 	m_output_settings.video_kbit_rate = page_output->GetVideoKBitRate();
@@ -617,6 +687,8 @@ void PageRecord::StartPage() {
 	m_output_settings.video_height = 0;
 	m_output_settings.video_frame_rate = m_video_frame_rate;
 	m_output_settings.video_allow_frame_skipping = page_output->GetVideoAllowFrameSkipping();
+	m_output_settings.video_degradation_ladder = CommandLineOptions::GetDegradationLadder();
+	m_output_settings.audio_fast_path = CommandLineOptions::GetAudioFastPath();
 
 	m_output_settings.audio_codec_avname = (m_audio_enabled)? page_output->GetAudioCodecAVName() : QString();
 	m_output_settings.audio_kbit_rate = page_output->GetAudioKBitRate();
@@ -666,6 +738,8 @@ void PageRecord::StartPage() {
 
 	Logger::LogInfo("[PageRecord::StartPage] " + tr("Starting page ..."));
 
+	FrameAccounting::Reset();
+
 	try {
 
 #if SSR_USE_OPENGL_RECORDING
@@ -673,12 +747,30 @@ void PageRecord::StartPage() {
 		if(m_video_area == PageInput::VIDEO_AREA_GLINJECT) {
 			if(glinject_auto_launch)
 				GLInjectInput::LaunchApplication(glinject_channel, glinject_relax_permissions, glinject_command, glinject_working_directory);
-			m_gl_inject_input.reset(new GLInjectInput(glinject_channel, glinject_relax_permissions, m_video_record_cursor, glinject_limit_fps, m_video_frame_rate));
+			bool exclusive = (glinject_stream_count > 1);
+			m_gl_inject_input.reset(new GLInjectInput(glinject_channel, glinject_relax_permissions, m_video_record_cursor, glinject_limit_fps, m_video_frame_rate, 0, exclusive));
+			for(unsigned int i = 1; i < glinject_stream_count; ++i) {
+				m_gl_inject_extra_inputs.emplace_back(new GLInjectInput(glinject_channel, glinject_relax_permissions, m_video_record_cursor, glinject_limit_fps, m_video_frame_rate, i, exclusive));
+			}
 		}
 #endif
 
+		// for file inputs, create the input now so the file continues where it stopped when the recording is paused
+		if(m_video_from_file) {
+			m_file_video_input.reset(new FileVideoInput(CommandLineOptions::GetVideoFile(), CommandLineOptions::GetFastInput(),
+														FileVideoInput::GetRawFormatFromName(CommandLineOptions::GetVideoFileFormat()),
+														CommandLineOptions::GetVideoFileWidth(), CommandLineOptions::GetVideoFileHeight(),
+														CommandLineOptions::GetVideoFileFrameRate()));
+			m_file_video_input->GetCurrentSize(&m_video_in_width, &m_video_in_height);
+		}
+		if(m_audio_from_file) {
+			m_file_audio_input.reset(new FileAudioInput(CommandLineOptions::GetAudioFile(), CommandLineOptions::GetFastInput(),
+														FileAudioInput::GetRawFormatFromName(CommandLineOptions::GetAudioFileFormat()),
+														CommandLineOptions::GetAudioFileSampleRate(), CommandLineOptions::GetAudioFileChannels()));
+		}
+
 #if SSR_USE_JACK
-		if(m_audio_enabled) {
+		if(m_audio_enabled && !m_audio_from_file) {
 			// for JACK, start the input now
 			if(m_audio_backend == PageInput::AUDIO_BACKEND_JACK)
 				m_jack_input.reset(new JACKInput(jack_connect_system_capture, jack_connect_system_playback));
@@ -687,7 +779,10 @@ void PageRecord::StartPage() {
 
 	} catch(...) {
 		Logger::LogError("[PageRecord::StartPage] " + tr("Error: Something went wrong during initialization."));
+		m_file_video_input.reset();
+		m_file_audio_input.reset();
 #if SSR_USE_OPENGL_RECORDING
+		m_gl_inject_extra_inputs.clear();
 		m_gl_inject_input.reset();
 #endif
 #if SSR_USE_JACK
@@ -701,11 +796,15 @@ void PageRecord::StartPage() {
 	m_recorded_something = false;
 	m_wait_saving = false;
 	m_error_occurred = false;
+	m_input_files_ended = false;
 	UpdateSysTray();
 #if SSR_USE_ALSA
 	OnUpdateSoundNotifications();
 #endif
 
+	// create the output in advance so the recording can start immediately
+	ArmOutput();
+
 	UpdateInput();
 	OnUpdateRecordingFrame();
 
@@ -730,12 +829,18 @@ void PageRecord::StopPage(bool save) {
 
 	Logger::LogInfo("[PageRecord::StopPage] " + tr("Stopping page ..."));
 
+	FrameAccounting::LogSummary();
+
+	// an armed output that was never started contains nothing, so it is never saved
+	DiscardArmedOutput();
+
 	if(m_output_manager != NULL) {
 
 		// stop the output
 		if(save)
 			FinishOutput();
 		m_output_manager.reset();
+		m_tap_sink.reset();
 
 		// delete the file if it isn't needed
 		if(!save && m_file_protocol.isNull()) {
@@ -746,10 +851,15 @@ void PageRecord::StopPage(bool save) {
 	}
 
 #if SSR_USE_OPENGL_RECORDING
-	// stop GLInject input
+	// stop GLInject inputs
+	m_gl_inject_extra_inputs.clear();
 	m_gl_inject_input.reset();
 #endif
 
+	// stop file inputs
+	m_file_video_input.reset();
+	m_file_audio_input.reset();
+
 #if SSR_USE_JACK
 	// stop JACK input
 	m_jack_input.reset();
@@ -775,6 +885,10 @@ void PageRecord::StartOutput() {
 	if(m_output_started)
 		return;
 
+	// the start latency is measured from here to the first frame that arrives in the synchronizer
+	m_output_start_time = hrt_time_micro();
+	m_start_was_armed = m_output_armed;
+
 #if SSR_USE_ALSA
 	if(m_simple_synth != NULL) {
 		m_simple_synth->PlaySequence(SEQUENCE_RECORD_START.data(), SEQUENCE_RECORD_START.size());
@@ -786,70 +900,37 @@ void PageRecord::StartOutput() {
 
 		Logger::LogInfo("[PageRecord::StartOutput] " + tr("Starting output ..."));
 
+		// the armed output can't be used if the size of the X11 input has changed since it was created
+		if(m_output_armed && m_x11_input != NULL && !m_video_scaling) {
+			unsigned int width, height;
+			m_x11_input->GetCurrentSize(&width, &height);
+			if(width / 2 * 2 != m_output_settings.video_width || height / 2 * 2 != m_output_settings.video_height) {
+				Logger::LogInfo("[PageRecord::StartOutput] " + tr("The video size has changed, the armed output can't be used."));
+				DiscardArmedOutput();
+				m_start_was_armed = false;
+			}
+		}
+
 		if(m_output_manager == NULL) {
 
-			// set the file name
-			m_output_settings.file = GetNewSegmentFile(m_file_base, m_add_timestamp);
+			CreateOutput();
 
-			// log the file name
-			{
-				QString file_name;
-				if(m_file_protocol.isNull())
-					file_name = m_output_settings.file;
-				else
-					file_name = "(" + m_file_protocol + ")";
-				Logger::LogInfo("[PageRecord::StartOutput] " + tr("Output file: %1").arg(file_name));
-			}
-
-			// for X11 recording, update the video size (if possible)
-			if(m_x11_input != NULL)
-				m_x11_input->GetCurrentSize(&m_video_in_width, &m_video_in_height);
+		} else if(m_output_armed) {
 
-#if SSR_USE_OPENGL_RECORDING
-			// for OpenGL recording, detect the video size
-			if(m_video_area == PageInput::VIDEO_AREA_GLINJECT && !m_video_scaling) {
-				if(m_gl_inject_input == NULL) {
-					Logger::LogError("[PageRecord::StartOutput] " + tr("Error: Could not get the size of the OpenGL application because the GLInject input has not been created."));
-					throw GLInjectException();
+			// the output was created in advance, but the file name should contain the start time
+			if(m_add_timestamp && m_file_protocol.isNull()) {
+				QString file = GetNewSegmentFile(m_file_base, m_add_timestamp, m_output_settings.file);
+				if(file != m_output_settings.file && m_output_manager->RenameOutputFile(file)) {
+					m_output_settings.file = file;
+					Logger::LogInfo("[PageRecord::StartOutput] " + tr("Output file: %1").arg(file));
 				}
-				m_gl_inject_input->GetCurrentSize(&m_video_in_width, &m_video_in_height);
-				if(m_video_in_width == 0 && m_video_in_height == 0) {
-					Logger::LogError("[PageRecord::StartOutput] " + tr("Error: Could not get the size of the OpenGL application. Either the "
-									 "application wasn't started correctly, or the application hasn't created an OpenGL window yet. If "
-									 "you want to start recording before starting the application, you have to enable scaling and enter "
-									 "the video size manually."));
-					throw GLInjectException();
-				}
-			}
-#endif
-
-			// calculate the output width and height
-			if(m_video_scaling) {
-				// Only even width and height is allowed because some pixel formats (e.g. YUV420) require this.
-				m_output_settings.video_width = m_video_scaled_width / 2 * 2;
-				m_output_settings.video_height = m_video_scaled_height / 2 * 2;
-#if SSR_USE_OPENGL_RECORDING
-			} else if(m_video_area == PageInput::VIDEO_AREA_GLINJECT) {
-				// The input size is the size of the OpenGL application and can't be changed. The output size is set to the current size of the application.
-				m_output_settings.video_width = m_video_in_width / 2 * 2;
-				m_output_settings.video_height = m_video_in_height / 2 * 2;
-#endif
-			} else {
-				// If the user did not explicitly select scaling, then don't force scaling just because the recording area is one pixel too large.
-				// One missing row/column of pixels is probably better than a blurry video (and scaling is SLOW).
-				m_video_in_width = m_video_in_width / 2 * 2;
-				m_video_in_height = m_video_in_height / 2 * 2;
-				m_output_settings.video_width = m_video_in_width;
-				m_output_settings.video_height = m_video_in_height;
 			}
-
-			// start the output
-			m_output_manager.reset(new OutputManager(m_output_settings));
+			m_output_armed = false;
 
 		} else {
 
 			// start a new segment
-			m_output_manager->GetSynchronizer()->NewSegment();
+			m_output_manager->NewSegment();
 
 		}
 
@@ -874,6 +955,9 @@ void PageRecord::StopOutput(bool final) {
 	if(!m_output_started)
 		return;
 
+	// a short segment may end before the timer has seen the first frame
+	UpdateStartLatency();
+
 	Logger::LogInfo("[PageRecord::StopOutput] " + tr("Stopping output ..."));
 
 	// if final, then StopPage will stop the output (and delete the file if needed)
@@ -882,6 +966,7 @@ void PageRecord::StopOutput(bool final) {
 		// stop the output
 		FinishOutput();
 		m_output_manager.reset();
+		m_tap_sink.reset();
 
 		// change the file name
 		m_output_settings.file = QString();
@@ -890,6 +975,9 @@ void PageRecord::StopOutput(bool final) {
 		m_output_settings.video_width = 0;
 		m_output_settings.video_height = 0;
 
+		// prepare the output for the next segment
+		ArmOutput();
+
 	}
 
 	Logger::LogInfo("[PageRecord::StopOutput] " + tr("Stopped output."));
@@ -908,6 +996,172 @@ void PageRecord::StopOutput(bool final) {
 
 }
 
+void PageRecord::CreateOutput() {
+	assert(m_output_manager == NULL);
+
+	// set the file name
+	m_output_settings.file = GetNewSegmentFile(m_file_base, m_add_timestamp);
+
+	// log the file name
+	{
+		QString file_name;
+		if(m_file_protocol.isNull())
+			file_name = m_output_settings.file;
+		else
+			file_name = "(" + m_file_protocol + ")";
+		Logger::LogInfo("[PageRecord::CreateOutput] " + tr("Output file: %1").arg(file_name));
+	}
+
+	// for X11 recording, update the video size (if possible)
+	if(m_x11_input != NULL)
+		m_x11_input->GetCurrentSize(&m_video_in_width, &m_video_in_height);
+
+#if SSR_USE_OPENGL_RECORDING
+	// for OpenGL recording, detect the video size
+	if(m_video_area == PageInput::VIDEO_AREA_GLINJECT && !m_video_test_pattern && !m_video_from_file && !m_video_scaling) {
+		if(m_gl_inject_input == NULL) {
+			Logger::LogError("[PageRecord::CreateOutput] " + tr("Error: Could not get the size of the OpenGL application because the GLInject input has not been created."));
+			throw GLInjectException();
+		}
+		m_gl_inject_input->GetCurrentSize(&m_video_in_width, &m_video_in_height);
+		if(m_video_in_width == 0 && m_video_in_height == 0) {
+			Logger::LogError("[PageRecord::CreateOutput] " + tr("Error: Could not get the size of the OpenGL application. Either the "
+							 "application wasn't started correctly, or the application hasn't created an OpenGL window yet. If "
+							 "you want to start recording before starting the application, you have to enable scaling and enter "
+							 "the video size manually."));
+			throw GLInjectException();
+		}
+	}
+#endif
+
+	// calculate the output width and height
+	if(m_video_scaling) {
+		// Only even width and height is allowed because some pixel formats (e.g. YUV420) require this.
+		m_output_settings.video_width = m_video_scaled_width / 2 * 2;
+		m_output_settings.video_height = m_video_scaled_height / 2 * 2;
+#if SSR_USE_OPENGL_RECORDING
+	} else if(m_video_area == PageInput::VIDEO_AREA_GLINJECT && !m_video_test_pattern && !m_video_from_file) {
+		// The input size is the size of the OpenGL application and can't be changed. The output size is set to the current size of the application.
+		m_output_settings.video_width = m_video_in_width / 2 * 2;
+		m_output_settings.video_height = m_video_in_height / 2 * 2;
+#endif
+	} else {
+		// If the user did not explicitly select scaling, then don't force scaling just because the recording area is one pixel too large.
+		// One missing row/column of pixels is probably better than a blurry video (and scaling is SLOW).
+		m_video_in_width = m_video_in_width / 2 * 2;
+		m_video_in_height = m_video_in_height / 2 * 2;
+		m_output_settings.video_width = m_video_in_width;
+		m_output_settings.video_height = m_video_in_height;
+	}
+
+	// when recording every screen separately, every additional screen is written to a separate video track
+	m_output_settings.video_extra_tracks.clear();
+	for(const QRect &rect : m_video_extra_screens) {
+		m_output_settings.video_extra_tracks.push_back(GetExtraTrackSize(rect.width(), rect.height(), m_video_scaling, std::max(1u, m_video_in_width), std::max(1u, m_video_in_height),
+																		 m_output_settings.video_width, m_output_settings.video_height));
+	}
+
+#if SSR_USE_OPENGL_RECORDING
+	// for OpenGL recording, every additional stream is written to a separate video track
+	// The size of a stream is only known when the application has created it. Streams that don't exist yet get the size of the main track.
+	if(!m_gl_inject_extra_inputs.empty()) {
+		unsigned int main_width, main_height;
+		m_gl_inject_input->GetCurrentSize(&main_width, &main_height);
+		for(std::unique_ptr<GLInjectInput> &input : m_gl_inject_extra_inputs) {
+			unsigned int width, height;
+			input->GetCurrentSize(&width, &height);
+			if(width == 0 || height == 0 || main_width == 0 || main_height == 0) {
+				Logger::LogWarning("[PageRecord::CreateOutput] " + tr("Warning: The size of an OpenGL stream is not known yet, using the size of the main video track."));
+				m_output_settings.video_extra_tracks.emplace_back(m_output_settings.video_width, m_output_settings.video_height);
+			} else {
+				m_output_settings.video_extra_tracks.push_back(GetExtraTrackSize(width, height, m_video_scaling, main_width, main_height,
+																				 m_output_settings.video_width, m_output_settings.video_height));
+			}
+		}
+	}
+#endif
+
+	// start the output
+	m_output_manager.reset(new OutputManager(m_output_settings));
+
+	// start the shared memory tap
+	// The tap is optional, so errors are logged but don't stop the recording.
+	if(!CommandLineOptions::GetTapFile().isNull()) {
+		try {
+			m_tap_sink.reset(new TapSink(CommandLineOptions::GetTapFile(), m_output_settings.video_width, m_output_settings.video_height,
+										 m_video_frame_rate, (m_audio_enabled)? m_audio_channels : 0));
+		} catch(const SSRStreamException&) {
+			Logger::LogError("[PageRecord::CreateOutput] " + tr("Error: Could not create the shared memory tap, continuing without it."));
+		}
+	}
+
+}
+
+void PageRecord::ArmOutput() {
+	assert(m_page_started);
+
+	if(!m_arm_output || m_output_manager != NULL)
+		return;
+
+#if SSR_USE_OPENGL_RECORDING
+	// the size of the OpenGL application is only known when the recording starts
+	if(m_video_area == PageInput::VIDEO_AREA_GLINJECT && !m_video_test_pattern && !m_video_from_file && !m_video_scaling)
+		return;
+#endif
+
+	try {
+		Logger::LogInfo("[PageRecord::ArmOutput] " + tr("Arming output ..."));
+		CreateOutput();
+		m_output_armed = true;
+		Logger::LogInfo("[PageRecord::ArmOutput] " + tr("Armed output."));
+	} catch(...) {
+		Logger::LogWarning("[PageRecord::ArmOutput] " + tr("Warning: Could not arm the output, it will be created when the recording starts."));
+		m_output_manager.reset();
+		m_tap_sink.reset();
+		m_output_settings.file = QString();
+		m_output_settings.video_width = 0;
+		m_output_settings.video_height = 0;
+	}
+
+}
+
+void PageRecord::DiscardArmedOutput() {
+
+	if(!m_output_armed)
+		return;
+
+	// nothing has been recorded, so this is fast
+	FinishOutput();
+	m_output_manager.reset();
+	m_tap_sink.reset();
+
+	// delete the empty file
+	if(m_file_protocol.isNull()) {
+		if(QFileInfo(m_output_settings.file).exists())
+			QFile(m_output_settings.file).remove();
+	}
+	m_output_settings.file = QString();
+	m_output_settings.video_width = 0;
+	m_output_settings.video_height = 0;
+
+	m_output_armed = false;
+
+}
+
+void PageRecord::UpdateStartLatency() {
+	if(m_output_start_time == AV_NOPTS_VALUE || m_output_manager == NULL || m_output_manager->GetSynchronizer() == NULL)
+		return;
+	int64_t first_timestamp = m_output_manager->GetSynchronizer()->GetSegmentFirstTimestamp();
+	if(first_timestamp == AV_NOPTS_VALUE)
+		return;
+	m_start_latency = std::max((int64_t) 0, first_timestamp - m_output_start_time);
+	m_output_start_time = AV_NOPTS_VALUE;
+	if(m_start_was_armed)
+		Logger::LogInfo("[PageRecord::UpdateStartLatency] " + tr("Start latency: %1 ms (armed output)").arg((m_start_latency + 500) / 1000));
+	else
+		Logger::LogInfo("[PageRecord::UpdateStartLatency] " + tr("Start latency: %1 ms").arg((m_start_latency + 500) / 1000));
+}
+
 void PageRecord::StartInput() {
 	assert(m_page_started);
 
@@ -915,6 +1169,8 @@ void PageRecord::StartInput() {
 		return;
 
 	assert(m_x11_input == NULL);
+	assert(m_x11_extra_inputs.empty());
+	assert(m_test_pattern_input == NULL);
 #if SSR_USE_ALSA
 	assert(m_alsa_input == NULL);
 #endif
@@ -927,29 +1183,49 @@ void PageRecord::StartInput() {
 		Logger::LogInfo("[PageRecord::StartInput] " + tr("Starting input ..."));
 
 		// start the video input
-		if(m_video_area == PageInput::VIDEO_AREA_SCREEN || m_video_area == PageInput::VIDEO_AREA_FIXED || m_video_area == PageInput::VIDEO_AREA_CURSOR) {
-			m_x11_input.reset(new X11Input(m_video_x, m_video_y, m_video_in_width, m_video_in_height, m_video_record_cursor,
-										   m_video_area == PageInput::VIDEO_AREA_CURSOR, m_video_area_follow_fullscreen));
-			connect(m_x11_input.get(), SIGNAL(CurrentRectangleChanged()), this, SLOT(OnUpdateRecordingFrame()), Qt::QueuedConnection);
-		}
+		if(m_video_test_pattern) {
+			m_test_pattern_input.reset(new TestPatternInput(TestPatternInput::GetPatternFromName(CommandLineOptions::GetTestPattern()),
+															m_video_in_width, m_video_in_height, CommandLineOptions::GetTestPatternFrameRate()));
+			m_test_pattern_input->GetCurrentSize(&m_video_in_width, &m_video_in_height);
+		} else if(!m_video_from_file) {
+			if(m_video_area == PageInput::VIDEO_AREA_SCREEN || m_video_area == PageInput::VIDEO_AREA_FIXED || m_video_area == PageInput::VIDEO_AREA_CURSOR) {
+				m_x11_input.reset(new X11Input(m_video_x, m_video_y, m_video_in_width, m_video_in_height, m_video_record_cursor,
+											   m_video_area == PageInput::VIDEO_AREA_CURSOR, m_video_area_follow_fullscreen));
+				connect(m_x11_input.get(), SIGNAL(CurrentRectangleChanged()), this, SLOT(OnUpdateRecordingFrame()), Qt::QueuedConnection);
+				for(const QRect &rect : m_video_extra_screens) {
+					unsigned int width = (m_video_scaling)? rect.width() : rect.width() / 2 * 2;
+					unsigned int height = (m_video_scaling)? rect.height() : rect.height() / 2 * 2;
+					m_x11_extra_inputs.emplace_back(new X11Input(rect.x(), rect.y(), width, height, m_video_record_cursor, false, false));
+				}
+			}
 #if SSR_USE_OPENGL_RECORDING
-		if(m_video_area == PageInput::VIDEO_AREA_GLINJECT) {
-			if(m_gl_inject_input == NULL) {
-				Logger::LogError("[PageRecord::StartInput] " + tr("Error: Could not start the GLInject input because it has not been created."));
-				throw GLInjectException();
+			if(m_video_area == PageInput::VIDEO_AREA_GLINJECT) {
+				if(m_gl_inject_input == NULL) {
+					Logger::LogError("[PageRecord::StartInput] " + tr("Error: Could not start the GLInject input because it has not been created."));
+					throw GLInjectException();
+				}
+				m_gl_inject_input->SetCapturing(true);
+				for(std::unique_ptr<GLInjectInput> &input : m_gl_inject_extra_inputs) {
+					input->SetCapturing(true);
+				}
 			}
-			m_gl_inject_input->SetCapturing(true);
-		}
 #endif
 #if SSR_USE_V4L2
-		if(m_video_area == PageInput::VIDEO_AREA_V4L2) {
-			m_v4l2_input.reset(new V4L2Input(m_v4l2_device, m_video_in_width, m_video_in_height));
-			m_v4l2_input->GetCurrentSize(&m_video_in_width, &m_video_in_height);
-		}
+			if(m_video_area == PageInput::VIDEO_AREA_V4L2) {
+				m_v4l2_input.reset(new V4L2Input(m_v4l2_device, m_video_in_width, m_video_in_height));
+				m_v4l2_input->GetCurrentSize(&m_video_in_width, &m_video_in_height);
+			}
 #endif
+#if SSR_USE_WAYLAND
+			if(m_video_area == PageInput::VIDEO_AREA_WAYLAND) {
+				m_wayland_input.reset(new WaylandInput(m_wayland_output, m_video_record_cursor));
+				m_wayland_input->GetCurrentSize(&m_video_in_width, &m_video_in_height);
+			}
+#endif
+		}
 
 		// start the audio input
-		if(m_audio_enabled) {
+		if(m_audio_enabled && !m_audio_from_file) {
 #if SSR_USE_ALSA
 			if(m_audio_backend == PageInput::AUDIO_BACKEND_ALSA)
 				m_alsa_input.reset(new ALSAInput(m_alsa_source, m_audio_sample_rate));
@@ -967,14 +1243,22 @@ void PageRecord::StartInput() {
 
 	} catch(...) {
 		Logger::LogError("[PageRecord::StartInput] " + tr("Error: Something went wrong during initialization."));
+		m_x11_extra_inputs.clear();
 		m_x11_input.reset();
+		m_test_pattern_input.reset();
 #if SSR_USE_OPENGL_RECORDING
 		if(m_gl_inject_input != NULL)
 			m_gl_inject_input->SetCapturing(false);
+		for(std::unique_ptr<GLInjectInput> &input : m_gl_inject_extra_inputs) {
+			input->SetCapturing(false);
+		}
 #endif
 #if SSR_USE_V4L2
 		m_v4l2_input.reset();
 #endif
+#if SSR_USE_WAYLAND
+		m_wayland_input.reset();
+#endif
 #if SSR_USE_ALSA
 		m_alsa_input.reset();
 #endif
@@ -995,14 +1279,22 @@ void PageRecord::StopInput() {
 
 	Logger::LogInfo("[PageRecord::StopInput] " + tr("Stopping input ..."));
 
+	m_x11_extra_inputs.clear();
 	m_x11_input.reset();
+	m_test_pattern_input.reset();
 #if SSR_USE_OPENGL_RECORDING
 	if(m_gl_inject_input != NULL)
 		m_gl_inject_input->SetCapturing(false);
+	for(std::unique_ptr<GLInjectInput> &input : m_gl_inject_extra_inputs) {
+		input->SetCapturing(false);
+	}
 #endif
 #if SSR_USE_V4L2
 	m_v4l2_input.reset();
 #endif
+#if SSR_USE_WAYLAND
+	m_wayland_input.reset();
+#endif
 #if SSR_USE_ALSA
 	m_alsa_input.reset();
 #endif
@@ -1069,7 +1361,17 @@ void PageRecord::UpdateInput() {
 	if(m_video_area == PageInput::VIDEO_AREA_V4L2)
 		video_source = m_v4l2_input.get();
 #endif
-	if(m_audio_enabled) {
+#if SSR_USE_WAYLAND
+	if(m_video_area == PageInput::VIDEO_AREA_WAYLAND)
+		video_source = m_wayland_input.get();
+#endif
+	if(m_video_test_pattern)
+		video_source = m_test_pattern_input.get();
+	if(m_video_from_file)
+		video_source = m_file_video_input.get();
+	if(m_audio_from_file) {
+		audio_source = m_file_audio_input.get();
+	} else if(m_audio_enabled) {
 #if SSR_USE_ALSA
 		if(m_audio_backend == PageInput::AUDIO_BACKEND_ALSA)
 			audio_source = m_alsa_input.get();
@@ -1093,6 +1395,25 @@ void PageRecord::UpdateInput() {
 			m_output_manager->GetSynchronizer()->ConnectVideoSource(NULL);
 			m_output_manager->GetSynchronizer()->ConnectAudioSource(NULL);
 		}
+		for(unsigned int i = 1; i < m_output_manager->GetVideoTrackCount(); ++i) {
+			VideoSource *extra_video_source = NULL;
+			if(m_output_started && i <= m_x11_extra_inputs.size())
+				extra_video_source = m_x11_extra_inputs[i - 1].get();
+#if SSR_USE_OPENGL_RECORDING
+			if(m_output_started && i <= m_gl_inject_extra_inputs.size())
+				extra_video_source = m_gl_inject_extra_inputs[i - 1].get();
+#endif
+			m_output_manager->GetSynchronizer(i)->ConnectVideoSource(extra_video_source, PRIORITY_RECORD);
+		}
+	}
+	if(m_tap_sink != NULL) {
+		if(m_output_started) {
+			m_tap_sink->ConnectVideoSource(video_source, PRIORITY_TAP);
+			m_tap_sink->ConnectAudioSource(audio_source, PRIORITY_TAP);
+		} else {
+			m_tap_sink->ConnectVideoSource(NULL);
+			m_tap_sink->ConnectAudioSource(NULL);
+		}
 	}
 	if(m_previewing) {
 		m_video_previewer->ConnectVideoSource(video_source, PRIORITY_PREVIEW);
@@ -1268,7 +1589,7 @@ void PageRecord::OnRecordCancel(bool confirm) {
 		return;
 	if(m_wait_saving)
 		return;
-	if(m_output_manager != NULL && confirm) {
+	if(m_output_manager != NULL && !m_output_armed && confirm) {
 		if(MessageBox(QMessageBox::Warning, this, MainWindow::WINDOW_CAPTION, tr("Are you sure that you want to cancel this recording?"),
 					  BUTTON_YES | BUTTON_NO, BUTTON_YES) != BUTTON_YES) {
 			return;
@@ -1471,6 +1792,17 @@ void PageRecord::OnUpdateInformation() {
 		if(m_v4l2_input != NULL)
 			fps_in = m_v4l2_input->GetFPS();
 #endif
+#if SSR_USE_WAYLAND
+		if(m_wayland_input != NULL)
+			fps_in = m_wayland_input->GetFPS();
+#endif
+		if(m_test_pattern_input != NULL)
+			fps_in = m_test_pattern_input->GetFPS();
+		if(m_file_video_input != NULL)
+			fps_in = m_file_video_input->GetFPS();
+
+		if(m_output_started)
+			UpdateStartLatency();
 
 		if(m_output_manager != NULL) {
 			total_time = (m_output_manager->GetSynchronizer() == NULL)? 0 : m_output_manager->GetSynchronizer()->GetTotalTime();
@@ -1495,6 +1827,12 @@ void PageRecord::OnUpdateInformation() {
 			m_gl_inject_input->GetCurrentSize(&m_video_in_width, &m_video_in_height);
 #endif
 
+#if SSR_USE_WAYLAND
+		// for Wayland recording, update the video size
+		if(m_wayland_input != NULL)
+			m_wayland_input->GetCurrentSize(&m_video_in_width, &m_video_in_height);
+#endif
+
 		m_label_info_total_time->setText(ReadableTime(total_time));
 		m_label_info_frame_rate_in->setText(QString::number(fps_in, 'f', 2));
 		m_label_info_frame_rate_out->setText(QString::number(fps_out, 'f', 2));
@@ -1517,7 +1855,34 @@ void PageRecord::OnUpdateInformation() {
 					"size_out_height\t" + QString::number(m_output_settings.video_height) + "\n"
 					"file_name\t" + file_name + "\n"
 					"file_size\t" + QString::number(total_bytes) + "\n"
-					"bit_rate\t" + QString::number(bit_rate) + "\n";
+					"bit_rate\t" + QString::number(bit_rate) + "\n"
+					"degradation_level\t" + QString::number((m_output_manager == NULL)? 0 : m_output_manager->GetDegradationLevel()) + "\n"
+					"output_armed\t" + ((m_output_armed)? "1" : "0") + "\n"
+					"start_latency\t" + QString::number((m_start_latency == AV_NOPTS_VALUE)? -1 : (m_start_latency + 500) / 1000) + "\n";
+			{
+				ThreadWatchdog::Stats stats = m_thread_watchdog->GetStats();
+				str += "watchdog_threads\t" + QString::number(stats.m_thread_count) + "\n"
+						"watchdog_stalled_threads\t" + QString::number(stats.m_stalled_threads) + "\n"
+						"watchdog_stalls\t" + QString::number(stats.m_stall_count) + "\n"
+						"watchdog_longest_stall\t" + QString::number(stats.m_longest_stall / 1000) + "\n";
+			}
+			str += FrameAccounting::GetStatsString();
+#if SSR_USE_OPENGL_RECORDING
+			if(m_gl_inject_input != NULL) {
+				unsigned int pacing_error_avg, pacing_error_max;
+				m_gl_inject_input->GetPacingError(&pacing_error_avg, &pacing_error_max);
+				SSRVideoStreamOverhead overhead;
+				m_gl_inject_input->GetOverhead(&overhead);
+				str += "glinject_pacing_error_avg\t" + QString::number(pacing_error_avg) + "\n"
+						"glinject_pacing_error_max\t" + QString::number(pacing_error_max) + "\n"
+						"glinject_overhead_cpu_mean\t" + QString::number(overhead.cpu_mean) + "\n"
+						"glinject_overhead_cpu_p99\t" + QString::number(overhead.cpu_p99) + "\n"
+						"glinject_overhead_cpu_max\t" + QString::number(overhead.cpu_max) + "\n"
+						"glinject_overhead_gpu_mean\t" + QString::number(overhead.gpu_mean) + "\n"
+						"glinject_overhead_gpu_p99\t" + QString::number(overhead.gpu_p99) + "\n"
+						"glinject_overhead_gpu_max\t" + QString::number(overhead.gpu_max) + "\n";
+			}
+#endif
 			QByteArray data = str.toUtf8();
 			QByteArray old_file = QFile::encodeName(CommandLineOptions::GetStatsFile());
 			QByteArray new_file = QFile::encodeName(CommandLineOptions::GetStatsFile() + "-new");
@@ -1531,6 +1896,17 @@ void PageRecord::OnUpdateInformation() {
 			}
 		}
 
+		// when all inputs are files, save the recording automatically once they have ended
+		if(m_output_started && !m_input_files_ended && m_video_from_file && (!m_audio_enabled || m_audio_from_file)) {
+			bool video_ended = (m_file_video_input == NULL || m_file_video_input->HasReachedEnd());
+			bool audio_ended = (m_file_audio_input == NULL || m_file_audio_input->HasReachedEnd());
+			if(video_ended && audio_ended) {
+				Logger::LogInfo("[PageRecord::OnUpdateInformation] " + tr("All input files have ended, saving recording ..."));
+				m_input_files_ended = true;
+				OnRecordSave(false);
+			}
+		}
+
 	} else {
 
 		m_label_info_total_time->clear();
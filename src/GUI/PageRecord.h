@@ -34,7 +34,12 @@ class Muxer;
 class VideoEncoder;
 class AudioEncoder;
 class Synchronizer;
+class TapSink;
+class ThreadWatchdog;
 class X11Input;
+class TestPatternInput;
+class FileVideoInput;
+class FileAudioInput;
 #if SSR_USE_OPENGL_RECORDING
 class GLInjectLauncher;
 class GLInjectInput;
@@ -42,6 +47,9 @@ class GLInjectInput;
 #if SSR_USE_V4L2
 class V4L2Input;
 #endif
+#if SSR_USE_WAYLAND
+class WaylandInput;
+#endif
 #if SSR_USE_ALSA
 class ALSAInput;
 #endif
@@ -61,13 +69,13 @@ class PageRecord : public QWidget {
 	Q_OBJECT
 
 private:
-	static constexpr int PRIORITY_RECORD = 0, PRIORITY_PREVIEW = -1;
+	static constexpr int PRIORITY_RECORD = 0, PRIORITY_PREVIEW = -1, PRIORITY_TAP = -2;
 
 private:
 	MainWindow *m_main_window;
 
 	bool m_page_started, m_input_started, m_output_started, m_previewing;
-	bool m_recorded_something, m_wait_saving, m_error_occurred;
+	bool m_recorded_something, m_wait_saving, m_error_occurred, m_input_files_ended;
 
 	bool m_schedule_active;
 	unsigned int m_schedule_position;
@@ -76,15 +84,20 @@ private:
 
 	PageInput::enum_video_area m_video_area;
 	bool m_video_area_follow_fullscreen;
+	bool m_video_test_pattern, m_video_from_file;
 #if SSR_USE_V4L2
 	QString m_v4l2_device;
+#endif
+#if SSR_USE_WAYLAND
+	QString m_wayland_output;
 #endif
 	unsigned int m_video_x, m_video_y, m_video_in_width, m_video_in_height;
+	std::vector<QRect> m_video_extra_screens;
 	unsigned int m_video_frame_rate;
 	bool m_video_scaling;
 	unsigned int m_video_scaled_width, m_video_scaled_height;
 	bool m_video_record_cursor;
-	bool m_audio_enabled;
+	bool m_audio_enabled, m_audio_from_file;
 	unsigned int m_audio_channels, m_audio_sample_rate;
 	PageInput::enum_audio_backend m_audio_backend;
 #if SSR_USE_ALSA
@@ -96,18 +109,31 @@ private:
 
 	OutputSettings m_output_settings;
 	std::unique_ptr<OutputManager> m_output_manager;
+	std::unique_ptr<TapSink> m_tap_sink;
+	std::unique_ptr<ThreadWatchdog> m_thread_watchdog;
 
 	QString m_file_base;
 	QString m_file_protocol;
 	bool m_separate_files, m_add_timestamp;
+	bool m_arm_output, m_output_armed; // whether the output should be created in advance, and whether the current output hasn't been started yet
+	int64_t m_output_start_time, m_start_latency; // the time when the recording was started (until the first frame arrives), and the last start latency
+	bool m_start_was_armed;
 
 	std::unique_ptr<X11Input> m_x11_input;
+	std::vector<std::unique_ptr<X11Input> > m_x11_extra_inputs;
+	std::unique_ptr<TestPatternInput> m_test_pattern_input;
+	std::unique_ptr<FileVideoInput> m_file_video_input;
+	std::unique_ptr<FileAudioInput> m_file_audio_input;
 #if SSR_USE_OPENGL_RECORDING
 	std::unique_ptr<GLInjectInput> m_gl_inject_input;
+	std::vector<std::unique_ptr<GLInjectInput> > m_gl_inject_extra_inputs;
 #endif
 #if SSR_USE_V4L2
 	std::unique_ptr<V4L2Input> m_v4l2_input;
 #endif
+#if SSR_USE_WAYLAND
+	std::unique_ptr<WaylandInput> m_wayland_input;
+#endif
 #if SSR_USE_ALSA
 	std::unique_ptr<ALSAInput> m_alsa_input;
 #endif
@@ -182,6 +208,10 @@ public:
 	void StopPage(bool save);
 	void StartOutput();
 	void StopOutput(bool final);
+	void CreateOutput();
+	void ArmOutput();
+	void DiscardArmedOutput();
+	void UpdateStartLatency();
 	void StartInput();
 	void StopInput();
 
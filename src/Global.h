@@ -82,6 +82,7 @@ along with SimpleScreenRecorder.  If not, see <http://www.gnu.org/licenses/>.
 
 #include <array>
 #include <atomic>
+#include <condition_variable>
 #include <deque>
 #include <limits>
 #include <memory>
@@ -154,6 +155,7 @@ extern "C" {
 #include <libavutil/avutil.h>
 #include <libavutil/channel_layout.h>
 #include <libavutil/mathematics.h>
+#include <libavutil/pixdesc.h>
 #include <libavutil/pixfmt.h>
 #include <libavutil/samplefmt.h>
 #include <libswscale/swscale.h>
@@ -185,6 +187,11 @@ extern "C" {
 #error SSR_USE_V4L2 should be defined!
 #endif
 
+// Whether Wayland screen capture should be used.
+#ifndef SSR_USE_WAYLAND
+#error SSR_USE_WAYLAND should be defined!
+#endif
+
 // Whether ALSA should be used.
 #ifndef SSR_USE_ALSA
 #error SSR_USE_ALSA should be defined!
@@ -240,6 +247,10 @@ inline void atomic_thread_fence_replacement(memory_order) {
 #define TEST_AV_VERSION(prefix, ffmpeg_major, ffmpeg_minor, libav_major, libav_minor) TEST_MAJOR_MINOR(prefix##_VERSION_MAJOR, prefix##_VERSION_MINOR, libav_major, libav_minor)
 #endif
 
+// AVIOContext write_packet callback with const buffer: lavf 61.1.100 / ???
+#define SSR_USE_AVIO_WRITE_PACKET_CONST            TEST_AV_VERSION(LIBAVFORMAT, 61, 1, 999, 999)
+// avio_context_free: lavf 57.80.100 / ???
+#define SSR_USE_AVIO_CONTEXT_FREE                  TEST_AV_VERSION(LIBAVFORMAT, 57, 80, 999, 999)
 // av_muxer_iterate: lavf 58.9.100 / ???
 #define SSR_USE_AV_MUXER_ITERATE                   TEST_AV_VERSION(LIBAVFORMAT, 58, 9, 999, 999)
 // av_register_all deprecated: lavf 58.9.100 / ???
@@ -348,6 +359,24 @@ public:
 		return "SSRStreamException";
 	}
 };
+class NetworkException : public std::exception {
+public:
+	inline virtual const char* what() const throw() override {
+		return "NetworkException";
+	}
+};
+class TestPatternException : public std::exception {
+public:
+	inline virtual const char* what() const throw() override {
+		return "TestPatternException";
+	}
+};
+class FileInputException : public std::exception {
+public:
+	inline virtual const char* what() const throw() override {
+		return "FileInputException";
+	}
+};
 #if SSR_USE_V4L2
 class V4L2Exception : public std::exception {
 public:
@@ -356,6 +385,14 @@ public:
 	}
 };
 #endif
+#if SSR_USE_WAYLAND
+class WaylandException : public std::exception {
+public:
+	inline virtual const char* what() const throw() override {
+		return "WaylandException";
+	}
+};
+#endif
 #if SSR_USE_ALSA
 class ALSAException : public std::exception {
 public:
@@ -27,6 +27,7 @@ along with SimpleScreenRecorder.  If not, see <http://www.gnu.org/licenses/>.
 #include "Logger.h"
 #include "MainWindow.h"
 #include "ScreenScaling.h"
+#include "ThreadBudget.h"
 
 int main(int argc, char* argv[]) {
 
@@ -104,6 +105,9 @@ int main(int argc, char* argv[]) {
 	CPUFeatures::Detect();
 #endif
 
+	// detect how many CPUs we can use
+	ThreadBudget::Detect();
+
 	// show screen scaling message
 	ScreenScalingMessage();
 
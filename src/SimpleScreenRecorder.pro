@@ -5,30 +5,58 @@ QT += core gui
 TARGET = SimpleScreenRecorder
 TEMPLATE = app
 
-DEFINES += SSR_USE_X86_ASM=1 SSR_USE_FFMPEG_VERSIONS=1 SSR_USE_OPENGL_RECORDING=1 SSR_USE_ALSA=1 SSR_USE_PULSEAUDIO=1 SSR_USE_JACK=1 SSR_SYSTEM_DIR=\\"/usr/share/simplescreenrecorder\\"
+DEFINES += SSR_USE_X86_ASM=1 SSR_USE_FFMPEG_VERSIONS=1 SSR_USE_OPENGL_RECORDING=1 SSR_USE_ALSA=1 SSR_USE_PULSEAUDIO=1 SSR_USE_JACK=1 SSR_USE_XCB_SHM=1 SSR_USE_WAYLAND=1 SSR_SYSTEM_DIR=\\"/usr/share/simplescreenrecorder\\"
 QMAKE_CXXFLAGS += -std=c++0x -flax-vector-conversions
-LIBS += -lavformat -lavcodec -lavutil -lswscale -lX11 -lXext -lXfixes -lasound
+LIBS += -lavformat -lavcodec -lavutil -lswscale -lX11 -lXext -lXfixes -lxcb -lxcb-shm -lwayland-client -lasound -ldl
 
-INCLUDEPATH += AV AV/Input AV/Output common GUI
+INCLUDEPATH += AV AV/Input AV/Output common GUI $$OUT_PWD
 DEPENDPATH += AV AV/Input AV/Output common GUI
 
+# generate the Wayland protocol code with wayland-scanner, like the CMake build does
+WAYLAND_PROTOCOLS += protocols/wlr-screencopy-unstable-v1.xml
+wayland_client_header.input = WAYLAND_PROTOCOLS
+wayland_client_header.output = ${QMAKE_FILE_BASE}-client-protocol.h
+wayland_client_header.commands = wayland-scanner client-header ${QMAKE_FILE_IN} ${QMAKE_FILE_OUT}
+wayland_client_header.variable_out = HEADERS
+wayland_client_header.CONFIG += target_predeps no_link
+wayland_private_code.input = WAYLAND_PROTOCOLS
+wayland_private_code.output = ${QMAKE_FILE_BASE}-protocol.c
+wayland_private_code.commands = wayland-scanner private-code ${QMAKE_FILE_IN} ${QMAKE_FILE_OUT}
+wayland_private_code.variable_out = SOURCES
+QMAKE_EXTRA_COMPILERS += wayland_client_header wayland_private_code
+
 SOURCES += \
 	AV/Input/ALSAInput.cpp \
+	AV/Input/CaptureTimestampFilter.cpp \
+	AV/Input/FileAudioInput.cpp \
+	AV/Input/FileInputStream.cpp \
+	AV/Input/FileVideoInput.cpp \
 	AV/Input/GLInjectInput.cpp \
 	AV/Input/JACKInput.cpp \
 	AV/Input/PulseAudioInput.cpp \
 	AV/Input/SSRVideoStreamReader.cpp \
 	AV/Input/SSRVideoStreamWatcher.cpp \
+	AV/Input/TestPatternInput.cpp \
+	AV/Input/WaylandInput.cpp \
 	AV/Input/X11Input.cpp \
+	AV/Input/XCBShmCapture.cpp \
 	AV/Output/AudioEncoder.cpp \
 	AV/Output/BaseEncoder.cpp \
+	AV/Output/CodecCapabilities.cpp \
+	AV/Output/DegradationController.cpp \
+	AV/Output/DriftEstimator.cpp \
 	AV/Output/Muxer.cpp \
+	AV/Output/MuxerJournal.cpp \
 	AV/Output/OutputManager.cpp \
 	AV/Output/SyncDiagram.cpp \
 	AV/Output/Synchronizer.cpp \
+	AV/Output/TapSink.cpp \
+	AV/Output/UDPTransport.cpp \
 	AV/Output/VideoEncoder.cpp \
 	AV/Output/X264Presets.cpp \
 	AV/AVWrapper.cpp \
+	AV/CursorBlend.cpp \
+	AV/CursorBlend_SSE2.cpp \
 	AV/FastResampler.cpp \
 	AV/FastResampler_FirFilter_Fallback.cpp \
 	AV/FastResampler_FirFilter_SSE2.cpp \
@@ -38,11 +66,15 @@ SOURCES += \
 	AV/FastScaler_Scale_Fallback.cpp \
 	AV/FastScaler_Scale_Generic.cpp \
 	AV/FastScaler_Scale_SSSE3.cpp \
+	AV/FrameAccounting.cpp \
+	AV/SampleSlipper.cpp \
 	AV/SimpleSynth.cpp \
 	AV/SourceSink.cpp \
 	common/CPUFeatures.cpp \
 	common/Dialogs.cpp \
 	common/Logger.cpp \
+	common/ThreadBudget.cpp \
+	common/ThreadWatchdog.cpp \
 	GUI/AudioPreviewer.cpp \
 	GUI/DialogGLInject.cpp \
 	GUI/ElidedLabel.cpp \
@@ -63,30 +95,46 @@ SOURCES += \
 
 HEADERS  += \
 	AV/Input/ALSAInput.h \
+	AV/Input/CaptureTimestampFilter.h \
+	AV/Input/FileAudioInput.h \
+	AV/Input/FileInputStream.h \
+	AV/Input/FileVideoInput.h \
 	AV/Input/GLInjectInput.h \
 	AV/Input/JACKInput.h \
 	AV/Input/PulseAudioInput.h \
 	AV/Input/SSRVideoStream.h \
 	AV/Input/SSRVideoStreamReader.h \
 	AV/Input/SSRVideoStreamWatcher.h \
+	AV/Input/TestPatternInput.h \
+	AV/Input/WaylandInput.h \
 	AV/Input/X11Input.h \
+	AV/Input/XCBShmCapture.h \
 	AV/Output/AudioEncoder.h \
 	AV/Output/BaseEncoder.h \
+	AV/Output/CodecCapabilities.h \
+	AV/Output/DegradationController.h \
+	AV/Output/DriftEstimator.h \
 	AV/Output/Muxer.h \
+	AV/Output/MuxerJournal.h \
 	AV/Output/OutputManager.h \
 	AV/Output/OutputSettings.h \
 	AV/Output/SyncDiagram.h \
 	AV/Output/Synchronizer.h \
+	AV/Output/TapSink.h \
+	AV/Output/UDPTransport.h \
 	AV/Output/VideoEncoder.h \
 	AV/Output/X264Presets.h \
 	AV/AVWrapper.h \
+	AV/CursorBlend.h \
 	AV/FastResampler.h \
 	AV/FastResampler_FirFilter.h \
 	AV/FastScaler.h \
 	AV/FastScaler_Convert.h \
 	AV/FastScaler_Scale.h \
 	AV/FastScaler_Scale_Generic.h \
+	AV/FrameAccounting.h \
 	AV/SampleCast.h \
+	AV/SampleSlipper.h \
 	AV/SimpleSynth.h \
 	AV/SourceSink.h \
 	common/CPUFeatures.h \
@@ -97,6 +145,8 @@ HEADERS  += \
 	common/MutexDataPair.h \
 	common/QueueBuffer.h \
 	common/TempBuffer.h \
+	common/ThreadBudget.h \
+	common/ThreadWatchdog.h \
 	GUI/AudioPreviewer.h \
 	GUI/DialogGLInject.h \
 	GUI/ElidedLabel.h \
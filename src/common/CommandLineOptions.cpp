@@ -38,6 +38,50 @@ void PrintOptionHelp() {
 		"                        /dev/shm/simplescreenrecorder-stats-PID is used. It will\n"
 		"                        be updated continuously and deleted when the recording\n"
 		"                        page is closed.\n"
+		"  --tapfile[=FILE]      Publish the recorded video frames (BGRA) and audio\n"
+		"                        samples in the shared memory file FILE, so other local\n"
+		"                        processes can read them (see tap/TapStructs.h). If FILE\n"
+		"                        is omitted, /dev/shm/simplescreenrecorder-tap-PID is\n"
+		"                        used.\n"
+		"  --testpattern=PATTERN[:WxH[@FPS]]\n"
+		"                        Record a synthetic test pattern instead of the selected\n"
+		"                        video input. PATTERN is one of 'static', 'text'\n"
+		"                        (scrolling text), 'noise' (full-motion noise) or\n"
+		"                        'partial' (a moving noise region on a static\n"
+		"                        background). The size defaults to the size of the\n"
+		"                        selected video input. If FPS is given, frames are\n"
+		"                        generated at exactly that rate, otherwise whenever the\n"
+		"                        encoder needs one.\n"
+		"  --videofile=[FORMAT:WxH@FPS:]FILE\n"
+		"                        Record video from a Y4M file instead of the selected\n"
+		"                        video input. For raw video, the format ('bgra',\n"
+		"                        'yuyv422' or 'yuv420p'), size and frame rate must be\n"
+		"                        given. If FILE is '-', standard input is used.\n"
+		"  --audiofile=[FORMAT:RATE:CHANNELS:]FILE\n"
+		"                        Record audio from a WAV file instead of the selected\n"
+		"                        audio input. For raw PCM, the format ('s16le', 's32le'\n"
+		"                        or 'f32le'), sample rate and channel count must be\n"
+		"                        given. If FILE is '-', standard input is used.\n"
+		"  --fastinput           Read the input files as fast as the encoders can handle\n"
+		"                        instead of in real time.\n"
+		"  --degradation-ladder=STEPS\n"
+		"                        Reduce the quality step by step when the video encoder\n"
+		"                        can't keep up, and restore it when the load decreases.\n"
+		"                        STEPS is a comma-separated list of 'fps/N' steps\n"
+		"                        (capture only one out of every N frames, even when\n"
+		"                        frame skipping is disabled) with increasing values of\n"
+		"                        N, e.g. 'fps/2,fps/3'.\n"
+		"  --arm-output          Create the output file and start the encoders as soon as\n"
+		"                        the recording page is opened (and again after every\n"
+		"                        segment when recording to separate files), so starting\n"
+		"                        the recording only has to start the capture.\n"
+		"  --recovery-journal    Write a journal next to the output file, so the\n"
+		"                        recording can be recovered with 'ssr-recover' after a\n"
+		"                        crash. Only for local files. The muxer has to interleave\n"
+		"                        the packets itself, which can hold back packets for up\n"
+		"                        to 10 seconds when a stream has no data.\n"
+		"  --no-audio-fast-path  Send the audio through the synchronizer thread even when\n"
+		"                        video is disabled.\n"
 		"  --no-redirect-stderr  Don't redirect stderr to the log.\n"
 		"  --no-systray          Don't show the system tray icon.\n"
 		"  --start-hidden        Start the application in hidden form.\n"
@@ -85,6 +129,10 @@ QString DefaultStatsFile() {
 	return "/dev/shm/simplescreenrecorder-stats-" + QString::number(QCoreApplication::applicationPid());
 }
 
+QString DefaultTapFile() {
+	return "/dev/shm/simplescreenrecorder-tap-" + QString::number(QCoreApplication::applicationPid());
+}
+
 void CheckOptionHasValue(const QString &option, const QString &value) {
 	if(value.isNull()) {
 		Logger::LogError("[CommandLineOptions::Parse] " + Logger::tr("Error: Command-line option '%1' requires a value!").arg(option));
@@ -108,6 +156,25 @@ CommandLineOptions::CommandLineOptions() {
 	m_settings_file = DefaultSettingsFile();
 	m_log_file = QString();
 	m_stats_file = QString();
+	m_tap_file = QString();
+	m_test_pattern = QString();
+	m_test_pattern_width = 0;
+	m_test_pattern_height = 0;
+	m_test_pattern_frame_rate = 0;
+	m_video_file = QString();
+	m_video_file_format = QString();
+	m_video_file_width = 0;
+	m_video_file_height = 0;
+	m_video_file_frame_rate = 0;
+	m_audio_file = QString();
+	m_audio_file_format = QString();
+	m_audio_file_sample_rate = 0;
+	m_audio_file_channels = 0;
+	m_fast_input = false;
+	m_degradation_ladder = QString();
+	m_arm_output = false;
+	m_recovery_journal = false;
+	m_audio_fast_path = true;
 	m_redirect_stderr = true;
 	m_systray = true;
 	m_start_hidden = false;
@@ -169,6 +236,70 @@ void CommandLineOptions::Parse() {
 				} else {
 					m_stats_file = value;
 				}
+			} else if(option == "--tapfile") {
+				if(value.isNull()) {
+					m_tap_file = DefaultTapFile();
+				} else {
+					m_tap_file = value;
+				}
+			} else if(option == "--testpattern") {
+				CheckOptionHasValue(option, value);
+				QRegExp spec_regex("^(static|text|noise|partial)(:([0-9]+)x([0-9]+)(@([0-9]+))?)?$", Qt::CaseSensitive, QRegExp::RegExp);
+				if(spec_regex.indexIn(value) < 0) {
+					Logger::LogError("[CommandLineOptions::Parse] " + Logger::tr("Error: Invalid test pattern '%1'!").arg(value));
+					PrintOptionHelp();
+					throw CommandLineException();
+				}
+				m_test_pattern = spec_regex.cap(1);
+				m_test_pattern_width = spec_regex.cap(3).toUInt();
+				m_test_pattern_height = spec_regex.cap(4).toUInt();
+				m_test_pattern_frame_rate = spec_regex.cap(6).toUInt();
+			} else if(option == "--videofile") {
+				CheckOptionHasValue(option, value);
+				QRegExp raw_regex("^(bgra|yuyv422|yuv420p):([0-9]+)x([0-9]+)@([0-9]+):(.+)$", Qt::CaseSensitive, QRegExp::RegExp);
+				if(raw_regex.indexIn(value) >= 0) {
+					m_video_file = raw_regex.cap(5);
+					m_video_file_format = raw_regex.cap(1);
+					m_video_file_width = raw_regex.cap(2).toUInt();
+					m_video_file_height = raw_regex.cap(3).toUInt();
+					m_video_file_frame_rate = raw_regex.cap(4).toUInt();
+				} else {
+					m_video_file = value;
+					m_video_file_format = QString();
+				}
+			} else if(option == "--audiofile") {
+				CheckOptionHasValue(option, value);
+				QRegExp raw_regex("^(s16le|s32le|f32le):([0-9]+):([0-9]+):(.+)$", Qt::CaseSensitive, QRegExp::RegExp);
+				if(raw_regex.indexIn(value) >= 0) {
+					m_audio_file = raw_regex.cap(4);
+					m_audio_file_format = raw_regex.cap(1);
+					m_audio_file_sample_rate = raw_regex.cap(2).toUInt();
+					m_audio_file_channels = raw_regex.cap(3).toUInt();
+				} else {
+					m_audio_file = value;
+					m_audio_file_format = QString();
+				}
+			} else if(option == "--fastinput") {
+				CheckOptionHasNoValue(option, value);
+				m_fast_input = true;
+			} else if(option == "--degradation-ladder") {
+				CheckOptionHasValue(option, value);
+				QRegExp ladder_regex("^fps/[1-9][0-9]?(,fps/[1-9][0-9]?)*$", Qt::CaseSensitive, QRegExp::RegExp);
+				if(ladder_regex.indexIn(value) < 0) {
+					Logger::LogError("[CommandLineOptions::Parse] " + Logger::tr("Error: Invalid degradation ladder '%1'!").arg(value));
+					PrintOptionHelp();
+					throw CommandLineException();
+				}
+				m_degradation_ladder = value;
+			} else if(option == "--arm-output") {
+				CheckOptionHasNoValue(option, value);
+				m_arm_output = true;
+			} else if(option == "--recovery-journal") {
+				CheckOptionHasNoValue(option, value);
+				m_recovery_journal = true;
+			} else if(option == "--no-audio-fast-path") {
+				CheckOptionHasNoValue(option, value);
+				m_audio_fast_path = false;
 			} else if(option == "--no-redirect-stderr") {
 				CheckOptionHasNoValue(option, value);
 				m_redirect_stderr = false;
@@ -207,6 +338,18 @@ void CommandLineOptions::Parse() {
 		}
 	}
 
+	// check for conflicts
+	if(!m_test_pattern.isNull() && !m_video_file.isNull()) {
+		Logger::LogError("[CommandLineOptions::Parse] " + Logger::tr("Error: Command-line options '%1' and '%2' can't be combined!").arg("--testpattern").arg("--videofile"));
+		PrintOptionHelp();
+		throw CommandLineException();
+	}
+	if(m_video_file == "-" && m_audio_file == "-") {
+		Logger::LogError("[CommandLineOptions::Parse] " + Logger::tr("Error: The video and audio file can't both be read from standard input!"));
+		PrintOptionHelp();
+		throw CommandLineException();
+	}
+
 }
 
 // see definition of AV_VERSION_INT() in libavutil/version.h
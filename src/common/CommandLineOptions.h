@@ -33,6 +33,18 @@ private:
 	QString m_settings_file;
 	QString m_log_file;
 	QString m_stats_file;
+	QString m_tap_file;
+	QString m_test_pattern;
+	unsigned int m_test_pattern_width, m_test_pattern_height, m_test_pattern_frame_rate;
+	QString m_video_file, m_video_file_format;
+	unsigned int m_video_file_width, m_video_file_height, m_video_file_frame_rate;
+	QString m_audio_file, m_audio_file_format;
+	unsigned int m_audio_file_sample_rate, m_audio_file_channels;
+	bool m_fast_input;
+	QString m_degradation_ladder;
+	bool m_arm_output;
+	bool m_recovery_journal;
+	bool m_audio_fast_path;
 	bool m_redirect_stderr;
 	bool m_systray;
 	bool m_start_hidden;
@@ -55,6 +67,25 @@ public:
 	inline static const QString& GetSettingsFile() { return GetInstance()->m_settings_file; }
 	inline static const QString& GetLogFile() { return GetInstance()->m_log_file; }
 	inline static const QString& GetStatsFile() { return GetInstance()->m_stats_file; }
+	inline static const QString& GetTapFile() { return GetInstance()->m_tap_file; }
+	inline static const QString& GetTestPattern() { return GetInstance()->m_test_pattern; }
+	inline static unsigned int GetTestPatternWidth() { return GetInstance()->m_test_pattern_width; }
+	inline static unsigned int GetTestPatternHeight() { return GetInstance()->m_test_pattern_height; }
+	inline static unsigned int GetTestPatternFrameRate() { return GetInstance()->m_test_pattern_frame_rate; }
+	inline static const QString& GetVideoFile() { return GetInstance()->m_video_file; }
+	inline static const QString& GetVideoFileFormat() { return GetInstance()->m_video_file_format; }
+	inline static unsigned int GetVideoFileWidth() { return GetInstance()->m_video_file_width; }
+	inline static unsigned int GetVideoFileHeight() { return GetInstance()->m_video_file_height; }
+	inline static unsigned int GetVideoFileFrameRate() { return GetInstance()->m_video_file_frame_rate; }
+	inline static const QString& GetAudioFile() { return GetInstance()->m_audio_file; }
+	inline static const QString& GetAudioFileFormat() { return GetInstance()->m_audio_file_format; }
+	inline static unsigned int GetAudioFileSampleRate() { return GetInstance()->m_audio_file_sample_rate; }
+	inline static unsigned int GetAudioFileChannels() { return GetInstance()->m_audio_file_channels; }
+	inline static bool GetFastInput() { return GetInstance()->m_fast_input; }
+	inline static const QString& GetDegradationLadder() { return GetInstance()->m_degradation_ladder; }
+	inline static bool GetArmOutput() { return GetInstance()->m_arm_output; }
+	inline static bool GetRecoveryJournal() { return GetInstance()->m_recovery_journal; }
+	inline static bool GetAudioFastPath() { return GetInstance()->m_audio_fast_path; }
 	inline static bool GetRedirectStderr() { return GetInstance()->m_redirect_stderr; }
 	inline static bool GetSysTray() { return GetInstance()->m_systray; }
 	inline static bool GetStartHidden() { return GetInstance()->m_start_hidden; }
@@ -33,6 +33,7 @@ public:
 		inline T* operator->() { return m_data; }
 		inline T* get() { return m_data; }
 		inline std::unique_lock<std::mutex>& lock() { return m_lock; }
+		inline void unlock() { m_lock.unlock(); } // releases the lock early, the data must not be accessed after this
 	};
 
 private:
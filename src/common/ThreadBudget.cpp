@@ -0,0 +1,191 @@
+/*
+Copyright (c) 2012-2020 Maarten Baert <maarten-baert@hotmail.com>
+
+This file is part of SimpleScreenRecorder.
+
+SimpleScreenRecorder is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+SimpleScreenRecorder is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with SimpleScreenRecorder.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "ThreadBudget.h"
+
+#include "Logger.h"
+
+#include <fstream>
+
+#include <sched.h>
+
+// More threads than this don't make libavcodec encoders faster (libavcodec uses the same limit when it picks the number of threads itself).
+const unsigned int ThreadBudget::MAX_ENCODER_THREADS = 16;
+
+unsigned int ThreadBudget::s_system_cpus = 1;
+unsigned int ThreadBudget::s_affinity_cpus = 1;
+double ThreadBudget::s_quota_cpus = 0.0;
+unsigned int ThreadBudget::s_available_cpus = 1;
+
+static bool ReadFirstLine(const std::string& file, std::string* line) {
+	std::ifstream stream(file);
+	return (stream && std::getline(stream, *line));
+}
+
+static std::vector<std::string> SplitString(const std::string& str, char sep) {
+	std::vector<std::string> parts;
+	size_t pos = 0;
+	for( ; ; ) {
+		size_t end = str.find(sep, pos);
+		parts.push_back(str.substr(pos, end - pos));
+		if(end == std::string::npos)
+			break;
+		pos = end + 1;
+	}
+	return parts;
+}
+
+// Finds the directory of a cgroup hierarchy that the process belongs to. For cgroup v2 'controller' should be empty.
+// Returns false if the hierarchy is not mounted.
+static bool FindCGroupDirectory(const std::string& controller, std::string* mount_point, std::string* directory) {
+
+	// find the path of the cgroup in /proc/self/cgroup, lines look like 'id:controllers:path'
+	std::string cgroup_path;
+	bool found = false;
+	{
+		std::ifstream stream("/proc/self/cgroup");
+		std::string line;
+		while(std::getline(stream, line)) {
+			size_t p1 = line.find(':'), p2 = line.find(':', p1 + 1);
+			if(p1 == std::string::npos || p2 == std::string::npos)
+				continue;
+			std::string controllers = line.substr(p1 + 1, p2 - p1 - 1);
+			if(controller.empty()) {
+				found = (line.substr(0, p1) == "0" && controllers.empty());
+			} else {
+				std::vector<std::string> list = SplitString(controllers, ',');
+				found = (std::find(list.begin(), list.end(), controller) != list.end());
+			}
+			if(found) {
+				cgroup_path = line.substr(p2 + 1);
+				break;
+			}
+		}
+	}
+	if(!found)
+		return false;
+
+	// find the mount point in /proc/self/mountinfo, lines look like 'id parent dev root mount_point options [tags] - type source super_options'
+	{
+		std::ifstream stream("/proc/self/mountinfo");
+		std::string line;
+		while(std::getline(stream, line)) {
+			size_t sep = line.find(" - ");
+			if(sep == std::string::npos)
+				continue;
+			std::vector<std::string> fields = SplitString(line.substr(0, sep), ' ');
+			std::vector<std::string> extra = SplitString(line.substr(sep + 3), ' ');
+			if(fields.size() < 5 || extra.size() < 3)
+				continue;
+			if(controller.empty()) {
+				if(extra[0] != "cgroup2")
+					continue;
+			} else {
+				std::vector<std::string> options = SplitString(extra[2], ',');
+				if(extra[0] != "cgroup" || std::find(options.begin(), options.end(), controller) == options.end())
+					continue;
+			}
+			// the root of the mount is a part of the cgroup path, unless the cgroup namespace hides it
+			const std::string &root = fields[3];
+			*mount_point = fields[4];
+			if(root != "/" && cgroup_path.compare(0, root.size(), root) == 0)
+				*directory = *mount_point + cgroup_path.substr(root.size());
+			else
+				*directory = *mount_point + cgroup_path;
+			if(access(directory->c_str(), F_OK) != 0)
+				*directory = *mount_point;
+			return true;
+		}
+	}
+	return false;
+
+}
+
+// Returns the lowest CPU quota (in CPUs) of the cgroup and its parents, or zero if there is no quota.
+// For cgroup v1 'controller' is "cpu", for cgroup v2 it should be empty.
+static double GetCGroupQuota(const std::string& controller) {
+	double quota = 0.0;
+	std::string mount_point, directory;
+	if(!FindCGroupDirectory(controller, &mount_point, &directory))
+		return 0.0;
+	for( ; ; ) {
+		std::string line;
+		int64_t max = -1, period = 0;
+		if(controller.empty()) {
+			// cpu.max looks like 'max 100000' or '400000 100000'
+			if(ReadFirstLine(directory + "/cpu.max", &line)) {
+				std::vector<std::string> parts = SplitString(line, ' ');
+				if(parts.size() == 2 && parts[0] != "max") {
+					max = strtoll(parts[0].c_str(), NULL, 10);
+					period = strtoll(parts[1].c_str(), NULL, 10);
+				}
+			}
+		} else {
+			// cpu.cfs_quota_us is -1 if there is no quota
+			if(ReadFirstLine(directory + "/cpu.cfs_quota_us", &line))
+				max = strtoll(line.c_str(), NULL, 10);
+			if(ReadFirstLine(directory + "/cpu.cfs_period_us", &line))
+				period = strtoll(line.c_str(), NULL, 10);
+		}
+		if(max > 0 && period > 0) {
+			double q = (double) max / (double) period;
+			if(quota == 0.0 || q < quota)
+				quota = q;
+		}
+		if(directory.size() <= mount_point.size())
+			break;
+		directory = directory.substr(0, directory.rfind('/'));
+	}
+	return quota;
+}
+
+void ThreadBudget::Detect() {
+
+	s_system_cpus = std::max(1, (int) std::thread::hardware_concurrency());
+
+	cpu_set_t cpu_set;
+	CPU_ZERO(&cpu_set);
+	if(sched_getaffinity(0, sizeof(cpu_set), &cpu_set) == 0)
+		s_affinity_cpus = std::max(1, CPU_COUNT(&cpu_set));
+	else
+		s_affinity_cpus = s_system_cpus;
+
+	// systems can use cgroup v1 and v2 at the same time (with different controllers), so check both
+	double quota_v1 = GetCGroupQuota("cpu"), quota_v2 = GetCGroupQuota("");
+	s_quota_cpus = (quota_v1 > 0.0 && (quota_v2 == 0.0 || quota_v1 < quota_v2))? quota_v1 : quota_v2;
+
+	s_available_cpus = std::min(s_system_cpus, s_affinity_cpus);
+	if(s_quota_cpus > 0.0)
+		s_available_cpus = clamp((unsigned int) ceil(s_quota_cpus - 0.01), 1u, s_available_cpus);
+
+	QString quota = (s_quota_cpus > 0.0)? QString::number(s_quota_cpus, 'f', 2) : Logger::tr("none");
+	Logger::LogInfo("[ThreadBudget::Detect] " + Logger::tr("Available CPUs: %1 (system %2, affinity %3, cgroup quota %4)")
+					.arg(s_available_cpus).arg(s_system_cpus).arg(s_affinity_cpus).arg(quota));
+
+}
+
+unsigned int ThreadBudget::GetVideoEncoderThreads(unsigned int video_encoders) {
+	// The capture and conversion threads get one CPU, and if there are enough CPUs, the muxer, audio and synchronizer threads get
+	// another one. These threads don't use a full CPU, but if the encoders take all CPUs, the capture thread gets preempted and frames are lost.
+	unsigned int reserved = (s_available_cpus >= 3)? 1 : 0;
+	if(s_available_cpus >= 8)
+		reserved += 1;
+	unsigned int threads = (s_available_cpus - reserved) / std::max(1u, video_encoders);
+	return clamp(threads, 1u, MAX_ENCODER_THREADS);
+}
@@ -0,0 +1,55 @@
+/*
+Copyright (c) 2012-2020 Maarten Baert <maarten-baert@hotmail.com>
+
+This file is part of SimpleScreenRecorder.
+
+SimpleScreenRecorder is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+SimpleScreenRecorder is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with SimpleScreenRecorder.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+#include "Global.h"
+
+// Determines how many CPUs the process can really use, based on the CPU affinity mask and the CPU quota of the cgroup (v1 or v2),
+// and divides them between the threads of the recording pipeline. std::thread::hardware_concurrency() returns the number of CPUs
+// in the system, which can be much higher than that in a container.
+class ThreadBudget {
+
+private:
+	static const unsigned int MAX_ENCODER_THREADS;
+
+private:
+	static unsigned int s_system_cpus, s_affinity_cpus;
+	static double s_quota_cpus;
+	static unsigned int s_available_cpus;
+
+public:
+	static void Detect();
+
+	// Returns the number of CPUs in the system.
+	inline static unsigned int GetSystemCPUs() { return s_system_cpus; }
+
+	// Returns the number of CPUs in the affinity mask of the process.
+	inline static unsigned int GetAffinityCPUs() { return s_affinity_cpus; }
+
+	// Returns the CPU quota of the cgroup (in CPUs), or zero if there is no quota.
+	inline static double GetQuotaCPUs() { return s_quota_cpus; }
+
+	// Returns the number of CPUs that can be used, this is the smallest of the above (the quota is rounded up).
+	inline static unsigned int GetAvailableCPUs() { return s_available_cpus; }
+
+	// Returns the number of threads that each video encoder should use, if there are 'video_encoders' encoders running at the same time.
+	// The capture and conversion threads and the muxer, audio and synchronizer threads are taken into account.
+	static unsigned int GetVideoEncoderThreads(unsigned int video_encoders);
+
+};
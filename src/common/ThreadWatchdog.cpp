@@ -0,0 +1,204 @@
+/*
+Copyright (c) 2012-2020 Maarten Baert <maarten-baert@hotmail.com>
+
+This file is part of SimpleScreenRecorder.
+
+SimpleScreenRecorder is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+SimpleScreenRecorder is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with SimpleScreenRecorder.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#include "ThreadWatchdog.h"
+
+#include "Logger.h"
+
+#include <execinfo.h>
+#include <signal.h>
+#include <sys/syscall.h>
+
+// The signal that is used to get the stack trace of a stalled thread. Nothing else in SSR uses real-time signals.
+#define THREAD_WATCHDOG_SIGNAL (SIGRTMIN + 3)
+
+static std::mutex g_heartbeat_mutex;
+static std::vector<ThreadHeartbeat*> g_heartbeats;
+static thread_local ThreadHeartbeat *g_current_heartbeat = NULL;
+
+ThreadHeartbeat::ThreadHeartbeat(const QString& name) {
+
+	m_name = name;
+	m_thread = pthread_self();
+	m_tid = syscall(SYS_gettid);
+
+	m_last_beat = hrt_time_micro();
+	m_phase = "start";
+	m_stall_start = -1;
+	m_stack_size = 0;
+
+	assert(g_current_heartbeat == NULL);
+	g_current_heartbeat = this;
+
+	std::lock_guard<std::mutex> lock(g_heartbeat_mutex);
+	g_heartbeats.push_back(this);
+
+}
+
+ThreadHeartbeat::~ThreadHeartbeat() {
+
+	// this waits until the watchdog is done with this heartbeat (including the stack trace)
+	{
+		std::lock_guard<std::mutex> lock(g_heartbeat_mutex);
+		g_heartbeats.erase(std::find(g_heartbeats.begin(), g_heartbeats.end(), this));
+	}
+
+	assert(g_current_heartbeat == this);
+	g_current_heartbeat = NULL;
+
+}
+
+void ThreadHeartbeat::BeatCurrentThread(const char* phase) {
+	if(g_current_heartbeat != NULL)
+		g_current_heartbeat->Beat(phase);
+}
+
+ThreadWatchdog::ThreadWatchdog(int64_t threshold) {
+
+	m_threshold = threshold;
+
+	{
+		MutexDataPair<Stats>::Lock lock(&m_stats);
+		lock->m_thread_count = 0;
+		lock->m_stalled_threads = 0;
+		lock->m_stall_count = 0;
+		lock->m_longest_stall = 0;
+	}
+
+	// install the signal handler
+	// backtrace is called once here because the first call may load libgcc, which isn't safe in a signal handler
+	void *dummy[1];
+	backtrace(dummy, 1);
+	struct sigaction action;
+	memset(&action, 0, sizeof(action));
+	action.sa_handler = &ThreadWatchdog::StackSignalHandler;
+	action.sa_flags = SA_RESTART;
+	sigemptyset(&action.sa_mask);
+	sigaction(THREAD_WATCHDOG_SIGNAL, &action, NULL);
+
+	// start the watchdog thread
+	m_should_stop = false;
+	m_thread = std::thread(&ThreadWatchdog::WatchdogThread, this);
+
+}
+
+ThreadWatchdog::~ThreadWatchdog() {
+
+	// stop the watchdog thread
+	m_should_stop = true;
+	if(m_thread.joinable())
+		m_thread.join();
+
+	// the signal handler is left installed, a signal could still be pending
+
+}
+
+ThreadWatchdog::Stats ThreadWatchdog::GetStats() {
+	MutexDataPair<Stats>::Lock lock(&m_stats);
+	return *lock.get();
+}
+
+void ThreadWatchdog::WatchdogThread() {
+	try {
+
+		while(!m_should_stop) {
+			usleep(CHECK_INTERVAL);
+
+			std::lock_guard<std::mutex> lock(g_heartbeat_mutex);
+			int64_t timestamp = hrt_time_micro();
+			unsigned int stalled_threads = 0, new_stalls = 0;
+			int64_t longest_stall = 0;
+			for(ThreadHeartbeat *heartbeat : g_heartbeats) {
+				int64_t last_beat = heartbeat->m_last_beat.load(std::memory_order_relaxed);
+				if(timestamp - last_beat > m_threshold) {
+					++stalled_threads;
+					longest_stall = std::max(longest_stall, timestamp - last_beat);
+					if(heartbeat->m_stall_start == -1) {
+						heartbeat->m_stall_start = last_beat;
+						++new_stalls;
+						LogStall(heartbeat, timestamp);
+					}
+				} else if(heartbeat->m_stall_start != -1) {
+					Logger::LogInfo("[ThreadWatchdog::WatchdogThread] " + Logger::tr("Thread '%1' has recovered after %2 ms.")
+									.arg(heartbeat->m_name).arg((last_beat - heartbeat->m_stall_start) / 1000));
+					heartbeat->m_stall_start = -1;
+				}
+			}
+
+			MutexDataPair<Stats>::Lock stats_lock(&m_stats);
+			stats_lock->m_thread_count = g_heartbeats.size();
+			stats_lock->m_stalled_threads = stalled_threads;
+			stats_lock->m_stall_count += new_stalls;
+			stats_lock->m_longest_stall = std::max(stats_lock->m_longest_stall, longest_stall);
+
+		}
+
+	} catch(const std::exception& e) {
+		Logger::LogError("[ThreadWatchdog::WatchdogThread] " + Logger::tr("Exception '%1' in watchdog thread.").arg(e.what()));
+	} catch(...) {
+		Logger::LogError("[ThreadWatchdog::WatchdogThread] " + Logger::tr("Unknown exception in watchdog thread."));
+	}
+}
+
+void ThreadWatchdog::LogStall(ThreadHeartbeat* stalled, int64_t timestamp) {
+
+	// state of all threads
+	Logger::LogWarning("[ThreadWatchdog::LogStall] " + Logger::tr("Warning: Thread '%1' has stalled for %2 ms in phase '%3'!")
+					   .arg(stalled->m_name).arg((timestamp - stalled->m_last_beat) / 1000).arg(QString(stalled->m_phase.load())));
+	for(ThreadHeartbeat *heartbeat : g_heartbeats) {
+		Logger::LogInfo("[ThreadWatchdog::LogStall] " + Logger::tr("Thread '%1' (tid %2): phase '%3', last heartbeat %4 ms ago.")
+						.arg(heartbeat->m_name).arg(heartbeat->m_tid).arg(QString(heartbeat->m_phase.load())).arg((timestamp - heartbeat->m_last_beat) / 1000));
+	}
+
+	// stack trace of the stalled thread
+	stalled->m_stack_size.store(-1, std::memory_order_release);
+	if(pthread_kill(stalled->m_thread, THREAD_WATCHDOG_SIGNAL) != 0) {
+		Logger::LogWarning("[ThreadWatchdog::LogStall] " + Logger::tr("Warning: Can't get stack trace of thread '%1'.").arg(stalled->m_name));
+		return;
+	}
+	int64_t stack_deadline = hrt_time_micro() + STACK_TIMEOUT;
+	while(stalled->m_stack_size.load(std::memory_order_acquire) < 0) {
+		if(hrt_time_micro() > stack_deadline) {
+			Logger::LogWarning("[ThreadWatchdog::LogStall] " + Logger::tr("Warning: Can't get stack trace of thread '%1'.").arg(stalled->m_name));
+			return;
+		}
+		usleep(1000);
+	}
+	int size = stalled->m_stack_size.load(std::memory_order_acquire);
+	char **symbols = backtrace_symbols(stalled->m_stack, size);
+	if(symbols == NULL)
+		return;
+	Logger::LogInfo("[ThreadWatchdog::LogStall] " + Logger::tr("Stack trace of thread '%1':").arg(stalled->m_name));
+	for(int i = 2; i < size; ++i) { // skip the signal handler and the signal trampoline
+		Logger::LogInfo("[ThreadWatchdog::LogStall]     #" + QString::number(i - 2) + " " + QString::fromLocal8Bit(symbols[i]));
+	}
+	free(symbols);
+
+}
+
+void ThreadWatchdog::StackSignalHandler(int) {
+	int saved_errno = errno;
+	ThreadHeartbeat *heartbeat = g_current_heartbeat;
+	if(heartbeat != NULL) {
+		int size = backtrace(heartbeat->m_stack, ThreadHeartbeat::STACK_MAX_FRAMES);
+		heartbeat->m_stack_size.store(size, std::memory_order_release);
+	}
+	errno = saved_errno;
+}
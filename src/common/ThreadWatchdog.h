@@ -0,0 +1,103 @@
+/*
+Copyright (c) 2012-2020 Maarten Baert <maarten-baert@hotmail.com>
+
+This file is part of SimpleScreenRecorder.
+
+SimpleScreenRecorder is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+SimpleScreenRecorder is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with SimpleScreenRecorder.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#pragma once
+#include "Global.h"
+
+#include "MutexDataPair.h"
+
+// Every pipeline thread creates a heartbeat at the start of its thread function, and calls Beat regularly with a short description of what
+// it is about to do (the phase). The watchdog checks all heartbeats periodically. If a thread hasn't called Beat for too long, the watchdog
+// logs the state of all threads, together with a stack trace of the stalled thread.
+class ThreadHeartbeat {
+	friend class ThreadWatchdog;
+
+private:
+	static constexpr unsigned int STACK_MAX_FRAMES = 32;
+
+private:
+	QString m_name;
+	pthread_t m_thread;
+	pid_t m_tid;
+
+	std::atomic<int64_t> m_last_beat;
+	std::atomic<const char*> m_phase;
+
+	// start of the current stall, or -1 if the thread is not stalled (only used by the watchdog thread, protected by the heartbeat list mutex)
+	int64_t m_stall_start;
+
+	// written by the signal handler
+	void *m_stack[STACK_MAX_FRAMES];
+	std::atomic<int> m_stack_size;
+
+public:
+	// Registers the current thread. The heartbeat must be created and destroyed in the thread that it represents.
+	ThreadHeartbeat(const QString& name);
+	~ThreadHeartbeat();
+
+	// Tells the watchdog that the thread is still making progress and what it will do next. The phase must be a string literal.
+	// This function is lock-free.
+	inline void Beat(const char* phase) {
+		m_phase.store(phase, std::memory_order_relaxed);
+		m_last_beat.store(hrt_time_micro(), std::memory_order_relaxed);
+	}
+
+	// Calls Beat on the heartbeat of the current thread, if it has one. This is useful for functions that are called from multiple threads.
+	// This function is lock-free.
+	static void BeatCurrentThread(const char* phase);
+
+};
+
+class ThreadWatchdog {
+
+public:
+	struct Stats {
+		unsigned int m_thread_count; // number of threads with a heartbeat
+		unsigned int m_stalled_threads; // number of threads that are stalled right now
+		unsigned int m_stall_count; // total number of stalls that were detected
+		int64_t m_longest_stall; // longest stall so far (microseconds)
+	};
+
+private:
+	static constexpr int64_t CHECK_INTERVAL = 200000, STACK_TIMEOUT = 100000;
+
+private:
+	int64_t m_threshold;
+
+	std::thread m_thread;
+	std::atomic<bool> m_should_stop;
+	MutexDataPair<Stats> m_stats;
+
+public:
+	// Starts the watchdog. Threads are considered stalled when they haven't called Beat for 'threshold' microseconds.
+	ThreadWatchdog(int64_t threshold);
+	~ThreadWatchdog();
+
+	// Returns the current statistics.
+	// This function is thread-safe.
+	Stats GetStats();
+
+private:
+	void WatchdogThread();
+	void LogStall(ThreadHeartbeat* stalled, int64_t timestamp);
+
+	static void StackSignalHandler(int);
+
+};
@@ -0,0 +1,187 @@
+/*
+Copyright (c) 2012-2020 Maarten Baert <maarten-baert@hotmail.com>
+
+Permission to use, copy, modify, and/or distribute this software for any purpose with or without fee is hereby granted, provided that the above copyright notice and this permission notice appear in all copies.
+
+THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+*/
+
+#include "SSRTapReader.h"
+
+#include <cerrno>
+#include <cstring>
+#include <atomic>
+#include <iostream>
+
+#include <fcntl.h>
+#include <signal.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#define TAP_PRINT(message) { \
+	std::cerr << "[SSR-Tap] " << message << std::endl; \
+}
+
+SSRTapReader::SSRTapReader(const std::string& filename) {
+
+	m_filename = filename;
+
+	m_fd = -1;
+	m_mmap_ptr = MAP_FAILED;
+	m_mmap_size = 0;
+
+	m_dropped_video_frames = 0;
+	m_dropped_audio_packets = 0;
+
+	try {
+		Init();
+	} catch(...) {
+		Free();
+		throw;
+	}
+
+}
+
+SSRTapReader::~SSRTapReader() {
+	Free();
+}
+
+void SSRTapReader::Init() {
+
+	// open the file (read-only, the readers never write anything)
+	m_fd = open(m_filename.c_str(), O_RDONLY | O_CLOEXEC);
+	if(m_fd == -1) {
+		TAP_PRINT("Error: Can't open tap file '" << m_filename << "'!");
+		throw SSRTapException();
+	}
+
+	// the file size is set before anything is written, so it is either zero or final
+	struct stat statinfo;
+	if(fstat(m_fd, &statinfo) == -1 || (size_t) statinfo.st_size < sizeof(TapHeader) + sizeof(TapVideoFrameInfo) * TAP_VIDEO_RING_SIZE + sizeof(TapAudioPacketInfo) * TAP_AUDIO_RING_SIZE) {
+		TAP_PRINT("Error: Tap file is too small!");
+		throw SSRTapException();
+	}
+	m_mmap_size = statinfo.st_size;
+
+	// map the file
+	m_mmap_ptr = mmap(NULL, m_mmap_size, PROT_READ, MAP_SHARED, m_fd, 0);
+	if(m_mmap_ptr == MAP_FAILED) {
+		TAP_PRINT("Error: Can't memory-map tap file!");
+		throw SSRTapException();
+	}
+
+	// check the header
+	// The identifier is written last, so if it is correct, the rest of the header is valid too.
+	TapHeader *header = (TapHeader*) m_mmap_ptr;
+	if(header->identifier != TAP_IDENTIFIER) {
+		TAP_PRINT("Error: Tap file is not ready or has an invalid identifier!");
+		throw SSRTapException();
+	}
+	std::atomic_thread_fence(std::memory_order_acquire);
+	memcpy(&m_header, header, sizeof(TapHeader));
+	if(m_header.version != TAP_VERSION) {
+		TAP_PRINT("Error: Tap file has version " << m_header.version << ", expected " << TAP_VERSION << "!");
+		throw SSRTapException();
+	}
+	if(m_header.video_stride < m_header.video_width * 4 || m_header.video_slot_size < (uint64_t) m_header.video_stride * m_header.video_height ||
+			m_header.audio_slot_size < TAP_AUDIO_PACKET_MAX_SAMPLES * m_header.audio_channels * sizeof(float) ||
+			m_header.video_data_offset + (uint64_t) m_header.video_slot_size * TAP_VIDEO_RING_SIZE > m_mmap_size ||
+			m_header.audio_data_offset + (uint64_t) m_header.audio_slot_size * TAP_AUDIO_RING_SIZE > m_mmap_size) {
+		TAP_PRINT("Error: Tap file has an invalid layout!");
+		throw SSRTapException();
+	}
+
+	// start reading at the current position
+	m_next_video_frame = m_header.video_frame_counter;
+	m_next_audio_packet = m_header.audio_packet_counter;
+
+}
+
+void SSRTapReader::Free() {
+	if(m_mmap_ptr != MAP_FAILED) {
+		munmap(m_mmap_ptr, m_mmap_size);
+		m_mmap_ptr = MAP_FAILED;
+	}
+	if(m_fd != -1) {
+		close(m_fd);
+		m_fd = -1;
+	}
+}
+
+bool SSRTapReader::ReadVideoFrame(uint8_t* data, int64_t* timestamp) {
+
+	// is there a new frame?
+	TapHeader *header = (TapHeader*) m_mmap_ptr;
+	uint32_t counter = header->video_frame_counter;
+	std::atomic_thread_fence(std::memory_order_acquire);
+	if(counter == m_next_video_frame)
+		return false;
+
+	// skip to the newest frame
+	uint32_t frame = counter - 1;
+	m_dropped_video_frames += frame - m_next_video_frame;
+	m_next_video_frame = counter;
+
+	// copy the frame, and check afterwards whether it was overwritten while copying
+	TapVideoFrameInfo *info = GetTapVideoFrameInfo(m_mmap_ptr, frame % TAP_VIDEO_RING_SIZE);
+	uint32_t sequence = info->sequence;
+	std::atomic_thread_fence(std::memory_order_acquire);
+	if((sequence & 1) || info->frame_number != frame) {
+		++m_dropped_video_frames;
+		return false;
+	}
+	*timestamp = info->timestamp;
+	memcpy(data, (char*) m_mmap_ptr + m_header.video_data_offset + (size_t) m_header.video_slot_size * (frame % TAP_VIDEO_RING_SIZE),
+		   (size_t) m_header.video_stride * m_header.video_height);
+	std::atomic_thread_fence(std::memory_order_acquire);
+	if(info->sequence != sequence) {
+		++m_dropped_video_frames;
+		return false;
+	}
+
+	return true;
+}
+
+bool SSRTapReader::ReadAudioPacket(float* data, unsigned int* sample_rate, unsigned int* sample_count, int64_t* timestamp) {
+
+	// is there a new packet?
+	TapHeader *header = (TapHeader*) m_mmap_ptr;
+	uint32_t counter = header->audio_packet_counter;
+	std::atomic_thread_fence(std::memory_order_acquire);
+	if(counter == m_next_audio_packet)
+		return false;
+
+	// if we fell behind, skip ahead to the middle of the ring buffer so we don't race with the writer again immediately
+	if(counter - m_next_audio_packet > TAP_AUDIO_RING_SIZE / 2) {
+		uint32_t skip = counter - m_next_audio_packet - TAP_AUDIO_RING_SIZE / 2;
+		m_dropped_audio_packets += skip;
+		m_next_audio_packet += skip;
+	}
+	uint32_t packet = m_next_audio_packet++;
+
+	// copy the packet, and check afterwards whether it was overwritten while copying
+	TapAudioPacketInfo *info = GetTapAudioPacketInfo(m_mmap_ptr, packet % TAP_AUDIO_RING_SIZE);
+	uint32_t sequence = info->sequence;
+	std::atomic_thread_fence(std::memory_order_acquire);
+	if((sequence & 1) || info->packet_number != packet || info->sample_count > TAP_AUDIO_PACKET_MAX_SAMPLES) {
+		++m_dropped_audio_packets;
+		return false;
+	}
+	*sample_rate = info->sample_rate;
+	*sample_count = info->sample_count;
+	*timestamp = info->timestamp;
+	memcpy(data, (char*) m_mmap_ptr + m_header.audio_data_offset + (size_t) m_header.audio_slot_size * (packet % TAP_AUDIO_RING_SIZE),
+		   (size_t) *sample_count * m_header.audio_channels * sizeof(float));
+	std::atomic_thread_fence(std::memory_order_acquire);
+	if(info->sequence != sequence) {
+		++m_dropped_audio_packets;
+		return false;
+	}
+
+	return true;
+}
+
+bool SSRTapReader::IsWriterAlive() {
+	return (kill(m_header.writer_pid, 0) == 0 || errno == EPERM);
+}
@@ -0,0 +1,70 @@
+/*
+Copyright (c) 2012-2020 Maarten Baert <maarten-baert@hotmail.com>
+
+Permission to use, copy, modify, and/or distribute this software for any purpose with or without fee is hereby granted, provided that the above copyright notice and this permission notice appear in all copies.
+
+THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+*/
+
+#pragma once
+
+#include <stdint.h>
+
+#include <exception>
+#include <string>
+
+#include "TapStructs.h"
+
+class SSRTapException : public std::exception {
+public:
+	inline virtual const char* what() const throw() override {
+		return "SSRTapException";
+	}
+};
+
+// Reads video frames and audio packets from the shared memory tap of SimpleScreenRecorder (see TapStructs.h).
+// The reader never blocks the writer. If the reader is too slow, frames and packets are dropped and counted.
+// This class is not thread-safe, but any number of readers (in the same or different processes) can read from the same tap.
+class SSRTapReader {
+
+private:
+	std::string m_filename;
+
+	int m_fd;
+	void *m_mmap_ptr;
+	size_t m_mmap_size;
+
+	TapHeader m_header;
+	uint32_t m_next_video_frame, m_next_audio_packet;
+	uint64_t m_dropped_video_frames, m_dropped_audio_packets;
+
+public:
+	// Opens the tap file. Throws SSRTapException if the file doesn't exist or isn't valid (yet).
+	SSRTapReader(const std::string& filename);
+	~SSRTapReader();
+
+	// Copies the newest video frame that hasn't been read yet to 'data', which should be at least GetVideoStride() * GetVideoHeight() bytes.
+	// Older unread frames are skipped (and counted as dropped). Returns false if there is no new frame.
+	bool ReadVideoFrame(uint8_t* data, int64_t* timestamp);
+
+	// Copies the next audio packet to 'data', which should be at least TAP_AUDIO_PACKET_MAX_SAMPLES * GetAudioChannels() floats.
+	// Packets are returned in order unless the reader falls behind, then the oldest packets are dropped. Returns false if there is no new packet.
+	bool ReadAudioPacket(float* data, unsigned int* sample_rate, unsigned int* sample_count, int64_t* timestamp);
+
+	// Returns whether the process that created the tap is still running.
+	bool IsWriterAlive();
+
+private:
+	void Init();
+	void Free();
+
+public:
+	inline unsigned int GetVideoWidth() { return m_header.video_width; }
+	inline unsigned int GetVideoHeight() { return m_header.video_height; }
+	inline unsigned int GetVideoStride() { return m_header.video_stride; }
+	inline unsigned int GetVideoFrameRate() { return m_header.video_frame_rate; }
+	inline unsigned int GetAudioChannels() { return m_header.audio_channels; }
+	inline uint64_t GetDroppedVideoFrames() { return m_dropped_video_frames; }
+	inline uint64_t GetDroppedAudioPackets() { return m_dropped_audio_packets; }
+
+};
@@ -0,0 +1,109 @@
+/*
+Copyright (c) 2012-2020 Maarten Baert <maarten-baert@hotmail.com>
+
+Permission to use, copy, modify, and/or distribute this software for any purpose with or without fee is hereby granted, provided that the above copyright notice and this permission notice appear in all copies.
+
+THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+*/
+
+#pragma once
+
+#include <stdint.h>
+
+/*
+SimpleScreenRecorder can republish the video frames and audio samples that it records to other local processes (the 'tap'), using a shared memory
+file (i.e. a file in /dev/shm). This is the same idea as the GLInject stream (see glinject/ShmStructs.h), except that SimpleScreenRecorder is the writer
+and other processes are the readers. The frames are already converted to BGRA and scaled to the output size, so readers don't need to decode anything.
+
+>>>> /dev/shm/simplescreenrecorder-tap-PID <<<<
+> PID is the process ID of SimpleScreenRecorder (the name can be changed with the --tapfile option).
+> This file contains a TapHeader struct, followed by TAP_VIDEO_RING_SIZE TapVideoFrameInfo structs, followed by TAP_AUDIO_RING_SIZE TapAudioPacketInfo
+> structs. The video and audio data is stored at the offsets given in the header, each slot has a fixed size. The file size never changes.
+
+The system is lock-free and supports any number of readers. The writer never waits for the readers: each slot has a sequence number that is odd while
+the slot is being written (i.e. a seqlock). A reader copies the slot and then checks whether the sequence number has changed, if it has then the reader
+was too slow and the frame is dropped. Readers only ever read the file, so a reader that crashes or stops reading can't affect the recording.
+
+The writer updates a slot as follows:
+- Increment the sequence number (it is now odd), followed by a release fence.
+- Write the info and data.
+- Release fence, followed by incrementing the sequence number (it is now even).
+- Release fence, followed by incrementing the frame or packet counter in the header.
+
+*/
+
+// Disable padding to make sure the 32-bit and 64-bit libs are compatible.
+#pragma pack(push, 1)
+
+#define TAP_VIDEO_RING_SIZE 4
+#define TAP_AUDIO_RING_SIZE 16
+
+// maximum number of samples per audio packet, larger packets are split
+#define TAP_AUDIO_PACKET_MAX_SAMPLES 4096
+
+#define TAP_IDENTIFIER 0x3c7a9d15
+#define TAP_VERSION 1
+
+struct TapHeader {
+
+	// identifier and version, the identifier is written last so readers can detect files that are not ready yet
+	uint32_t identifier;
+	uint32_t version;
+	uint32_t writer_pid;
+
+	// video format: always BGRA, the size is fixed for the lifetime of the file
+	uint32_t video_width, video_height;
+	uint32_t video_stride;
+	uint32_t video_frame_rate;
+	uint32_t video_slot_size;
+	uint64_t video_data_offset;
+
+	// audio format: always interleaved 32-bit float, the sample rate is stored per packet
+	uint32_t audio_channels;
+	uint32_t audio_slot_size;
+	uint64_t audio_data_offset;
+
+	// counters: the number of frames or packets written so far, the last one is stored in slot (counter - 1) % RING_SIZE
+	uint32_t video_frame_counter;
+	uint32_t audio_packet_counter;
+
+};
+
+struct TapVideoFrameInfo {
+
+	// seqlock sequence number (odd while the slot is being written)
+	uint32_t sequence;
+
+	// the value of video_frame_counter before this frame was written
+	uint32_t frame_number;
+
+	// timestamp (microseconds, CLOCK_MONOTONIC)
+	int64_t timestamp;
+
+};
+
+struct TapAudioPacketInfo {
+
+	// seqlock sequence number (odd while the slot is being written)
+	uint32_t sequence;
+
+	// the value of audio_packet_counter before this packet was written
+	uint32_t packet_number;
+
+	// timestamp of the first sample (microseconds, CLOCK_MONOTONIC)
+	int64_t timestamp;
+
+	// audio packet info
+	uint32_t sample_rate;
+	uint32_t sample_count;
+
+};
+
+#pragma pack(pop)
+
+inline TapVideoFrameInfo* GetTapVideoFrameInfo(void* base, unsigned int slot) {
+	return (TapVideoFrameInfo*) ((char*) base + sizeof(TapHeader) + sizeof(TapVideoFrameInfo) * slot);
+}
+inline TapAudioPacketInfo* GetTapAudioPacketInfo(void* base, unsigned int slot) {
+	return (TapAudioPacketInfo*) ((char*) base + sizeof(TapHeader) + sizeof(TapVideoFrameInfo) * TAP_VIDEO_RING_SIZE + sizeof(TapAudioPacketInfo) * slot);
+}
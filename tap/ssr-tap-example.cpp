@@ -0,0 +1,117 @@
+/*
+Copyright (c) 2012-2020 Maarten Baert <maarten-baert@hotmail.com>
+
+Permission to use, copy, modify, and/or distribute this software for any purpose with or without fee is hereby granted, provided that the above copyright notice and this permission notice appear in all copies.
+
+THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+*/
+
+// Example client for the SimpleScreenRecorder tap. It prints some statistics about the video and audio stream every second,
+// and can optionally save the first video frame as a PPM file.
+// Usage: ssr-tap-example TAPFILE [SNAPSHOT.ppm]
+
+#include "SSRTapReader.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <iostream>
+#include <vector>
+
+#include <time.h>
+#include <unistd.h>
+
+static int64_t hrt_time_micro() {
+	timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (uint64_t) ts.tv_sec * (uint64_t) 1000000 + (uint64_t) (ts.tv_nsec / 1000);
+}
+
+static bool WritePPM(const std::string& filename, const uint8_t* data, unsigned int width, unsigned int height, unsigned int stride) {
+	FILE *f = fopen(filename.c_str(), "wb");
+	if(f == NULL)
+		return false;
+	fprintf(f, "P6\n%u %u\n255\n", width, height);
+	std::vector<uint8_t> row(width * 3);
+	for(unsigned int y = 0; y < height; ++y) {
+		const uint8_t *in = data + (size_t) stride * y;
+		for(unsigned int x = 0; x < width; ++x) {
+			row[x * 3 + 0] = in[x * 4 + 2];
+			row[x * 3 + 1] = in[x * 4 + 1];
+			row[x * 3 + 2] = in[x * 4 + 0];
+		}
+		fwrite(row.data(), 1, row.size(), f);
+	}
+	return (fclose(f) == 0);
+}
+
+int main(int argc, char* argv[]) {
+
+	if(argc < 2 || argc > 3) {
+		std::cerr << "Usage: " << argv[0] << " TAPFILE [SNAPSHOT.ppm]" << std::endl;
+		return 1;
+	}
+	std::string snapshot_file = (argc == 3)? argv[2] : "";
+
+	try {
+
+		SSRTapReader reader(argv[1]);
+		std::cout << "Video: " << reader.GetVideoWidth() << "x" << reader.GetVideoHeight() << " @ " << reader.GetVideoFrameRate() << " fps, "
+				  << "audio: " << reader.GetAudioChannels() << " channels" << std::endl;
+
+		std::vector<uint8_t> video_data((size_t) reader.GetVideoStride() * reader.GetVideoHeight());
+		std::vector<float> audio_data(TAP_AUDIO_PACKET_MAX_SAMPLES * std::max(1u, reader.GetAudioChannels()));
+
+		unsigned int video_frames = 0, audio_samples = 0, sample_rate = 0;
+		float audio_peak = 0.0f;
+		int64_t video_latency = 0;
+		int64_t next_report = hrt_time_micro() + 1000000;
+		while(reader.IsWriterAlive()) {
+
+			// read everything that's available
+			bool idle = true;
+			int64_t timestamp;
+			if(reader.ReadVideoFrame(video_data.data(), &timestamp)) {
+				idle = false;
+				++video_frames;
+				video_latency = hrt_time_micro() - timestamp;
+				if(!snapshot_file.empty()) {
+					if(WritePPM(snapshot_file, video_data.data(), reader.GetVideoWidth(), reader.GetVideoHeight(), reader.GetVideoStride()))
+						std::cout << "Saved snapshot to '" << snapshot_file << "'." << std::endl;
+					else
+						std::cerr << "Error: Can't write snapshot to '" << snapshot_file << "'!" << std::endl;
+					snapshot_file.clear();
+				}
+			}
+			unsigned int sample_count;
+			while(reader.ReadAudioPacket(audio_data.data(), &sample_rate, &sample_count, &timestamp)) {
+				idle = false;
+				audio_samples += sample_count;
+				for(size_t i = 0; i < (size_t) sample_count * reader.GetAudioChannels(); ++i) {
+					audio_peak = std::max(audio_peak, std::fabs(audio_data[i]));
+				}
+			}
+
+			// print statistics
+			int64_t now = hrt_time_micro();
+			if(now >= next_report) {
+				std::cout << "Video: " << video_frames << " fps, latency " << video_latency / 1000 << " ms, dropped " << reader.GetDroppedVideoFrames()
+						  << " | Audio: " << audio_samples << " samples @ " << sample_rate << " Hz, peak " << audio_peak << ", dropped " << reader.GetDroppedAudioPackets() << std::endl;
+				video_frames = 0;
+				audio_samples = 0;
+				audio_peak = 0.0f;
+				next_report = std::max(next_report + 1000000, now);
+			}
+
+			if(idle)
+				usleep(2000);
+
+		}
+		std::cout << "The recorder has stopped." << std::endl;
+
+	} catch(const SSRTapException&) {
+		return 1;
+	}
+
+	return 0;
+}